@@ -1,6 +1,9 @@
 #ifndef mtotsa_stbimage_h
 #define mtotsa_stbimage_h
 
+/* Images are always decoded to 8-bit RGBA.
+ * The returned data is allocated with malloc, so it may be
+ * released with either 'mtotsa_free_image_data' or 'free' */
 int mtotsa_load_image_from_memory(
   const unsigned char *buffer,
   int len,
@@ -14,6 +17,17 @@ int mtotsa_load_image_from_file(
   int *width,
   int *height);
 
+/* Like 'mtotsa_load_image_from_memory', but instead of calling
+ * 'runtimeError', sets '*error' to a static description of the failure.
+ * Safe to call from any thread */
+int mtotsa_decode_image(
+  const unsigned char *buffer,
+  int len,
+  unsigned char **data,
+  int *width,
+  int *height,
+  const char **error);
+
 void mtotsa_free_image_data(unsigned char *data);
 
 #endif/*mtotsa_stbimage_h*/
@@ -48,6 +48,23 @@ int mtotsa_load_image_from_file(
   return 1;
 }
 
+/* stb_image keeps its failure reason in a thread local variable,
+ * so this does not race with decodes on other threads */
+int mtotsa_decode_image(
+    const unsigned char *buffer,
+    int len,
+    unsigned char **data,
+    int *width,
+    int *height,
+    const char **error) {
+  *data = stbi_load_from_memory(buffer, len, width, height, NULL, 4);
+  if (!*data) {
+    *error = stbi_failure_reason();
+    return 0;
+  }
+  return 1;
+}
+
 void mtotsa_free_image_data(unsigned char *data) {
   stbi_image_free(data);
 }
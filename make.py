@@ -99,6 +99,74 @@ MACOS_LODEPNG_FLAGS = [
     os.path.join("lib", "lodepng", "src", "lodepng.c"),
 ]
 
+MACOS_DR_MP3_FLAGS = [
+    "-DMTOTS_ENABLE_DR_MP3=1",
+    "-I" + os.path.join("lib", "dr_mp3", "include"),
+]
+
+MACOS_MINIZ_FLAGS = [
+    "-DMTOTS_ENABLE_MINIZ=1",
+    "-I" + os.path.join("lib", "miniz", "src"),
+    os.path.join("lib", "miniz", "src", "miniz.c"),
+]
+
+# stb_image is not C89, so its adapter is compiled
+# separately (see 'compile_stbimage') and linked in as an object
+STBIMAGE_OBJECT = os.path.join("lib", "stbimage", "mtotsa_stbimage.o")
+
+MACOS_STBIMAGE_FLAGS = [
+    "-DMTOTS_ENABLE_STBIMAGE=1",
+    "-I" + os.path.join("lib", "stbimage", "include"),
+    STBIMAGE_OBJECT,
+]
+
+# FreeType is built from its own sources (with FT2_BUILD_LIBRARY) into
+# objects next to them (see 'compile_freetype')
+FREETYPE_DIR = os.path.join("lib", "freetype")
+
+FREETYPE_SOURCES = [
+    os.path.join("src", *path.split("/"))
+    for path in [
+        "base/ftsystem.c",
+        "base/ftinit.c",
+        "base/ftdebug.c",
+        "base/ftbase.c",
+        "base/ftbbox.c",
+        "base/ftglyph.c",
+        "base/ftbitmap.c",
+        "base/ftmm.c",
+        "autofit/autofit.c",
+        "truetype/truetype.c",
+        "type1/type1.c",
+        "cff/cff.c",
+        "cid/type1cid.c",
+        "pfr/pfr.c",
+        "type42/type42.c",
+        "winfonts/winfnt.c",
+        "pcf/pcf.c",
+        "bdf/bdf.c",
+        "psaux/psaux.c",
+        "psnames/psnames.c",
+        "pshinter/pshinter.c",
+        "sfnt/sfnt.c",
+        "smooth/smooth.c",
+        "raster/raster.c",
+        "sdf/sdf.c",
+        "gzip/ftgzip.c",
+        "lzw/ftlzw.c",
+    ]
+]
+
+FREETYPE_OBJECTS = [
+    os.path.join(FREETYPE_DIR, source[: -len(".c")] + ".o") for source in FREETYPE_SOURCES
+]
+
+MACOS_FREETYPE_FLAGS = [
+    "-DMTOTS_ENABLE_FREETYPE=1",
+    "-I" + os.path.join(FREETYPE_DIR, "include"),
+    *FREETYPE_OBJECTS,
+]
+
 aparser = argparse.ArgumentParser()
 aparser.add_argument("--verbose", "-v", default=False, action="store_true")
 aparser.add_argument("--release", "-r", default=False, action="store_true")
@@ -110,6 +178,30 @@ aparser.add_argument(
     action="store_true",
     help="Build with lodepng support",
 )
+aparser.add_argument(
+    "--enable-stbimage",
+    default=False,
+    action="store_true",
+    help="Build with stb_image support",
+)
+aparser.add_argument(
+    "--enable-dr-mp3",
+    default=False,
+    action="store_true",
+    help="Build with dr_mp3 (MP3 decoding) support",
+)
+aparser.add_argument(
+    "--enable-miniz",
+    default=False,
+    action="store_true",
+    help="Build with miniz (zip) support",
+)
+aparser.add_argument(
+    "--enable-freetype",
+    default=False,
+    action="store_true",
+    help="Build with FreeType (media.font) support",
+)
 aparser.add_argument(
     "--enable-sdl",
     default=False,
@@ -124,6 +216,10 @@ COMPILE: bool = args.compile
 TEST: bool = args.test
 ENABLE_SDL: bool = args.enable_sdl
 ENABLE_LODEPNG: bool = args.enable_lodepng
+ENABLE_STBIMAGE: bool = args.enable_stbimage
+ENABLE_MINIZ: bool = args.enable_miniz
+ENABLE_DR_MP3: bool = args.enable_dr_mp3
+ENABLE_FREETYPE: bool = args.enable_freetype
 
 
 def c_sources() -> typing.List[str]:
@@ -134,6 +230,42 @@ def c_sources() -> typing.List[str]:
     return srcs
 
 
+def compile_stbimage(release: bool):
+    """
+    Compile the stb_image adapter into `STBIMAGE_OBJECT`
+    """
+    subprocess.run(
+        [
+            "gcc",
+            "-c",
+            "-O3" if release else "-O1",
+            "-I" + os.path.join("lib", "stbimage", "include"),
+            os.path.join("lib", "stbimage", "src", "mtotsa_stbimage.c"),
+            "-o" + STBIMAGE_OBJECT,
+        ],
+        check=True,
+    )
+
+
+def compile_freetype(release: bool):
+    """
+    Compile the FreeType sources into `FREETYPE_OBJECTS`
+    """
+    for source, obj in zip(FREETYPE_SOURCES, FREETYPE_OBJECTS):
+        subprocess.run(
+            [
+                "gcc",
+                "-c",
+                "-O3" if release else "-O1",
+                "-DFT2_BUILD_LIBRARY",
+                "-I" + os.path.join(FREETYPE_DIR, "include"),
+                os.path.join(FREETYPE_DIR, source),
+                "-o" + obj,
+            ],
+            check=True,
+        )
+
+
 def compile(release: bool):
     """
     Compile Mtots for the current platform and produces the binary at `mtots`
@@ -154,6 +286,10 @@ def compile(release: bool):
             ]
         )
     elif SYSTEM == SYSTEM_MACOS:
+        if ENABLE_STBIMAGE:
+            compile_stbimage(release)
+        if ENABLE_FREETYPE:
+            compile_freetype(release)
         args.extend(
             [
                 # using 'gcc' to access clang adds additional
@@ -163,6 +299,10 @@ def compile(release: bool):
                 *(MACOS_RELEASE_FLAGS if release else MACOS_DEBUG_FLAGS),
                 *(MACOS_SDL_FLAGS if ENABLE_SDL else []),
                 *(MACOS_LODEPNG_FLAGS if ENABLE_LODEPNG else []),
+                *(MACOS_STBIMAGE_FLAGS if ENABLE_STBIMAGE else []),
+                *(MACOS_MINIZ_FLAGS if ENABLE_MINIZ else []),
+                *(MACOS_DR_MP3_FLAGS if ENABLE_DR_MP3 else []),
+                *(MACOS_FREETYPE_FLAGS if ENABLE_FREETYPE else []),
                 *c_sources(),
                 "-omtots",
             ]
@@ -180,6 +320,11 @@ def compile(release: bool):
     subprocess.run(args, check=True)
 
 
+# A test script that exits with this code (as automake does) is reported
+# as skipped rather than failed, unless its .exit.txt expects it
+SKIP_EXIT_CODE = 77
+
+
 def test():
     """
     Test the `mtots` binary
@@ -195,7 +340,7 @@ def test():
     dirnames = sorted(os.listdir(testDir))
 
     testSetCount = len(dirnames)
-    testCount = passCount = 0
+    testCount = passCount = skipCount = 0
 
     print("TESTING mtots")
     print(f"  Found {testSetCount} test set(s)")
@@ -257,7 +402,11 @@ def test():
                 cwd=REPO_DIR,
             )
 
-            if expectExit is not None and proc.returncode != expectExit:
+            if proc.returncode == SKIP_EXIT_CODE and expectExit != SKIP_EXIT_CODE:
+                # e.g. the test needs a module this build was not configured with
+                skipCount += 1
+                print(f"SKIPPED {proc.stdout.strip()}")
+            elif expectExit is not None and proc.returncode != expectExit:
                 print(ansiRed)
                 print("FAILED (exit code)")
                 print("##### Expected #####")
@@ -302,14 +451,16 @@ def test():
                 print(f"{ansiGreen}OK{ansiReset}")
             testCount += 1
 
-    if passCount == testCount:
+    if skipCount:
+        print(f"  {skipCount} test(s) skipped")
+    if passCount + skipCount == testCount:
         print("  ALL TESTS PASS")
     else:
         print(f"  Some tests {ansiRed}failed{ansiReset}:")
-        print(f"    {passCount} / {testCount}")
-        print(f"    {testCount - passCount} test(s) failed")
+        print(f"    {passCount} / {testCount - skipCount}")
+        print(f"    {testCount - passCount - skipCount} test(s) failed")
 
-    exit(0 if passCount == testCount else 1)
+    exit(0 if passCount + skipCount == testCount else 1)
 
 
 if __name__ == "__main__":
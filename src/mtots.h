@@ -44,6 +44,33 @@ Status callFunction(i16 argCount);
  */
 Status callMethod(String *methodName, i16 argCount);
 
+/* Continuation based calls from C
+ *
+ * callFunction and callMethod run the called function in a nested
+ * interpreter loop on the C stack. A CFunction that needs to call back
+ * into the VM can instead ask the VM's active loop to make the call:
+ *
+ *   1. push any state the CFunction needs to keep between calls,
+ *   2. push the function and its arguments (as with callFunction),
+ *   3. return scheduleCall(argCount, &continuation).
+ *
+ * When the call returns, the function and its arguments are popped, and
+ * 'resume' is called with the CFunction's original argc and argv and the
+ * call's return value. The state pushed in step 1 is still at the top
+ * of the stack. 'resume' may schedule another call in the same way, or
+ * set '*out' and return, which completes the original CFunction call.
+ *
+ * If the scheduled call fails and 'recover' is not NULL, the stack is
+ * unwound to where it was right after step 1 and 'recover' is called
+ * instead of 'resume'. If 'recover' is NULL, the error propagates.
+ */
+typedef struct NativeContinuation {
+  Status (*resume)(i16 argc, Value *argv, Value result, Value *out);
+  Status (*recover)(i16 argc, Value *argv, Value *out);
+} NativeContinuation;
+
+Status scheduleCall(i16 argCount, NativeContinuation *continuation);
+
 /*
  * Native module bodies should be a CFunction that accepts
  * Exactly one argument, the module
@@ -0,0 +1,270 @@
+#include "mtots_archive.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtots_util_error.h"
+
+#if MTOTS_ENABLE_MINIZ
+#include "miniz.h"
+#include "mtots_m_data.h"
+
+typedef struct ArchiveEntry {
+  const char *name; /* points into Archive.names */
+  u32 hash;
+  mz_uint fileIndex;
+  u8 *data; /* the inflated contents, once read by archiveGetResource */
+  size_t length;
+  struct ArchiveEntry *next;
+} ArchiveEntry;
+
+struct Archive {
+  char *path;
+  mz_zip_archive zip;
+  DataSourceView view;
+  char *names;
+  ArchiveEntry *entries;
+  ArchiveEntry **buckets;
+  size_t bucketCount; /* a power of 2 */
+  Archive *next;
+};
+
+/* Every archive opened so far. Archives are never closed */
+static Archive *archives;
+
+static u32 hashName(const char *name) {
+  /* FNV-1a */
+  u32 hash = 2166136261u;
+  for (; *name; name++) {
+    hash ^= (u8)*name;
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+static void *allocate(size_t size) {
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr) {
+    panic("out of memory");
+  }
+  return ptr;
+}
+
+/* Builds the name -> entry table from the central directory.
+ * Directories are left out since they cannot be read */
+static void indexArchive(Archive *archive) {
+  mz_uint i, fileCount = mz_zip_reader_get_num_files(&archive->zip);
+  size_t namesSize = 0, entryCount = 0;
+  char *name;
+
+  for (i = 0; i < fileCount; i++) {
+    namesSize += mz_zip_reader_get_filename(&archive->zip, i, NULL, 0);
+  }
+  archive->names = name = (char *)allocate(namesSize);
+  archive->entries = (ArchiveEntry *)allocate(sizeof(ArchiveEntry) * fileCount);
+  for (archive->bucketCount = 16; archive->bucketCount < fileCount;) {
+    archive->bucketCount *= 2;
+  }
+  archive->buckets = (ArchiveEntry **)calloc(archive->bucketCount, sizeof(ArchiveEntry *));
+  if (!archive->buckets) {
+    panic("out of memory");
+  }
+
+  for (i = 0; i < fileCount; i++) {
+    ArchiveEntry *entry, **bucket;
+    char *entryName = name;
+    mz_uint size = mz_zip_reader_get_filename(&archive->zip, i, name, (mz_uint)namesSize);
+    name += size;
+    namesSize -= size;
+    if (size == 0 || mz_zip_reader_is_file_a_directory(&archive->zip, i)) {
+      continue;
+    }
+    entry = &archive->entries[entryCount++];
+    entry->name = entryName;
+    entry->hash = hashName(entryName);
+    entry->fileIndex = i;
+    entry->data = NULL;
+    entry->length = 0;
+
+    /* Entries are pushed onto the end of each chain, so that the
+     * first of several entries with the same name is the one found */
+    bucket = &archive->buckets[entry->hash & (archive->bucketCount - 1)];
+    while (*bucket) {
+      bucket = &(*bucket)->next;
+    }
+    entry->next = NULL;
+    *bucket = entry;
+  }
+}
+
+static ArchiveEntry *findEntry(Archive *archive, const char *name) {
+  u32 hash = hashName(name);
+  ArchiveEntry *entry = archive->buckets[hash & (archive->bucketCount - 1)];
+  for (; entry; entry = entry->next) {
+    if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+static ArchiveEntry *getEntry(Archive *archive, const char *name) {
+  ArchiveEntry *entry = findEntry(archive, name);
+  if (!entry) {
+    runtimeError("%s: no entry named %s", archive->path, name);
+  }
+  return entry;
+}
+
+/* Inflates the entry into a new malloc'd block with a '\0' after it */
+static Status inflateEntry(Archive *archive, ArchiveEntry *entry, u8 **out, size_t *length) {
+  mz_zip_archive_file_stat stat;
+  u8 *data;
+  if (!mz_zip_reader_file_stat(&archive->zip, entry->fileIndex, &stat)) {
+    goto error;
+  }
+  if (stat.m_uncomp_size >= (mz_uint64)(size_t)-1) {
+    runtimeError("%s: %s is too large", archive->path, entry->name);
+    return STATUS_ERROR;
+  }
+  data = (u8 *)allocate((size_t)stat.m_uncomp_size + 1);
+  if (!mz_zip_reader_extract_to_mem(
+          &archive->zip, entry->fileIndex, data, (size_t)stat.m_uncomp_size, 0)) {
+    free(data);
+    goto error;
+  }
+  data[stat.m_uncomp_size] = '\0';
+  *out = data;
+  *length = (size_t)stat.m_uncomp_size;
+  return STATUS_OK;
+
+error:
+  runtimeError(
+      "%s: %s: %s", archive->path, entry->name,
+      mz_zip_get_error_string(mz_zip_get_last_error(&archive->zip)));
+  return STATUS_ERROR;
+}
+
+Archive *openArchive(const char *path) {
+  Archive *archive;
+  mz_bool ok;
+
+  for (archive = archives; archive; archive = archive->next) {
+    if (strcmp(archive->path, path) == 0) {
+      return archive;
+    }
+  }
+
+  archive = (Archive *)allocate(sizeof(Archive));
+  mz_zip_zero_struct(&archive->zip);
+
+  /* Map the archive if possible, so that only the pages of the
+   * central directory and of the entries actually read are loaded */
+  if (!openMappedFileView(path, &archive->view)) {
+    free(archive);
+    return NULL;
+  }
+  if (archive->view.mapped) {
+    ok = mz_zip_reader_init_mem(
+        &archive->zip, archive->view.data, archive->view.length,
+        MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY);
+  } else {
+    ok = mz_zip_reader_init_file(
+        &archive->zip, path, MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY);
+  }
+  if (!ok) {
+    runtimeError(
+        "%s: %s", path, mz_zip_get_error_string(mz_zip_get_last_error(&archive->zip)));
+    dataSourceCloseView(&archive->view);
+    free(archive);
+    return NULL;
+  }
+
+  archive->path = (char *)allocate(strlen(path) + 1);
+  strcpy(archive->path, path);
+  indexArchive(archive);
+  archive->next = archives;
+  archives = archive;
+  return archive;
+}
+
+ubool archiveHasEntry(Archive *archive, const char *name) {
+  return findEntry(archive, name) != NULL;
+}
+
+Status archiveExtract(Archive *archive, const char *name, char **out, size_t *length) {
+  ArchiveEntry *entry = getEntry(archive, name);
+  if (!entry) {
+    return STATUS_ERROR;
+  }
+  if (entry->data) {
+    *out = (char *)allocate(entry->length + 1);
+    memcpy(*out, entry->data, entry->length + 1);
+    *length = entry->length;
+    return STATUS_OK;
+  }
+  return inflateEntry(archive, entry, (u8 **)out, length);
+}
+
+Status archiveGetResource(
+    Archive *archive, const char *name, const u8 **out, size_t *length) {
+  ArchiveEntry *entry = getEntry(archive, name);
+  if (!entry) {
+    return STATUS_ERROR;
+  }
+  if (!entry->data && !inflateEntry(archive, entry, &entry->data, &entry->length)) {
+    return STATUS_ERROR;
+  }
+  *out = entry->data;
+  *length = entry->length;
+  return STATUS_OK;
+}
+
+#else
+struct Archive {
+  int unused;
+};
+
+Archive *openArchive(const char *path) {
+  runtimeError("%s: mtots was built without zip archive support", path);
+  return NULL;
+}
+
+ubool archiveHasEntry(Archive *archive, const char *name) {
+  return UFALSE;
+}
+
+Status archiveExtract(Archive *archive, const char *name, char **out, size_t *length) {
+  return runtimeError("mtots was built without zip archive support");
+}
+
+Status archiveGetResource(
+    Archive *archive, const char *name, const u8 **out, size_t *length) {
+  return runtimeError("mtots was built without zip archive support");
+}
+#endif
+
+ubool isArchivePath(const char *path, size_t length) {
+  size_t extensionLength = strlen(ARCHIVE_FILE_EXTENSION);
+  return length > extensionLength &&
+         memcmp(path + length - extensionLength, ARCHIVE_FILE_EXTENSION, extensionLength) == 0;
+}
+
+ubool findArchiveForPath(const char *path, Archive **out, const char **entryName) {
+  const char *sep;
+  for (sep = strchr(path, '/'); sep; sep = strchr(sep + 1, '/')) {
+    if (isArchivePath(path, sep - path)) {
+      char *archivePath = (char *)malloc(sep - path + 1);
+      if (!archivePath) {
+        panic("out of memory");
+      }
+      memcpy(archivePath, path, sep - path);
+      archivePath[sep - path] = '\0';
+      *out = openArchive(archivePath);
+      *entryName = sep + 1;
+      free(archivePath);
+      return UTRUE;
+    }
+  }
+  return UFALSE;
+}
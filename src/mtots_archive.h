@@ -0,0 +1,53 @@
+#ifndef mtots_archive_h
+#define mtots_archive_h
+
+#include "mtots_common.h"
+
+/*
+ * Zip archives of mtots modules and resources.
+ *
+ * A path like "app.zip/foo/bar.mtots" refers to the entry "foo/bar.mtots"
+ * inside the archive "app.zip". Such paths can be used as module roots
+ * (the main script or an entry of $MTOTSPATH may be an archive) and are
+ * what modules imported from an archive see as their `__file__`.
+ *
+ * Each archive is opened once per process. Its central directory is read
+ * into a hash table of entry names when it is opened, and entries are
+ * only inflated when they are read.
+ *
+ * Reading archives requires miniz (MTOTS_ENABLE_MINIZ). Without it,
+ * opening an archive always fails.
+ */
+
+#define ARCHIVE_FILE_EXTENSION ".zip"
+
+typedef struct Archive Archive;
+
+/* Checks whether the first 'length' bytes of 'path' name an archive */
+ubool isArchivePath(const char *path, size_t length);
+
+/* Returns the archive at the given path, opening it if this is the first
+ * time it has been asked for. Returns NULL and sets the error string if
+ * the archive cannot be opened */
+Archive *openArchive(const char *path);
+
+/* If 'path' refers to an entry in an archive, opens the archive and
+ * sets '*entryName' to the part of 'path' that names the entry.
+ *
+ * Returns UFALSE without touching the error string if 'path' does not
+ * refer into an archive. If it does but the archive cannot be opened,
+ * returns UTRUE with '*out' set to NULL and the error string set */
+ubool findArchiveForPath(const char *path, Archive **out, const char **entryName);
+
+ubool archiveHasEntry(Archive *archive, const char *name);
+
+/* Inflates the given entry into a newly malloc'd block that the caller
+ * must free. A '\0' is stored after the last byte */
+Status archiveExtract(Archive *archive, const char *name, char **out, size_t *length);
+
+/* Returns the contents of the given entry. The entry is inflated the
+ * first time it is read and kept for the life of the process */
+Status archiveGetResource(
+    Archive *archive, const char *name, const u8 **out, size_t *length);
+
+#endif /*mtots_archive_h*/
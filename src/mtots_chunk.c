@@ -6,32 +6,67 @@ void initChunk(Chunk *chunk) {
   chunk->count = 0;
   chunk->capacity = 0;
   chunk->code = NULL;
-  chunk->lines = NULL;
+  chunk->lineRunCount = 0;
+  chunk->lineRunCapacity = 0;
+  chunk->lineRuns = NULL;
   initValueArray(&chunk->constants);
 }
 
 void freeChunk(Chunk *chunk) {
   FREE_ARRAY(u8, chunk->code, chunk->capacity);
-  FREE_ARRAY(i16, chunk->lines, chunk->capacity);
+  FREE_ARRAY(LineRun, chunk->lineRuns, chunk->lineRunCapacity);
   freeValueArray(&chunk->constants);
   initChunk(chunk);
 }
 
-void writeChunk(Chunk *chunk, u8 byte, i16 line) {
+static void addLineRun(Chunk *chunk, u32 line) {
+  if (chunk->lineRunCapacity < chunk->lineRunCount + 1) {
+    i32 oldCapacity = chunk->lineRunCapacity;
+    chunk->lineRunCapacity = GROW_CAPACITY(oldCapacity);
+    chunk->lineRuns = GROW_ARRAY(
+        LineRun, chunk->lineRuns, oldCapacity, chunk->lineRunCapacity);
+  }
+  chunk->lineRuns[chunk->lineRunCount].offset = (u32)chunk->count;
+  chunk->lineRuns[chunk->lineRunCount].line = line;
+  chunk->lineRunCount++;
+}
+
+void writeChunk(Chunk *chunk, u8 byte, u32 line) {
   if (chunk->capacity < chunk->count + 1) {
     i32 oldCapacity = chunk->capacity;
     chunk->capacity = GROW_CAPACITY(oldCapacity);
     chunk->code = GROW_ARRAY(
         u8, chunk->code, oldCapacity, chunk->capacity);
-    chunk->lines = GROW_ARRAY(
-        i16, chunk->lines, oldCapacity, chunk->capacity);
+  }
+
+  /* Only start a new run when the line actually changes */
+  if (chunk->lineRunCount == 0 ||
+      chunk->lineRuns[chunk->lineRunCount - 1].line != line) {
+    addLineRun(chunk, line);
   }
 
   chunk->code[chunk->count] = byte;
-  chunk->lines[chunk->count] = line;
   chunk->count++;
 }
 
+u32 getChunkLine(Chunk *chunk, size_t offset) {
+  i32 lo = 0, hi = chunk->lineRunCount - 1;
+  if (hi < 0) {
+    return 0;
+  }
+
+  /* find the last run whose offset is <= the given offset */
+  while (lo < hi) {
+    i32 mid = lo + (hi - lo + 1) / 2;
+    if (chunk->lineRuns[mid].offset <= offset) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return chunk->lineRuns[lo].line;
+}
+
 size_t addConstant(Chunk *chunk, Value value) {
   size_t i;
 
@@ -67,17 +67,32 @@ typedef enum OpCode {
   OP_STATIC_METHOD
 } OpCode;
 
+/* A run of consecutive bytes of code that all came from the same line.
+ * The run starts at 'offset' and continues until the next run's offset
+ * (or the end of the chunk) */
+typedef struct LineRun {
+  u32 offset;
+  u32 line;
+} LineRun;
+
 typedef struct Chunk {
   i32 count;
   i32 capacity;
   u8 *code;
-  i16 *lines;
+  i32 lineRunCount;
+  i32 lineRunCapacity;
+  LineRun *lineRuns;
   ValueArray constants;
 } Chunk;
 
 void initChunk(Chunk *chunk);
 void freeChunk(Chunk *chunk);
-void writeChunk(Chunk *chunk, u8 byte, i16 line);
+void writeChunk(Chunk *chunk, u8 byte, u32 line);
 size_t addConstant(Chunk *chunk, Value value);
 
+/* Returns the line number of the code at the given offset.
+ * This does a binary search over the runs, so it is meant to be
+ * called only when formatting errors, not on any hot path */
+u32 getChunkLine(Chunk *chunk, size_t offset);
+
 #endif /*mtots_chunk_h*/
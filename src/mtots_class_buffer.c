@@ -31,6 +31,14 @@ static Status implBufferIsLocked(i16 argCount, Value *args, Value *out) {
 
 static CFunction funcBufferIsLocked = {implBufferIsLocked, "isLocked", 0};
 
+static Status implBufferIsReadOnly(i16 argCount, Value *args, Value *out) {
+  ObjBuffer *bo = asBuffer(args[-1]);
+  *out = valBool(bo->handle.isReadOnly);
+  return STATUS_OK;
+}
+
+static CFunction funcBufferIsReadOnly = {implBufferIsReadOnly, "isReadOnly", 0};
+
 static Status implBufferClear(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
   bufferSetLength(&bo->handle, 0);
@@ -42,6 +50,9 @@ static CFunction funcBufferClear = {implBufferClear, "clear"};
 static Status implBufferSetLength(i16 argc, Value *argv, Value *out) {
   ObjBuffer *bo = asBuffer(argv[-1]);
   size_t newSize = asSize(argv[0]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetLength(&bo->handle, newSize);
   return STATUS_OK;
 }
@@ -98,6 +109,9 @@ static Status implBufferSetitem(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
   size_t i = asIndex(args[0], bo->handle.length);
   u8 value = asU8(args[1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bo->handle.data[i] = value;
   return STATUS_OK;
 }
@@ -109,6 +123,9 @@ static Status implBufferMemset(i16 argc, Value *args, Value *out) {
   u8 value = (u8)asU32Bits(args[0]);
   size_t start = argc > 1 && !isNil(args[1]) ? asIndex(args[1], bo->handle.length) : 0;
   size_t end = argc > 2 && !isNil(args[2]) ? asIndex(args[2], bo->handle.length) : bo->handle.length;
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   if (start < end) {
     memset(bo->handle.data + start, value, end - start);
   }
@@ -151,6 +168,9 @@ static Status implBufferView(i16 argCount, Value *args, Value *out) {
   newBuffer = newBufferWithExternalData(
       valBuffer(bo), bo->handle.data + start, end - start);
   newBuffer->handle.byteOrder = bo->handle.byteOrder;
+  if (bo->handle.isReadOnly) {
+    bufferLockReadOnly(&newBuffer->handle);
+  }
   *out = valBuffer(newBuffer);
   return STATUS_OK;
 }
@@ -232,11 +252,14 @@ static CFunction funcBufferAddString = {implBufferAddString, "addUTF8", 1};
 
 static Status implBufferAddBase64(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
-  String *string = asString(args[0]);
-  if (!decodeBase64(string->chars, string->byteLength, &bo->handle)) {
-    return STATUS_ERROR;
+  if (isBuffer(args[0])) {
+    ObjBuffer *input = asBuffer(args[0]);
+    if (input == bo) {
+      return runtimeError("Buffer.addBase64() cannot decode a Buffer into itself");
+    }
+    return decodeBase64((const char *)input->handle.data, input->handle.length, &bo->handle);
   }
-  return STATUS_OK;
+  return decodeBase64(asString(args[0])->chars, asString(args[0])->byteLength, &bo->handle);
 }
 
 static CFunction funcBufferAddBase64 = {
@@ -312,6 +335,9 @@ static CFunction funcBufferGetF64 = {implBufferGetF64, "getF64", 1};
 
 static Status implBufferSetI8(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetI8(&bo->handle, asNumber(args[0]), asNumber(args[1]));
   return STATUS_OK;
 }
@@ -320,6 +346,9 @@ static CFunction funcBufferSetI8 = {implBufferSetI8, "setI8", 2};
 
 static Status implBufferSetU8(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetU8(&bo->handle, asNumber(args[0]), asNumber(args[1]));
   return STATUS_OK;
 }
@@ -328,6 +357,9 @@ static CFunction funcBufferSetU8 = {implBufferSetU8, "setU8", 2};
 
 static Status implBufferSetI16(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetI16(&bo->handle, asNumber(args[0]), asNumber(args[1]));
   return STATUS_OK;
 }
@@ -336,6 +368,9 @@ static CFunction funcBufferSetI16 = {implBufferSetI16, "setI16", 2};
 
 static Status implBufferSetU16(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetU16(&bo->handle, asNumber(args[0]), asNumber(args[1]));
   return STATUS_OK;
 }
@@ -344,6 +379,9 @@ static CFunction funcBufferSetU16 = {implBufferSetU16, "setU16", 2};
 
 static Status implBufferSetI32(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetI32(&bo->handle, asNumber(args[0]), asNumber(args[1]));
   return STATUS_OK;
 }
@@ -352,6 +390,9 @@ static CFunction funcBufferSetI32 = {implBufferSetI32, "setI32", 2};
 
 static Status implBufferSetU32(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetU32(&bo->handle, asNumber(args[0]), asNumber(args[1]));
   return STATUS_OK;
 }
@@ -360,6 +401,9 @@ static CFunction funcBufferSetU32 = {implBufferSetU32, "setU32", 2};
 
 static Status implBufferSetF32(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetF32(&bo->handle, asNumber(args[0]), asNumber(args[1]));
   return STATUS_OK;
 }
@@ -368,6 +412,9 @@ static CFunction funcBufferSetF32 = {implBufferSetF32, "setF32", 2};
 
 static Status implBufferSetF64(i16 argCount, Value *args, Value *out) {
   ObjBuffer *bo = asBuffer(args[-1]);
+  if (!bufferCheckWritable(&bo->handle)) {
+    return STATUS_ERROR;
+  }
   bufferSetF64(&bo->handle, asNumber(args[0]), asNumber(args[1]));
   return STATUS_OK;
 }
@@ -380,6 +427,9 @@ static Status implBufferMemcpy(i16 argCount, Value *args, Value *out) {
   ObjBuffer *src = asBuffer(args[1]);
   size_t start = argCount > 2 ? asIndex(args[2], src->handle.length) : 0;
   size_t end = argCount > 3 ? asIndexUpper(args[3], src->handle.length) : src->handle.length;
+  if (!bufferCheckWritable(&buffer->handle)) {
+    return STATUS_ERROR;
+  }
   if (start < end) {
     size_t len = end - start;
     if (start + len > src->handle.length) {
@@ -405,7 +455,9 @@ static Status implBufferGetPointer(i16 argc, Value *argv, Value *out) {
   Buffer *buffer = &asBuffer(argv[-1])->handle;
   size_t i = argc > 0 && !isNil(argv[0]) ? asIndex(argv[0], buffer->length) : 0;
   bufferLock(buffer);
-  *out = valPointer(newTypedPointer(buffer->data + i, POINTER_TYPE_U8));
+  *out = valPointer(
+      buffer->isReadOnly ? newConstTypedPointer(buffer->data + i, POINTER_TYPE_U8)
+                         : newTypedPointer(buffer->data + i, POINTER_TYPE_U8));
   return STATUS_OK;
 }
 
@@ -464,6 +516,7 @@ void initBufferClass(void) {
   CFunction *methods[] = {
       &funcBufferLock,
       &funcBufferIsLocked,
+      &funcBufferIsReadOnly,
       &funcBufferClear,
       &funcBufferSetLength,
       &funcBufferSetMinCapacity,
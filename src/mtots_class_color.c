@@ -0,0 +1,43 @@
+#include "mtots_class_color.h"
+
+#include "mtots_vm.h"
+
+static Status implColorStaticCall(i16 argc, Value *argv, Value *out) {
+  u8 alpha = argc > 3 && !isNil(argv[3]) ? asU8(argv[3]) : 255;
+  *out = valColor(newColor(asU8(argv[0]), asU8(argv[1]), asU8(argv[2]), alpha));
+  return STATUS_OK;
+}
+
+static CFunction funcColorStaticCall = {implColorStaticCall, "__call__", 3, 4};
+
+static Status implColorGetattr(i16 argc, Value *argv, Value *out) {
+  Color color = asColor(argv[-1]);
+  String *name = asString(argv[0]);
+  if (name == vm.cs->red) {
+    *out = valNumber(color.red);
+  } else if (name == vm.cs->green) {
+    *out = valNumber(color.green);
+  } else if (name == vm.cs->blue) {
+    *out = valNumber(color.blue);
+  } else if (name == vm.cs->alpha) {
+    *out = valNumber(color.alpha);
+  } else {
+    fieldNotFoundError(argv[-1], name->chars);
+    return STATUS_ERROR;
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcColorGetattr = {implColorGetattr, "__getattr__", 1};
+
+void initColorClass(void) {
+  CFunction *staticMethods[] = {
+      &funcColorStaticCall,
+      NULL,
+  };
+  CFunction *methods[] = {
+      &funcColorGetattr,
+      NULL,
+  };
+  newBuiltinClass("Color", &vm.colorClass, methods, staticMethods);
+}
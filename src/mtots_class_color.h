@@ -0,0 +1,6 @@
+#ifndef mtots_class_color_h
+#define mtots_class_color_h
+
+void initColorClass(void);
+
+#endif /*mtots_class_color_h*/
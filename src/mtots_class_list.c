@@ -23,17 +23,6 @@ static ValueSlice getValueSlice(Value value) {
   return slice;
 }
 
-static Status implListStaticCall(i16 argc, Value *argv, Value *out) {
-  ObjList *list;
-  if (!newListFromIterable(argv[0], &list)) {
-    return STATUS_ERROR;
-  }
-  *out = valList(list);
-  return STATUS_OK;
-}
-
-static CFunction funcListStaticCall = {implListStaticCall, "__call__", 1};
-
 static Status implFrozenListStaticCall(i16 argCount, Value *args, Value *out) {
   ObjFrozenList *frozenList;
   if (!newFrozenListFromIterable(args[0], &frozenList)) {
@@ -95,6 +84,45 @@ static Status implListAppend(i16 argc, Value *argv, Value *out) {
 
 static CFunction funcListAppend = {implListAppend, "append", 1};
 
+static Status continueListExtend(ObjList *list, Value *iterator);
+static Status resumeListExtend(i16 argc, Value *argv, Value item, Value *out);
+
+static NativeContinuation listExtendContinuation = {resumeListExtend, NULL};
+
+/* Iterators implemented in mtots are called with 'scheduleCall',
+ * all others are stepped through directly.
+ * The iterator is kept at the top of the stack */
+static Status continueListExtend(ObjList *list, Value *iterator) {
+  for (;;) {
+    Value item;
+    if (isClosure(*iterator)) {
+      push(*iterator);
+      return scheduleCall(0, &listExtendContinuation);
+    }
+    if (!valueFastIterNext(iterator, &item)) {
+      return STATUS_ERROR;
+    }
+    if (isStopIteration(item)) {
+      vm.stackTop = iterator; /* in case no call was ever scheduled */
+      return STATUS_OK;
+    }
+    push(item);
+    listAppend(list, item);
+    pop(); /* item */
+  }
+}
+
+static Status resumeListExtend(i16 argc, Value *argv, Value item, Value *out) {
+  ObjList *list = AS_LIST_UNSAFE(argv[-1]);
+  if (isStopIteration(item)) {
+    return STATUS_OK;
+  }
+  push(item);
+  listAppend(list, item);
+  pop(); /* item */
+  return continueListExtend(list, vm.stackTop - 1);
+}
+
 static Status implListExtend(i16 argc, Value *argv, Value *out) {
   ObjList *list = asList(argv[-1]);
   Value iterable = argv[0], iterator;
@@ -102,23 +130,71 @@ static Status implListExtend(i16 argc, Value *argv, Value *out) {
     return STATUS_ERROR;
   }
   push(iterator);
+  return continueListExtend(list, vm.stackTop - 1);
+}
+
+static CFunction funcListExtend = {implListExtend, "extend", 1};
+
+static Status resumeListStaticCall(i16 argc, Value *argv, Value item, Value *out);
+
+static NativeContinuation listStaticCallContinuation = {resumeListStaticCall, NULL};
+
+/* Like continueListExtend, but the new list is kept on the stack
+ * just below the iterator and is the result of the call */
+static Status continueListStaticCall(ObjList *list, Value *iterator, Value *out) {
+  *out = valList(list);
   for (;;) {
     Value item;
-    if (!valueFastIterNext(&iterator, &item)) {
+    if (isClosure(*iterator)) {
+      push(*iterator);
+      return scheduleCall(0, &listStaticCallContinuation);
+    }
+    if (!valueFastIterNext(iterator, &item)) {
       return STATUS_ERROR;
     }
     if (isStopIteration(item)) {
-      break;
+      vm.stackTop = iterator - 1; /* in case no call was ever scheduled */
+      return STATUS_OK;
     }
     push(item);
     listAppend(list, item);
     pop(); /* item */
   }
-  pop(); /* iterator */
-  return STATUS_OK;
 }
 
-static CFunction funcListExtend = {implListExtend, "extend", 1};
+static Status resumeListStaticCall(i16 argc, Value *argv, Value item, Value *out) {
+  ObjList *list = AS_LIST_UNSAFE(vm.stackTop[-2]);
+  if (isStopIteration(item)) {
+    *out = valList(list);
+    return STATUS_OK;
+  }
+  push(item);
+  listAppend(list, item);
+  pop(); /* item */
+  return continueListStaticCall(list, vm.stackTop - 1, out);
+}
+
+static Status implListStaticCall(i16 argc, Value *argv, Value *out) {
+  Value iterable = argv[0], iterator;
+  ObjList *list;
+  if (isList(iterable) || isFrozenList(iterable)) {
+    if (!newListFromIterable(iterable, &list)) {
+      return STATUS_ERROR;
+    }
+    *out = valList(list);
+    return STATUS_OK;
+  }
+  if (!valueFastIter(iterable, &iterator)) {
+    return STATUS_ERROR;
+  }
+  push(iterator);
+  list = newList(0);
+  vm.stackTop[-1] = valList(list);
+  push(iterator);
+  return continueListStaticCall(list, vm.stackTop - 1, out);
+}
+
+static CFunction funcListStaticCall = {implListStaticCall, "__call__", 1};
 
 static Status implListPop(i16 argc, Value *argv, Value *out) {
   ObjList *list = asList(argv[-1]);
@@ -240,7 +316,7 @@ static CFunction funcListReverse = {implListReverse, "reverse"};
 
 static Status implListSort(i16 argc, Value *argv, Value *out) {
   ObjList *list = asList(argv[-1]);
-  return sortListWithKeyFunc(list, argc > 0 ? argv[0] : valNil());
+  return sortListWithKeyFunc(list, argc > 0 ? argv[0] : valNil(), valNil(), out);
 }
 
 static CFunction funcListSort = {implListSort, "sort", 0, 1};
@@ -0,0 +1,107 @@
+#include "mtots_class_rect.h"
+
+#include "mtots_vm.h"
+
+static Status implRectStaticCall(i16 argc, Value *argv, Value *out) {
+  *out = valRect(newRect(
+      asFloat(argv[0]), asFloat(argv[1]), asFloat(argv[2]), asFloat(argv[3])));
+  return STATUS_OK;
+}
+
+static CFunction funcRectStaticCall = {implRectStaticCall, "__call__", 4};
+
+static Status implRectGetattr(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[-1]);
+  String *name = asString(argv[0]);
+  if (name == vm.cs->minX) {
+    *out = valNumber(rect.minX);
+  } else if (name == vm.cs->minY) {
+    *out = valNumber(rect.minY);
+  } else if (name == vm.cs->maxX) {
+    *out = valNumber(rect.minX + rect.width);
+  } else if (name == vm.cs->maxY) {
+    *out = valNumber(rect.minY + rect.height);
+  } else if (name == vm.cs->width) {
+    *out = valNumber(rect.width);
+  } else if (name == vm.cs->height) {
+    *out = valNumber(rect.height);
+  } else {
+    fieldNotFoundError(argv[-1], name->chars);
+    return STATUS_ERROR;
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcRectGetattr = {implRectGetattr, "__getattr__", 1};
+
+static Status implRectWithMinX(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[-1]);
+  rect.minX = asFloat(argv[0]);
+  *out = valRect(rect);
+  return STATUS_OK;
+}
+
+static CFunction funcRectWithMinX = {implRectWithMinX, "withMinX", 1};
+
+static Status implRectWithMinY(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[-1]);
+  rect.minY = asFloat(argv[0]);
+  *out = valRect(rect);
+  return STATUS_OK;
+}
+
+static CFunction funcRectWithMinY = {implRectWithMinY, "withMinY", 1};
+
+static Status implRectWithMaxX(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[-1]);
+  rect.minX = asFloat(argv[0]) - rect.width;
+  *out = valRect(rect);
+  return STATUS_OK;
+}
+
+static CFunction funcRectWithMaxX = {implRectWithMaxX, "withMaxX", 1};
+
+static Status implRectWithMaxY(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[-1]);
+  rect.minY = asFloat(argv[0]) - rect.height;
+  *out = valRect(rect);
+  return STATUS_OK;
+}
+
+static CFunction funcRectWithMaxY = {implRectWithMaxY, "withMaxY", 1};
+
+static Status implRectWithWidth(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[-1]);
+  rect.width = asFloat(argv[0]);
+  *out = valRect(rect);
+  return STATUS_OK;
+}
+
+static CFunction funcRectWithWidth = {implRectWithWidth, "withWidth", 1};
+
+static Status implRectWithHeight(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[-1]);
+  rect.height = asFloat(argv[0]);
+  *out = valRect(rect);
+  return STATUS_OK;
+}
+
+static CFunction funcRectWithHeight = {implRectWithHeight, "withHeight", 1};
+
+void initRectClass(void) {
+  CFunction *staticMethods[] = {
+      &funcRectStaticCall,
+      NULL,
+  };
+  CFunction *methods[] = {
+      &funcRectGetattr,
+      &funcRectWithMinX,
+      &funcRectWithMinY,
+      &funcRectWithMaxX,
+      &funcRectWithMaxY,
+      &funcRectWithWidth,
+      &funcRectWithHeight,
+      NULL,
+  };
+  newBuiltinClass("Rect", &vm.rectClass, methods, staticMethods);
+}
@@ -0,0 +1,6 @@
+#ifndef mtots_class_rect_h
+#define mtots_class_rect_h
+
+void initRectClass(void);
+
+#endif /*mtots_class_rect_h*/
@@ -13,6 +13,7 @@
 #define U16_MAX 65535
 #define U32_MAX 4294967295U
 #define U64_MAX 0xFFFFFFFFFFFFFFFF
+#define I8_MIN (-128)
 #define I8_MAX 127
 #define I16_MIN (-32768)
 #define I16_MAX 32767
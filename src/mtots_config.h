@@ -3,8 +3,10 @@
 
 #if defined(MTOTS_RELEASE) && MTOTS_RELEASE
 #define DEBUG_STRESS_GC 0
+#define DEBUG_STACK_CHECKS 0
 #else
 #define DEBUG_STRESS_GC 1
+#define DEBUG_STACK_CHECKS 1
 #endif
 
 #define MAX_PATH_LENGTH 4096
@@ -4,9 +4,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "mtots_archive.h"
 #include "mtots_common.h"
 #include "mtots_util_buffer.h"
 #include "mtots_util_error.h"
+#include "mtots_util_fs.h"
 
 #if MTOTS_IS_WINDOWS
 #include <Windows.h>
@@ -16,88 +18,278 @@
 #include <unistd.h>
 #endif
 
-#define PATH_LIMIT 1024
+#define INIT_FILE_NAME "__init__" MTOTS_FILE_EXTENSION
+#define DIR_LISTING_BUCKET_COUNT 64
 
-/* TODO: allocate these dynamically.
- * I fear that this may be wasteful in memory */
-static char scriptBuf[PATH_LIMIT];
-static char exeRootBuf[PATH_LIMIT];
-static char pathBuffer[PATH_LIMIT];
-static char exePathBuf[PATH_LIMIT];
+/* The sorted names of the entries in a directory.
+ *
+ * Module lookups check these listings instead of trying to open each
+ * candidate path, so that each directory on the search path is read
+ * at most once per process, no matter how many modules are imported */
+typedef struct DirListing {
+  char *path;
+  char **names;
+  size_t count;
+  struct DirListing *next;
+} DirListing;
 
-static ubool canOpen(const char *path) {
-  FILE *file = fopen(path, "rb");
-  if (file) {
-    fclose(file);
-    return UTRUE;
+typedef struct NameList {
+  char **names;
+  size_t count;
+  size_t capacity;
+} NameList;
+
+static DirListing *dirListings[DIR_LISTING_BUCKET_COUNT];
+
+/* The listings that did not have an entry a lookup asked for.
+ * If the lookup fails, only these are listed again */
+static DirListing **missedListings;
+static size_t missedListingCount;
+static size_t missedListingCapacity;
+
+static char *scriptRoot;
+static char *exeRoot;
+
+/* Holds the path returned by findMtotsModulePath */
+static char *pathBuffer;
+static size_t pathBufferCapacity;
+
+static char *copyString(const char *chars, size_t length) {
+  char *copy = (char *)malloc(length + 1);
+  if (!copy) {
+    panic("out of memory");
   }
-  return UFALSE;
+  memcpy(copy, chars, length);
+  copy[length] = '\0';
+  return copy;
 }
 
-static ubool testPrefix(size_t prefixLen) {
-  size_t totalLen;
+static void reservePathBuffer(size_t length) {
+  if (pathBufferCapacity < length + 1) {
+    size_t newCapacity = pathBufferCapacity < 256 ? 256 : pathBufferCapacity;
+    while (newCapacity < length + 1) {
+      newCapacity *= 2;
+    }
+    pathBuffer = (char *)realloc(pathBuffer, newCapacity);
+    if (!pathBuffer) {
+      panic("out of memory");
+    }
+    pathBufferCapacity = newCapacity;
+  }
+}
 
-  /* Try `module/path/__init__.mtots` */
-  totalLen = prefixLen + strlen(PATH_SEP_STR "__init__" MTOTS_FILE_EXTENSION);
-  if (totalLen + 1 < PATH_LIMIT) {
-    strcpy(pathBuffer + prefixLen, PATH_SEP_STR "__init__" MTOTS_FILE_EXTENSION);
-    if (canOpen(pathBuffer)) {
-      return STATUS_OK;
+/* Sets the contents of the path buffer from 'start' onwards */
+static void putPath(size_t start, const char *chars, size_t length) {
+  reservePathBuffer(start + length);
+  memcpy(pathBuffer + start, chars, length);
+  pathBuffer[start + length] = '\0';
+}
+
+static u32 hashPath(const char *path) {
+  /* FNV-1a */
+  u32 hash = 2166136261u;
+  for (; *path; path++) {
+    hash ^= (u8)*path;
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+static int compareNames(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static Status addName(void *userData, const char *name) {
+  NameList *list = (NameList *)userData;
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity < 8 ? 8 : list->capacity * 2;
+    list->names = (char **)realloc(list->names, sizeof(char *) * list->capacity);
+    if (!list->names) {
+      panic("out of memory");
     }
   }
+  list->names[list->count++] = copyString(name, strlen(name));
+  return STATUS_OK;
+}
 
-  /* Try `module/path.mtots` */
-  totalLen = prefixLen + strlen(MTOTS_FILE_EXTENSION);
-  if (totalLen + 1 < PATH_LIMIT) {
-    strcpy(pathBuffer + prefixLen, MTOTS_FILE_EXTENSION);
-    if (canOpen(pathBuffer)) {
-      return STATUS_OK;
+/* (Re)reads the names in the listing's directory.
+ * Paths that are not directories get an empty listing */
+static void readDirListing(DirListing *listing) {
+  NameList list;
+
+  list.names = NULL;
+  list.count = list.capacity = 0;
+  if (isDirectory(listing->path)) {
+    if (!listDirectory(listing->path, &list, addName)) {
+      /* Treat unreadable directories like missing ones */
+      clearErrorString();
     }
+    qsort(list.names, list.count, sizeof(char *), compareNames);
   }
+  listing->names = list.names;
+  listing->count = list.count;
+}
 
-  return STATUS_ERROR;
+static void freeDirListingNames(DirListing *listing) {
+  size_t i;
+  for (i = 0; i < listing->count; i++) {
+    free(listing->names[i]);
+  }
+  free(listing->names);
+  listing->names = NULL;
+  listing->count = 0;
 }
 
-static ubool testRoot(size_t rootLen, const char *moduleName, size_t moduleNameLen) {
-  size_t prefixLen = rootLen + 1 + moduleNameLen;
-  if (prefixLen + 1 < PATH_LIMIT) {
-    size_t i;
-    pathBuffer[rootLen] = PATH_SEP;
-    strcpy(pathBuffer + rootLen + 1, moduleName);
-    pathBuffer[prefixLen] = '\0';
-    for (i = rootLen; i < prefixLen; i++) {
-      if (pathBuffer[i] == '.') {
-        pathBuffer[i] = PATH_SEP;
-      }
+/* Returns the (cached) listing of the given directory */
+static DirListing *getDirListing(const char *path) {
+  u32 bucket = hashPath(path) % DIR_LISTING_BUCKET_COUNT;
+  DirListing *listing;
+
+  for (listing = dirListings[bucket]; listing; listing = listing->next) {
+    if (strcmp(listing->path, path) == 0) {
+      return listing;
     }
-    return testPrefix(prefixLen);
   }
-  return STATUS_ERROR;
+
+  listing = (DirListing *)malloc(sizeof(DirListing));
+  if (!listing) {
+    panic("out of memory");
+  }
+  listing->path = copyString(path, strlen(path));
+  readDirListing(listing);
+  listing->next = dirListings[bucket];
+  dirListings[bucket] = listing;
+  return listing;
 }
 
-/*
-static ubool testPartialRoot(
-    size_t rootPrefixLen,
-    const char *rootSuffix,
-    const char *moduleName,
-    size_t moduleNameLen) {
-  size_t rootSuffixLen = strlen(rootSuffix);
-  size_t rootLen = rootPrefixLen + rootSuffixLen;
-  if (rootLen + 1 < PATH_LIMIT) {
-    strcpy(pathBuffer + rootPrefixLen, rootSuffix);
-    return testRoot(rootLen, moduleName, moduleNameLen);
+static ubool dirListingHas(DirListing *listing, const char *name) {
+  return listing->count > 0 &&
+         bsearch(&name, listing->names, listing->count,
+                 sizeof(char *), compareNames) != NULL;
+}
+
+static void addMissedListing(DirListing *listing) {
+  size_t i;
+  for (i = 0; i < missedListingCount; i++) {
+    if (missedListings[i] == listing) {
+      return;
+    }
   }
-  return STATUS_ERROR;
+  if (missedListingCount == missedListingCapacity) {
+    missedListingCapacity = missedListingCapacity < 8 ? 8 : missedListingCapacity * 2;
+    missedListings = (DirListing **)realloc(
+        missedListings, sizeof(DirListing *) * missedListingCapacity);
+    if (!missedListings) {
+      panic("out of memory");
+    }
+  }
+  missedListings[missedListingCount++] = listing;
 }
-*/
 
-const char *findMtotsModulePath(const char *moduleName) {
-  size_t moduleNameLen = strlen(moduleName);
+/* Lists each directory that missed during the last lookup again */
+static void refreshMissedListings(void) {
+  size_t i;
+  for (i = 0; i < missedListingCount; i++) {
+    freeDirListingNames(missedListings[i]);
+    readDirListing(missedListings[i]);
+  }
+  missedListingCount = 0;
+}
 
+/* Checks whether the directory whose path is in pathBuffer[0:dirLen]
+ * contains the entry whose name follows it in pathBuffer */
+static ubool testEntry(size_t dirLen) {
+  DirListing *listing;
+  ubool found;
+  pathBuffer[dirLen] = '\0';
+  listing = getDirListing(pathBuffer);
+  found = dirListingHas(listing, pathBuffer + dirLen + 1);
+  if (!found) {
+    addMissedListing(listing);
+  }
+  pathBuffer[dirLen] = PATH_SEP;
+  return found;
+}
+
+/* Like testRoot, but for a root that is an archive. Entries in
+ * an archive are always separated with '/' */
+static ubool testArchiveRoot(size_t rootLen, const char *moduleName) {
+  Archive *archive;
+  size_t nameLen = strlen(moduleName), i;
+  const char *entryName;
+
+  putPath(rootLen, "", 0);
+  archive = openArchive(pathBuffer);
+  if (!archive) {
+    /* Treat unreadable archives like missing directories */
+    clearErrorString();
+    return UFALSE;
+  }
+
+  putPath(rootLen, "/", 1);
+  putPath(rootLen + 1, moduleName, nameLen);
+  for (i = rootLen + 1; i < rootLen + 1 + nameLen; i++) {
+    if (pathBuffer[i] == '.') {
+      pathBuffer[i] = '/';
+    }
+  }
+
+  /* Try `module/path/__init__.mtots` */
+  putPath(rootLen + 1 + nameLen, "/" INIT_FILE_NAME, strlen("/" INIT_FILE_NAME));
+  entryName = pathBuffer + rootLen + 1;
+  if (archiveHasEntry(archive, entryName)) {
+    return UTRUE;
+  }
+
+  /* Try `module/path.mtots` */
+  putPath(rootLen + 1 + nameLen, MTOTS_FILE_EXTENSION, strlen(MTOTS_FILE_EXTENSION));
+  entryName = pathBuffer + rootLen + 1;
+  return archiveHasEntry(archive, entryName);
+}
+
+/* Looks for the module under the root already in pathBuffer[0:rootLen].
+ * On success, pathBuffer will contain the path to the module */
+static ubool testRoot(size_t rootLen, const char *moduleName) {
+  size_t dirLen = rootLen, partLen;
+  const char *part = moduleName, *dot;
+
+  if (isArchivePath(pathBuffer, rootLen)) {
+    return testArchiveRoot(rootLen, moduleName);
+  }
+
+  /* Every part of the name except the last must be a directory */
+  while ((dot = strchr(part, '.')) != NULL) {
+    partLen = dot - part;
+    putPath(dirLen + 1, part, partLen);
+    if (!testEntry(dirLen)) {
+      return UFALSE;
+    }
+    dirLen += 1 + partLen;
+    part = dot + 1;
+  }
+  partLen = strlen(part);
+
+  /* Try `module/path/__init__.mtots` */
+  putPath(dirLen + 1, part, partLen);
+  if (testEntry(dirLen)) {
+    putPath(dirLen + 1 + partLen + 1, INIT_FILE_NAME, strlen(INIT_FILE_NAME));
+    if (testEntry(dirLen + 1 + partLen)) {
+      return UTRUE;
+    }
+  }
+
+  /* Try `module/path.mtots` */
+  putPath(dirLen + 1 + partLen, MTOTS_FILE_EXTENSION, strlen(MTOTS_FILE_EXTENSION));
+  return testEntry(dirLen);
+}
+
+static ubool testRoots(const char *moduleName) {
   /* Check directory relative to the main script */
-  strcpy(pathBuffer, scriptBuf);
-  if (testRoot(strlen(scriptBuf), moduleName, moduleNameLen)) {
-    return pathBuffer;
+  if (scriptRoot) {
+    putPath(0, scriptRoot, strlen(scriptRoot));
+    if (testRoot(strlen(scriptRoot), moduleName)) {
+      return UTRUE;
+    }
   }
 
   /* Check directories indicated by $MTOTSPATH */
@@ -116,11 +308,13 @@ const char *findMtotsModulePath(const char *moduleName) {
           i++;
         }
         rootLen = i - start;
-        if (rootLen + 1 < PATH_LIMIT) {
-          memcpy(pathBuffer, mtotsPath + start, rootLen);
-          pathBuffer[rootLen] = '\0';
-          if (testRoot(rootLen, moduleName, moduleNameLen)) {
-            return pathBuffer;
+        if (mtotsPath[i] == PATH_LIST_SEP) {
+          i++;
+        }
+        if (rootLen > 0) {
+          putPath(0, mtotsPath + start, rootLen);
+          if (testRoot(rootLen, moduleName)) {
+            return UTRUE;
           }
         }
       }
@@ -128,114 +322,141 @@ const char *findMtotsModulePath(const char *moduleName) {
   }
 
   /* Check directory relative to the mtots executable */
-  strcpy(pathBuffer, exeRootBuf);
-  if (testRoot(strlen(exeRootBuf), moduleName, moduleNameLen)) {
+  if (exeRoot) {
+    putPath(0, exeRoot, strlen(exeRoot));
+    if (testRoot(strlen(exeRoot), moduleName)) {
+      return UTRUE;
+    }
+  }
+
+  return UFALSE;
+}
+
+const char *findMtotsModulePath(const char *moduleName) {
+  missedListingCount = 0;
+  if (testRoots(moduleName)) {
     return pathBuffer;
   }
 
-  /*
-   * Check fixed directories under $HOME/git/mtots
-   * (%USERPROFILE%/git/mtots on windows)
-   */
-  /*
-  {
-    const char *homePath = getenv("HOME");
-    if (!homePath) {
-      homePath = getenv("USERPROFILE");
-    }
-    if (homePath && homePath[0] != '\0') {
-      size_t homeLen = strlen(homePath);
-
-      if (homeLen + 1 < PATH_LIMIT) {
-        ubool found;
-        strcpy(pathBuffer, homePath);
-        found =
-          testPartialRoot(
-            homeLen,
-            PATH_SEP_STR "git" PATH_SEP_STR "mtots" PATH_SEP_STR "root",
-            moduleName,
-            moduleNameLen) ||
-          testPartialRoot(
-            homeLen,
-            PATH_SEP_STR "git" PATH_SEP_STR "mtots" PATH_SEP_STR "apps",
-            moduleName,
-            moduleNameLen);
-        return found ? pathBuffer : NULL;
-      }
-    }
+  /* The module may have been created after the directories were
+   * listed, so list the directories that missed again and look once more.
+   * Directories the module could not be in keep their listings */
+  refreshMissedListings();
+  if (testRoots(moduleName)) {
+    return pathBuffer;
   }
-  */
 
   return NULL;
 }
 
-/* Basically https://stackoverflow.com/questions/933850 */
-static const char *getMtotsExecutablePath(const char *argv0) {
+/* Basically https://stackoverflow.com/questions/933850
+ * Returns a malloc'd string that the caller must free */
+static char *getMtotsExecutablePath(const char *argv0) {
 #if MTOTS_IS_WINDOWS
-  /* TODO: handle cases where buffer is too small */
-  GetModuleFileName(NULL, exePathBuf, PATH_LIMIT);
-  exePathBuf[PATH_LIMIT - 1] = '\0';
-  return exePathBuf;
+  DWORD size = 256, length;
+  char *buffer = NULL;
+  for (;;) {
+    buffer = (char *)realloc(buffer, size);
+    if (!buffer) {
+      panic("out of memory");
+    }
+    length = GetModuleFileName(NULL, buffer, size);
+    if (length == 0) {
+      free(buffer);
+      return NULL;
+    }
+    if (length < size) {
+      return buffer;
+    }
+    size *= 2;
+  }
 #elif __APPLE__
-  uint32_t bufsize;
-  if (_NSGetExecutablePath(exePathBuf, &bufsize) != 0) {
-    /* buffer is too small */
-    return NULL;
+  uint32_t bufsize = 256;
+  char *buffer = (char *)malloc(bufsize);
+  if (!buffer) {
+    panic("out of memory");
+  }
+  if (_NSGetExecutablePath(buffer, &bufsize) != 0) {
+    /* buffer is too small - bufsize now holds the required size */
+    buffer = (char *)realloc(buffer, bufsize);
+    if (!buffer) {
+      panic("out of memory");
+    }
+    if (_NSGetExecutablePath(buffer, &bufsize) != 0) {
+      free(buffer);
+      return NULL;
+    }
   }
-  return exePathBuf;
+  return buffer;
 #elif __linux__
-  if (readlink("/proc/self/exe", exePathBuf, PATH_LIMIT - 1) == -1) {
-    /* Failed to read, maybe buffer too small */
-    return NULL;
+  size_t size = 256;
+  char *buffer = NULL;
+  for (;;) {
+    ssize_t length;
+    buffer = (char *)realloc(buffer, size);
+    if (!buffer) {
+      panic("out of memory");
+    }
+    length = readlink("/proc/self/exe", buffer, size);
+    if (length < 0) {
+      free(buffer);
+      return NULL;
+    }
+    if ((size_t)length < size) {
+      buffer[length] = '\0';
+      return buffer;
+    }
+    size *= 2;
   }
-  exePathBuf[PATH_LIMIT - 1] = '\0';
-  return exePathBuf;
 #else
   /* TODO: Try other ways to figure this out */
-  (void)exePathBuf;
   return NULL;
 #endif
 }
 
 void registerMtotsExecutablePath(const char *argv0) {
-  const char *exePath = getMtotsExecutablePath(argv0);
-  size_t exePathLen, rootLen;
+  char *exePath = getMtotsExecutablePath(argv0);
+  size_t rootLen;
   if (!exePath) {
     return;
   }
-  exePathLen = strlen(exePath);
-  if (exePathLen + strlen("/root") >= PATH_LIMIT) {
-    return; /* too long */
-  }
-  strcpy(exeRootBuf, exePath);
-  for (rootLen = exePathLen; rootLen > 0 && exeRootBuf[rootLen - 1] != PATH_SEP; rootLen--) {
-    exeRootBuf[rootLen - 1] = '\0';
-  }
+  for (rootLen = strlen(exePath); rootLen > 0 && exePath[rootLen - 1] != PATH_SEP; rootLen--)
+    ;
+  free(exeRoot);
   if (rootLen) {
-    strcpy(exeRootBuf + rootLen, "root");
+    exeRoot = (char *)malloc(rootLen + strlen("root") + 1);
+    if (!exeRoot) {
+      panic("out of memory");
+    }
+    memcpy(exeRoot, exePath, rootLen);
+    strcpy(exeRoot + rootLen, "root");
   } else {
-    strcpy(exeRootBuf, "." PATH_SEP_STR "root");
+    exeRoot = copyString("." PATH_SEP_STR "root", strlen("." PATH_SEP_STR "root"));
   }
+  free(exePath);
 }
 
 void registerMtotsMainScriptPath(const char *scriptPath) {
-  size_t scriptPathLen = strlen(scriptPath), rootLen;
-  if (scriptPathLen >= PATH_LIMIT) {
-    return; /* too long */
-  }
-  strcpy(scriptBuf, scriptPath);
-  for (rootLen = scriptPathLen; rootLen > 0 && scriptBuf[rootLen - 1] != PATH_SEP; rootLen--)
+  size_t rootLen;
+  for (rootLen = strlen(scriptPath); rootLen > 0 && scriptPath[rootLen - 1] != PATH_SEP; rootLen--)
     ;
-  if (strcmp(scriptBuf + rootLen, "main.mtots") == 0) {
+  free(scriptRoot);
+  if (isArchivePath(scriptPath, strlen(scriptPath))) {
+    /* An archive is the root of its own modules */
+    scriptRoot = copyString(scriptPath, strlen(scriptPath));
+  } else if (strcmp(scriptPath + rootLen, "main.mtots") == 0) {
     /* If the name of the script is 'main.mtots', we need the parent of the
      * enclosing directory */
-    strcpy(scriptBuf + rootLen, "..");
-  } else {
-    /* otherwise, we use the enclosing directory */
-    if (rootLen) {
-      scriptBuf[rootLen] = '\0';
-    } else {
-      strcpy(scriptBuf, ".");
+    scriptRoot = (char *)malloc(rootLen + strlen("..") + 1);
+    if (!scriptRoot) {
+      panic("out of memory");
     }
+    memcpy(scriptRoot, scriptPath, rootLen);
+    strcpy(scriptRoot + rootLen, "..");
+  } else if (rootLen) {
+    /* otherwise, we use the enclosing directory */
+    scriptRoot = copyString(scriptPath, rootLen);
+  } else {
+    scriptRoot = copyString(".", 1);
   }
 }
@@ -4,8 +4,19 @@
 #include "mtots_util_buffer.h"
 
 /*
- * Returns a pointer to a statically allocated buffer containing
- * the path to the specified module.
+ * Returns a pointer to a buffer containing the path to the specified module.
+ * The buffer is owned by this module and is only valid until the
+ * next call to `findMtotsModulePath`.
+ *
+ * Directory listings are cached for the life of the process, so that
+ * each directory on the search path is read at most once. If a module
+ * cannot be found in the cached listings, the directories that did not
+ * have the entries being looked for are listed again and the lookup is
+ * retried once.
+ *
+ * A root on the search path may also be a zip archive (see
+ * mtots_archive.h), in which case the returned path refers to
+ * an entry inside the archive.
  *
  * If the module could not be found, this function
  * returns NULL.
@@ -29,6 +40,8 @@ void registerMtotsExecutablePath(const char *argv0);
  *   * if the basename of the script path is "main.mtots",
  *     the *parent* of the enclosing directory will be used as
  *     the root,
+ *   * if the script is a zip archive, the archive itself will be
+ *     used as the root,
  *   * otherwise, the enclosign directory will be used as
  *     the root.
  */
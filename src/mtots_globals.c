@@ -37,33 +37,383 @@ static Status implLen(i16 argCount, Value *args, Value *out) {
 
 static CFunction cfuncLen = {implLen, "len", 1};
 
-static Status implSum(i16 argCount, Value *args, Value *out) {
-  Value iterable = args[0];
-  Value iterator, item;
-  double total = 0;
-  if (!valueFastIter(iterable, &iterator)) {
-    return STATUS_ERROR;
+typedef enum Reduction {
+  REDUCE_SUM,
+  REDUCE_PROD,
+  REDUCE_MEAN,
+  REDUCE_MIN,
+  REDUCE_MAX,
+  REDUCE_ANY,
+  REDUCE_ALL
+} Reduction;
+
+static const char *const reductionNames[] = {
+    "sum", "prod", "mean", "min", "max", "any", "all"};
+
+/* Working copy of a reduction's state. Between items the state lives
+ * on the VM stack (see REDUCE_STATE_SIZE) so that it survives calls
+ * into mtots iterators */
+typedef struct Reducer {
+  Reduction reduction;
+  ubool compensated;
+  ubool done; /* any() or all() already know their answer */
+  double total;
+  double compensation; /* low order bits lost from 'total' */
+  double count;
+  Value best; /* min() and max() */
+} Reducer;
+
+/* The top of the stack holds:
+ *   iterator, reduction, compensated, total, compensation, count, best */
+#define REDUCE_STATE_SIZE 7
+
+static Status continueReduce(Value *state, Value *out);
+static Status resumeReduce(i16 argCount, Value *args, Value item, Value *out);
+
+static NativeContinuation reduceContinuation = {resumeReduce, NULL};
+
+static void initReducer(Reducer *r, Reduction reduction, ubool compensated) {
+  r->reduction = reduction;
+  r->compensated = compensated;
+  r->done = UFALSE;
+  r->total = reduction == REDUCE_PROD ? 1 : 0;
+  r->compensation = 0;
+  r->count = 0;
+  r->best = valNil();
+}
+
+static void loadReducer(Reducer *r, Value *state) {
+  r->reduction = (Reduction)state[1].as.number;
+  r->compensated = state[2].as.boolean;
+  r->done = UFALSE;
+  r->total = state[3].as.number;
+  r->compensation = state[4].as.number;
+  r->count = state[5].as.number;
+  r->best = state[6];
+}
+
+static void storeReducer(Reducer *r, Value *state) {
+  state[3] = valNumber(r->total);
+  state[4] = valNumber(r->compensation);
+  state[5] = valNumber(r->count);
+  state[6] = r->best;
+}
+
+static Status reduceTypeError(Reducer *r, Value item) {
+  runtimeError(
+      "%s() expected number but got %s",
+      reductionNames[r->reduction], getKindName(item));
+  return STATUS_ERROR;
+}
+
+/* Neumaier's variant of Kahan summation */
+#define COMPENSATED_ADD(total, compensation, x) \
+  do {                                         \
+    double t_ = (total) + (x);                 \
+    if (fabs(total) >= fabs(x)) {              \
+      (compensation) += ((total)-t_) + (x);    \
+    } else {                                   \
+      (compensation) += ((x)-t_) + (total);    \
+    }                                          \
+    (total) = t_;                              \
+  } while (0)
+
+/* valueLessThan with numbers compared inline */
+#define LESS_THAN(a, b)                                       \
+  (isNumber(a) && isNumber(b) ? (a).as.number < (b).as.number \
+                              : valueLessThan((a), (b)))
+
+static Status reduceItem(Reducer *r, Value item) {
+  switch (r->reduction) {
+    case REDUCE_SUM:
+    case REDUCE_MEAN:
+      if (!isNumber(item)) {
+        return reduceTypeError(r, item);
+      }
+      if (r->compensated) {
+        COMPENSATED_ADD(r->total, r->compensation, item.as.number);
+      } else {
+        r->total += item.as.number;
+      }
+      break;
+    case REDUCE_PROD:
+      if (!isNumber(item)) {
+        return reduceTypeError(r, item);
+      }
+      r->total *= item.as.number;
+      break;
+    case REDUCE_MIN:
+      if (r->count == 0 || LESS_THAN(item, r->best)) {
+        r->best = item;
+      }
+      break;
+    case REDUCE_MAX:
+      if (r->count == 0 || LESS_THAN(r->best, item)) {
+        r->best = item;
+      }
+      break;
+    case REDUCE_ANY:
+      r->done = !isFalsey(item);
+      break;
+    case REDUCE_ALL:
+      r->done = isFalsey(item);
+      break;
   }
-  push(iterator);
+  r->count++;
+  return STATUS_OK;
+}
+
+/* Fast path for List and FrozenList.
+ * Sums and products of numbers get their own loops, unrolled by 4
+ * so that the type checks don't serialize the additions. The
+ * additions themselves stay in order so that the result does
+ * not depend on which path was taken. min() and max() compare
+ * numbers directly until the first item that is not one */
+static Status reduceValues(Reducer *r, Value *items, size_t length) {
+  size_t i = 0;
+  if (r->reduction == REDUCE_SUM || r->reduction == REDUCE_MEAN ||
+      r->reduction == REDUCE_PROD) {
+    double total = r->total;
+    ubool prod = r->reduction == REDUCE_PROD;
+    if (!r->compensated) {
+      for (; i + 4 <= length; i += 4) {
+        if (!isNumber(items[i]) || !isNumber(items[i + 1]) ||
+            !isNumber(items[i + 2]) || !isNumber(items[i + 3])) {
+          break;
+        }
+        if (prod) {
+          total = total * items[i].as.number * items[i + 1].as.number *
+                  items[i + 2].as.number * items[i + 3].as.number;
+        } else {
+          total = total + items[i].as.number + items[i + 1].as.number +
+                  items[i + 2].as.number + items[i + 3].as.number;
+        }
+      }
+    }
+    r->total = total;
+    r->count += i;
+  } else if ((r->reduction == REDUCE_MIN || r->reduction == REDUCE_MAX) &&
+             length > 0 && isNumber(items[0]) && r->count == 0) {
+    double best = items[0].as.number;
+    if (r->reduction == REDUCE_MIN) {
+      for (i = 1; i < length && isNumber(items[i]); i++) {
+        if (items[i].as.number < best) {
+          best = items[i].as.number;
+        }
+      }
+    } else {
+      for (i = 1; i < length && isNumber(items[i]); i++) {
+        if (items[i].as.number > best) {
+          best = items[i].as.number;
+        }
+      }
+    }
+    r->best = valNumber(best);
+    r->count += i;
+  }
+  for (; i < length; i++) {
+    if (!reduceItem(r, items[i])) {
+      return STATUS_ERROR;
+    }
+    if (r->done) {
+      break;
+    }
+  }
+  return STATUS_OK;
+}
+
+/* Fast path for Range: everything except prod() has a closed form */
+static void reduceRange(Reducer *r, Range range) {
+  double start = range.start, step = range.step, n = 0, last;
+  ubool hasZero;
+  if (range.step > 0 && range.start < range.stop) {
+    n = ((double)range.stop - start + step - 1) / step;
+  } else if (range.step < 0 && range.start > range.stop) {
+    n = ((double)range.stop - start + step + 1) / step;
+  }
+  n = floor(n);
+  last = start + (n - 1) * step;
+  hasZero = n > 0 &&
+            (step > 0 ? start <= 0 && 0 <= last : last <= 0 && 0 <= start) &&
+            fmod(start, step) == 0;
+  r->count = n;
+  switch (r->reduction) {
+    case REDUCE_SUM:
+    case REDUCE_MEAN:
+      r->total = n * start + step * (n * (n - 1) / 2);
+      break;
+    case REDUCE_PROD:
+      if (hasZero) {
+        r->total = 0;
+      } else {
+        double i;
+        for (i = 0; i < n && fabs(r->total) != HUGE_VAL; i++) {
+          r->total *= start + i * step;
+        }
+      }
+      break;
+    case REDUCE_MIN:
+      r->best = valNumber(step > 0 ? start : last);
+      break;
+    case REDUCE_MAX:
+      r->best = valNumber(step > 0 ? last : start);
+      break;
+    case REDUCE_ANY:
+      r->done = n > 1 || (n == 1 && start != 0);
+      break;
+    case REDUCE_ALL:
+      r->done = hasZero;
+      break;
+  }
+}
+
+static Status finishReduce(Reducer *r, Value *out) {
+  switch (r->reduction) {
+    case REDUCE_SUM:
+      *out = valNumber(r->total + r->compensation);
+      return STATUS_OK;
+    case REDUCE_PROD:
+      *out = valNumber(r->total);
+      return STATUS_OK;
+    case REDUCE_MEAN:
+      if (r->count == 0) {
+        break;
+      }
+      *out = valNumber((r->total + r->compensation) / r->count);
+      return STATUS_OK;
+    case REDUCE_MIN:
+    case REDUCE_MAX:
+      if (r->count == 0) {
+        break;
+      }
+      *out = r->best;
+      return STATUS_OK;
+    case REDUCE_ANY:
+      *out = valBool(r->done);
+      return STATUS_OK;
+    case REDUCE_ALL:
+      *out = valBool(!r->done);
+      return STATUS_OK;
+  }
+  runtimeError("%s() of an empty iterable", reductionNames[r->reduction]);
+  return STATUS_ERROR;
+}
+
+/* Iterators implemented in mtots are called with 'scheduleCall',
+ * all others are stepped through directly */
+static Status continueReduce(Value *state, Value *out) {
+  Reducer r;
+  loadReducer(&r, state);
   for (;;) {
-    if (!valueFastIterNext(&iterator, &item)) {
+    Value item;
+    if (isClosure(state[0])) {
+      storeReducer(&r, state);
+      push(state[0]);
+      return scheduleCall(0, &reduceContinuation);
+    }
+    if (!valueFastIterNext(&state[0], &item)) {
       return STATUS_ERROR;
     }
     if (isStopIteration(item)) {
       break;
     }
-    if (!isNumber(item)) {
-      runtimeError("Expected number but got %s", getKindName(item));
+    if (!reduceItem(&r, item)) {
       return STATUS_ERROR;
     }
-    total += asNumber(item);
+    if (r.done) {
+      break;
+    }
+    state[6] = r.best; /* keep the current min or max reachable */
   }
-  pop(); /* iterator */
-  *out = valNumber(total);
-  return STATUS_OK;
+  vm.stackTop = state; /* in case no call was ever scheduled */
+  return finishReduce(&r, out);
 }
 
-static CFunction cfuncSum = {implSum, "sum", 1};
+static Status resumeReduce(i16 argCount, Value *args, Value item, Value *out) {
+  Value *state = vm.stackTop - REDUCE_STATE_SIZE;
+  Reducer r;
+  loadReducer(&r, state);
+  if (!isStopIteration(item)) {
+    if (!reduceItem(&r, item)) {
+      return STATUS_ERROR;
+    }
+    if (!r.done) {
+      storeReducer(&r, state);
+      return continueReduce(state, out);
+    }
+  }
+  return finishReduce(&r, out);
+}
+
+static Status reduce(
+    Reduction reduction, Value iterable, ubool compensated, Value *out) {
+  Reducer r;
+  Value iterator;
+  initReducer(&r, reduction, compensated);
+  if (isList(iterable) || isFrozenList(iterable)) {
+    ubool list = isList(iterable);
+    if (!reduceValues(
+            &r,
+            list ? asList(iterable)->buffer : asFrozenList(iterable)->buffer,
+            list ? asList(iterable)->length : asFrozenList(iterable)->length)) {
+      return STATUS_ERROR;
+    }
+    return finishReduce(&r, out);
+  }
+  if (isRange(iterable)) {
+    reduceRange(&r, asRange(iterable));
+    return finishReduce(&r, out);
+  }
+  if (!valueFastIter(iterable, &iterator)) {
+    return STATUS_ERROR;
+  }
+  push(iterator);
+  push(valNumber(reduction));
+  push(valBool(compensated));
+  push(valNumber(r.total));
+  push(valNumber(r.compensation));
+  push(valNumber(r.count));
+  push(r.best);
+  return continueReduce(vm.stackTop - REDUCE_STATE_SIZE, out);
+}
+
+#undef REDUCE_STATE_SIZE
+
+static const char *argsSum[] = {"iterable", "compensated", NULL};
+
+static Status implSum(i16 argCount, Value *args, Value *out) {
+  ubool compensated = argCount > 1 && !isNil(args[1]) && asBool(args[1]);
+  return reduce(REDUCE_SUM, args[0], compensated, out);
+}
+
+static CFunction cfuncSum = {
+    implSum, "sum", 1, sizeof(argsSum) / sizeof(argsSum[0]) - 1, argsSum};
+
+static Status implProd(i16 argCount, Value *args, Value *out) {
+  return reduce(REDUCE_PROD, args[0], UFALSE, out);
+}
+
+static CFunction cfuncProd = {implProd, "prod", 1};
+
+static Status implMean(i16 argCount, Value *args, Value *out) {
+  ubool compensated = argCount > 1 && !isNil(args[1]) && asBool(args[1]);
+  return reduce(REDUCE_MEAN, args[0], compensated, out);
+}
+
+static CFunction cfuncMean = {
+    implMean, "mean", 1, sizeof(argsSum) / sizeof(argsSum[0]) - 1, argsSum};
+
+static Status implAny(i16 argCount, Value *args, Value *out) {
+  return reduce(REDUCE_ANY, args[0], UFALSE, out);
+}
+
+static CFunction cfuncAny = {implAny, "any", 1};
+
+static Status implAll(i16 argCount, Value *args, Value *out) {
+  return reduce(REDUCE_ALL, args[0], UFALSE, out);
+}
+
+static CFunction cfuncAll = {implAll, "all", 1};
 
 static void reverseChars(char *chars, size_t start, size_t end) {
   while (start + 1 < end) {
@@ -241,14 +591,56 @@ static Status implOrd(i16 argCount, Value *args, Value *out) {
 
 static CFunction cfunctionOrd = {implOrd, "ord", 1};
 
+/* Whether min(value) and max(value) reduce over the items of 'value':
+ * Lists, FrozenLists, Ranges, the builtin iterators and values whose
+ * class has __iter__. Closures are not counted even though iterators
+ * may be closures, so that min(f) is an error instead of a call to f */
+static ubool isIterable(Value value) {
+  ObjClass *klass;
+  Value method;
+  if (isList(value) || isFrozenList(value) || isRange(value) ||
+      isRangeIterator(value)) {
+    return UTRUE;
+  }
+  if (isObj(value) && OBJ_TYPE(value) == OBJ_NATIVE) {
+    CFunction *call = AS_NATIVE_UNSAFE(value)->descriptor->klass->call;
+    if (call && call->arity == 0) {
+      return UTRUE;
+    }
+  }
+  klass = getClassOfValue(value);
+  return klass != NULL && mapGetStr(&klass->methods, vm.cs->iter, &method);
+}
+
+/* A single argument that is not iterable must be a number, which is
+ * returned as is */
+static Status minMaxSingle(
+    Reduction reduction, Value value, Value *out) {
+  if (isIterable(value)) {
+    return reduce(reduction, value, UFALSE, out);
+  }
+  if (!isNumber(value)) {
+    runtimeError(
+        "%s() expected an iterable or a number but got %s",
+        reductionNames[reduction], getKindName(value));
+    return STATUS_ERROR;
+  }
+  *out = value;
+  return STATUS_OK;
+}
+
 static Status implMin(i16 argCount, Value *args, Value *out) {
-  Value best = args[0];
+  Value best;
   i16 i;
+  if (argCount == 1) {
+    return minMaxSingle(REDUCE_MIN, args[0], out);
+  }
+  best = args[0];
   for (i = 1; i < argCount; i++) {
     if (isNil(args[i])) {
       break;
     }
-    if (valueLessThan(args[i], best)) {
+    if (LESS_THAN(args[i], best)) {
       best = args[i];
     }
   }
@@ -259,13 +651,17 @@ static Status implMin(i16 argCount, Value *args, Value *out) {
 static CFunction cfunctionMin = {implMin, "min", 1, MAX_ARG_COUNT};
 
 static Status implMax(i16 argCount, Value *args, Value *out) {
-  Value best = args[0];
+  Value best;
   i16 i;
+  if (argCount == 1) {
+    return minMaxSingle(REDUCE_MAX, args[0], out);
+  }
+  best = args[0];
   for (i = 1; i < argCount; i++) {
     if (isNil(args[i])) {
       break;
     }
-    if (valueLessThan(best, args[i])) {
+    if (LESS_THAN(best, args[i])) {
       best = args[i];
     }
   }
@@ -280,12 +676,8 @@ static Status implSorted(i16 argCount, Value *args, Value *out) {
   if (!newListFromIterable(args[0], &list)) {
     return STATUS_ERROR;
   }
-  push(valList(list));
-  if (!sortListWithKeyFunc(list, argCount > 1 ? args[1] : valNil())) {
-    return STATUS_ERROR;
-  }
-  *out = pop(); /* list */
-  return STATUS_OK;
+  return sortListWithKeyFunc(
+      list, argCount > 1 ? args[1] : valNil(), valList(list), out);
 }
 
 static CFunction cfunctionSorted = {implSorted, "sorted", 1, 2};
@@ -401,7 +793,7 @@ static Status implFloat(i16 argCount, Value *args, Value *out) {
         }
       }
       if (*ptr == '\0') {
-        *out = valNumber(strtod(str->chars, NULL));
+        *out = valNumber(parseDouble(str->chars, NULL));
         return STATUS_OK;
       }
     }
@@ -566,88 +958,89 @@ static Status implSort(i16 argCount, Value *args, Value *out) {
 
 static CFunction funcSort = {implSort, "__sort__", 1, 2};
 
-typedef struct TryState {
-  Value *stackTop;
-  i16 frameCount;
-} TryState;
-
-static void saveTryState(TryState *state) {
-  state->stackTop = vm.stackTop;
-  state->frameCount = vm.frameCount;
+/* tryCatch is implemented with continuations (see scheduleCall) so that
+ * the try, catch and finally functions run in the VM's active loop
+ * rather than in nested ones on the C stack.
+ *
+ * Unwinding the stack when the try function fails is handled by
+ * the VM before 'recover' is called */
+
+static Status resumeTryCatchFinallyOk(i16 argc, Value *argv, Value result, Value *out);
+static Status resumeTryCatchFinallyError(i16 argc, Value *argv, Value result, Value *out);
+static Status recoverTry(i16 argc, Value *argv, Value *out);
+static Status recoverCatch(i16 argc, Value *argv, Value *out);
+static Status resumeTryCatch(i16 argc, Value *argv, Value result, Value *out);
+
+static NativeContinuation tryContinuation = {resumeTryCatch, recoverTry};
+static NativeContinuation catchContinuation = {resumeTryCatch, recoverCatch};
+static NativeContinuation finallyOkContinuation = {resumeTryCatchFinallyOk, NULL};
+static NativeContinuation finallyErrorContinuation = {resumeTryCatchFinallyError, NULL};
+
+static Value getFinallyFunc(i16 argc, Value *argv) {
+  return argc > 2 ? argv[2] : valNil();
 }
 
-static void restoreTryState(TryState *state) {
-  closeUpvalues(state->stackTop);
-  vm.stackTop = state->stackTop;
-  vm.frameCount = state->frameCount;
+/* Runs finallyFunc (if any) and then propagates the pending error */
+static Status propagateTryCatchError(i16 argc, Value *argv) {
+  Value finallyFunc = getFinallyFunc(argc, argv);
+  if (isNil(finallyFunc)) {
+    return STATUS_ERROR;
+  }
+
+  /* we need to store the error string, because finallyFunc could
+   * clobber it (with an inner tryCatch of its own) */
+  push(valString(internCString(getErrorString())));
+
+  push(finallyFunc);
+  return scheduleCall(0, &finallyErrorContinuation);
 }
 
-static Status tryCatchWithoutFinally(Value tryFunc, Value catchFunc, TryState *state) {
-  push(tryFunc);
-  if (callFunction(0)) {
-    /* tryFunc encountered no errors */
+static Status resumeTryCatch(i16 argc, Value *argv, Value result, Value *out) {
+  /* try-catch had no errors or successfully recovered */
+  Value finallyFunc = getFinallyFunc(argc, argv);
+  if (isNil(finallyFunc)) {
+    *out = result;
     return STATUS_OK;
   }
-  if (!isNil(catchFunc)) {
-    /* attempt to save with a catchFunc */
-    restoreTryState(state);
-    saveCurrentErrorString();
-    push(catchFunc);
-    if (callFunction(0)) {
-      /* catchFunc handled the exception successfully */
-      return STATUS_OK;
-    }
-  }
-  /* there is a pending error to be propagated */
+
+  /* if a finallyFunc is present, we need to run this */
+  push(result);
+  push(finallyFunc);
+  return scheduleCall(0, &finallyOkContinuation);
+}
+
+static Status resumeTryCatchFinallyOk(i16 argc, Value *argv, Value result, Value *out) {
+  *out = pop(); /* try-catch */
+  return STATUS_OK;
+}
+
+static Status resumeTryCatchFinallyError(i16 argc, Value *argv, Value result, Value *out) {
+  /* If finallyFunc does not throw, we need to restore
+   * the previous exception -
+   * pop the value we pushed earlier with getErrorString() */
+  setErrorString(asString(pop())->chars);
   return STATUS_ERROR;
 }
 
-static Status implTryCatch(i16 argc, Value *argv, Value *out) {
-  /* WARNING: this is an extra hairy function - since tryCatch
-   * needs to know how to recover when we enter potentially
-   * inconsistent states, this function needs to poke at internals
-   * that most other CFunctions wouldn't know about */
-  Value tryFunc = argv[0];
-  Value catchFunc = argc > 1 && !isNil(argv[1]) ? argv[1] : valNil();
-  Value finallyFunc = argc > 2 && !isNil(argv[2]) ? argv[2] : valNil();
-  TryState state;
-  saveTryState(&state);
-
-  if (tryCatchWithoutFinally(tryFunc, catchFunc, &state)) {
-    /* try-catch had no errors or successfully recovered -
-     * the return value should be on the top of stack at this point */
-    if (!isNil(finallyFunc)) {
-      /* if a finallyFunc is present, we need to run this */
-      push(finallyFunc);
-      if (!callFunction(0)) {
-        return STATUS_ERROR;
-      }
-      pop(); /* return value (finallyFunc) */
-    }
-    *out = pop(); /* try-catch */
-    return STATUS_OK;
+static Status recoverTry(i16 argc, Value *argv, Value *out) {
+  Value catchFunc = argv[1];
+  if (isNil(catchFunc)) {
+    return propagateTryCatchError(argc, argv);
   }
 
-  /* if the try-catch still propagates an error, we need
-   * to propagate it. However, we still need to run finallyFunc */
-  if (!isNil(finallyFunc)) {
-    restoreTryState(&state);
-
-    /* we need to store the error string, because finallyFunc could
-     * clobber it (with an inner tryCatch of its own) */
-    push(valString(internCString(getErrorString())));
+  /* attempt to save with a catchFunc */
+  saveCurrentErrorString();
+  push(catchFunc);
+  return scheduleCall(0, &catchContinuation);
+}
 
-    push(finallyFunc);
-    if (callFunction(0)) {
-      pop(); /* return value (finallyFunc) */
+static Status recoverCatch(i16 argc, Value *argv, Value *out) {
+  return propagateTryCatchError(argc, argv);
+}
 
-      /* If finallyFunc does not throw, we need to restore
-       * the previous exception -
-       * pop the value we pushed earlier with getErrorString() */
-      setErrorString(asString(pop())->chars);
-    }
-  }
-  return STATUS_ERROR;
+static Status implTryCatch(i16 argc, Value *argv, Value *out) {
+  push(argv[0]); /* tryFunc */
+  return scheduleCall(0, &tryContinuation);
 }
 
 static CFunction funcTryCatch = {implTryCatch, "tryCatch", 2, 3};
@@ -676,6 +1069,10 @@ void defineDefaultGlobals(void) {
       &cfuncExit,
       &cfuncLen,
       &cfuncSum,
+      &cfuncProd,
+      &cfuncMean,
+      &cfuncAny,
+      &cfuncAll,
       &funcHex,
       &funcOct,
       &funcBin,
@@ -719,6 +1116,8 @@ void defineDefaultGlobals(void) {
       &vm.numberClass,
       &vm.stringClass,
       &vm.vectorClass,
+      &vm.colorClass,
+      &vm.rectClass,
       &vm.bufferClass,
       &vm.listClass,
       &vm.frozenListClass,
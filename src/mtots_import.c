@@ -4,18 +4,29 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "mtots_archive.h"
 #include "mtots_env.h"
 #include "mtots_parser.h"
 #include "mtots_vm.h"
 
 /*
  * Runs the module specified by the given path with the given moduleName
+ * The path may refer to an entry in an archive (see mtots_archive.h)
  * Puts the result of running the module on the top of the stack
  * NOTE: Never cached (unlike importModule())
  */
 Status importModuleWithPath(String *moduleName, const char *path) {
   void *source;
-  if (!readFile(path, &source, NULL)) {
+  Archive *archive;
+  const char *entryName;
+  if (findArchiveForPath(path, &archive, &entryName)) {
+    size_t length;
+    char *chars;
+    if (!archive || !archiveExtract(archive, entryName, &chars, &length)) {
+      return STATUS_ERROR;
+    }
+    source = chars;
+  } else if (!readFile(path, &source, NULL)) {
     return STATUS_ERROR;
   }
   return importModuleWithPathAndSource(moduleName, path, (char *)source, NULL, (char *)source);
@@ -87,22 +98,23 @@ static Status importModuleNoCache(String *moduleName) {
     ObjModule *module = NULL;
     Value moduleValue;
     if (isCFunction(nativeModuleThunkValue)) {
-      Value result = valNil(), *stackStart;
+      Value result = valNil();
+      ptrdiff_t stackStart;
       CFunction *nativeModuleThunk;
       nativeModuleThunk = nativeModuleThunkValue.as.cfunction;
       module = newModule(moduleName, UFALSE);
       moduleValue = valModule(module);
       push(valModule(module));
-      stackStart = vm.stackTop;
+      stackStart = vm.stackTop - vm.stack;
       if (!nativeModuleThunk->body(1, &moduleValue, &result)) {
         return STATUS_ERROR;
       }
       /* At this point, module should be at the top of the stack */
-      if (vm.stackTop != stackStart) {
+      if (vm.stackTop - vm.stack != stackStart) {
         panic(
             "Native module started with %d items on the stack, but "
             "ended with %d",
-            (int)(stackStart - vm.stack),
+            (int)stackStart,
             (int)(vm.stackTop - vm.stack));
       }
     } else {
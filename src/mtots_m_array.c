@@ -0,0 +1,1522 @@
+#include "mtots_m_array.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "mtots.h"
+
+typedef enum ArrayOp {
+  ARRAY_ADD,
+  ARRAY_SUB,
+  ARRAY_MUL,
+  ARRAY_DIV
+} ArrayOp;
+
+typedef enum ArrayComparison {
+  ARRAY_EQ,
+  ARRAY_LT,
+  ARRAY_LE,
+  ARRAY_GT,
+  ARRAY_GE
+} ArrayComparison;
+
+static void blackenTypedArray(ObjNative *n) {
+  markObject((Obj *)((ObjTypedArray *)n)->buffer);
+}
+
+NativeObjectDescriptor descriptorFloat32Array = {
+    blackenTypedArray,
+    nopFree,
+    sizeof(ObjTypedArray),
+    "Float32Array",
+};
+
+NativeObjectDescriptor descriptorFloat64Array = {
+    blackenTypedArray,
+    nopFree,
+    sizeof(ObjTypedArray),
+    "Float64Array",
+};
+
+NativeObjectDescriptor descriptorInt32Array = {
+    blackenTypedArray,
+    nopFree,
+    sizeof(ObjTypedArray),
+    "Int32Array",
+};
+
+static NativeObjectDescriptor *descriptors[] = {
+    &descriptorFloat32Array,
+    &descriptorFloat64Array,
+    &descriptorInt32Array,
+};
+
+int getTypedArrayDescriptorType(NativeObjectDescriptor *descriptor) {
+  if (descriptor == &descriptorFloat32Array) {
+    return TYPED_ARRAY_F32;
+  }
+  if (descriptor == &descriptorFloat64Array) {
+    return TYPED_ARRAY_F64;
+  }
+  if (descriptor == &descriptorInt32Array) {
+    return TYPED_ARRAY_I32;
+  }
+  return -1;
+}
+
+Value valTypedArray(ObjTypedArray *array) {
+  return valObjExplicit((Obj *)array);
+}
+
+ObjTypedArray *asTypedArray(Value value) {
+  if (!isTypedArray(value)) {
+    panic("Expected typed array but got %s", getKindName(value));
+  }
+  return (ObjTypedArray *)value.as.obj;
+}
+
+size_t typedArrayElementSize(TypedArrayType type) {
+  switch (type) {
+    case TYPED_ARRAY_F32:
+      return sizeof(f32);
+    case TYPED_ARRAY_F64:
+      return sizeof(f64);
+    case TYPED_ARRAY_I32:
+      return sizeof(i32);
+  }
+  panic("Invalid TypedArrayType %d", type);
+}
+
+size_t typedArrayLength(ObjTypedArray *array) {
+  return array->buffer->handle.length / typedArrayElementSize(array->type);
+}
+
+static const char *typedArrayName(TypedArrayType type) {
+  return descriptors[type]->name;
+}
+
+static ObjTypedArray *newTypedArrayWithBuffer(TypedArrayType type, ObjBuffer *buffer) {
+  ObjTypedArray *array;
+  push(valBuffer(buffer));
+  array = NEW_NATIVE(ObjTypedArray, descriptors[type]);
+  array->type = type;
+  array->buffer = buffer;
+  pop(); /* buffer */
+  return array;
+}
+
+ObjTypedArray *newTypedArray(TypedArrayType type, size_t length) {
+  ObjBuffer *buffer = newBuffer();
+  ObjTypedArray *array;
+  push(valBuffer(buffer));
+  bufferSetLength(&buffer->handle, length * typedArrayElementSize(type));
+  array = newTypedArrayWithBuffer(type, buffer);
+  pop(); /* buffer */
+  return array;
+}
+
+static Value getElement(ObjTypedArray *array, size_t i) {
+  void *data = array->buffer->handle.data;
+  switch (array->type) {
+    case TYPED_ARRAY_F32:
+      return valNumber(((f32 *)data)[i]);
+    case TYPED_ARRAY_F64:
+      return valNumber(((f64 *)data)[i]);
+    case TYPED_ARRAY_I32:
+      return valNumber(((i32 *)data)[i]);
+  }
+  panic("Invalid TypedArrayType %d", array->type);
+}
+
+/* Integer arrays only accept integral values that fit in an i32 */
+static Status checkElementValue(TypedArrayType type, double value) {
+  if (type == TYPED_ARRAY_I32 &&
+      (value != floor(value) || value < (double)I32_MIN || value > (double)I32_MAX)) {
+    return runtimeError("Int32Array values must be 32-bit integers but got %f", value);
+  }
+  return STATUS_OK;
+}
+
+static void setElement(ObjTypedArray *array, size_t i, double value) {
+  void *data = array->buffer->handle.data;
+  switch (array->type) {
+    case TYPED_ARRAY_F32:
+      ((f32 *)data)[i] = (f32)value;
+      return;
+    case TYPED_ARRAY_F64:
+      ((f64 *)data)[i] = value;
+      return;
+    case TYPED_ARRAY_I32:
+      ((i32 *)data)[i] = (i32)value;
+      return;
+  }
+  panic("Invalid TypedArrayType %d", array->type);
+}
+
+double typedArrayGetNumber(ObjTypedArray *array, size_t i) {
+  return getElement(array, i).as.number;
+}
+
+Status typedArraySetNumber(ObjTypedArray *array, size_t i, double value) {
+  if (!checkElementValue(array->type, value)) {
+    return STATUS_ERROR;
+  }
+  setElement(array, i, value);
+  return STATUS_OK;
+}
+
+static Status checkSameShape(ObjTypedArray *a, ObjTypedArray *b) {
+  if (a->type != b->type) {
+    return runtimeError(
+        "Expected %s but got %s", typedArrayName(a->type), typedArrayName(b->type));
+  }
+  if (typedArrayLength(a) != typedArrayLength(b)) {
+    return runtimeError(
+        "%s length mismatch (%lu != %lu)",
+        typedArrayName(a->type),
+        (unsigned long)typedArrayLength(a),
+        (unsigned long)typedArrayLength(b));
+  }
+  return STATUS_OK;
+}
+
+/****************************************************************
+ * Kernels
+ *
+ * Each kernel is a plain loop over contiguous elements with the
+ * operation chosen outside of the loop, so that the compiler can
+ * vectorize them.
+ ****************************************************************/
+
+#define DEFINE_FLOAT_KERNELS(T, suffix)                                                \
+  static void binary##suffix(ArrayOp op, T *dst, const T *a, const T *b, size_t n) {   \
+    size_t i;                                                                          \
+    switch (op) {                                                                      \
+      case ARRAY_ADD:                                                                  \
+        for (i = 0; i < n; i++) dst[i] = a[i] + b[i];                                  \
+        return;                                                                        \
+      case ARRAY_SUB:                                                                  \
+        for (i = 0; i < n; i++) dst[i] = a[i] - b[i];                                  \
+        return;                                                                        \
+      case ARRAY_MUL:                                                                  \
+        for (i = 0; i < n; i++) dst[i] = a[i] * b[i];                                  \
+        return;                                                                        \
+      case ARRAY_DIV:                                                                  \
+        for (i = 0; i < n; i++) dst[i] = a[i] / b[i];                                  \
+        return;                                                                        \
+    }                                                                                  \
+  }                                                                                    \
+  static void scalar##suffix(ArrayOp op, T *dst, const T *a, T b, size_t n) {          \
+    size_t i;                                                                          \
+    switch (op) {                                                                      \
+      case ARRAY_ADD:                                                                  \
+        for (i = 0; i < n; i++) dst[i] = a[i] + b;                                     \
+        return;                                                                        \
+      case ARRAY_SUB:                                                                  \
+        for (i = 0; i < n; i++) dst[i] = a[i] - b;                                     \
+        return;                                                                        \
+      case ARRAY_MUL:                                                                  \
+        for (i = 0; i < n; i++) dst[i] = a[i] * b;                                     \
+        return;                                                                        \
+      case ARRAY_DIV:                                                                  \
+        for (i = 0; i < n; i++) dst[i] = a[i] / b;                                     \
+        return;                                                                        \
+    }                                                                                  \
+  }                                                                                    \
+  static double sum##suffix(const T *a, size_t n) {                                    \
+    /* independent partial sums let the loop pipeline */                               \
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;                                             \
+    size_t i;                                                                          \
+    for (i = 0; i + 4 <= n; i += 4) {                                                  \
+      s0 += a[i];                                                                      \
+      s1 += a[i + 1];                                                                  \
+      s2 += a[i + 2];                                                                  \
+      s3 += a[i + 3];                                                                  \
+    }                                                                                  \
+    for (; i < n; i++) s0 += a[i];                                                     \
+    return (s0 + s1) + (s2 + s3);                                                      \
+  }                                                                                    \
+  static double dot##suffix(const T *a, const T *b, size_t n) {                        \
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;                                             \
+    size_t i;                                                                          \
+    for (i = 0; i + 4 <= n; i += 4) {                                                  \
+      s0 += (double)a[i] * b[i];                                                       \
+      s1 += (double)a[i + 1] * b[i + 1];                                               \
+      s2 += (double)a[i + 2] * b[i + 2];                                               \
+      s3 += (double)a[i + 3] * b[i + 3];                                               \
+    }                                                                                  \
+    for (; i < n; i++) s0 += (double)a[i] * b[i];                                      \
+    return (s0 + s1) + (s2 + s3);                                                      \
+  }
+
+DEFINE_FLOAT_KERNELS(f32, F32)
+DEFINE_FLOAT_KERNELS(f64, F64)
+
+/* i32 arithmetic wraps around instead of overflowing,
+ * and division truncates towards zero */
+static void binaryI32(ArrayOp op, i32 *dst, const i32 *a, const i32 *b, size_t n) {
+  size_t i;
+  switch (op) {
+    case ARRAY_ADD:
+      for (i = 0; i < n; i++) dst[i] = (i32)((u32)a[i] + (u32)b[i]);
+      return;
+    case ARRAY_SUB:
+      for (i = 0; i < n; i++) dst[i] = (i32)((u32)a[i] - (u32)b[i]);
+      return;
+    case ARRAY_MUL:
+      for (i = 0; i < n; i++) dst[i] = (i32)((u32)a[i] * (u32)b[i]);
+      return;
+    case ARRAY_DIV:
+      for (i = 0; i < n; i++) dst[i] = (i32)((i64)a[i] / b[i]);
+      return;
+  }
+}
+
+static void scalarI32(ArrayOp op, i32 *dst, const i32 *a, i32 b, size_t n) {
+  size_t i;
+  switch (op) {
+    case ARRAY_ADD:
+      for (i = 0; i < n; i++) dst[i] = (i32)((u32)a[i] + (u32)b);
+      return;
+    case ARRAY_SUB:
+      for (i = 0; i < n; i++) dst[i] = (i32)((u32)a[i] - (u32)b);
+      return;
+    case ARRAY_MUL:
+      for (i = 0; i < n; i++) dst[i] = (i32)((u32)a[i] * (u32)b);
+      return;
+    case ARRAY_DIV:
+      for (i = 0; i < n; i++) dst[i] = (i32)((i64)a[i] / b);
+      return;
+  }
+}
+
+static double sumI32(const i32 *a, size_t n) {
+  i64 s0 = 0, s1 = 0;
+  size_t i;
+  for (i = 0; i + 2 <= n; i += 2) {
+    s0 += a[i];
+    s1 += a[i + 1];
+  }
+  for (; i < n; i++) s0 += a[i];
+  return (double)(s0 + s1);
+}
+
+static double dotI32(const i32 *a, const i32 *b, size_t n) {
+  i64 s = 0;
+  size_t i;
+  for (i = 0; i < n; i++) s += (i64)a[i] * b[i];
+  return (double)s;
+}
+
+#define DEFINE_COMPARE_KERNELS(T, suffix)                                                    \
+  static void compare##suffix(ArrayComparison cmp, i32 *dst, const T *a, const T *b,          \
+                              ubool scalar, size_t n) {                                       \
+    size_t i;                                                                                 \
+    T s = scalar ? b[0] : 0;                                                                  \
+    switch (cmp) {                                                                            \
+      case ARRAY_EQ:                                                                          \
+        if (scalar) for (i = 0; i < n; i++) dst[i] = a[i] == s;                               \
+        else for (i = 0; i < n; i++) dst[i] = a[i] == b[i];                                   \
+        return;                                                                               \
+      case ARRAY_LT:                                                                          \
+        if (scalar) for (i = 0; i < n; i++) dst[i] = a[i] < s;                                \
+        else for (i = 0; i < n; i++) dst[i] = a[i] < b[i];                                    \
+        return;                                                                               \
+      case ARRAY_LE:                                                                          \
+        if (scalar) for (i = 0; i < n; i++) dst[i] = a[i] <= s;                               \
+        else for (i = 0; i < n; i++) dst[i] = a[i] <= b[i];                                   \
+        return;                                                                               \
+      case ARRAY_GT:                                                                          \
+        if (scalar) for (i = 0; i < n; i++) dst[i] = a[i] > s;                                \
+        else for (i = 0; i < n; i++) dst[i] = a[i] > b[i];                                    \
+        return;                                                                               \
+      case ARRAY_GE:                                                                          \
+        if (scalar) for (i = 0; i < n; i++) dst[i] = a[i] >= s;                               \
+        else for (i = 0; i < n; i++) dst[i] = a[i] >= b[i];                                   \
+        return;                                                                               \
+    }                                                                                         \
+  }
+
+DEFINE_COMPARE_KERNELS(f32, F32)
+DEFINE_COMPARE_KERNELS(f64, F64)
+DEFINE_COMPARE_KERNELS(i32, I32)
+
+/****************************************************************
+ * Operations
+ ****************************************************************/
+
+static ubool containsZero(ObjTypedArray *array) {
+  const i32 *data = (const i32 *)array->buffer->handle.data;
+  size_t i, n = typedArrayLength(array);
+  for (i = 0; i < n; i++) {
+    if (data[i] == 0) {
+      return UTRUE;
+    }
+  }
+  return UFALSE;
+}
+
+/* dst = a op b, where 'b' is either a typed array of the same type and
+ * length as 'a', or a Number. 'dst' may be the same as 'a' */
+static Status applyOp(ArrayOp op, ObjTypedArray *dst, ObjTypedArray *a, Value b) {
+  void *dstData = dst->buffer->handle.data;
+  const void *aData = a->buffer->handle.data;
+  size_t n = typedArrayLength(a);
+  if (isNumber(b)) {
+    double scalar = b.as.number;
+    switch (a->type) {
+      case TYPED_ARRAY_F32:
+        scalarF32(op, (f32 *)dstData, (const f32 *)aData, (f32)scalar, n);
+        return STATUS_OK;
+      case TYPED_ARRAY_F64:
+        scalarF64(op, (f64 *)dstData, (const f64 *)aData, scalar, n);
+        return STATUS_OK;
+      case TYPED_ARRAY_I32:
+        if (!checkElementValue(a->type, scalar)) {
+          return STATUS_ERROR;
+        }
+        if (op == ARRAY_DIV && scalar == 0) {
+          return runtimeError("Int32Array division by zero");
+        }
+        scalarI32(op, (i32 *)dstData, (const i32 *)aData, (i32)scalar, n);
+        return STATUS_OK;
+    }
+  } else {
+    ObjTypedArray *other = asTypedArray(b);
+    const void *bData = other->buffer->handle.data;
+    if (!checkSameShape(a, other)) {
+      return STATUS_ERROR;
+    }
+    switch (a->type) {
+      case TYPED_ARRAY_F32:
+        binaryF32(op, (f32 *)dstData, (const f32 *)aData, (const f32 *)bData, n);
+        return STATUS_OK;
+      case TYPED_ARRAY_F64:
+        binaryF64(op, (f64 *)dstData, (const f64 *)aData, (const f64 *)bData, n);
+        return STATUS_OK;
+      case TYPED_ARRAY_I32:
+        if (op == ARRAY_DIV && containsZero(other)) {
+          return runtimeError("Int32Array division by zero");
+        }
+        binaryI32(op, (i32 *)dstData, (const i32 *)aData, (const i32 *)bData, n);
+        return STATUS_OK;
+    }
+  }
+  panic("Invalid TypedArrayType %d", a->type);
+}
+
+static Status applyOpToNew(ArrayOp op, Value *argv, Value *out) {
+  ObjTypedArray *a = asTypedArray(argv[-1]);
+  ObjTypedArray *result = newTypedArray(a->type, typedArrayLength(a));
+  *out = valTypedArray(result);
+  return applyOp(op, result, a, argv[0]);
+}
+
+static Status applyOpInPlace(ArrayOp op, Value *argv, Value *out) {
+  ObjTypedArray *a = asTypedArray(argv[-1]);
+  *out = argv[-1];
+  return applyOp(op, a, a, argv[0]);
+}
+
+static Status compare(ArrayComparison cmp, Value *argv, Value *out) {
+  ObjTypedArray *a = asTypedArray(argv[-1]);
+  size_t n = typedArrayLength(a);
+  ObjTypedArray *result = newTypedArray(TYPED_ARRAY_I32, n);
+  i32 *dst = (i32 *)result->buffer->handle.data;
+  const void *aData = a->buffer->handle.data;
+  const void *bData;
+  ubool scalar = isNumber(argv[0]);
+  f32 f32Scalar;
+  f64 f64Scalar;
+  i32 i32Scalar;
+  *out = valTypedArray(result);
+  if (scalar) {
+    double value = argv[0].as.number;
+    f32Scalar = (f32)value;
+    f64Scalar = value;
+    i32Scalar = (i32)value;
+    if (!checkElementValue(a->type, value)) {
+      return STATUS_ERROR;
+    }
+    bData = a->type == TYPED_ARRAY_F32   ? (const void *)&f32Scalar
+            : a->type == TYPED_ARRAY_F64 ? (const void *)&f64Scalar
+                                         : (const void *)&i32Scalar;
+  } else {
+    ObjTypedArray *other = asTypedArray(argv[0]);
+    if (!checkSameShape(a, other)) {
+      return STATUS_ERROR;
+    }
+    bData = other->buffer->handle.data;
+  }
+  switch (a->type) {
+    case TYPED_ARRAY_F32:
+      compareF32(cmp, dst, (const f32 *)aData, (const f32 *)bData, scalar, n);
+      return STATUS_OK;
+    case TYPED_ARRAY_F64:
+      compareF64(cmp, dst, (const f64 *)aData, (const f64 *)bData, scalar, n);
+      return STATUS_OK;
+    case TYPED_ARRAY_I32:
+      compareI32(cmp, dst, (const i32 *)aData, (const i32 *)bData, scalar, n);
+      return STATUS_OK;
+  }
+  panic("Invalid TypedArrayType %d", a->type);
+}
+
+/* Finds the smallest (or largest if 'findMax' is set) element */
+static Status extremum(ObjTypedArray *array, ubool findMax, Value *out) {
+  size_t i, n = typedArrayLength(array);
+  const void *data = array->buffer->handle.data;
+  if (n == 0) {
+    return runtimeError("%s() of an empty %s", findMax ? "max" : "min", typedArrayName(array->type));
+  }
+#define FIND_EXTREMUM(T)                                  \
+  do {                                                    \
+    const T *a = (const T *)data;                         \
+    T best = a[0];                                        \
+    if (findMax) {                                        \
+      for (i = 1; i < n; i++) best = a[i] > best ? a[i] : best; \
+    } else {                                              \
+      for (i = 1; i < n; i++) best = a[i] < best ? a[i] : best; \
+    }                                                     \
+    *out = valNumber(best);                               \
+  } while (0)
+  switch (array->type) {
+    case TYPED_ARRAY_F32:
+      FIND_EXTREMUM(f32);
+      return STATUS_OK;
+    case TYPED_ARRAY_F64:
+      FIND_EXTREMUM(f64);
+      return STATUS_OK;
+    case TYPED_ARRAY_I32:
+      FIND_EXTREMUM(i32);
+      return STATUS_OK;
+  }
+#undef FIND_EXTREMUM
+  panic("Invalid TypedArrayType %d", array->type);
+}
+
+/* Copies elements from a List, FrozenList or typed array into 'array'.
+ * The lengths must match */
+static Status copyElements(ObjTypedArray *array, Value source) {
+  size_t i, n = typedArrayLength(array);
+  if (isTypedArray(source)) {
+    ObjTypedArray *src = asTypedArray(source);
+    if (src->type == array->type) {
+      memcpy(array->buffer->handle.data, src->buffer->handle.data, n * typedArrayElementSize(array->type));
+      return STATUS_OK;
+    }
+    for (i = 0; i < n; i++) {
+      double value = getElement(src, i).as.number;
+      if (array->type == TYPED_ARRAY_I32) {
+        value = value != value ? 0 : value < 0 ? ceil(value) : floor(value);
+      }
+      if (!checkElementValue(array->type, value)) {
+        return STATUS_ERROR;
+      }
+      setElement(array, i, value);
+    }
+    return STATUS_OK;
+  } else {
+    Value *items;
+    if (isList(source)) {
+      items = asList(source)->buffer;
+    } else {
+      items = asFrozenList(source)->buffer;
+    }
+    for (i = 0; i < n; i++) {
+      double value;
+      if (!isNumber(items[i])) {
+        return runtimeError(
+            "%s requires a list of numbers but found list item %s",
+            typedArrayName(array->type),
+            getKindName(items[i]));
+      }
+      value = items[i].as.number;
+      if (!checkElementValue(array->type, value)) {
+        return STATUS_ERROR;
+      }
+      setElement(array, i, value);
+    }
+    return STATUS_OK;
+  }
+}
+
+/****************************************************************
+ * Methods
+ ****************************************************************/
+
+static Status construct(TypedArrayType type, Value arg, Value *out) {
+  ObjTypedArray *array;
+  size_t elementSize = typedArrayElementSize(type);
+  if (isNumber(arg)) {
+    *out = valTypedArray(newTypedArray(type, asSize(arg)));
+    return STATUS_OK;
+  }
+  if (isBuffer(arg)) {
+    /* Shares the Buffer's memory */
+    ObjBuffer *buffer = asBuffer(arg);
+    if (buffer->handle.isReadOnly) {
+      return runtimeError(
+          "%s requires a writable Buffer (clone() a read only one first)",
+          typedArrayName(type));
+    }
+    if (((size_t)buffer->handle.data) % elementSize != 0) {
+      return runtimeError(
+          "%s requires a Buffer whose data is aligned to %lu bytes",
+          typedArrayName(type),
+          (unsigned long)elementSize);
+    }
+    *out = valTypedArray(newTypedArrayWithBuffer(type, buffer));
+    return STATUS_OK;
+  }
+  array = newTypedArray(
+      type,
+      isTypedArray(arg) ? typedArrayLength(asTypedArray(arg))
+      : isList(arg)     ? asList(arg)->length
+                        : asFrozenList(arg)->length);
+  *out = valTypedArray(array);
+  return copyElements(array, arg);
+}
+
+static Status implFloat32ArrayStaticCall(i16 argc, Value *argv, Value *out) {
+  return construct(TYPED_ARRAY_F32, argv[0], out);
+}
+
+static Status implFloat64ArrayStaticCall(i16 argc, Value *argv, Value *out) {
+  return construct(TYPED_ARRAY_F64, argv[0], out);
+}
+
+static Status implInt32ArrayStaticCall(i16 argc, Value *argv, Value *out) {
+  return construct(TYPED_ARRAY_I32, argv[0], out);
+}
+
+static CFunction funcFloat32ArrayStaticCall = {implFloat32ArrayStaticCall, "__call__", 1};
+static CFunction funcFloat64ArrayStaticCall = {implFloat64ArrayStaticCall, "__call__", 1};
+static CFunction funcInt32ArrayStaticCall = {implInt32ArrayStaticCall, "__call__", 1};
+
+static Status implTypedArrayGetBuffer(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  *out = valBuffer(array->buffer);
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArrayGetBuffer = {implTypedArrayGetBuffer, "__get_buffer"};
+
+static Status implTypedArrayLen(i16 argc, Value *argv, Value *out) {
+  *out = valNumber(typedArrayLength(asTypedArray(argv[-1])));
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArrayLen = {implTypedArrayLen, "__len__"};
+
+static Status implTypedArrayGetitem(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  *out = getElement(array, asIndex(argv[0], typedArrayLength(array)));
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArrayGetitem = {implTypedArrayGetitem, "__getitem__", 1};
+
+static Status implTypedArraySetitem(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  size_t i = asIndex(argv[0], typedArrayLength(array));
+  double value = asNumber(argv[1]);
+  if (!checkElementValue(array->type, value)) {
+    return STATUS_ERROR;
+  }
+  setElement(array, i, value);
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArraySetitem = {implTypedArraySetitem, "__setitem__", 2};
+
+static Status implTypedArrayRepr(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  size_t i, n = typedArrayLength(array);
+  StringBuilder sb;
+  initStringBuilder(&sb);
+  sbputstr(&sb, typedArrayName(array->type));
+  sbputstr(&sb, "([");
+  for (i = 0; i < n; i++) {
+    if (i > 0) {
+      sbputstr(&sb, ", ");
+    }
+    if (array->type == TYPED_ARRAY_F32) {
+      sbputfloat(&sb, (float)getElement(array, i).as.number);
+    } else {
+      sbputnumber(&sb, getElement(array, i).as.number);
+    }
+  }
+  sbputstr(&sb, "])");
+  *out = valString(sbstring(&sb));
+  freeStringBuilder(&sb);
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArrayRepr = {implTypedArrayRepr, "__repr__"};
+
+static Status implTypedArrayClone(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  ObjTypedArray *copy = newTypedArray(array->type, typedArrayLength(array));
+  memcpy(
+      copy->buffer->handle.data,
+      array->buffer->handle.data,
+      copy->buffer->handle.length);
+  *out = valTypedArray(copy);
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArrayClone = {implTypedArrayClone, "clone"};
+
+static Status implTypedArrayToList(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  size_t i, n = typedArrayLength(array);
+  ObjList *list = newList(n);
+  for (i = 0; i < n; i++) {
+    list->buffer[i] = getElement(array, i);
+  }
+  *out = valList(list);
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArrayToList = {implTypedArrayToList, "toList"};
+
+static Status implTypedArrayCopy(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  size_t n = typedArrayLength(array);
+  size_t sourceLength = isTypedArray(argv[0]) ? typedArrayLength(asTypedArray(argv[0]))
+                        : isList(argv[0])     ? asList(argv[0])->length
+                                              : asFrozenList(argv[0])->length;
+  if (sourceLength != n) {
+    return runtimeError(
+        "%s.copy() length mismatch (%lu != %lu)",
+        typedArrayName(array->type),
+        (unsigned long)n,
+        (unsigned long)sourceLength);
+  }
+  return copyElements(array, argv[0]);
+}
+
+static CFunction funcTypedArrayCopy = {implTypedArrayCopy, "copy", 1};
+
+static Status implTypedArrayFill(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  double value = asNumber(argv[0]);
+  size_t i, n = typedArrayLength(array);
+  void *data = array->buffer->handle.data;
+  if (!checkElementValue(array->type, value)) {
+    return STATUS_ERROR;
+  }
+  switch (array->type) {
+    case TYPED_ARRAY_F32: {
+      f32 *a = (f32 *)data, x = (f32)value;
+      for (i = 0; i < n; i++) a[i] = x;
+      break;
+    }
+    case TYPED_ARRAY_F64: {
+      f64 *a = (f64 *)data;
+      for (i = 0; i < n; i++) a[i] = value;
+      break;
+    }
+    case TYPED_ARRAY_I32: {
+      i32 *a = (i32 *)data, x = (i32)value;
+      for (i = 0; i < n; i++) a[i] = x;
+      break;
+    }
+  }
+  *out = argv[-1];
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArrayFill = {implTypedArrayFill, "fill", 1};
+
+static Status implTypedArrayAdd(i16 argc, Value *argv, Value *out) {
+  return applyOpToNew(ARRAY_ADD, argv, out);
+}
+
+static Status implTypedArraySub(i16 argc, Value *argv, Value *out) {
+  return applyOpToNew(ARRAY_SUB, argv, out);
+}
+
+static Status implTypedArrayMul(i16 argc, Value *argv, Value *out) {
+  return applyOpToNew(ARRAY_MUL, argv, out);
+}
+
+static Status implTypedArrayDiv(i16 argc, Value *argv, Value *out) {
+  return applyOpToNew(ARRAY_DIV, argv, out);
+}
+
+static CFunction funcTypedArrayAdd = {implTypedArrayAdd, "__add__", 1};
+static CFunction funcTypedArraySub = {implTypedArraySub, "__sub__", 1};
+static CFunction funcTypedArrayMul = {implTypedArrayMul, "__mul__", 1};
+static CFunction funcTypedArrayDiv = {implTypedArrayDiv, "__div__", 1};
+
+static Status implTypedArrayIAdd(i16 argc, Value *argv, Value *out) {
+  return applyOpInPlace(ARRAY_ADD, argv, out);
+}
+
+static Status implTypedArrayISub(i16 argc, Value *argv, Value *out) {
+  return applyOpInPlace(ARRAY_SUB, argv, out);
+}
+
+static Status implTypedArrayIMul(i16 argc, Value *argv, Value *out) {
+  return applyOpInPlace(ARRAY_MUL, argv, out);
+}
+
+static Status implTypedArrayIDiv(i16 argc, Value *argv, Value *out) {
+  return applyOpInPlace(ARRAY_DIV, argv, out);
+}
+
+static CFunction funcTypedArrayIAdd = {implTypedArrayIAdd, "iadd", 1};
+static CFunction funcTypedArrayISub = {implTypedArrayISub, "isub", 1};
+static CFunction funcTypedArrayIMul = {implTypedArrayIMul, "imul", 1};
+static CFunction funcTypedArrayIDiv = {implTypedArrayIDiv, "idiv", 1};
+
+static Status implTypedArrayEq(i16 argc, Value *argv, Value *out) {
+  return compare(ARRAY_EQ, argv, out);
+}
+
+static Status implTypedArrayLt(i16 argc, Value *argv, Value *out) {
+  return compare(ARRAY_LT, argv, out);
+}
+
+static Status implTypedArrayLe(i16 argc, Value *argv, Value *out) {
+  return compare(ARRAY_LE, argv, out);
+}
+
+static Status implTypedArrayGt(i16 argc, Value *argv, Value *out) {
+  return compare(ARRAY_GT, argv, out);
+}
+
+static Status implTypedArrayGe(i16 argc, Value *argv, Value *out) {
+  return compare(ARRAY_GE, argv, out);
+}
+
+static CFunction funcTypedArrayEq = {implTypedArrayEq, "eq", 1};
+static CFunction funcTypedArrayLt = {implTypedArrayLt, "lt", 1};
+static CFunction funcTypedArrayLe = {implTypedArrayLe, "le", 1};
+static CFunction funcTypedArrayGt = {implTypedArrayGt, "gt", 1};
+static CFunction funcTypedArrayGe = {implTypedArrayGe, "ge", 1};
+
+static Status implTypedArrayEquals(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *a = asTypedArray(argv[-1]);
+  ObjTypedArray *b = asTypedArray(argv[0]);
+  size_t i, n = typedArrayLength(a);
+  *out = valBool(UFALSE);
+  if (a->type != b->type || n != typedArrayLength(b)) {
+    return STATUS_OK;
+  }
+  for (i = 0; i < n; i++) {
+    if (getElement(a, i).as.number != getElement(b, i).as.number) {
+      return STATUS_OK;
+    }
+  }
+  *out = valBool(UTRUE);
+  return STATUS_OK;
+}
+
+static CFunction funcTypedArrayEquals = {implTypedArrayEquals, "equals", 1};
+
+static Status implTypedArraySum(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[-1]);
+  const void *data = array->buffer->handle.data;
+  size_t n = typedArrayLength(array);
+  switch (array->type) {
+    case TYPED_ARRAY_F32:
+      *out = valNumber(sumF32((const f32 *)data, n));
+      return STATUS_OK;
+    case TYPED_ARRAY_F64:
+      *out = valNumber(sumF64((const f64 *)data, n));
+      return STATUS_OK;
+    case TYPED_ARRAY_I32:
+      *out = valNumber(sumI32((const i32 *)data, n));
+      return STATUS_OK;
+  }
+  panic("Invalid TypedArrayType %d", array->type);
+}
+
+static CFunction funcTypedArraySum = {implTypedArraySum, "sum"};
+
+static Status implTypedArrayDot(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *a = asTypedArray(argv[-1]);
+  ObjTypedArray *b = asTypedArray(argv[0]);
+  const void *aData = a->buffer->handle.data;
+  const void *bData = b->buffer->handle.data;
+  size_t n = typedArrayLength(a);
+  if (!checkSameShape(a, b)) {
+    return STATUS_ERROR;
+  }
+  switch (a->type) {
+    case TYPED_ARRAY_F32:
+      *out = valNumber(dotF32((const f32 *)aData, (const f32 *)bData, n));
+      return STATUS_OK;
+    case TYPED_ARRAY_F64:
+      *out = valNumber(dotF64((const f64 *)aData, (const f64 *)bData, n));
+      return STATUS_OK;
+    case TYPED_ARRAY_I32:
+      *out = valNumber(dotI32((const i32 *)aData, (const i32 *)bData, n));
+      return STATUS_OK;
+  }
+  panic("Invalid TypedArrayType %d", a->type);
+}
+
+static CFunction funcTypedArrayDot = {implTypedArrayDot, "dot", 1};
+
+static Status implTypedArrayMin(i16 argc, Value *argv, Value *out) {
+  return extremum(asTypedArray(argv[-1]), UFALSE, out);
+}
+
+static CFunction funcTypedArrayMin = {implTypedArrayMin, "min"};
+
+static Status implTypedArrayMax(i16 argc, Value *argv, Value *out) {
+  return extremum(asTypedArray(argv[-1]), UTRUE, out);
+}
+
+static CFunction funcTypedArrayMax = {implTypedArrayMax, "max"};
+
+static CFunction *TypedArrayMethods[] = {
+    &funcTypedArrayGetBuffer,
+    &funcTypedArrayLen,
+    &funcTypedArrayGetitem,
+    &funcTypedArraySetitem,
+    &funcTypedArrayRepr,
+    &funcTypedArrayClone,
+    &funcTypedArrayToList,
+    &funcTypedArrayCopy,
+    &funcTypedArrayFill,
+    &funcTypedArrayAdd,
+    &funcTypedArraySub,
+    &funcTypedArrayMul,
+    &funcTypedArrayDiv,
+    &funcTypedArrayIAdd,
+    &funcTypedArrayISub,
+    &funcTypedArrayIMul,
+    &funcTypedArrayIDiv,
+    &funcTypedArrayEq,
+    &funcTypedArrayLt,
+    &funcTypedArrayLe,
+    &funcTypedArrayGt,
+    &funcTypedArrayGe,
+    &funcTypedArrayEquals,
+    &funcTypedArraySum,
+    &funcTypedArrayDot,
+    &funcTypedArrayMin,
+    &funcTypedArrayMax,
+    NULL,
+};
+
+/****************************************************************
+ * VectorArray
+ *
+ * Vectors are packed as consecutive (x, y, z) f32 triples, the same
+ * precision as Vector values, so the Buffer can be handed directly
+ * to APIs that expect packed 3D float coordinates.
+ ****************************************************************/
+
+static void blackenVectorArray(ObjNative *n) {
+  markObject((Obj *)((ObjVectorArray *)n)->buffer);
+}
+
+NativeObjectDescriptor descriptorVectorArray = {
+    blackenVectorArray,
+    nopFree,
+    sizeof(ObjVectorArray),
+    "VectorArray",
+};
+
+Value valVectorArray(ObjVectorArray *array) {
+  return valObjExplicit((Obj *)array);
+}
+
+ObjVectorArray *asVectorArray(Value value) {
+  if (!isVectorArray(value)) {
+    panic("Expected VectorArray but got %s", getKindName(value));
+  }
+  return (ObjVectorArray *)value.as.obj;
+}
+
+size_t vectorArrayLength(ObjVectorArray *array) {
+  return array->buffer->handle.length / (3 * sizeof(f32));
+}
+
+static f32 *vectorArrayData(ObjVectorArray *array) {
+  return (f32 *)array->buffer->handle.data;
+}
+
+static ObjVectorArray *newVectorArrayWithBuffer(ObjBuffer *buffer) {
+  ObjVectorArray *array;
+  push(valBuffer(buffer));
+  array = NEW_NATIVE(ObjVectorArray, &descriptorVectorArray);
+  array->buffer = buffer;
+  pop(); /* buffer */
+  return array;
+}
+
+ObjVectorArray *newVectorArray(size_t length) {
+  ObjBuffer *buffer = newBuffer();
+  ObjVectorArray *array;
+  push(valBuffer(buffer));
+  bufferSetLength(&buffer->handle, length * 3 * sizeof(f32));
+  array = newVectorArrayWithBuffer(buffer);
+  pop(); /* buffer */
+  return array;
+}
+
+/* The right hand side of a VectorArray operation: either another
+ * VectorArray of the same length, or a single Vector applied to
+ * every element */
+typedef struct VectorOperand {
+  const f32 *data; /* NULL if 'vector' should be used */
+  f32 vector[3];
+} VectorOperand;
+
+static Status getVectorOperand(ObjVectorArray *array, Value value, VectorOperand *out) {
+  if (isVector(value)) {
+    Vector vector = asVector(value);
+    out->data = NULL;
+    out->vector[0] = vector.x;
+    out->vector[1] = vector.y;
+    out->vector[2] = vector.z;
+  } else {
+    ObjVectorArray *other = asVectorArray(value);
+    if (vectorArrayLength(other) != vectorArrayLength(array)) {
+      return runtimeError(
+          "VectorArray length mismatch (%lu != %lu)",
+          (unsigned long)vectorArrayLength(array),
+          (unsigned long)vectorArrayLength(other));
+    }
+    out->data = vectorArrayData(other);
+  }
+  return STATUS_OK;
+}
+
+static void vectorOp(ArrayOp op, f32 *dst, const f32 *a, VectorOperand *b, size_t count) {
+  size_t i;
+  f32 x, y, z;
+  if (b->data) {
+    binaryF32(op, dst, a, b->data, 3 * count);
+    return;
+  }
+  x = b->vector[0];
+  y = b->vector[1];
+  z = b->vector[2];
+  switch (op) {
+    case ARRAY_ADD:
+      for (i = 0; i < 3 * count; i += 3) {
+        dst[i] = a[i] + x;
+        dst[i + 1] = a[i + 1] + y;
+        dst[i + 2] = a[i + 2] + z;
+      }
+      return;
+    case ARRAY_SUB:
+      for (i = 0; i < 3 * count; i += 3) {
+        dst[i] = a[i] - x;
+        dst[i + 1] = a[i + 1] - y;
+        dst[i + 2] = a[i + 2] - z;
+      }
+      return;
+    case ARRAY_MUL:
+      for (i = 0; i < 3 * count; i += 3) {
+        dst[i] = a[i] * x;
+        dst[i + 1] = a[i + 1] * y;
+        dst[i + 2] = a[i + 2] * z;
+      }
+      return;
+    case ARRAY_DIV:
+      for (i = 0; i < 3 * count; i += 3) {
+        dst[i] = a[i] / x;
+        dst[i + 1] = a[i + 1] / y;
+        dst[i + 2] = a[i + 2] / z;
+      }
+      return;
+  }
+}
+
+static void vectorDot(f32 *dst, const f32 *a, VectorOperand *b, size_t count) {
+  size_t i;
+  if (b->data) {
+    const f32 *c = b->data;
+    for (i = 0; i < count; i++) {
+      dst[i] = a[3 * i] * c[3 * i] + a[3 * i + 1] * c[3 * i + 1] + a[3 * i + 2] * c[3 * i + 2];
+    }
+  } else {
+    const f32 x = b->vector[0], y = b->vector[1], z = b->vector[2];
+    for (i = 0; i < count; i++) {
+      dst[i] = a[3 * i] * x + a[3 * i + 1] * y + a[3 * i + 2] * z;
+    }
+  }
+}
+
+/* 'dst' must not overlap 'a' or 'b' */
+static void vectorCross(f32 *dst, const f32 *a, VectorOperand *b, size_t count) {
+  size_t i;
+  const f32 *c = b->data ? b->data : b->vector;
+  const size_t step = b->data ? 3 : 0;
+  for (i = 0; i < count; i++, a += 3, c += step, dst += 3) {
+    dst[0] = a[1] * c[2] - a[2] * c[1];
+    dst[1] = a[2] * c[0] - a[0] * c[2];
+    dst[2] = a[0] * c[1] - a[1] * c[0];
+  }
+}
+
+static void vectorLengths(f32 *dst, const f32 *a, size_t count) {
+  size_t i;
+  for (i = 0; i < count; i++, a += 3) {
+    dst[i] = (f32)sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+  }
+}
+
+/* Zero length vectors are left unchanged */
+static void vectorNormalize(f32 *a, size_t count) {
+  size_t i;
+  for (i = 0; i < count; i++, a += 3) {
+    f32 length = (f32)sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    if (length > 0) {
+      f32 inverse = 1 / length;
+      a[0] *= inverse;
+      a[1] *= inverse;
+      a[2] *= inverse;
+    }
+  }
+}
+
+/* Applies a 4x4 row-major matrix to every vector, treating each as the
+ * point (x, y, z, 1). The results are divided by w unless w is 0 or 1 */
+static void vectorTransform(f32 *a, const f32 *m, size_t count) {
+  size_t i;
+  ubool affine = m[12] == 0 && m[13] == 0 && m[14] == 0 && m[15] == 1;
+  for (i = 0; i < count; i++, a += 3) {
+    f32 x = a[0], y = a[1], z = a[2];
+    a[0] = m[0] * x + m[1] * y + m[2] * z + m[3];
+    a[1] = m[4] * x + m[5] * y + m[6] * z + m[7];
+    a[2] = m[8] * x + m[9] * y + m[10] * z + m[11];
+    if (!affine) {
+      f32 w = m[12] * x + m[13] * y + m[14] * z + m[15];
+      if (w != 0 && w != 1) {
+        a[0] /= w;
+        a[1] /= w;
+        a[2] /= w;
+      }
+    }
+  }
+}
+
+/* Rotating about the X, Y or Z axis is the same 2D rotation applied to
+ * a different pair of coordinates */
+static void vectorRotate(f32 *a, size_t first, size_t second, double angle, Vector center, size_t count) {
+  const f32 cost = (f32)cos(angle), sint = (f32)sin(angle);
+  f32 c[3], c1, c2;
+  size_t i;
+  c[0] = center.x;
+  c[1] = center.y;
+  c[2] = center.z;
+  c1 = c[first];
+  c2 = c[second];
+  for (i = 0; i < count; i++, a += 3) {
+    f32 u = a[first] - c1, v = a[second] - c2;
+    a[first] = cost * u - sint * v + c1;
+    a[second] = sint * u + cost * v + c2;
+  }
+}
+
+static Status implVectorArrayStaticCall(i16 argc, Value *argv, Value *out) {
+  Value arg = argv[0];
+  ObjVectorArray *array;
+  Value *items;
+  size_t i, n;
+  f32 *data;
+  if (isNumber(arg)) {
+    *out = valVectorArray(newVectorArray(asSize(arg)));
+    return STATUS_OK;
+  }
+  if (isBuffer(arg)) {
+    /* Shares the Buffer's memory */
+    ObjBuffer *buffer = asBuffer(arg);
+    if (buffer->handle.isReadOnly) {
+      return runtimeError(
+          "VectorArray requires a writable Buffer (clone() a read only one first)");
+    }
+    if (((size_t)buffer->handle.data) % sizeof(f32) != 0) {
+      return runtimeError(
+          "VectorArray requires a Buffer whose data is aligned to %lu bytes",
+          (unsigned long)sizeof(f32));
+    }
+    *out = valVectorArray(newVectorArrayWithBuffer(buffer));
+    return STATUS_OK;
+  }
+  if (isList(arg)) {
+    items = asList(arg)->buffer;
+    n = asList(arg)->length;
+  } else {
+    items = asFrozenList(arg)->buffer;
+    n = asFrozenList(arg)->length;
+  }
+  array = newVectorArray(n);
+  *out = valVectorArray(array);
+  data = vectorArrayData(array);
+  for (i = 0; i < n; i++) {
+    Vector vector;
+    if (!isVector(items[i])) {
+      return runtimeError(
+          "VectorArray requires a list of Vectors but found list item %s",
+          getKindName(items[i]));
+    }
+    vector = asVector(items[i]);
+    data[3 * i] = vector.x;
+    data[3 * i + 1] = vector.y;
+    data[3 * i + 2] = vector.z;
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayStaticCall = {implVectorArrayStaticCall, "__call__", 1};
+
+static Status implVectorArrayGetBuffer(i16 argc, Value *argv, Value *out) {
+  *out = valBuffer(asVectorArray(argv[-1])->buffer);
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayGetBuffer = {implVectorArrayGetBuffer, "__get_buffer"};
+
+static Status implVectorArrayLen(i16 argc, Value *argv, Value *out) {
+  *out = valNumber(vectorArrayLength(asVectorArray(argv[-1])));
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayLen = {implVectorArrayLen, "__len__"};
+
+static Status implVectorArrayGetitem(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *array = asVectorArray(argv[-1]);
+  const f32 *v = vectorArrayData(array) + 3 * asIndex(argv[0], vectorArrayLength(array));
+  *out = valVector(newVector(v[0], v[1], v[2]));
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayGetitem = {implVectorArrayGetitem, "__getitem__", 1};
+
+static Status implVectorArraySetitem(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *array = asVectorArray(argv[-1]);
+  f32 *v = vectorArrayData(array) + 3 * asIndex(argv[0], vectorArrayLength(array));
+  Vector vector = asVector(argv[1]);
+  v[0] = vector.x;
+  v[1] = vector.y;
+  v[2] = vector.z;
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArraySetitem = {implVectorArraySetitem, "__setitem__", 2};
+
+static Status implVectorArrayRepr(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *array = asVectorArray(argv[-1]);
+  const f32 *data = vectorArrayData(array);
+  size_t i, n = vectorArrayLength(array);
+  StringBuilder sb;
+  initStringBuilder(&sb);
+  sbputstr(&sb, "VectorArray([");
+  for (i = 0; i < n; i++) {
+    if (i > 0) {
+      sbputstr(&sb, ", ");
+    }
+    sbputstr(&sb, "Vector(");
+    sbputfloat(&sb, data[3 * i]);
+    sbputstr(&sb, ", ");
+    sbputfloat(&sb, data[3 * i + 1]);
+    sbputstr(&sb, ", ");
+    sbputfloat(&sb, data[3 * i + 2]);
+    sbputstr(&sb, ")");
+  }
+  sbputstr(&sb, "])");
+  *out = valString(sbstring(&sb));
+  freeStringBuilder(&sb);
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayRepr = {implVectorArrayRepr, "__repr__"};
+
+static Status implVectorArrayClone(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *array = asVectorArray(argv[-1]);
+  ObjVectorArray *copy = newVectorArray(vectorArrayLength(array));
+  memcpy(vectorArrayData(copy), vectorArrayData(array), copy->buffer->handle.length);
+  *out = valVectorArray(copy);
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayClone = {implVectorArrayClone, "clone"};
+
+static Status implVectorArrayToList(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *array = asVectorArray(argv[-1]);
+  const f32 *data = vectorArrayData(array);
+  size_t i, n = vectorArrayLength(array);
+  ObjList *list = newList(n);
+  for (i = 0; i < n; i++) {
+    list->buffer[i] = valVector(newVector(data[3 * i], data[3 * i + 1], data[3 * i + 2]));
+  }
+  *out = valList(list);
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayToList = {implVectorArrayToList, "toList"};
+
+static Status applyVectorOpToNew(ArrayOp op, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  ObjVectorArray *result;
+  VectorOperand b;
+  if (!getVectorOperand(a, argv[0], &b)) {
+    return STATUS_ERROR;
+  }
+  result = newVectorArray(vectorArrayLength(a));
+  vectorOp(op, vectorArrayData(result), vectorArrayData(a), &b, vectorArrayLength(a));
+  *out = valVectorArray(result);
+  return STATUS_OK;
+}
+
+static Status applyVectorOpInPlace(ArrayOp op, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  VectorOperand b;
+  if (!getVectorOperand(a, argv[0], &b)) {
+    return STATUS_ERROR;
+  }
+  vectorOp(op, vectorArrayData(a), vectorArrayData(a), &b, vectorArrayLength(a));
+  *out = argv[-1];
+  return STATUS_OK;
+}
+
+static Status implVectorArrayAdd(i16 argc, Value *argv, Value *out) {
+  return applyVectorOpToNew(ARRAY_ADD, argv, out);
+}
+
+static Status implVectorArraySub(i16 argc, Value *argv, Value *out) {
+  return applyVectorOpToNew(ARRAY_SUB, argv, out);
+}
+
+static Status implVectorArrayMul(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  size_t n = vectorArrayLength(a);
+  ObjVectorArray *result = newVectorArray(n);
+  scalarF32(ARRAY_MUL, vectorArrayData(result), vectorArrayData(a), (f32)asNumber(argv[0]), 3 * n);
+  *out = valVectorArray(result);
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayAdd = {implVectorArrayAdd, "__add__", 1};
+static CFunction funcVectorArraySub = {implVectorArraySub, "__sub__", 1};
+static CFunction funcVectorArrayMul = {implVectorArrayMul, "__mul__", 1};
+
+static Status implVectorArrayIAdd(i16 argc, Value *argv, Value *out) {
+  return applyVectorOpInPlace(ARRAY_ADD, argv, out);
+}
+
+static Status implVectorArrayISub(i16 argc, Value *argv, Value *out) {
+  return applyVectorOpInPlace(ARRAY_SUB, argv, out);
+}
+
+static Status implVectorArrayIMul(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  size_t n = vectorArrayLength(a);
+  scalarF32(ARRAY_MUL, vectorArrayData(a), vectorArrayData(a), (f32)asNumber(argv[0]), 3 * n);
+  *out = argv[-1];
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayIAdd = {implVectorArrayIAdd, "iadd", 1};
+static CFunction funcVectorArrayISub = {implVectorArrayISub, "isub", 1};
+static CFunction funcVectorArrayIMul = {implVectorArrayIMul, "imul", 1};
+
+static Status implVectorArrayScale(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  VectorOperand factors;
+  factors.data = NULL;
+  factors.vector[0] = (f32)asNumber(argv[0]);
+  factors.vector[1] = (f32)asNumber(argv[1]);
+  factors.vector[2] = argc > 2 && !isNil(argv[2]) ? (f32)asNumber(argv[2]) : 1.0f;
+  vectorOp(ARRAY_MUL, vectorArrayData(a), vectorArrayData(a), &factors, vectorArrayLength(a));
+  *out = argv[-1];
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayScale = {implVectorArrayScale, "scale", 2, 3};
+
+static Status implVectorArrayDot(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  ObjTypedArray *result;
+  VectorOperand b;
+  if (!getVectorOperand(a, argv[0], &b)) {
+    return STATUS_ERROR;
+  }
+  result = newTypedArray(TYPED_ARRAY_F32, vectorArrayLength(a));
+  vectorDot((f32 *)result->buffer->handle.data, vectorArrayData(a), &b, vectorArrayLength(a));
+  *out = valTypedArray(result);
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayDot = {implVectorArrayDot, "dot", 1};
+
+static Status implVectorArrayCross(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  ObjVectorArray *result;
+  VectorOperand b;
+  if (!getVectorOperand(a, argv[0], &b)) {
+    return STATUS_ERROR;
+  }
+  result = newVectorArray(vectorArrayLength(a));
+  vectorCross(vectorArrayData(result), vectorArrayData(a), &b, vectorArrayLength(a));
+  *out = valVectorArray(result);
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayCross = {implVectorArrayCross, "cross", 1};
+
+static Status implVectorArrayLengths(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  ObjTypedArray *result = newTypedArray(TYPED_ARRAY_F32, vectorArrayLength(a));
+  vectorLengths((f32 *)result->buffer->handle.data, vectorArrayData(a), vectorArrayLength(a));
+  *out = valTypedArray(result);
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayLengths = {implVectorArrayLengths, "lengths"};
+
+static Status implVectorArrayNormalize(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  vectorNormalize(vectorArrayData(a), vectorArrayLength(a));
+  *out = argv[-1];
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayNormalize = {implVectorArrayNormalize, "normalize"};
+
+static Status rotate(size_t first, size_t second, i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  double angle = asNumber(argv[0]);
+  Vector center = argc > 1 && !isNil(argv[1]) ? asVector(argv[1]) : newVector(0, 0, 0);
+  vectorRotate(vectorArrayData(a), first, second, angle, center, vectorArrayLength(a));
+  *out = argv[-1];
+  return STATUS_OK;
+}
+
+static Status implVectorArrayRotateX(i16 argc, Value *argv, Value *out) {
+  return rotate(1, 2, argc, argv, out);
+}
+
+static Status implVectorArrayRotateY(i16 argc, Value *argv, Value *out) {
+  return rotate(2, 0, argc, argv, out);
+}
+
+static Status implVectorArrayRotateZ(i16 argc, Value *argv, Value *out) {
+  return rotate(0, 1, argc, argv, out);
+}
+
+static CFunction funcVectorArrayRotateX = {implVectorArrayRotateX, "rotateX", 1, 2};
+static CFunction funcVectorArrayRotateY = {implVectorArrayRotateY, "rotateY", 1, 2};
+static CFunction funcVectorArrayRotateZ = {implVectorArrayRotateZ, "rotateZ", 1, 2};
+static CFunction funcVectorArrayRotate = {implVectorArrayRotateZ, "rotate", 1, 2};
+
+static Status implVectorArrayTransform(i16 argc, Value *argv, Value *out) {
+  ObjVectorArray *a = asVectorArray(argv[-1]);
+  Value arg = argv[0];
+  f32 matrix[16];
+  size_t i;
+  if (isTypedArray(arg)) {
+    ObjTypedArray *m = asTypedArray(arg);
+    if (typedArrayLength(m) != 16) {
+      return runtimeError(
+          "VectorArray.transform() requires 16 matrix entries but got %lu",
+          (unsigned long)typedArrayLength(m));
+    }
+    for (i = 0; i < 16; i++) {
+      matrix[i] = (f32)typedArrayGetNumber(m, i);
+    }
+  } else {
+    Value *items = isList(arg) ? asList(arg)->buffer : asFrozenList(arg)->buffer;
+    size_t n = isList(arg) ? asList(arg)->length : asFrozenList(arg)->length;
+    if (n != 16) {
+      return runtimeError(
+          "VectorArray.transform() requires 16 matrix entries but got %lu",
+          (unsigned long)n);
+    }
+    for (i = 0; i < 16; i++) {
+      matrix[i] = (f32)asNumber(items[i]);
+    }
+  }
+  vectorTransform(vectorArrayData(a), matrix, vectorArrayLength(a));
+  *out = argv[-1];
+  return STATUS_OK;
+}
+
+static CFunction funcVectorArrayTransform = {implVectorArrayTransform, "transform", 1};
+
+static CFunction *VectorArrayMethods[] = {
+    &funcVectorArrayGetBuffer,
+    &funcVectorArrayLen,
+    &funcVectorArrayGetitem,
+    &funcVectorArraySetitem,
+    &funcVectorArrayRepr,
+    &funcVectorArrayClone,
+    &funcVectorArrayToList,
+    &funcVectorArrayAdd,
+    &funcVectorArraySub,
+    &funcVectorArrayMul,
+    &funcVectorArrayIAdd,
+    &funcVectorArrayISub,
+    &funcVectorArrayIMul,
+    &funcVectorArrayScale,
+    &funcVectorArrayDot,
+    &funcVectorArrayCross,
+    &funcVectorArrayLengths,
+    &funcVectorArrayNormalize,
+    &funcVectorArrayRotateX,
+    &funcVectorArrayRotateY,
+    &funcVectorArrayRotateZ,
+    &funcVectorArrayRotate,
+    &funcVectorArrayTransform,
+    NULL,
+};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *float32ArrayStaticMethods[] = {
+      &funcFloat32ArrayStaticCall,
+      NULL,
+  };
+  CFunction *float64ArrayStaticMethods[] = {
+      &funcFloat64ArrayStaticCall,
+      NULL,
+  };
+  CFunction *int32ArrayStaticMethods[] = {
+      &funcInt32ArrayStaticCall,
+      NULL,
+  };
+  CFunction *vectorArrayStaticMethods[] = {
+      &funcVectorArrayStaticCall,
+      NULL,
+  };
+
+  newNativeClass(
+      module,
+      &descriptorFloat32Array,
+      TypedArrayMethods,
+      float32ArrayStaticMethods);
+  newNativeClass(
+      module,
+      &descriptorFloat64Array,
+      TypedArrayMethods,
+      float64ArrayStaticMethods);
+  newNativeClass(
+      module,
+      &descriptorInt32Array,
+      TypedArrayMethods,
+      int32ArrayStaticMethods);
+  newNativeClass(
+      module,
+      &descriptorVectorArray,
+      VectorArrayMethods,
+      vectorArrayStaticMethods);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "array", 1};
+
+void addNativeModuleArray(void) {
+  addNativeModule(&func);
+}
@@ -0,0 +1,68 @@
+#ifndef mtots_m_array_h
+#define mtots_m_array_h
+
+#include "mtots_object.h"
+
+/* Native Module array
+ * Typed numeric arrays backed by a Buffer, with bulk operations
+ * that run as plain C loops over the whole array */
+
+#define isTypedArray(v) (getTypedArrayDescriptorType(getNativeObjectDescriptor(v)) >= 0)
+#define isVectorArray(v) (getNativeObjectDescriptor(v) == &descriptorVectorArray)
+
+typedef enum TypedArrayType {
+  TYPED_ARRAY_F32,
+  TYPED_ARRAY_F64,
+  TYPED_ARRAY_I32
+} TypedArrayType;
+
+/* Elements are stored in the Buffer in native byte order,
+ * regardless of the Buffer's byteOrder */
+typedef struct ObjTypedArray {
+  ObjNative obj;
+  TypedArrayType type;
+  ObjBuffer *buffer;
+} ObjTypedArray;
+
+extern NativeObjectDescriptor descriptorFloat32Array;
+extern NativeObjectDescriptor descriptorFloat64Array;
+extern NativeObjectDescriptor descriptorInt32Array;
+
+/* Returns the TypedArrayType for the given descriptor, or -1 if
+ * the descriptor does not belong to a typed array */
+int getTypedArrayDescriptorType(NativeObjectDescriptor *descriptor);
+
+Value valTypedArray(ObjTypedArray *array);
+ObjTypedArray *asTypedArray(Value value);
+
+/* Creates a new zero filled typed array with its own Buffer */
+ObjTypedArray *newTypedArray(TypedArrayType type, size_t length);
+
+size_t typedArrayElementSize(TypedArrayType type);
+size_t typedArrayLength(ObjTypedArray *array);
+
+/* Element access for other native modules. 'i' must be in bounds.
+ * typedArraySetNumber fails if the value does not fit the element type */
+double typedArrayGetNumber(ObjTypedArray *array, size_t i);
+Status typedArraySetNumber(ObjTypedArray *array, size_t i, double value);
+
+/* Packed array of 3D vectors, stored in the Buffer as consecutive
+ * (x, y, z) f32 triples in native byte order */
+typedef struct ObjVectorArray {
+  ObjNative obj;
+  ObjBuffer *buffer;
+} ObjVectorArray;
+
+extern NativeObjectDescriptor descriptorVectorArray;
+
+Value valVectorArray(ObjVectorArray *array);
+ObjVectorArray *asVectorArray(Value value);
+
+/* Creates a new VectorArray of zero vectors with its own Buffer */
+ObjVectorArray *newVectorArray(size_t length);
+
+size_t vectorArrayLength(ObjVectorArray *array);
+
+void addNativeModuleArray(void);
+
+#endif /*mtots_m_array_h*/
@@ -0,0 +1,173 @@
+#include "mtots_m_base64.h"
+
+#include <string.h>
+
+#include "mtots.h"
+
+typedef struct ObjEncoder {
+  ObjNative obj;
+  Base64Encoder handle;
+} ObjEncoder;
+
+typedef struct ObjDecoder {
+  ObjNative obj;
+  Base64Decoder handle;
+} ObjDecoder;
+
+WRAP_C_TYPE_EX(Encoder, Base64Encoder, static, nopBlacken, nopFree)
+WRAP_C_TYPE_EX(Decoder, Base64Decoder, static, nopBlacken, nopFree)
+
+/* Gets the bytes of a Buffer or String argument. The output Buffer
+ * must not be the input, since growing it could move the input */
+static Status getInput(
+    const char *functionName, Value value, ObjBuffer *out,
+    const u8 **data, size_t *length) {
+  if (isString(value)) {
+    String *string = asString(value);
+    *data = (const u8 *)string->chars;
+    *length = string->byteLength;
+  } else {
+    ObjBuffer *buffer = asBuffer(value);
+    if (buffer == out) {
+      return runtimeError("%s: the output Buffer cannot also be the input", functionName);
+    }
+    *data = buffer->handle.data;
+    *length = buffer->handle.length;
+  }
+  return STATUS_OK;
+}
+
+/* Returns the output Buffer argument at 'argv[i]', or a new Buffer if it
+ * is missing or nil. The result is also stored in '*out' */
+static ObjBuffer *getOutput(i16 argc, Value *argv, i16 i, Value *out) {
+  ObjBuffer *buffer = argc > i && !isNil(argv[i]) ? asBuffer(argv[i]) : newBuffer();
+  *out = valBuffer(buffer);
+  return buffer;
+}
+
+static Status implEncode(i16 argc, Value *argv, Value *out) {
+  ObjBuffer *output = getOutput(argc, argv, 1, out);
+  const u8 *data;
+  size_t length;
+  if (!getInput("base64.encode()", argv[0], output, &data, &length)) {
+    return STATUS_ERROR;
+  }
+  encodeBase64ToBuffer(data, length, &output->handle);
+  return STATUS_OK;
+}
+
+static CFunction funcEncode = {implEncode, "encode", 1, 2};
+
+static Status implDecode(i16 argc, Value *argv, Value *out) {
+  ObjBuffer *output = getOutput(argc, argv, 1, out);
+  const u8 *data;
+  size_t length;
+  if (!getInput("base64.decode()", argv[0], output, &data, &length)) {
+    return STATUS_ERROR;
+  }
+  return decodeBase64((const char *)data, length, &output->handle);
+}
+
+static CFunction funcDecode = {implDecode, "decode", 1, 2};
+
+static Status implEncoderStaticCall(i16 argc, Value *argv, Value *out) {
+  ObjEncoder *encoder = allocEncoder();
+  initBase64Encoder(&encoder->handle);
+  *out = valEncoder(encoder);
+  return STATUS_OK;
+}
+
+static CFunction funcEncoderStaticCall = {implEncoderStaticCall, "__call__"};
+
+static Status implEncoderUpdate(i16 argc, Value *argv, Value *out) {
+  ObjEncoder *encoder = asEncoder(argv[-1]);
+  ObjBuffer *output = asBuffer(argv[1]);
+  const u8 *data;
+  size_t length;
+  if (!getInput("Encoder.update()", argv[0], output, &data, &length)) {
+    return STATUS_ERROR;
+  }
+  base64EncoderUpdate(&encoder->handle, data, length, &output->handle);
+  return STATUS_OK;
+}
+
+static CFunction funcEncoderUpdate = {implEncoderUpdate, "update", 2};
+
+static Status implEncoderFinish(i16 argc, Value *argv, Value *out) {
+  base64EncoderFinish(&asEncoder(argv[-1])->handle, &asBuffer(argv[0])->handle);
+  return STATUS_OK;
+}
+
+static CFunction funcEncoderFinish = {implEncoderFinish, "finish", 1};
+
+static Status implDecoderStaticCall(i16 argc, Value *argv, Value *out) {
+  ObjDecoder *decoder = allocDecoder();
+  initBase64Decoder(&decoder->handle);
+  *out = valDecoder(decoder);
+  return STATUS_OK;
+}
+
+static CFunction funcDecoderStaticCall = {implDecoderStaticCall, "__call__"};
+
+static Status implDecoderUpdate(i16 argc, Value *argv, Value *out) {
+  ObjDecoder *decoder = asDecoder(argv[-1]);
+  ObjBuffer *output = asBuffer(argv[1]);
+  const u8 *data;
+  size_t length;
+  if (!getInput("Decoder.update()", argv[0], output, &data, &length)) {
+    return STATUS_ERROR;
+  }
+  return base64DecoderUpdate(&decoder->handle, (const char *)data, length, &output->handle);
+}
+
+static CFunction funcDecoderUpdate = {implDecoderUpdate, "update", 2};
+
+static Status implDecoderFinish(i16 argc, Value *argv, Value *out) {
+  return base64DecoderFinish(&asDecoder(argv[-1])->handle);
+}
+
+static CFunction funcDecoderFinish = {implDecoderFinish, "finish"};
+
+static CFunction *EncoderMethods[] = {
+    &funcEncoderUpdate,
+    &funcEncoderFinish,
+    NULL,
+};
+
+static CFunction *EncoderStaticMethods[] = {
+    &funcEncoderStaticCall,
+    NULL,
+};
+
+static CFunction *DecoderMethods[] = {
+    &funcDecoderUpdate,
+    &funcDecoderFinish,
+    NULL,
+};
+
+static CFunction *DecoderStaticMethods[] = {
+    &funcDecoderStaticCall,
+    NULL,
+};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *functions[] = {
+      &funcEncode,
+      &funcDecode,
+      NULL,
+  };
+
+  moduleAddFunctions(module, functions);
+
+  ADD_TYPE_TO_MODULE(Encoder);
+  ADD_TYPE_TO_MODULE(Decoder);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "base64", 1};
+
+void addNativeModuleBase64(void) {
+  addNativeModule(&func);
+}
@@ -0,0 +1,10 @@
+#ifndef mtots_m_base64_h
+#define mtots_m_base64_h
+
+/* Native Module base64
+ * Buffer to Buffer base64 encoding and decoding, in one call
+ * or incrementally */
+
+void addNativeModuleBase64(void);
+
+#endif /*mtots_m_base64_h*/
@@ -1,6 +1,8 @@
 #include "mtots_m_c.h"
 
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "mtots.h"
 
@@ -25,6 +27,184 @@ WRAP_C_FUNCTION_EX(mallocSizeof, MallocSizeof, 1, 2, {
 
 WRAP_C_FUNCTION_EX(free, Free, 1, 0, free(asVoidPointer(argv[0])))
 
+static ScalarType getIntScalarType(size_t size, ubool isSigned) {
+  switch (size) {
+    case 1:
+      return isSigned ? SCALAR_I8 : SCALAR_U8;
+    case 2:
+      return isSigned ? SCALAR_I16 : SCALAR_U16;
+    case 4:
+      return isSigned ? SCALAR_I32 : SCALAR_U32;
+  }
+  return isSigned ? SCALAR_I64 : SCALAR_U64;
+}
+
+static Status getScalarType(TypedPointer pointer, ScalarType *out) {
+  switch (pointer.metadata.type) {
+    case POINTER_TYPE_VOID:
+      break;
+    case POINTER_TYPE_CHAR:
+      *out = getIntScalarType(sizeof(char), CHAR_MIN < 0);
+      return STATUS_OK;
+    case POINTER_TYPE_SHORT:
+      *out = getIntScalarType(sizeof(short), UTRUE);
+      return STATUS_OK;
+    case POINTER_TYPE_INT:
+      *out = getIntScalarType(sizeof(int), UTRUE);
+      return STATUS_OK;
+    case POINTER_TYPE_LONG:
+      *out = getIntScalarType(sizeof(long), UTRUE);
+      return STATUS_OK;
+    case POINTER_TYPE_UNSIGNED_SHORT:
+      *out = getIntScalarType(sizeof(unsigned short), UFALSE);
+      return STATUS_OK;
+    case POINTER_TYPE_UNSIGNED_INT:
+      *out = getIntScalarType(sizeof(unsigned int), UFALSE);
+      return STATUS_OK;
+    case POINTER_TYPE_UNSIGNED_LONG:
+      *out = getIntScalarType(sizeof(unsigned long), UFALSE);
+      return STATUS_OK;
+    case POINTER_TYPE_U8:
+      *out = SCALAR_U8;
+      return STATUS_OK;
+    case POINTER_TYPE_U16:
+      *out = SCALAR_U16;
+      return STATUS_OK;
+    case POINTER_TYPE_U32:
+      *out = SCALAR_U32;
+      return STATUS_OK;
+    case POINTER_TYPE_U64:
+      *out = SCALAR_U64;
+      return STATUS_OK;
+    case POINTER_TYPE_I8:
+      *out = SCALAR_I8;
+      return STATUS_OK;
+    case POINTER_TYPE_I16:
+      *out = SCALAR_I16;
+      return STATUS_OK;
+    case POINTER_TYPE_I32:
+      *out = SCALAR_I32;
+      return STATUS_OK;
+    case POINTER_TYPE_I64:
+      *out = SCALAR_I64;
+      return STATUS_OK;
+    case POINTER_TYPE_SIZE_T:
+      *out = getIntScalarType(sizeof(size_t), UFALSE);
+      return STATUS_OK;
+    case POINTER_TYPE_PTRDIFF_T:
+      *out = getIntScalarType(sizeof(ptrdiff_t), UTRUE);
+      return STATUS_OK;
+    case POINTER_TYPE_FLOAT:
+      *out = SCALAR_F32;
+      return STATUS_OK;
+    case POINTER_TYPE_DOUBLE:
+      *out = SCALAR_F64;
+      return STATUS_OK;
+  }
+  runtimeError(
+      "Expected a pointer to a numeric type but got %s pointer",
+      getPointerTypeName(pointer.metadata.type));
+  return STATUS_ERROR;
+}
+
+static Status getWritablePointer(Value value, TypedPointer *out) {
+  *out = asPointer(value);
+  if (out->metadata.isConst) {
+    runtimeError("Expected a non-const destination pointer");
+    return STATUS_ERROR;
+  }
+  return STATUS_OK;
+}
+
+static const void *getReadablePointer(TypedPointer pointer) {
+  return pointer.metadata.isConst ?
+      pointer.as.constVoidPointer : pointer.as.voidPointer;
+}
+
+static Status implCopy(i16 argc, Value *argv, Value *out) {
+  TypedPointer dst, src = asPointer(argv[1]);
+  ScalarType dstType, srcType;
+  size_t count = asSize(argv[2]);
+  double scale = argc > 3 && !isNil(argv[3]) ? asNumber(argv[3]) : 1;
+  double bias = argc > 4 && !isNil(argv[4]) ? asNumber(argv[4]) : 0;
+  if (!getWritablePointer(argv[0], &dst) ||
+      !getScalarType(dst, &dstType) ||
+      !getScalarType(src, &srcType)) {
+    return STATUS_ERROR;
+  }
+  convertScalars(
+      dst.as.voidPointer, dstType,
+      getReadablePointer(src), srcType,
+      count, scale, bias);
+  return STATUS_OK;
+}
+
+static CFunction funcCopy = {implCopy, "copy", 3, 5};
+
+static Status checkSameItemSize(TypedPointer dst, TypedPointer src, size_t *out) {
+  ScalarType dstType, srcType;
+  if (!getScalarType(dst, &dstType) || !getScalarType(src, &srcType)) {
+    return STATUS_ERROR;
+  }
+  if (getScalarTypeSize(dstType) != getScalarTypeSize(srcType)) {
+    runtimeError(
+        "Expected pointers with the same item size but got %s and %s",
+        getPointerTypeName(dst.metadata.type),
+        getPointerTypeName(src.metadata.type));
+    return STATUS_ERROR;
+  }
+  *out = getScalarTypeSize(dstType);
+  return STATUS_OK;
+}
+
+static Status implGather(i16 argc, Value *argv, Value *out) {
+  TypedPointer dst, src = asPointer(argv[1]);
+  size_t count = asSize(argv[2]), srcStride = asSize(argv[3]), itemSize;
+  if (!getWritablePointer(argv[0], &dst) ||
+      !checkSameItemSize(dst, src, &itemSize)) {
+    return STATUS_ERROR;
+  }
+  gatherItems(
+      dst.as.voidPointer, getReadablePointer(src), itemSize, count, srcStride);
+  return STATUS_OK;
+}
+
+static CFunction funcGather = {implGather, "gather", 4};
+
+static Status implScatter(i16 argc, Value *argv, Value *out) {
+  TypedPointer dst, src = asPointer(argv[1]);
+  size_t count = asSize(argv[2]), dstStride = asSize(argv[3]), itemSize;
+  if (!getWritablePointer(argv[0], &dst) ||
+      !checkSameItemSize(dst, src, &itemSize)) {
+    return STATUS_ERROR;
+  }
+  scatterItems(
+      dst.as.voidPointer, getReadablePointer(src), itemSize, count, dstStride);
+  return STATUS_OK;
+}
+
+static CFunction funcScatter = {implScatter, "scatter", 4};
+
+static Status implMemcmp(i16 argc, Value *argv, Value *out) {
+  const void *a = getReadablePointer(asPointer(argv[0]));
+  const void *b = getReadablePointer(asPointer(argv[1]));
+  int cmp = memcmp(a, b, asSize(argv[2]));
+  *out = valNumber(cmp < 0 ? -1 : cmp > 0 ? 1 : 0);
+  return STATUS_OK;
+}
+
+static CFunction funcMemcmp = {implMemcmp, "memcmp", 3};
+
+static Status implMemchr(i16 argc, Value *argv, Value *out) {
+  const u8 *start = (const u8 *)getReadablePointer(asPointer(argv[0]));
+  const u8 *found = (const u8 *)memchr(
+      start, (u8)asNumber(argv[1]), asSize(argv[2]));
+  *out = found ? valNumber(found - start) : valNil();
+  return STATUS_OK;
+}
+
+static CFunction funcMemchr = {implMemchr, "memchr", 3};
+
 static Status impl(i16 argc, Value *argv, Value *out) {
   ObjModule *module = asModule(argv[0]);
   CFunction *functions[] = {
@@ -32,6 +212,11 @@ static Status impl(i16 argc, Value *argv, Value *out) {
       &funcMalloc,
       &funcMallocSizeof,
       &funcFree,
+      &funcCopy,
+      &funcGather,
+      &funcScatter,
+      &funcMemcmp,
+      &funcMemchr,
       NULL,
   };
 
@@ -1,7 +1,17 @@
 #include "mtots_m_data.h"
 
+#include <string.h>
+
 #include "mtots.h"
 
+#if MTOTS_IS_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 static void blackenDataSource(ObjNative *n) {
   ObjDataSource *dataSource = (ObjDataSource *)n;
   switch (dataSource->type) {
@@ -156,6 +166,93 @@ ubool dataSourceReadToString(ObjDataSource *ds, String **out) {
   return STATUS_OK;
 }
 
+#if MTOTS_IS_POSIX
+/* Returns STATUS_OK without mapping anything if the file
+ * cannot be mapped but may still be readable */
+static ubool mapFile(const char *path, DataSourceView *view) {
+  struct stat st;
+  void *data;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    runtimeError("%s: %s", path, strerror(errno));
+    return STATUS_ERROR;
+  }
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    close(fd);
+    return STATUS_OK;
+  }
+  data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return STATUS_OK;
+  }
+  view->data = (const u8 *)data;
+  view->length = (size_t)st.st_size;
+  view->mapped = UTRUE;
+  return STATUS_OK;
+}
+#endif
+
+ubool dataSourceOpenView(ObjDataSource *ds, DataSourceView *view) {
+  view->data = NULL;
+  view->length = 0;
+  view->mapped = UFALSE;
+  initBuffer(&view->buffer);
+  switch (ds->type) {
+    case DATA_SOURCE_BUFFER:
+      view->data = ds->as.buffer->handle.data;
+      view->length = ds->as.buffer->handle.length;
+      return STATUS_OK;
+    case DATA_SOURCE_STRING:
+      view->data = (const u8 *)ds->as.string->chars;
+      view->length = ds->as.string->byteLength;
+      return STATUS_OK;
+    case DATA_SOURCE_FILE:
+      return openFileView(ds->as.file.path->chars, view);
+  }
+  panic("Invalid DataSourceType %d", ds->type);
+}
+
+ubool openMappedFileView(const char *path, DataSourceView *view) {
+  view->data = NULL;
+  view->length = 0;
+  view->mapped = UFALSE;
+  initBuffer(&view->buffer);
+#if MTOTS_IS_POSIX
+  return mapFile(path, view);
+#else
+  return STATUS_OK;
+#endif
+}
+
+ubool openFileView(const char *path, DataSourceView *view) {
+  if (!openMappedFileView(path, view)) {
+    return STATUS_ERROR;
+  }
+  if (view->mapped) {
+    return STATUS_OK;
+  }
+  if (!readFileIntoBuffer(path, &view->buffer)) {
+    freeBuffer(&view->buffer);
+    return STATUS_ERROR;
+  }
+  view->data = view->buffer.data;
+  view->length = view->buffer.length;
+  return STATUS_OK;
+}
+
+void dataSourceCloseView(DataSourceView *view) {
+#if MTOTS_IS_POSIX
+  if (view->mapped) {
+    munmap((void *)view->data, view->length);
+  }
+#endif
+  freeBuffer(&view->buffer);
+  view->data = NULL;
+  view->length = 0;
+  view->mapped = UFALSE;
+}
+
 ObjDataSink *newDataSinkFromBuffer(ObjBuffer *buffer) {
   ObjDataSink *ds = NEW_NATIVE(ObjDataSink, &descriptorDataSink);
   ds->type = DATA_SINK_BUFFER;
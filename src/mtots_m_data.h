@@ -44,6 +44,20 @@ typedef struct ObjDataSink {
   } as;
 } ObjDataSink;
 
+/* Read only access to the bytes of a DataSource without copying them.
+ * Buffer and String sources are used in place, and files are memory
+ * mapped where the platform allows it (otherwise they are read into
+ * 'buffer').
+ *
+ * A Buffer or String source must stay alive and unmodified until the
+ * view is closed */
+typedef struct DataSourceView {
+  const u8 *data;
+  size_t length;
+  ubool mapped;
+  Buffer buffer;
+} DataSourceView;
+
 extern NativeObjectDescriptor descriptorDataSource;
 extern NativeObjectDescriptor descriptorDataSink;
 
@@ -59,6 +73,16 @@ ObjDataSource *newDataSourceFromFile(String *filePath);
 ubool dataSourceInitBuffer(ObjDataSource *ds, Buffer *out);
 ubool dataSourceReadIntoBuffer(ObjDataSource *ds, Buffer *out);
 ubool dataSourceReadToString(ObjDataSource *ds, String **out);
+ubool dataSourceOpenView(ObjDataSource *ds, DataSourceView *view);
+void dataSourceCloseView(DataSourceView *view);
+
+/* Memory maps the file at 'path' into 'view' where the platform allows it.
+ * If the file cannot be mapped, 'view->mapped' is left false and nothing
+ * else is done. Close the view with dataSourceCloseView */
+ubool openMappedFileView(const char *path, DataSourceView *view);
+
+/* Like dataSourceOpenView for a file source, but for a plain path */
+ubool openFileView(const char *path, DataSourceView *view);
 
 ObjDataSink *newDataSinkFromBuffer(ObjBuffer *buffer);
 ObjDataSink *newDataSinkFromFile(String *filePath);
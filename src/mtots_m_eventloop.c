@@ -0,0 +1,518 @@
+#include "mtots_m_eventloop.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtots.h"
+#include "mtots_util_fd.h"
+#include "mtots_vm.h"
+
+#define NSEC_IN_SEC 1000000000
+
+typedef struct Watcher {
+  Value reader; /* nil if not watching for reads */
+  Value writer; /* nil if not watching for writes */
+} Watcher;
+
+typedef struct Timer {
+  double when;
+  u32 id;
+  Value callback;
+} Timer;
+
+typedef enum PendingKind {
+  PENDING_CALL,
+  PENDING_READ,
+  PENDING_WRITE
+} PendingKind;
+
+/* A callback that is ready to run. For reads and writes, the callback
+ * is looked up right before it is called, so that a callback removed
+ * earlier in the same batch is never called */
+typedef struct Pending {
+  PendingKind kind;
+  int fd;
+  Value callback;
+} Pending;
+
+typedef struct EventLoop {
+  MTOTSPoller poller;
+  ubool hasPoller;
+
+  Watcher *watchers; /* indexed by file descriptor */
+  size_t watcherCapacity;
+  size_t watcherCount; /* number of file descriptors with any callback */
+
+  Timer *timers; /* binary min-heap ordered by (when, id) */
+  size_t timerCount;
+  size_t timerCapacity;
+  u32 nextTimerID;
+
+  Pending *pending;
+  size_t pendingHead;     /* next pending callback to run */
+  size_t pendingBatchEnd; /* callbacks added after this run in the next batch */
+  size_t pendingCount;
+  size_t pendingCapacity;
+
+  ubool stopRequested;
+} EventLoop;
+
+typedef struct ObjEventLoop {
+  ObjNative obj;
+  EventLoop handle;
+} ObjEventLoop;
+
+static void blackenEventLoop(ObjNative *n) {
+  EventLoop *loop = &((ObjEventLoop *)n)->handle;
+  size_t i;
+  for (i = 0; i < loop->watcherCapacity; i++) {
+    markValue(loop->watchers[i].reader);
+    markValue(loop->watchers[i].writer);
+  }
+  for (i = 0; i < loop->timerCount; i++) {
+    markValue(loop->timers[i].callback);
+  }
+  for (i = loop->pendingHead; i < loop->pendingCount; i++) {
+    markValue(loop->pending[i].callback);
+  }
+}
+
+static void freeEventLoop(ObjNative *n) {
+  EventLoop *loop = &((ObjEventLoop *)n)->handle;
+  if (loop->hasPoller) {
+    MTOTSPollerFree(&loop->poller);
+  }
+  free(loop->watchers);
+  free(loop->timers);
+  free(loop->pending);
+}
+
+WRAP_C_TYPE_EX(EventLoop, EventLoop, static, blackenEventLoop, freeEventLoop)
+
+static void *growArray(void *array, size_t *capacity, size_t minCapacity, size_t itemSize) {
+  size_t newCapacity = *capacity < 8 ? 8 : *capacity;
+  while (newCapacity < minCapacity) {
+    newCapacity *= 2;
+  }
+  array = realloc(array, newCapacity * itemSize);
+  if (!array) {
+    panic("out of memory");
+  }
+  *capacity = newCapacity;
+  return array;
+}
+
+/* Timers are measured against this clock, in seconds.
+ *
+ * Without POSIX there is no poller, so creating an EventLoop fails
+ * before any timer can be scheduled. The fallback only keeps this file
+ * building there: it is wall-clock time with a resolution of one second
+ * (clock() would measure CPU time, which stops while the loop waits) */
+static double monotonicTime(void) {
+#if MTOTS_IS_POSIX
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ((double)ts.tv_nsec) / NSEC_IN_SEC;
+#else
+  return (double)time(NULL);
+#endif
+}
+
+static Status getFD(Value value, int *out) {
+  int fd = isFileDescriptor(value) ? value.as.fileDescriptor : asInt(value);
+  if (fd < 0) {
+    return runtimeError("Invalid file descriptor %d", fd);
+  }
+  *out = fd;
+  return STATUS_OK;
+}
+
+static void addPending(EventLoop *loop, PendingKind kind, int fd, Value callback) {
+  Pending *pending;
+  if (loop->pendingCount == loop->pendingCapacity) {
+    loop->pending = (Pending *)growArray(
+        loop->pending, &loop->pendingCapacity, loop->pendingCount + 1, sizeof(Pending));
+  }
+  pending = &loop->pending[loop->pendingCount++];
+  pending->kind = kind;
+  pending->fd = fd;
+  pending->callback = callback;
+}
+
+/****************************************************************
+ * Timer heap
+ ****************************************************************/
+
+static ubool timerBefore(Timer *a, Timer *b) {
+  return a->when < b->when || (a->when == b->when && a->id < b->id);
+}
+
+static void timerSwap(EventLoop *loop, size_t i, size_t j) {
+  Timer tmp = loop->timers[i];
+  loop->timers[i] = loop->timers[j];
+  loop->timers[j] = tmp;
+}
+
+static void timerSiftUp(EventLoop *loop, size_t i) {
+  while (i > 0 && timerBefore(&loop->timers[i], &loop->timers[(i - 1) / 2])) {
+    timerSwap(loop, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void timerSiftDown(EventLoop *loop, size_t i) {
+  for (;;) {
+    size_t left = 2 * i + 1, right = left + 1, smallest = i;
+    if (left < loop->timerCount && timerBefore(&loop->timers[left], &loop->timers[smallest])) {
+      smallest = left;
+    }
+    if (right < loop->timerCount && timerBefore(&loop->timers[right], &loop->timers[smallest])) {
+      smallest = right;
+    }
+    if (smallest == i) {
+      return;
+    }
+    timerSwap(loop, i, smallest);
+    i = smallest;
+  }
+}
+
+static void timerRemoveAt(EventLoop *loop, size_t i) {
+  loop->timers[i] = loop->timers[--loop->timerCount];
+  if (i < loop->timerCount) {
+    timerSiftUp(loop, i);
+    timerSiftDown(loop, i);
+  }
+}
+
+/****************************************************************
+ * File descriptor watchers
+ ****************************************************************/
+
+static Status updateWatcher(EventLoop *loop, int fd, Value reader, Value writer) {
+  Watcher *watcher;
+  ubool wasWatched, isWatched;
+  if ((size_t)fd >= loop->watcherCapacity) {
+    size_t i = loop->watcherCapacity;
+    loop->watchers = (Watcher *)growArray(
+        loop->watchers, &loop->watcherCapacity, (size_t)fd + 1, sizeof(Watcher));
+    for (; i < loop->watcherCapacity; i++) {
+      loop->watchers[i].reader = loop->watchers[i].writer = valNil();
+    }
+  }
+  watcher = &loop->watchers[fd];
+  wasWatched = !isNil(watcher->reader) || !isNil(watcher->writer);
+  isWatched = !isNil(reader) || !isNil(writer);
+  if (!MTOTSPollerSet(
+          &loop->poller,
+          fd,
+          (isNil(reader) ? 0 : MTOTS_POLL_IN) | (isNil(writer) ? 0 : MTOTS_POLL_OUT))) {
+    return STATUS_ERROR;
+  }
+  watcher->reader = reader;
+  watcher->writer = writer;
+  if (wasWatched && !isWatched) {
+    loop->watcherCount--;
+  } else if (!wasWatched && isWatched) {
+    loop->watcherCount++;
+  }
+  return STATUS_OK;
+}
+
+static Watcher *getWatcher(EventLoop *loop, int fd) {
+  return (size_t)fd < loop->watcherCapacity ? &loop->watchers[fd] : NULL;
+}
+
+/****************************************************************
+ * Running the loop
+ ****************************************************************/
+
+static int getPollTimeout(EventLoop *loop) {
+  double delay;
+  if (loop->pendingCount > 0) {
+    return 0;
+  }
+  if (loop->timerCount == 0) {
+    return -1;
+  }
+  delay = ceil((loop->timers[0].when - monotonicTime()) * 1000);
+  return delay <= 0 ? 0 : delay >= INT_MAX ? INT_MAX : (int)delay;
+}
+
+/* Waits for file descriptors and timers, and queues up the
+ * callbacks that are ready as the next batch */
+static Status pollEventLoop(EventLoop *loop) {
+  int timeout = getPollTimeout(loop);
+  double now;
+
+  if (loop->watcherCount > 0 || timeout != 0) {
+    MTOTSPollEvent *events;
+    size_t i, count;
+    if (!MTOTSPollerWait(&loop->poller, timeout, &events, &count)) {
+      return STATUS_ERROR;
+    }
+    for (i = 0; i < count; i++) {
+      int fd = events[i].fd;
+      Watcher *watcher = getWatcher(loop, fd);
+      if (!watcher) {
+        continue;
+      }
+      if ((events[i].events & (MTOTS_POLL_IN | MTOTS_POLL_ERR)) && !isNil(watcher->reader)) {
+        addPending(loop, PENDING_READ, fd, valNil());
+      }
+      if ((events[i].events & (MTOTS_POLL_OUT | MTOTS_POLL_ERR)) && !isNil(watcher->writer)) {
+        addPending(loop, PENDING_WRITE, fd, valNil());
+      }
+    }
+  }
+
+  now = monotonicTime();
+  while (loop->timerCount > 0 && loop->timers[0].when <= now) {
+    addPending(loop, PENDING_CALL, -1, loop->timers[0].callback);
+    timerRemoveAt(loop, 0);
+  }
+
+  loop->pendingBatchEnd = loop->pendingCount;
+
+  if (vm.trap && !checkAndHandleSignals()) {
+    return STATUS_ERROR;
+  }
+
+  return STATUS_OK;
+}
+
+static NativeContinuation runContinuation;
+
+/* Runs the loop until either nothing is left to wait on or stop() is
+ * called. Each callback is run with 'scheduleCall', and this function
+ * is called again once the callback returns */
+static Status stepEventLoop(EventLoop *loop) {
+  for (;;) {
+    if (loop->stopRequested) {
+      loop->stopRequested = UFALSE;
+      return STATUS_OK;
+    }
+
+    while (loop->pendingHead < loop->pendingBatchEnd) {
+      Pending pending = loop->pending[loop->pendingHead++];
+      Watcher *watcher = getWatcher(loop, pending.fd);
+      switch (pending.kind) {
+        case PENDING_CALL:
+          push(pending.callback);
+          return scheduleCall(0, &runContinuation);
+        case PENDING_READ:
+          if (watcher && !isNil(watcher->reader)) {
+            push(watcher->reader);
+            push(valFileDescriptor(pending.fd));
+            return scheduleCall(1, &runContinuation);
+          }
+          break;
+        case PENDING_WRITE:
+          if (watcher && !isNil(watcher->writer)) {
+            push(watcher->writer);
+            push(valFileDescriptor(pending.fd));
+            return scheduleCall(1, &runContinuation);
+          }
+          break;
+      }
+    }
+
+    /* The batch is done - drop it and keep anything queued since */
+    memmove(
+        loop->pending,
+        loop->pending + loop->pendingHead,
+        sizeof(Pending) * (loop->pendingCount - loop->pendingHead));
+    loop->pendingCount -= loop->pendingHead;
+    loop->pendingHead = loop->pendingBatchEnd = 0;
+
+    if (loop->watcherCount == 0 && loop->timerCount == 0 && loop->pendingCount == 0) {
+      return STATUS_OK;
+    }
+
+    if (!pollEventLoop(loop)) {
+      return STATUS_ERROR;
+    }
+  }
+}
+
+static Status resumeRun(i16 argc, Value *argv, Value result, Value *out) {
+  return stepEventLoop(&asEventLoop(argv[-1])->handle);
+}
+
+static NativeContinuation runContinuation = {resumeRun, NULL};
+
+/****************************************************************
+ * EventLoop methods
+ ****************************************************************/
+
+static Status implEventLoopStaticCall(i16 argc, Value *argv, Value *out) {
+  ObjEventLoop *loop = allocEventLoop();
+  push(valEventLoop(loop));
+  if (!MTOTSPollerInit(&loop->handle.poller)) {
+    pop();
+    return STATUS_ERROR;
+  }
+  loop->handle.hasPoller = UTRUE;
+  loop->handle.nextTimerID = 1;
+  *out = pop();
+  return STATUS_OK;
+}
+
+static CFunction funcEventLoopStaticCall = {implEventLoopStaticCall, "__call__"};
+
+static Status implEventLoopAddReader(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  int fd;
+  Watcher *watcher;
+  if (!getFD(argv[0], &fd)) {
+    return STATUS_ERROR;
+  }
+  watcher = getWatcher(loop, fd);
+  return updateWatcher(loop, fd, argv[1], watcher ? watcher->writer : valNil());
+}
+
+static CFunction funcEventLoopAddReader = {implEventLoopAddReader, "addReader", 2};
+
+static Status implEventLoopAddWriter(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  int fd;
+  Watcher *watcher;
+  if (!getFD(argv[0], &fd)) {
+    return STATUS_ERROR;
+  }
+  watcher = getWatcher(loop, fd);
+  return updateWatcher(loop, fd, watcher ? watcher->reader : valNil(), argv[1]);
+}
+
+static CFunction funcEventLoopAddWriter = {implEventLoopAddWriter, "addWriter", 2};
+
+static Status implEventLoopRemoveReader(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  int fd;
+  Watcher *watcher;
+  if (!getFD(argv[0], &fd)) {
+    return STATUS_ERROR;
+  }
+  watcher = getWatcher(loop, fd);
+  if (!watcher || isNil(watcher->reader)) {
+    *out = valBool(UFALSE);
+    return STATUS_OK;
+  }
+  *out = valBool(UTRUE);
+  return updateWatcher(loop, fd, valNil(), watcher->writer);
+}
+
+static CFunction funcEventLoopRemoveReader = {implEventLoopRemoveReader, "removeReader", 1};
+
+static Status implEventLoopRemoveWriter(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  int fd;
+  Watcher *watcher;
+  if (!getFD(argv[0], &fd)) {
+    return STATUS_ERROR;
+  }
+  watcher = getWatcher(loop, fd);
+  if (!watcher || isNil(watcher->writer)) {
+    *out = valBool(UFALSE);
+    return STATUS_OK;
+  }
+  *out = valBool(UTRUE);
+  return updateWatcher(loop, fd, watcher->reader, valNil());
+}
+
+static CFunction funcEventLoopRemoveWriter = {implEventLoopRemoveWriter, "removeWriter", 1};
+
+static Status implEventLoopCallSoon(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  addPending(loop, PENDING_CALL, -1, argv[0]);
+  return STATUS_OK;
+}
+
+static CFunction funcEventLoopCallSoon = {implEventLoopCallSoon, "callSoon", 1};
+
+static Status implEventLoopCallLater(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  double delay = asNumber(argv[0]);
+  Timer *timer;
+  if (loop->timerCount == loop->timerCapacity) {
+    loop->timers = (Timer *)growArray(
+        loop->timers, &loop->timerCapacity, loop->timerCount + 1, sizeof(Timer));
+  }
+  timer = &loop->timers[loop->timerCount++];
+  timer->when = monotonicTime() + (delay > 0 ? delay : 0);
+  timer->id = loop->nextTimerID++;
+  timer->callback = argv[1];
+  *out = valNumber(timer->id);
+  timerSiftUp(loop, loop->timerCount - 1);
+  return STATUS_OK;
+}
+
+static CFunction funcEventLoopCallLater = {implEventLoopCallLater, "callLater", 2};
+
+static Status implEventLoopCancel(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  u32 id = asU32(argv[0]);
+  size_t i;
+  for (i = 0; i < loop->timerCount; i++) {
+    if (loop->timers[i].id == id) {
+      timerRemoveAt(loop, i);
+      *out = valBool(UTRUE);
+      return STATUS_OK;
+    }
+  }
+  *out = valBool(UFALSE);
+  return STATUS_OK;
+}
+
+static CFunction funcEventLoopCancel = {implEventLoopCancel, "cancel", 1};
+
+static Status implEventLoopRun(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  loop->stopRequested = UFALSE;
+  return stepEventLoop(loop);
+}
+
+static CFunction funcEventLoopRun = {implEventLoopRun, "run"};
+
+static Status implEventLoopStop(i16 argc, Value *argv, Value *out) {
+  EventLoop *loop = &asEventLoop(argv[-1])->handle;
+  loop->stopRequested = UTRUE;
+  return STATUS_OK;
+}
+
+static CFunction funcEventLoopStop = {implEventLoopStop, "stop"};
+
+static CFunction *EventLoopStaticMethods[] = {
+    &funcEventLoopStaticCall,
+    NULL,
+};
+
+static CFunction *EventLoopMethods[] = {
+    &funcEventLoopAddReader,
+    &funcEventLoopAddWriter,
+    &funcEventLoopRemoveReader,
+    &funcEventLoopRemoveWriter,
+    &funcEventLoopCallSoon,
+    &funcEventLoopCallLater,
+    &funcEventLoopCancel,
+    &funcEventLoopRun,
+    &funcEventLoopStop,
+    NULL,
+};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+
+  ADD_TYPE_TO_MODULE(EventLoop);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "eventloop", 1};
+
+void addNativeModuleEventLoop(void) {
+  addNativeModule(&func);
+}
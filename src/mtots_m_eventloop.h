@@ -0,0 +1,8 @@
+#ifndef mtots_m_eventloop_h
+#define mtots_m_eventloop_h
+
+/* Native Module eventloop */
+
+void addNativeModuleEventLoop(void);
+
+#endif /*mtots_m_eventloop_h*/
@@ -7,6 +7,42 @@
 #include "mtots.h"
 #include "mtots_common.h"
 
+#if MTOTS_IS_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Owner of the memory region of a Buffer returned by fs.mmap().
+ * The mapping is removed when this object is collected */
+typedef struct MemoryMap {
+  u8 *data;
+  size_t length;
+  ubool writable; /* if false, the mapping is read only */
+} MemoryMap;
+
+typedef struct ObjMemoryMap {
+  ObjNative obj;
+  MemoryMap handle;
+} ObjMemoryMap;
+
+static void freeMemoryMap(ObjNative *n) {
+  MemoryMap *map = &((ObjMemoryMap *)n)->handle;
+#if MTOTS_IS_POSIX
+  if (map->data) {
+    munmap(map->data, map->length);
+  }
+#endif
+  map->data = NULL;
+  map->length = 0;
+}
+
+WRAP_C_TYPE_EX(MemoryMap, MemoryMap, static, nopBlacken, freeMemoryMap)
+static CFunction *MemoryMapMethods[] = {NULL};
+static CFunction *MemoryMapStaticMethods[] = {NULL};
+
 static Status implReadString(i16 argCount, Value *args, Value *out) {
   String *fileName = asString(args[0]);
   size_t fileSize;
@@ -239,6 +275,156 @@ static Status implBasename(i16 argCount, Value *args, Value *out) {
 
 static CFunction funcBasename = {implBasename, "basename", 1, 0};
 
+static Status implMmap(i16 argc, Value *argv, Value *out) {
+#if MTOTS_IS_POSIX
+  String *path = asString(argv[0]);
+  ubool writable = argc > 1 && !isNil(argv[1]) ? asBool(argv[1]) : UFALSE;
+  ObjMemoryMap *map;
+  ObjBuffer *buffer;
+  struct stat st;
+  void *data;
+  int fd;
+
+  fd = open(path->chars, writable ? O_RDWR : O_RDONLY);
+  if (fd < 0) {
+    runtimeError("fs.mmap(): %s: %s", path->chars, strerror(errno));
+    return STATUS_ERROR;
+  }
+  if (fstat(fd, &st) != 0) {
+    runtimeError("fs.mmap(): %s: %s", path->chars, strerror(errno));
+    close(fd);
+    return STATUS_ERROR;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    runtimeError("fs.mmap(): %s is not a regular file", path->chars);
+    close(fd);
+    return STATUS_ERROR;
+  }
+
+  map = allocMemoryMap();
+  push(valMemoryMap(map));
+
+  /* Zero length mappings are not allowed, but an empty
+   * Buffer serves just as well for empty files */
+  if (st.st_size > 0) {
+    /* Read only mappings are mapped without PROT_WRITE, so they are not
+     * charged against commit memory. The Buffer is marked read only so
+     * that writes to it raise errors instead of faulting */
+    data = mmap(
+        NULL, (size_t)st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+        writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      runtimeError("fs.mmap(): %s: %s", path->chars, strerror(errno));
+      close(fd);
+      return STATUS_ERROR;
+    }
+    map->handle.data = (u8 *)data;
+    map->handle.length = (size_t)st.st_size;
+  }
+  map->handle.writable = writable;
+  close(fd);
+
+  buffer = newBufferWithExternalData(
+      valMemoryMap(map), map->handle.data, map->handle.length);
+  if (!writable) {
+    bufferLockReadOnly(&buffer->handle);
+  }
+  pop(); /* map */
+  *out = valBuffer(buffer);
+  return STATUS_OK;
+#else
+  runtimeError("fs.mmap() is not supported on this platform");
+  return STATUS_ERROR;
+#endif
+}
+
+static CFunction funcMmap = {implMmap, "mmap", 1, 2};
+
+/* Finds the mapping backing the given Buffer (or a view of such a Buffer)
+ * and sets 'start' and 'length' to the page aligned range it covers */
+static Status getMappedRange(
+    const char *functionName, Value value, ObjMemoryMap **outMap,
+    u8 **start, size_t *length) {
+  ObjBuffer *buffer = asBuffer(value);
+  Value owner = buffer->memoryRegionOwner;
+  u8 *end = buffer->handle.data + buffer->handle.length;
+  size_t pageSize;
+  while (isBuffer(owner)) {
+    owner = asBuffer(owner)->memoryRegionOwner;
+  }
+  if (!isMemoryMap(owner)) {
+    runtimeError("%s: Buffer was not created by fs.mmap()", functionName);
+    return STATUS_ERROR;
+  }
+#if MTOTS_IS_POSIX
+  pageSize = (size_t)sysconf(_SC_PAGESIZE);
+#else
+  pageSize = 1;
+#endif
+  *outMap = asMemoryMap(owner);
+  *start = buffer->handle.data - (buffer->handle.data - (*outMap)->handle.data) % pageSize;
+  *length = (size_t)(end - *start);
+  return STATUS_OK;
+}
+
+static Status implMsync(i16 argc, Value *argv, Value *out) {
+  ObjMemoryMap *map;
+  u8 *start;
+  size_t length;
+  if (!getMappedRange("fs.msync()", argv[0], &map, &start, &length)) {
+    return STATUS_ERROR;
+  }
+  if (!map->handle.writable) {
+    runtimeError("fs.msync(): Buffer was not mapped as writable");
+    return STATUS_ERROR;
+  }
+#if MTOTS_IS_POSIX
+  if (length > 0 && msync(start, length, MS_SYNC) != 0) {
+    runtimeError("fs.msync(): %s", strerror(errno));
+    return STATUS_ERROR;
+  }
+#endif
+  return STATUS_OK;
+}
+
+static CFunction funcMsync = {implMsync, "msync", 1};
+
+static Status implMadvise(i16 argc, Value *argv, Value *out) {
+  String *adviceName = asString(argv[1]);
+  ObjMemoryMap *map;
+  u8 *start;
+  size_t length;
+  if (!getMappedRange("fs.madvise()", argv[0], &map, &start, &length)) {
+    return STATUS_ERROR;
+  }
+#if MTOTS_IS_POSIX
+  {
+    int advice;
+    if (strcmp(adviceName->chars, "normal") == 0) {
+      advice = MADV_NORMAL;
+    } else if (strcmp(adviceName->chars, "random") == 0) {
+      advice = MADV_RANDOM;
+    } else if (strcmp(adviceName->chars, "sequential") == 0) {
+      advice = MADV_SEQUENTIAL;
+    } else if (strcmp(adviceName->chars, "willneed") == 0) {
+      advice = MADV_WILLNEED;
+    } else if (strcmp(adviceName->chars, "dontneed") == 0) {
+      advice = MADV_DONTNEED;
+    } else {
+      runtimeError("fs.madvise(): Unrecognized advice %s", adviceName->chars);
+      return STATUS_ERROR;
+    }
+    if (length > 0 && madvise(start, length, advice) != 0) {
+      runtimeError("fs.madvise(): %s", strerror(errno));
+      return STATUS_ERROR;
+    }
+  }
+#endif
+  return STATUS_OK;
+}
+
+static CFunction funcMadvise = {implMadvise, "madvise", 2};
+
 static Status impl(i16 argCount, Value *args, Value *out) {
   ObjModule *module = asModule(args[0]);
   CFunction *functions[] = {
@@ -254,10 +440,14 @@ static Status impl(i16 argCount, Value *args, Value *out) {
       &funcJoin,
       &funcDirname,
       &funcBasename,
+      &funcMmap,
+      &funcMsync,
+      &funcMadvise,
       NULL,
   };
 
   moduleAddFunctions(module, functions);
+  ADD_TYPE_TO_MODULE(MemoryMap);
   mapSetN(&module->fields, "sep", valString(internCString(PATH_SEP_STR)));
 
   return STATUS_OK;
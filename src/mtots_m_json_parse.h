@@ -335,7 +335,7 @@ static Status parseNumber(JSONParseState *s) {
       incr(s);
     }
   }
-  push(valNumber(atof(start)));
+  push(valNumber(parseDouble(start, NULL)));
   return STATUS_OK;
 }
 
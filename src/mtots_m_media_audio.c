@@ -0,0 +1,730 @@
+#include "mtots_m_media_audio.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtots.h"
+#include "mtots_m_array.h"
+#include "mtots_m_data.h"
+
+#if MTOTS_ENABLE_DR_MP3
+#define DR_MP3_IMPLEMENTATION
+#define DR_MP3_NO_STDIO
+#include "dr_mp3.h"
+#endif
+
+#define WAVEFORM_SINE 0
+#define WAVEFORM_SQUARE 1
+#define WAVEFORM_SAW 2
+#define WAVEFORM_NOISE 3
+
+/* Waveforms are generated this many samples at a time */
+#define WAVE_CHUNK_SIZE 1024
+
+#define WAVE_HEADER_SIZE 44
+
+/* Wave files with more channels than this are rejected as corrupt */
+#define WAVE_MAX_CHANNEL_COUNT 32
+
+static size_t getAudioSamplesSize(ObjAudio *audio) {
+  return audio->sampleCount * AUDIO_CHANNEL_COUNT * sizeof(i16);
+}
+
+static void freeAudio(ObjNative *n) {
+  ObjAudio *audio = (ObjAudio *)n;
+  if (audio->samples) {
+    trackExternalFree(EXTERNAL_MEMORY_NATIVE, getAudioSamplesSize(audio));
+    free(audio->samples);
+    audio->samples = NULL;
+  }
+}
+
+NativeObjectDescriptor descriptorAudio = {
+    nopBlacken,
+    freeAudio,
+    sizeof(ObjAudio),
+    "Audio",
+};
+
+Value valAudio(ObjAudio *audio) {
+  return valObjExplicit((Obj *)audio);
+}
+
+ObjAudio *asAudio(Value value) {
+  if (!isAudio(value)) {
+    panic("Expected Audio but got %s", getKindName(value));
+  }
+  return (ObjAudio *)value.as.obj;
+}
+
+ObjAudio *newAudio(size_t sampleCount) {
+  ObjAudio *audio;
+  i16 *samples;
+  if (sampleCount > (size_t)-1 / (AUDIO_CHANNEL_COUNT * sizeof(i16)) - 1) {
+    panic("Audio too long (%lu samples)", (unsigned long)sampleCount);
+  }
+  samples = (i16 *)calloc(sampleCount * AUDIO_CHANNEL_COUNT + 1, sizeof(i16));
+  if (!samples) {
+    panic("Failed to allocate Audio with %lu samples", (unsigned long)sampleCount);
+  }
+  audio = NEW_NATIVE(ObjAudio, &descriptorAudio);
+  audio->sampleCount = sampleCount;
+  audio->samples = samples;
+  trackExternalAllocation(EXTERNAL_MEMORY_NATIVE, getAudioSamplesSize(audio));
+  return audio;
+}
+
+/****************************************************************
+ * Kernels
+ *
+ * Plain loops over contiguous samples with no calls or branches
+ * other than the clamps, so that the compiler can vectorize them.
+ * Sample math is done in float and clamped to the 16-bit range
+ * before being stored.
+ ****************************************************************/
+
+#define CLAMP_SAMPLE(v) ((v) < -32768.0f ? -32768.0f : (v) > 32767.0f ? 32767.0f : (v))
+
+/* dst[i] += src[i] * gain */
+static void mixSamples(i16 *dst, const i16 *src, size_t count, float gain) {
+  size_t i;
+  for (i = 0; i < count; i++) {
+    float v = dst[i] + src[i] * gain;
+    dst[i] = (i16)CLAMP_SAMPLE(v);
+  }
+}
+
+/* Scales each sample by a gain that changes linearly
+ * by 'step' per sample, starting at 'gain'.
+ * Loop indices that are converted to float are kept to i32,
+ * since unsigned and 64-bit conversions do not vectorize */
+static void fadeSamples(i16 *samples, size_t sampleCount, double gain, double step) {
+  size_t start;
+  for (start = 0; start < sampleCount; start += WAVE_CHUNK_SIZE) {
+    i32 i, count = (i32)(sampleCount - start < WAVE_CHUNK_SIZE ?
+                            sampleCount - start : WAVE_CHUNK_SIZE);
+    i16 *chunk = samples + start * AUDIO_CHANNEL_COUNT;
+    float chunkGain = (float)(gain + step * start), chunkStep = (float)step;
+    for (i = 0; i < count; i++) {
+      float g = chunkGain + chunkStep * (float)i;
+      float left = chunk[2 * i] * g;
+      float right = chunk[2 * i + 1] * g;
+      chunk[2 * i] = (i16)CLAMP_SAMPLE(left);
+      chunk[2 * i + 1] = (i16)CLAMP_SAMPLE(right);
+    }
+  }
+}
+
+/* Adds the mono 'wave' scaled by 'amplitude' to both channels */
+static void addWaveSamples(i16 *samples, const float *wave, size_t sampleCount, float amplitude) {
+  size_t i;
+  for (i = 0; i < sampleCount; i++) {
+    float w = wave[i] * amplitude;
+    float left = samples[2 * i] + w;
+    float right = samples[2 * i + 1] + w;
+    samples[2 * i] = (i16)CLAMP_SAMPLE(left);
+    samples[2 * i + 1] = (i16)CLAMP_SAMPLE(right);
+  }
+}
+
+static void samplesToFloats(float *dst, const i16 *src, size_t count) {
+  size_t i;
+  for (i = 0; i < count; i++) {
+    dst[i] = src[i] * (1.0f / 32768.0f);
+  }
+}
+
+static void floatsToSamples(i16 *dst, const float *src, size_t count) {
+  size_t i;
+  for (i = 0; i < count; i++) {
+    float v = src[i] * 32768.0f;
+    dst[i] = (i16)CLAMP_SAMPLE(v);
+  }
+}
+
+/* Linear interpolation between the stereo samples of 'src', reading
+ * 'step' source samples for every destination sample */
+static void resampleSamples(
+    i16 *dst, size_t dstCount, const i16 *src, size_t srcCount, double step) {
+  size_t i;
+  for (i = 0; i < dstCount; i++) {
+    double position = i * step;
+    size_t j = (size_t)position;
+    size_t k = j + 1 < srcCount ? j + 1 : srcCount - 1;
+    float t = (float)(position - j);
+    float left = src[2 * j] + (src[2 * k] - src[2 * j]) * t;
+    float right = src[2 * j + 1] + (src[2 * k + 1] - src[2 * j + 1]) * t;
+    dst[2 * i] = (i16)CLAMP_SAMPLE(left);
+    dst[2 * i + 1] = (i16)CLAMP_SAMPLE(right);
+  }
+}
+
+static size_t getResampledCount(size_t count, double step) {
+  return count == 0 ? 0 : (size_t)((count - 1) / step) + 1;
+}
+
+/* Fills 'wave' with 'count' samples of the waveform in [-1, 1].
+ * 'phase' is the position in the cycle of the first sample (in [0, 1))
+ * and 'delta' is how far the cycle advances with each sample.
+ * 'state' holds the noise generator's state between chunks */
+static void generateWave(
+    int waveform, float *wave, size_t count, double phase, double delta,
+    const float *cosTable, const float *sinTable, u32 *state) {
+  size_t i;
+  switch (waveform) {
+    case WAVEFORM_SINE: {
+      /* sin(a + b) = sin(a)cos(b) + cos(a)sin(b), with the cos(b)
+       * and sin(b) for each sample of a chunk computed up front */
+      float s = (float)sin(2 * PI * phase);
+      float c = (float)cos(2 * PI * phase);
+      for (i = 0; i < count; i++) {
+        wave[i] = s * cosTable[i] + c * sinTable[i];
+      }
+      return;
+    }
+    case WAVEFORM_SQUARE:
+      for (i = 0; i < count; i++) {
+        float t = (float)phase + (float)delta * (float)(i32)i;
+        t -= (float)(i32)t;
+        wave[i] = t < 0.5f ? 1.0f : -1.0f;
+      }
+      return;
+    case WAVEFORM_SAW:
+      for (i = 0; i < count; i++) {
+        float t = (float)phase + (float)delta * (float)(i32)i;
+        t -= (float)(i32)t;
+        wave[i] = 2.0f * t - 1.0f;
+      }
+      return;
+    case WAVEFORM_NOISE: {
+      /* xorshift32 */
+      u32 x = *state;
+      for (i = 0; i < count; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        wave[i] = (float)((i32)x * (1.0 / 2147483648.0));
+      }
+      *state = x;
+      return;
+    }
+  }
+  panic("Invalid waveform %d", waveform);
+}
+
+ObjAudio *newAudioFromFloats(
+    const float *samples, size_t frameCount, size_t channelCount, double sampleRate) {
+  ObjAudio *audio = NULL;
+  double step = sampleRate / AUDIO_SAMPLE_RATE;
+  i16 *stereo;
+  size_t i;
+
+  /* Convert to 16-bit stereo, straight into the result if
+   * no resampling is needed */
+  if (sampleRate == AUDIO_SAMPLE_RATE) {
+    audio = newAudio(frameCount);
+    stereo = audio->samples;
+  } else {
+    stereo = (i16 *)malloc(sizeof(i16) * AUDIO_CHANNEL_COUNT * (frameCount + 1));
+    if (!stereo) {
+      panic("Failed to allocate %lu samples", (unsigned long)frameCount);
+    }
+  }
+  if (channelCount == AUDIO_CHANNEL_COUNT) {
+    floatsToSamples(stereo, samples, frameCount * AUDIO_CHANNEL_COUNT);
+  } else {
+    for (i = 0; i < frameCount; i++) {
+      float left = samples[i * channelCount] * 32768.0f;
+      float right = samples[i * channelCount + (channelCount > 1)] * 32768.0f;
+      stereo[2 * i] = (i16)CLAMP_SAMPLE(left);
+      stereo[2 * i + 1] = (i16)CLAMP_SAMPLE(right);
+    }
+  }
+
+  if (!audio) {
+    audio = newAudio(getResampledCount(frameCount, step));
+    resampleSamples(audio->samples, audio->sampleCount, stereo, frameCount, step);
+    free(stereo);
+  }
+  return audio;
+}
+
+/****************************************************************
+ * WAVE files
+ ****************************************************************/
+
+static u16 readU16LE(const u8 *p) {
+  return (u16)(p[0] | (p[1] << 8));
+}
+
+static u32 readU32LE(const u8 *p) {
+  return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static void writeU16LE(u8 *p, u16 value) {
+  p[0] = (u8)value;
+  p[1] = (u8)(value >> 8);
+}
+
+static void writeU32LE(u8 *p, u32 value) {
+  p[0] = (u8)value;
+  p[1] = (u8)(value >> 8);
+  p[2] = (u8)(value >> 16);
+  p[3] = (u8)(value >> 24);
+}
+
+/* Reads one sample of the given format as a float in [-1, 1] */
+static float readWaveSample(const u8 *p, u16 format, u16 bitsPerSample) {
+  if (format == 3) {
+    u32 bits = readU32LE(p);
+    f32 value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  switch (bitsPerSample) {
+    case 8:
+      return (p[0] - 128) * (1.0f / 128.0f);
+    case 16:
+      return (i16)readU16LE(p) * (1.0f / 32768.0f);
+    case 24:
+      return (i32)(((u32)p[0] << 8) | ((u32)p[1] << 16) | ((u32)p[2] << 24)) *
+             (1.0f / 2147483648.0f);
+    default:
+      return (i32)readU32LE(p) * (1.0f / 2147483648.0f);
+  }
+}
+
+static Status decodeWave(const char *path, const u8 *data, size_t length, ObjAudio **out) {
+  const u8 *fmt = NULL, *samples = NULL;
+  size_t pos = 12, fmtSize = 0, samplesLength = 0, frameCount, frameSize, sampleSize, i;
+  u16 format, channelCount, bitsPerSample;
+  u32 sampleRate;
+
+  if (length < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+    return runtimeError("Audio.fromWaveFile(): %s: not a WAVE file", path);
+  }
+  while (pos + 8 <= length) {
+    u32 chunkSize = readU32LE(data + pos + 4);
+    size_t available = length - pos - 8;
+    size_t size = chunkSize < available ? chunkSize : available;
+    if (memcmp(data + pos, "fmt ", 4) == 0 && size >= 16) {
+      fmt = data + pos + 8;
+      fmtSize = size;
+    } else if (memcmp(data + pos, "data", 4) == 0) {
+      samples = data + pos + 8;
+      samplesLength = size;
+    }
+    pos += 8 + size + (size & 1);
+  }
+  if (!fmt || !samples) {
+    return runtimeError("Audio.fromWaveFile(): %s: missing fmt or data chunk", path);
+  }
+
+  format = readU16LE(fmt);
+  channelCount = readU16LE(fmt + 2);
+  sampleRate = readU32LE(fmt + 4);
+  bitsPerSample = readU16LE(fmt + 14);
+  if (format == 0xFFFE) {
+    /* WAVE_FORMAT_EXTENSIBLE: the format is the start of the SubFormat GUID,
+     * which follows cbSize and needs at least 22 bytes of extension */
+    size_t extensionSize = fmtSize < 18 ? 0 : readU16LE(fmt + 16);
+    if (extensionSize < 22 || fmtSize < 18 + extensionSize) {
+      return runtimeError("Audio.fromWaveFile(): %s: truncated extensible fmt chunk", path);
+    }
+    format = readU16LE(fmt + 24);
+  }
+  if (!(format == 1 && (bitsPerSample == 8 || bitsPerSample == 16 ||
+                        bitsPerSample == 24 || bitsPerSample == 32)) &&
+      !(format == 3 && bitsPerSample == 32)) {
+    return runtimeError(
+        "Audio.fromWaveFile(): %s: unsupported format %d with %d bits per sample",
+        path, format, bitsPerSample);
+  }
+  if (channelCount == 0 || channelCount > WAVE_MAX_CHANNEL_COUNT || sampleRate == 0) {
+    return runtimeError("Audio.fromWaveFile(): %s: invalid fmt chunk", path);
+  }
+
+  sampleSize = bitsPerSample / 8;
+  frameSize = sampleSize * channelCount;
+  frameCount = samplesLength / frameSize;
+
+  if (format == 1 && bitsPerSample == 16 && channelCount == AUDIO_CHANNEL_COUNT &&
+      sampleRate == AUDIO_SAMPLE_RATE) {
+    /* Already in the Audio format */
+    ObjAudio *audio = newAudio(frameCount);
+    for (i = 0; i < frameCount * AUDIO_CHANNEL_COUNT; i++) {
+      audio->samples[i] = (i16)readU16LE(samples + 2 * i);
+    }
+    *out = audio;
+  } else {
+    float *floats = (float *)malloc(sizeof(float) * (frameCount * channelCount + 1));
+    if (!floats) {
+      panic("Failed to allocate %lu samples", (unsigned long)frameCount);
+    }
+    for (i = 0; i < frameCount * channelCount; i++) {
+      floats[i] = readWaveSample(samples + i * sampleSize, format, bitsPerSample);
+    }
+    *out = newAudioFromFloats(floats, frameCount, channelCount, sampleRate);
+    free(floats);
+  }
+  return STATUS_OK;
+}
+
+/****************************************************************
+ * Methods
+ ****************************************************************/
+
+static Status implAudioStaticFromSampleCount(i16 argc, Value *argv, Value *out) {
+  *out = valAudio(newAudio(asSize(argv[0])));
+  return STATUS_OK;
+}
+
+static CFunction funcAudioStaticFromSampleCount = {
+    implAudioStaticFromSampleCount, "fromSampleCount", 1};
+
+static Status implAudioStaticFromWaveFile(i16 argc, Value *argv, Value *out) {
+  String *path = asString(argv[0]);
+  DataSourceView view;
+  ObjAudio *audio = NULL;
+  ubool ok;
+  if (!openFileView(path->chars, &view)) {
+    return STATUS_ERROR;
+  }
+  ok = decodeWave(path->chars, view.data, view.length, &audio);
+  dataSourceCloseView(&view);
+  if (!ok) {
+    return STATUS_ERROR;
+  }
+  *out = valAudio(audio);
+  return STATUS_OK;
+}
+
+static CFunction funcAudioStaticFromWaveFile = {
+    implAudioStaticFromWaveFile, "fromWaveFile", 1};
+
+static Status implAudioStaticFromMP3File(i16 argc, Value *argv, Value *out) {
+#if MTOTS_ENABLE_DR_MP3
+  String *path = asString(argv[0]);
+  DataSourceView view;
+  drmp3_config config;
+  drmp3_uint64 frameCount;
+  float *samples;
+  if (!openFileView(path->chars, &view)) {
+    return STATUS_ERROR;
+  }
+  samples = mtots_drmp3_open_memory_and_read_pcm_frames_f32(
+      view.data, view.length, &config, &frameCount, NULL);
+  dataSourceCloseView(&view);
+  if (!samples) {
+    return runtimeError("Audio.fromMP3File(): %s: could not decode MP3", path->chars);
+  }
+  *out = valAudio(newAudioFromFloats(
+      samples, (size_t)frameCount, config.channels, config.sampleRate));
+  mtots_drmp3_free(samples, NULL);
+  return STATUS_OK;
+#else
+  return runtimeError("Audio.fromMP3File(): mtots was built without MP3 support");
+#endif
+}
+
+static CFunction funcAudioStaticFromMP3File = {
+    implAudioStaticFromMP3File, "fromMP3File", 1};
+
+static Status implAudioStaticFromFloat32Array(i16 argc, Value *argv, Value *out) {
+  ObjTypedArray *array = asTypedArray(argv[0]);
+  size_t channelCount = argc > 1 && !isNil(argv[1]) ? asSize(argv[1]) : AUDIO_CHANNEL_COUNT;
+  double sampleRate = argc > 2 && !isNil(argv[2]) ? asNumber(argv[2]) : AUDIO_SAMPLE_RATE;
+  size_t length;
+  if (array->type != TYPED_ARRAY_F32) {
+    return runtimeError("Audio.fromFloat32Array(): expected a Float32Array");
+  }
+  length = typedArrayLength(array);
+  if (channelCount == 0 || length % channelCount != 0) {
+    return runtimeError(
+        "Audio.fromFloat32Array(): length %lu is not a multiple of the channel count %lu",
+        (unsigned long)length, (unsigned long)channelCount);
+  }
+  if (!(sampleRate > 0)) {
+    return runtimeError("Audio.fromFloat32Array(): invalid sample rate %f", sampleRate);
+  }
+  *out = valAudio(newAudioFromFloats(
+      (const float *)array->buffer->handle.data, length / channelCount,
+      channelCount, sampleRate));
+  return STATUS_OK;
+}
+
+static const char *argsFromFloat32Array[] = {
+    "samples",
+    "channelCount",
+    "sampleRate",
+    NULL,
+};
+
+static CFunction funcAudioStaticFromFloat32Array = {
+    implAudioStaticFromFloat32Array,
+    "fromFloat32Array",
+    1,
+    sizeof(argsFromFloat32Array) / sizeof(argsFromFloat32Array[0]) - 1,
+    argsFromFloat32Array,
+};
+
+static Status implAudioLen(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  *out = valNumber(audio->sampleCount);
+  return STATUS_OK;
+}
+
+static CFunction funcAudioLen = {implAudioLen, "__len__"};
+
+static Status implAudioGet(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  size_t sampleIndex = asIndex(argv[0], audio->sampleCount);
+  size_t channelIndex = asIndex(argv[1], AUDIO_CHANNEL_COUNT);
+  *out = valNumber(audio->samples[sampleIndex * AUDIO_CHANNEL_COUNT + channelIndex]);
+  return STATUS_OK;
+}
+
+static CFunction funcAudioGet = {implAudioGet, "get", 2};
+
+static Status implAudioSet(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  size_t sampleIndex = asIndex(argv[0], audio->sampleCount);
+  size_t channelIndex = asIndex(argv[1], AUDIO_CHANNEL_COUNT);
+  i32 sample = asI32(argv[2]);
+  if (sample < -32768 || sample > 32767) {
+    return runtimeError("Audio.set(): sample %ld is out of the 16-bit range", (long)sample);
+  }
+  audio->samples[sampleIndex * AUDIO_CHANNEL_COUNT + channelIndex] = (i16)sample;
+  return STATUS_OK;
+}
+
+static CFunction funcAudioSet = {implAudioSet, "set", 3};
+
+static Status implAudioSaveToWaveFile(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  String *path = asString(argv[0]);
+  size_t dataSize = getAudioSamplesSize(audio), i;
+  u8 *data;
+  ubool ok;
+  if (dataSize > 0xFFFFFFFFUL - (WAVE_HEADER_SIZE - 8)) {
+    return runtimeError("Audio.saveToWaveFile(): Audio is too long for a WAVE file");
+  }
+  data = (u8 *)malloc(WAVE_HEADER_SIZE + dataSize);
+  if (!data) {
+    panic("Failed to allocate WAVE file data");
+  }
+  memcpy(data, "RIFF", 4);
+  writeU32LE(data + 4, (u32)(WAVE_HEADER_SIZE - 8 + dataSize));
+  memcpy(data + 8, "WAVEfmt ", 8);
+  writeU32LE(data + 16, 16);
+  writeU16LE(data + 20, 1); /* PCM */
+  writeU16LE(data + 22, AUDIO_CHANNEL_COUNT);
+  writeU32LE(data + 24, AUDIO_SAMPLE_RATE);
+  writeU32LE(data + 28, AUDIO_SAMPLE_RATE * AUDIO_CHANNEL_COUNT * sizeof(i16));
+  writeU16LE(data + 32, AUDIO_CHANNEL_COUNT * sizeof(i16));
+  writeU16LE(data + 34, 16);
+  memcpy(data + 36, "data", 4);
+  writeU32LE(data + 40, (u32)dataSize);
+  for (i = 0; i < audio->sampleCount * AUDIO_CHANNEL_COUNT; i++) {
+    writeU16LE(data + WAVE_HEADER_SIZE + 2 * i, (u16)audio->samples[i]);
+  }
+  ok = writeFile(data, WAVE_HEADER_SIZE + dataSize, path->chars);
+  free(data);
+  return ok ? STATUS_OK : STATUS_ERROR;
+}
+
+static CFunction funcAudioSaveToWaveFile = {implAudioSaveToWaveFile, "saveToWaveFile", 1};
+
+static Status implAudioToFloat32Array(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  size_t count = audio->sampleCount * AUDIO_CHANNEL_COUNT;
+  ObjTypedArray *array = newTypedArray(TYPED_ARRAY_F32, count);
+  samplesToFloats((float *)array->buffer->handle.data, audio->samples, count);
+  *out = valTypedArray(array);
+  return STATUS_OK;
+}
+
+static CFunction funcAudioToFloat32Array = {implAudioToFloat32Array, "toFloat32Array"};
+
+static Status implAudioMix(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  ObjAudio *other = asAudio(argv[0]);
+  float gain = argc > 1 && !isNil(argv[1]) ? (float)asNumber(argv[1]) : 1.0f;
+  size_t start = argc > 2 && !isNil(argv[2]) ? asIndexLower(argv[2], audio->sampleCount) : 0;
+  size_t count = audio->sampleCount - start;
+  if (count > other->sampleCount) {
+    count = other->sampleCount;
+  }
+  if (other == audio && start > 0) {
+    /* The source would be overwritten before it is read */
+    i16 *copy = (i16 *)malloc(sizeof(i16) * AUDIO_CHANNEL_COUNT * (count + 1));
+    if (!copy) {
+      panic("Failed to allocate %lu samples", (unsigned long)count);
+    }
+    memcpy(copy, other->samples, sizeof(i16) * AUDIO_CHANNEL_COUNT * count);
+    mixSamples(audio->samples + start * AUDIO_CHANNEL_COUNT, copy, count * AUDIO_CHANNEL_COUNT, gain);
+    free(copy);
+  } else {
+    mixSamples(
+        audio->samples + start * AUDIO_CHANNEL_COUNT, other->samples,
+        count * AUDIO_CHANNEL_COUNT, gain);
+  }
+  return STATUS_OK;
+}
+
+static const char *argsMix[] = {
+    "other",
+    "gain",
+    "start",
+    NULL,
+};
+
+static CFunction funcAudioMix = {
+    implAudioMix,
+    "mix",
+    1,
+    sizeof(argsMix) / sizeof(argsMix[0]) - 1,
+    argsMix,
+};
+
+static Status implAudioFade(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  double fromGain = asNumber(argv[0]);
+  double toGain = asNumber(argv[1]);
+  size_t start = argc > 2 && !isNil(argv[2]) ? asIndexLower(argv[2], audio->sampleCount) : 0;
+  size_t end = argc > 3 && !isNil(argv[3]) ?
+      asIndexUpper(argv[3], audio->sampleCount) : audio->sampleCount;
+  if (start < end) {
+    fadeSamples(
+        audio->samples + start * AUDIO_CHANNEL_COUNT, end - start,
+        fromGain, (toGain - fromGain) / (end - start));
+  }
+  return STATUS_OK;
+}
+
+static const char *argsFade[] = {
+    "fromGain",
+    "toGain",
+    "start",
+    "end",
+    NULL,
+};
+
+static CFunction funcAudioFade = {
+    implAudioFade,
+    "fade",
+    2,
+    sizeof(argsFade) / sizeof(argsFade[0]) - 1,
+    argsFade,
+};
+
+static Status implAudioResample(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  double fromRate = asNumber(argv[0]);
+  double toRate = asNumber(argv[1]);
+  double step;
+  ObjAudio *result;
+  if (!(fromRate > 0) || !(toRate > 0)) {
+    return runtimeError("Audio.resample(): sample rates must be positive");
+  }
+  step = fromRate / toRate;
+  result = newAudio(getResampledCount(audio->sampleCount, step));
+  resampleSamples(result->samples, result->sampleCount, audio->samples, audio->sampleCount, step);
+  *out = valAudio(result);
+  return STATUS_OK;
+}
+
+static CFunction funcAudioResample = {implAudioResample, "resample", 2};
+
+static Status implAudioAddWave(i16 argc, Value *argv, Value *out) {
+  ObjAudio *audio = asAudio(argv[-1]);
+  int waveform = asInt(argv[0]);
+  double frequency = asNumber(argv[1]);
+  float amplitude = (float)(argc > 2 && !isNil(argv[2]) ? asNumber(argv[2]) : 0.5) * 32767.0f;
+  size_t start = argc > 3 && !isNil(argv[3]) ? asIndexLower(argv[3], audio->sampleCount) : 0;
+  size_t end = argc > 4 && !isNil(argv[4]) ?
+      asIndexUpper(argv[4], audio->sampleCount) : audio->sampleCount;
+  double delta = frequency / AUDIO_SAMPLE_RATE;
+  float wave[WAVE_CHUNK_SIZE], cosTable[WAVE_CHUNK_SIZE], sinTable[WAVE_CHUNK_SIZE];
+  u32 state = 0x9E3779B9u ^ (u32)start;
+  size_t i;
+
+  if (waveform < WAVEFORM_SINE || waveform > WAVEFORM_NOISE) {
+    return runtimeError("Audio.addWave(): invalid waveform %d", waveform);
+  }
+  if (waveform == WAVEFORM_SINE) {
+    for (i = 0; i < WAVE_CHUNK_SIZE; i++) {
+      cosTable[i] = (float)cos(2 * PI * delta * i);
+      sinTable[i] = (float)sin(2 * PI * delta * i);
+    }
+  }
+  for (i = start; i < end; i += WAVE_CHUNK_SIZE) {
+    size_t count = end - i < WAVE_CHUNK_SIZE ? end - i : WAVE_CHUNK_SIZE;
+    double phase = delta * (i - start);
+    generateWave(
+        waveform, wave, count, phase - floor(phase), delta, cosTable, sinTable, &state);
+    addWaveSamples(audio->samples + i * AUDIO_CHANNEL_COUNT, wave, count, amplitude);
+  }
+  return STATUS_OK;
+}
+
+static const char *argsAddWave[] = {
+    "waveform",
+    "frequency",
+    "amplitude",
+    "start",
+    "end",
+    NULL,
+};
+
+static CFunction funcAudioAddWave = {
+    implAudioAddWave,
+    "addWave",
+    2,
+    sizeof(argsAddWave) / sizeof(argsAddWave[0]) - 1,
+    argsAddWave,
+};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *methods[] = {
+      &funcAudioLen,
+      &funcAudioGet,
+      &funcAudioSet,
+      &funcAudioSaveToWaveFile,
+      &funcAudioToFloat32Array,
+      &funcAudioMix,
+      &funcAudioFade,
+      &funcAudioResample,
+      &funcAudioAddWave,
+      NULL,
+  };
+  CFunction *staticMethods[] = {
+      &funcAudioStaticFromSampleCount,
+      &funcAudioStaticFromWaveFile,
+      &funcAudioStaticFromMP3File,
+      &funcAudioStaticFromFloat32Array,
+      NULL,
+  };
+
+  if (!importModuleAndPop("array")) {
+    return STATUS_ERROR;
+  }
+
+  newNativeClass(module, &descriptorAudio, methods, staticMethods);
+
+  mapSetN(&module->fields, "SAMPLE_RATE", valNumber(AUDIO_SAMPLE_RATE));
+  mapSetN(&module->fields, "SINE", valNumber(WAVEFORM_SINE));
+  mapSetN(&module->fields, "SQUARE", valNumber(WAVEFORM_SQUARE));
+  mapSetN(&module->fields, "SAW", valNumber(WAVEFORM_SAW));
+  mapSetN(&module->fields, "NOISE", valNumber(WAVEFORM_NOISE));
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "media.audio", 1};
+
+void addNativeModuleMediaAudio(void) {
+  addNativeModule(&func);
+}
@@ -0,0 +1,38 @@
+#ifndef mtots_m_media_audio_h
+#define mtots_m_media_audio_h
+
+#include "mtots_object.h"
+
+/* Native Module media.audio
+ * Audio is stereo 16-bit signed samples at 44.1kHz, stored with the
+ * two channels of each sample interleaved */
+
+#define AUDIO_SAMPLE_RATE 44100
+#define AUDIO_CHANNEL_COUNT 2
+
+#define isAudio(v) (getNativeObjectDescriptor(v) == &descriptorAudio)
+
+typedef struct ObjAudio {
+  ObjNative obj;
+  size_t sampleCount;
+  i16 *samples; /* sampleCount * AUDIO_CHANNEL_COUNT values */
+} ObjAudio;
+
+extern NativeObjectDescriptor descriptorAudio;
+
+Value valAudio(ObjAudio *audio);
+ObjAudio *asAudio(Value value);
+
+/* Creates a new silent Audio */
+ObjAudio *newAudio(size_t sampleCount);
+
+/* Creates an Audio from interleaved float samples in [-1, 1] with the
+ * given channel count and sample rate. Mono is copied to both channels,
+ * channels past the second are dropped, and other sample rates are
+ * resampled to AUDIO_SAMPLE_RATE */
+ObjAudio *newAudioFromFloats(
+    const float *samples, size_t frameCount, size_t channelCount, double sampleRate);
+
+void addNativeModuleMediaAudio(void);
+
+#endif /*mtots_m_media_audio_h*/
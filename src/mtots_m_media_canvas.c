@@ -0,0 +1,393 @@
+#include "mtots_m_media_canvas.h"
+
+#include <stdlib.h>
+
+#include "mtots.h"
+
+/* Number of polygon points that can be passed without allocating */
+#define POLYGON_STACK_POINTS 32
+
+static void blackenCanvas(ObjNative *n) {
+  markObject((Obj *)((ObjCanvas *)n)->image);
+}
+
+static void freeCanvas(ObjNative *n) {
+  freeRasterCommandList(&((ObjCanvas *)n)->commands);
+}
+
+NativeObjectDescriptor descriptorCanvas = {
+    blackenCanvas,
+    freeCanvas,
+    sizeof(ObjCanvas),
+    "Canvas",
+};
+
+Value valCanvas(ObjCanvas *canvas) {
+  return valObjExplicit((Obj *)canvas);
+}
+
+ObjCanvas *asCanvas(Value value) {
+  if (!isCanvas(value)) {
+    panic("Expected Canvas but got %s", getKindName(value));
+  }
+  return (ObjCanvas *)value.as.obj;
+}
+
+void flushCanvas(ObjCanvas *canvas) {
+  RasterCommandList *commands = &canvas->commands;
+  if (commands->count > 0) {
+    size_t i;
+    for (i = 0; i < commands->count; i++) {
+      RasterBounds bounds;
+      bounds.minX = commands->commands[i].minX;
+      bounds.minY = commands->commands[i].minY;
+      bounds.maxX = commands->commands[i].maxX;
+      bounds.maxY = commands->commands[i].maxY;
+      markImageDirty(canvas->image, &bounds);
+    }
+    rasterFlush(&canvas->raster, commands);
+  }
+}
+
+static void draw(
+    ObjCanvas *canvas, RasterCommandType type,
+    double a, double b, double c, double d, Color color) {
+  double args[4];
+  args[0] = a;
+  args[1] = b;
+  args[2] = c;
+  args[3] = d;
+  if (canvas->recording) {
+    rasterRecord(&canvas->commands, &canvas->raster, type, args, colorToPixel(color));
+  } else {
+    RasterBounds bounds;
+    if (rasterGetBounds(&canvas->raster, type, args, colorToPixel(color), &bounds)) {
+      markImageDirty(canvas->image, &bounds);
+      rasterDraw(&canvas->raster, type, args, colorToPixel(color));
+    }
+  }
+}
+
+static Status implCanvasStaticCall(i16 argc, Value *argv, Value *out) {
+  ObjImage *image = asImage(argv[0]);
+  ObjCanvas *canvas = NEW_NATIVE(ObjCanvas, &descriptorCanvas);
+  canvas->image = image;
+  canvas->recording = UFALSE;
+  initRasterCommandList(&canvas->commands);
+  initRaster(&canvas->raster, image->pixels, image->width, image->height, image->width);
+  *out = valCanvas(canvas);
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasStaticCall = {implCanvasStaticCall, "__call__", 1};
+
+static Status implCanvasGetattr(i16 argc, Value *argv, Value *out) {
+  ObjCanvas *canvas = asCanvas(argv[-1]);
+  String *name = asString(argv[0]);
+  CommonStrings *cs = getCommonStrings();
+  if (name == cs->width) {
+    *out = valNumber(canvas->image->width);
+  } else if (name == cs->height) {
+    *out = valNumber(canvas->image->height);
+  } else if (name == cs->image) {
+    *out = valImage(canvas->image);
+  } else {
+    fieldNotFoundError(argv[-1], name->chars);
+    return STATUS_ERROR;
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasGetattr = {implCanvasGetattr, "__getattr__", 1};
+
+static Status implCanvasGet(i16 argc, Value *argv, Value *out) {
+  ObjCanvas *canvas = asCanvas(argv[-1]);
+  ObjImage *image = canvas->image;
+  size_t row = asIndex(argv[0], image->height);
+  size_t column = asIndex(argv[1], image->width);
+  flushCanvas(canvas);
+  *out = valColor(pixelToColor(image->pixels[row * image->width + column]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasGet = {implCanvasGet, "get", 2};
+
+static Status implCanvasSet(i16 argc, Value *argv, Value *out) {
+  ObjCanvas *canvas = asCanvas(argv[-1]);
+  ObjImage *image = canvas->image;
+  size_t row = asIndex(argv[0], image->height);
+  size_t column = asIndex(argv[1], image->width);
+  u32 pixel = colorToPixel(asColor(argv[2]));
+  if (canvas->recording) {
+    /* A fill clipped to just the one pixel */
+    static const double noArgs[4] = {0, 0, 0, 0};
+    Raster raster = canvas->raster;
+    rasterSetClip(&raster, column, row, 1, 1);
+    rasterRecord(&canvas->commands, &raster, RASTER_COMMAND_FILL, noArgs, pixel);
+  } else {
+    RasterBounds bounds;
+    image->pixels[row * image->width + column] = pixel;
+    bounds.minX = column;
+    bounds.minY = row;
+    bounds.maxX = column + 1;
+    bounds.maxY = row + 1;
+    markImageDirty(image, &bounds);
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasSet = {implCanvasSet, "set", 3};
+
+static Status implCanvasSetClipRect(i16 argc, Value *argv, Value *out) {
+  Raster *raster = &asCanvas(argv[-1])->raster;
+  if (argc > 0 && !isNil(argv[0])) {
+    Rect rect = asRect(argv[0]);
+    rasterSetClip(raster, rect.minX, rect.minY, rect.width, rect.height);
+  } else {
+    rasterResetClip(raster);
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasSetClipRect = {implCanvasSetClipRect, "setClipRect", 0, 1};
+
+static Status implCanvasFill(i16 argc, Value *argv, Value *out) {
+  Color color = argc > 0 && !isNil(argv[0]) ? asColor(argv[0]) : newColor(0, 0, 0, 0);
+  draw(asCanvas(argv[-1]), RASTER_COMMAND_FILL, 0, 0, 0, 0, color);
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasFill = {implCanvasFill, "fill", 0, 1};
+
+static Status implCanvasDrawLine(i16 argc, Value *argv, Value *out) {
+  Vector start = asVector(argv[0]), end = asVector(argv[1]);
+  draw(asCanvas(argv[-1]), RASTER_COMMAND_LINE, start.x, start.y, end.x, end.y, asColor(argv[2]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasDrawLine = {implCanvasDrawLine, "drawLine", 3};
+
+static Status implCanvasFillRect(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[0]);
+  draw(
+      asCanvas(argv[-1]), RASTER_COMMAND_FILL_RECT,
+      rect.minX, rect.minY, rect.width, rect.height, asColor(argv[1]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasFillRect = {implCanvasFillRect, "fillRect", 2};
+
+static Status implCanvasStrokeRect(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[0]);
+  draw(
+      asCanvas(argv[-1]), RASTER_COMMAND_STROKE_RECT,
+      rect.minX, rect.minY, rect.width, rect.height, asColor(argv[1]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasStrokeRect = {implCanvasStrokeRect, "strokeRect", 2};
+
+static Status implCanvasFillPolygon(i16 argc, Value *argv, Value *out) {
+  ObjCanvas *canvas = asCanvas(argv[-1]);
+  Value *items = isList(argv[0]) ? asList(argv[0])->buffer : asFrozenList(argv[0])->buffer;
+  size_t i, count = isList(argv[0]) ? asList(argv[0])->length : asFrozenList(argv[0])->length;
+  float stackPoints[2 * POLYGON_STACK_POINTS];
+  float *points = stackPoints;
+  u32 color = colorToPixel(asColor(argv[1]));
+  if (count > POLYGON_STACK_POINTS) {
+    points = (float *)malloc(sizeof(float) * 2 * count);
+    if (!points) {
+      panic("fillPolygon(): out of memory");
+    }
+  }
+  for (i = 0; i < count; i++) {
+    Vector point;
+    if (!isVector(items[i])) {
+      if (points != stackPoints) {
+        free(points);
+      }
+      runtimeError("fillPolygon() expects Vector points but got %s", getKindName(items[i]));
+      return STATUS_ERROR;
+    }
+    point = asVector(items[i]);
+    points[2 * i] = point.x;
+    points[2 * i + 1] = point.y;
+  }
+  if (canvas->recording) {
+    rasterRecordPolygon(&canvas->commands, &canvas->raster, points, count, color);
+  } else {
+    RasterBounds bounds;
+    if (rasterGetPolygonBounds(&canvas->raster, points, count, color, &bounds)) {
+      markImageDirty(canvas->image, &bounds);
+      rasterFillPolygon(&canvas->raster, points, count, color);
+    }
+  }
+  if (points != stackPoints) {
+    free(points);
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasFillPolygon = {implCanvasFillPolygon, "fillPolygon", 2};
+
+static Status implCanvasFillCircle(i16 argc, Value *argv, Value *out) {
+  Vector center = asVector(argv[0]);
+  double radius = asNumber(argv[1]);
+  draw(
+      asCanvas(argv[-1]), RASTER_COMMAND_FILL_OVAL,
+      center.x - radius, center.y - radius, 2 * radius, 2 * radius, asColor(argv[2]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasFillCircle = {implCanvasFillCircle, "fillCircle", 3};
+
+static Status implCanvasStrokeCircle(i16 argc, Value *argv, Value *out) {
+  Vector center = asVector(argv[0]);
+  double radius = asNumber(argv[1]);
+  draw(
+      asCanvas(argv[-1]), RASTER_COMMAND_STROKE_OVAL,
+      center.x - radius, center.y - radius, 2 * radius, 2 * radius, asColor(argv[2]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasStrokeCircle = {implCanvasStrokeCircle, "strokeCircle", 3};
+
+static Status implCanvasFillOval(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[0]);
+  draw(
+      asCanvas(argv[-1]), RASTER_COMMAND_FILL_OVAL,
+      rect.minX, rect.minY, rect.width, rect.height, asColor(argv[1]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasFillOval = {implCanvasFillOval, "fillOval", 2};
+
+static Status implCanvasStrokeOval(i16 argc, Value *argv, Value *out) {
+  Rect rect = asRect(argv[0]);
+  draw(
+      asCanvas(argv[-1]), RASTER_COMMAND_STROKE_OVAL,
+      rect.minX, rect.minY, rect.width, rect.height, asColor(argv[1]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasStrokeOval = {implCanvasStrokeOval, "strokeOval", 2};
+
+static Status implCanvasCopy(i16 argc, Value *argv, Value *out) {
+  ObjCanvas *canvas = asCanvas(argv[-1]);
+  ObjImage *src = asImage(argv[0]);
+  Rect srcRect, dstRect;
+  double dstArgs[4];
+  RasterBounds bounds;
+  ubool flipX = argc > 3 && !isNil(argv[3]) && asBool(argv[3]);
+  ubool flipY = argc > 4 && !isNil(argv[4]) && asBool(argv[4]);
+  Raster srcRaster;
+  initRaster(&srcRaster, src->pixels, src->width, src->height, src->width);
+  if (argc > 1 && !isNil(argv[1])) {
+    srcRect = asRect(argv[1]);
+  } else {
+    srcRect = newRect(0, 0, src->width, src->height);
+  }
+  if (argc > 2 && !isNil(argv[2])) {
+    dstRect = asRect(argv[2]);
+  } else {
+    dstRect = newRect(0, 0, canvas->image->width, canvas->image->height);
+  }
+  flushCanvas(canvas);
+  dstArgs[0] = dstRect.minX;
+  dstArgs[1] = dstRect.minY;
+  dstArgs[2] = dstRect.width;
+  dstArgs[3] = dstRect.height;
+  if (!rasterGetBounds(
+          &canvas->raster, RASTER_COMMAND_FILL_RECT, dstArgs, rasterPixel(0, 0, 0, 255),
+          &bounds)) {
+    return STATUS_OK;
+  }
+  markImageDirty(canvas->image, &bounds);
+  rasterCopy(
+      &canvas->raster, dstRect.minX, dstRect.minY, dstRect.width, dstRect.height,
+      &srcRaster, srcRect.minX, srcRect.minY, srcRect.width, srcRect.height,
+      flipX, flipY);
+  return STATUS_OK;
+}
+
+static const char *argsCanvasCopy[] = {
+    "src",
+    "srcRect",
+    "dstRect",
+    "flipX",
+    "flipY",
+    NULL,
+};
+
+static CFunction funcCanvasCopy = {
+    implCanvasCopy,
+    "copy",
+    1,
+    sizeof(argsCanvasCopy) / sizeof(argsCanvasCopy[0]) - 1,
+    argsCanvasCopy,
+};
+
+static Status implCanvasBeginRecording(i16 argc, Value *argv, Value *out) {
+  asCanvas(argv[-1])->recording = UTRUE;
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasBeginRecording = {implCanvasBeginRecording, "beginRecording"};
+
+static Status implCanvasFlush(i16 argc, Value *argv, Value *out) {
+  flushCanvas(asCanvas(argv[-1]));
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasFlush = {implCanvasFlush, "flush"};
+
+static Status implCanvasEndRecording(i16 argc, Value *argv, Value *out) {
+  ObjCanvas *canvas = asCanvas(argv[-1]);
+  flushCanvas(canvas);
+  canvas->recording = UFALSE;
+  return STATUS_OK;
+}
+
+static CFunction funcCanvasEndRecording = {implCanvasEndRecording, "endRecording"};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *methods[] = {
+      &funcCanvasGetattr,
+      &funcCanvasGet,
+      &funcCanvasSet,
+      &funcCanvasSetClipRect,
+      &funcCanvasFill,
+      &funcCanvasDrawLine,
+      &funcCanvasFillRect,
+      &funcCanvasStrokeRect,
+      &funcCanvasFillPolygon,
+      &funcCanvasFillCircle,
+      &funcCanvasStrokeCircle,
+      &funcCanvasFillOval,
+      &funcCanvasStrokeOval,
+      &funcCanvasCopy,
+      &funcCanvasBeginRecording,
+      &funcCanvasFlush,
+      &funcCanvasEndRecording,
+      NULL,
+  };
+  CFunction *staticMethods[] = {
+      &funcCanvasStaticCall,
+      NULL,
+  };
+
+  if (!importModuleAndPop("media.image")) {
+    return STATUS_ERROR;
+  }
+
+  newNativeClass(module, &descriptorCanvas, methods, staticMethods);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "media.canvas", 1};
+
+void addNativeModuleMediaCanvas(void) {
+  addNativeModule(&func);
+}
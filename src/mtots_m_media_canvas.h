@@ -0,0 +1,32 @@
+#ifndef mtots_m_media_canvas_h
+#define mtots_m_media_canvas_h
+
+#include "mtots_m_media_image.h"
+
+/* Native Module media.canvas
+ * Draws shapes into an Image with the rasterizer in mtots_util_raster.h.
+ *
+ * While recording, drawing calls are appended to 'commands' and only
+ * reach the image when the canvas is flushed */
+
+#define isCanvas(v) (getNativeObjectDescriptor(v) == &descriptorCanvas)
+
+typedef struct ObjCanvas {
+  ObjNative obj;
+  ObjImage *image;
+  Raster raster;
+  ubool recording;
+  RasterCommandList commands;
+} ObjCanvas;
+
+extern NativeObjectDescriptor descriptorCanvas;
+
+Value valCanvas(ObjCanvas *canvas);
+ObjCanvas *asCanvas(Value value);
+
+/* Draws any recorded commands, so that 'image' is up to date */
+void flushCanvas(ObjCanvas *canvas);
+
+void addNativeModuleMediaCanvas(void);
+
+#endif /*mtots_m_media_canvas_h*/
@@ -0,0 +1,821 @@
+#include "mtots_m_media_font.h"
+
+#if MTOTS_ENABLE_FREETYPE
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtots.h"
+#include "mtots_m_data.h"
+#include "mtots_m_media_canvas.h"
+
+/* Width of every atlas in pixels. Atlases grow by doubling their height */
+#define ATLAS_WIDTH 1024
+#define ATLAS_INITIAL_HEIGHT 64
+
+#define DEFAULT_EM_SIZE 16
+
+/* Number of glyphs in a run that can be drawn without allocating */
+#define RUN_STACK_GLYPHS 64
+
+/* Pen positions are clamped to this range before being converted to
+ * integers */
+#define COORDINATE_LIMIT 1073741824.0
+
+#define isFont(v) (getNativeObjectDescriptor(v) == &descriptorFont)
+#define isPen(v) (getNativeObjectDescriptor(v) == &descriptorPen)
+
+static FT_Library library;
+
+/* A glyph rasterized at one size. The bitmap's top left corner is at
+ * (penX + left, baselineY - top) */
+typedef struct Glyph {
+  u32 glyphIndex;
+  i32 left;
+  i32 top;
+  u32 width;
+  u32 height;
+  u32 atlasX;
+  u32 atlasY;
+  i32 advance; /* 26.6 fixed point */
+} Glyph;
+
+/* Open addressing hash table from (size, a, b) to a value.
+ * Sizes are never 0, so a 0 size marks an empty entry */
+typedef struct FontCacheEntry {
+  u32 size;
+  u32 a;
+  u32 b;
+  i32 value;
+} FontCacheEntry;
+
+typedef struct FontCache {
+  FontCacheEntry *entries;
+  size_t count;
+  size_t capacity; /* 0 or a power of 2 */
+} FontCache;
+
+typedef struct ObjFont {
+  ObjNative obj;
+  FT_Face face;
+  u8 *data; /* contents of the font file, for faces opened from memory */
+  size_t dataLength;
+  u32 sizeKey; /* (emWidth << 16) | emHeight */
+
+  /* Coverage atlas of ATLAS_WIDTH x atlasHeight bytes, filled with
+   * shelves of glyphs from top to bottom */
+  u8 *atlas;
+  size_t atlasHeight;
+  size_t shelfX;
+  size_t shelfY;
+  size_t shelfHeight;
+
+  Glyph *glyphs;
+  size_t glyphCount;
+  size_t glyphCapacity;
+  FontCache glyphCache;   /* (size, code point) -> index into 'glyphs' */
+  FontCache kerningCache; /* (size, left glyph index, right glyph index) -> 26.6 */
+} ObjFont;
+
+typedef struct ObjPen {
+  ObjNative obj;
+  ObjFont *font;
+  Value image; /* nil, Image or Canvas */
+  double lineStartX;
+  double x;
+  double y;
+  Color color;
+  Rect boundingBox;
+} ObjPen;
+
+/* One glyph of a laid out run */
+typedef struct GlyphBlit {
+  long x;
+  long y;
+  size_t glyph; /* index into the font's 'glyphs' */
+} GlyphBlit;
+
+static void freeFontCache(FontCache *cache) {
+  free(cache->entries);
+  cache->entries = NULL;
+  cache->count = cache->capacity = 0;
+}
+
+static u32 hashFontCacheKey(u32 size, u32 a, u32 b) {
+  u32 hash = size * 0x9E3779B1UL;
+  hash = (hash ^ a) * 0x85EBCA77UL;
+  hash = (hash ^ b) * 0xC2B2AE3DUL;
+  return hash ^ (hash >> 15);
+}
+
+static FontCacheEntry *findFontCacheEntry(
+    FontCacheEntry *entries, size_t capacity, u32 size, u32 a, u32 b) {
+  size_t i = hashFontCacheKey(size, a, b) & (capacity - 1);
+  for (;;) {
+    FontCacheEntry *entry = entries + i;
+    if (entry->size == 0 || (entry->size == size && entry->a == a && entry->b == b)) {
+      return entry;
+    }
+    i = (i + 1) & (capacity - 1);
+  }
+}
+
+static ubool fontCacheGet(FontCache *cache, u32 size, u32 a, u32 b, i32 *out) {
+  FontCacheEntry *entry;
+  if (cache->count == 0) {
+    return UFALSE;
+  }
+  entry = findFontCacheEntry(cache->entries, cache->capacity, size, a, b);
+  if (entry->size == 0) {
+    return UFALSE;
+  }
+  *out = entry->value;
+  return UTRUE;
+}
+
+static void fontCachePut(FontCache *cache, u32 size, u32 a, u32 b, i32 value) {
+  FontCacheEntry *entry;
+  if ((cache->count + 1) * 4 > cache->capacity * 3) {
+    size_t newCapacity = cache->capacity ? cache->capacity * 2 : 64, i;
+    FontCacheEntry *newEntries =
+        (FontCacheEntry *)calloc(newCapacity, sizeof(FontCacheEntry));
+    if (!newEntries) {
+      panic("Failed to allocate font cache");
+    }
+    for (i = 0; i < cache->capacity; i++) {
+      FontCacheEntry *old = cache->entries + i;
+      if (old->size != 0) {
+        *findFontCacheEntry(newEntries, newCapacity, old->size, old->a, old->b) = *old;
+      }
+    }
+    free(cache->entries);
+    cache->entries = newEntries;
+    cache->capacity = newCapacity;
+  }
+  entry = findFontCacheEntry(cache->entries, cache->capacity, size, a, b);
+  if (entry->size == 0) {
+    cache->count++;
+  }
+  entry->size = size;
+  entry->a = a;
+  entry->b = b;
+  entry->value = value;
+}
+
+static void freeFont(ObjNative *n) {
+  ObjFont *font = (ObjFont *)n;
+  if (font->face) {
+    FT_Done_Face(font->face);
+    font->face = NULL;
+  }
+  if (font->data) {
+    trackExternalFree(EXTERNAL_MEMORY_NATIVE, font->dataLength);
+    free(font->data);
+    font->data = NULL;
+  }
+  if (font->atlas) {
+    trackExternalFree(EXTERNAL_MEMORY_NATIVE, ATLAS_WIDTH * font->atlasHeight);
+    free(font->atlas);
+    font->atlas = NULL;
+  }
+  free(font->glyphs);
+  font->glyphs = NULL;
+  freeFontCache(&font->glyphCache);
+  freeFontCache(&font->kerningCache);
+}
+
+static NativeObjectDescriptor descriptorFont = {
+    nopBlacken,
+    freeFont,
+    sizeof(ObjFont),
+    "Font",
+};
+
+static void blackenPen(ObjNative *n) {
+  ObjPen *pen = (ObjPen *)n;
+  markObject((Obj *)pen->font);
+  markValue(pen->image);
+}
+
+static NativeObjectDescriptor descriptorPen = {
+    blackenPen,
+    nopFree,
+    sizeof(ObjPen),
+    "Pen",
+};
+
+static Value valFont(ObjFont *font) {
+  return valObjExplicit((Obj *)font);
+}
+
+static ObjFont *asFont(Value value) {
+  if (!isFont(value)) {
+    panic("Expected Font but got %s", getKindName(value));
+  }
+  return (ObjFont *)value.as.obj;
+}
+
+static Value valPen(ObjPen *pen) {
+  return valObjExplicit((Obj *)pen);
+}
+
+static ObjPen *asPen(Value value) {
+  if (!isPen(value)) {
+    panic("Expected Pen but got %s", getKindName(value));
+  }
+  return (ObjPen *)value.as.obj;
+}
+
+static Status setFontSize(ObjFont *font, u32 emWidth, u32 emHeight) {
+  FT_Error error;
+  if (emWidth < 1 || emWidth > 0xFFFF || emHeight < 1 || emHeight > 0xFFFF) {
+    runtimeError("Invalid font size %lu x %lu", (unsigned long)emWidth, (unsigned long)emHeight);
+    return STATUS_ERROR;
+  }
+  error = FT_Set_Pixel_Sizes(font->face, emWidth, emHeight);
+  if (error) {
+    runtimeError(
+        "Failed to set font size to %lu x %lu (FreeType error %d)",
+        (unsigned long)emWidth, (unsigned long)emHeight, (int)error);
+    return STATUS_ERROR;
+  }
+  font->sizeKey = ((u32)font->face->size->metrics.x_ppem << 16) |
+                  (u32)font->face->size->metrics.y_ppem;
+  return STATUS_OK;
+}
+
+/* Takes ownership of 'data' (which may be NULL when opening 'path') */
+static Status newFont(const char *path, u8 *data, size_t dataLength, Value *out) {
+  ObjFont *font = NEW_NATIVE(ObjFont, &descriptorFont);
+  FT_Error error;
+  font->face = NULL;
+  font->data = data;
+  font->dataLength = dataLength;
+  font->sizeKey = 0;
+  font->atlas = NULL;
+  font->atlasHeight = 0;
+  font->shelfX = font->shelfY = font->shelfHeight = 0;
+  font->glyphs = NULL;
+  font->glyphCount = font->glyphCapacity = 0;
+  font->glyphCache.entries = font->kerningCache.entries = NULL;
+  font->glyphCache.count = font->glyphCache.capacity = 0;
+  font->kerningCache.count = font->kerningCache.capacity = 0;
+  if (data) {
+    trackExternalAllocation(EXTERNAL_MEMORY_NATIVE, dataLength);
+    error = FT_New_Memory_Face(library, data, (FT_Long)dataLength, 0, &font->face);
+  } else {
+    error = FT_New_Face(library, path, 0, &font->face);
+  }
+  if (error) {
+    font->face = NULL;
+    if (path) {
+      runtimeError("Failed to load font %s (FreeType error %d)", path, (int)error);
+    } else {
+      runtimeError("Failed to load font (FreeType error %d)", (int)error);
+    }
+    return STATUS_ERROR;
+  }
+  *out = valFont(font);
+  return setFontSize(font, DEFAULT_EM_SIZE, DEFAULT_EM_SIZE);
+}
+
+static Status newFontFromBytes(const u8 *bytes, size_t length, Value *out) {
+  u8 *data = (u8 *)malloc(length ? length : 1);
+  if (!data) {
+    panic("Failed to allocate font data (%lu bytes)", (unsigned long)length);
+  }
+  memcpy(data, bytes, length);
+  return newFont(NULL, data, length, out);
+}
+
+/* Reserves a width x height region of the atlas, starting a new shelf
+ * or doubling the atlas height as needed */
+static Status allocateAtlasRegion(ObjFont *font, size_t width, size_t height, size_t *x, size_t *y) {
+  size_t newHeight;
+  if (width > ATLAS_WIDTH) {
+    runtimeError("Glyph too wide for the font atlas (%lu pixels)", (unsigned long)width);
+    return STATUS_ERROR;
+  }
+  if (font->shelfX + width > ATLAS_WIDTH) {
+    font->shelfY += font->shelfHeight;
+    font->shelfX = 0;
+    font->shelfHeight = 0;
+  }
+  newHeight = font->atlasHeight ? font->atlasHeight : ATLAS_INITIAL_HEIGHT;
+  while (font->shelfY + height > newHeight) {
+    newHeight *= 2;
+  }
+  if (newHeight != font->atlasHeight) {
+    u8 *atlas = (u8 *)realloc(font->atlas, ATLAS_WIDTH * newHeight);
+    if (!atlas) {
+      panic("Failed to grow font atlas to %lu rows", (unsigned long)newHeight);
+    }
+    memset(atlas + ATLAS_WIDTH * font->atlasHeight, 0,
+           ATLAS_WIDTH * (newHeight - font->atlasHeight));
+    trackExternalAllocation(EXTERNAL_MEMORY_NATIVE, ATLAS_WIDTH * (newHeight - font->atlasHeight));
+    font->atlas = atlas;
+    font->atlasHeight = newHeight;
+  }
+  *x = font->shelfX;
+  *y = font->shelfY;
+  font->shelfX += width;
+  if (height > font->shelfHeight) {
+    font->shelfHeight = height;
+  }
+  return STATUS_OK;
+}
+
+/* Copies the rendered glyph bitmap into the atlas as 8-bit coverage */
+static Status copyGlyphBitmap(const FT_Bitmap *bitmap, u8 *dst) {
+  /* With a negative pitch, the rows are stored bottom up */
+  const u8 *top = bitmap->pitch < 0 ?
+      bitmap->buffer - (long)(bitmap->rows - 1) * bitmap->pitch : bitmap->buffer;
+  size_t row, column;
+  for (row = 0; row < bitmap->rows; row++) {
+    const u8 *src = top + (long)row * bitmap->pitch;
+    u8 *dstRow = dst + row * ATLAS_WIDTH;
+    switch (bitmap->pixel_mode) {
+      case FT_PIXEL_MODE_GRAY:
+        if (bitmap->num_grays == 256) {
+          memcpy(dstRow, src, bitmap->width);
+        } else {
+          for (column = 0; column < bitmap->width; column++) {
+            dstRow[column] = (u8)(src[column] * 255 / (bitmap->num_grays - 1));
+          }
+        }
+        break;
+      case FT_PIXEL_MODE_MONO:
+        for (column = 0; column < bitmap->width; column++) {
+          dstRow[column] = (src[column / 8] & (0x80 >> (column % 8))) ? 255 : 0;
+        }
+        break;
+      default:
+        runtimeError("Unsupported glyph bitmap format %d", (int)bitmap->pixel_mode);
+        return STATUS_ERROR;
+    }
+  }
+  return STATUS_OK;
+}
+
+/* Finds the glyph for 'codePoint' at the font's current size,
+ * rasterizing it into the atlas the first time it is used */
+static Status loadGlyph(ObjFont *font, u32 codePoint, size_t *out) {
+  FT_GlyphSlot slot;
+  FT_Error error;
+  Glyph glyph;
+  size_t atlasX = 0, atlasY = 0;
+  i32 cached;
+
+  if (fontCacheGet(&font->glyphCache, font->sizeKey, codePoint, 0, &cached)) {
+    *out = (size_t)cached;
+    return STATUS_OK;
+  }
+
+  glyph.glyphIndex = FT_Get_Char_Index(font->face, codePoint);
+  error = FT_Load_Glyph(font->face, glyph.glyphIndex, FT_LOAD_RENDER);
+  if (error) {
+    runtimeError(
+        "Failed to render glyph for U+%04lX (FreeType error %d)",
+        (unsigned long)codePoint, (int)error);
+    return STATUS_ERROR;
+  }
+  slot = font->face->glyph;
+  glyph.left = slot->bitmap_left;
+  glyph.top = slot->bitmap_top;
+  glyph.width = slot->bitmap.width;
+  glyph.height = slot->bitmap.rows;
+  glyph.advance = (i32)slot->advance.x;
+  if (glyph.width > 0 && glyph.height > 0) {
+    if (!allocateAtlasRegion(font, glyph.width, glyph.height, &atlasX, &atlasY) ||
+        !copyGlyphBitmap(&slot->bitmap, font->atlas + atlasY * ATLAS_WIDTH + atlasX)) {
+      return STATUS_ERROR;
+    }
+  }
+  glyph.atlasX = (u32)atlasX;
+  glyph.atlasY = (u32)atlasY;
+
+  if (font->glyphCount == font->glyphCapacity) {
+    size_t newCapacity = font->glyphCapacity ? font->glyphCapacity * 2 : 128;
+    Glyph *glyphs = (Glyph *)realloc(font->glyphs, newCapacity * sizeof(Glyph));
+    if (!glyphs) {
+      panic("Failed to allocate glyph table");
+    }
+    font->glyphs = glyphs;
+    font->glyphCapacity = newCapacity;
+  }
+  font->glyphs[font->glyphCount] = glyph;
+  fontCachePut(&font->glyphCache, font->sizeKey, codePoint, 0, (i32)font->glyphCount);
+  *out = font->glyphCount++;
+  return STATUS_OK;
+}
+
+/* Kerning between two glyphs at the font's current size, in 26.6 */
+static i32 getKerning(ObjFont *font, u32 left, u32 right) {
+  FT_Vector delta;
+  i32 kerning;
+  if (left == 0 || !FT_HAS_KERNING(font->face)) {
+    return 0;
+  }
+  if (fontCacheGet(&font->kerningCache, font->sizeKey, left, right, &kerning)) {
+    return kerning;
+  }
+  kerning = FT_Get_Kerning(font->face, left, right, FT_KERNING_DEFAULT, &delta) ?
+      0 : (i32)delta.x;
+  fontCachePut(&font->kerningCache, font->sizeKey, left, right, kerning);
+  return kerning;
+}
+
+static long roundCoordinate(double value) {
+  value = floor(value + 0.5);
+  if (!(value > -COORDINATE_LIMIT)) {
+    return (long)-COORDINATE_LIMIT;
+  }
+  if (!(value < COORDINATE_LIMIT)) {
+    return (long)COORDINATE_LIMIT;
+  }
+  return (long)value;
+}
+
+/* Blends a laid out run from the atlas into the pen's image */
+static void drawRun(ObjPen *pen, const GlyphBlit *run, size_t count) {
+  ObjFont *font = pen->font;
+  ObjImage *image;
+  Raster raster;
+  u32 color;
+  size_t i;
+  if (isNil(pen->image) || count == 0) {
+    return;
+  }
+  if (isCanvas(pen->image)) {
+    ObjCanvas *canvas = asCanvas(pen->image);
+    flushCanvas(canvas);
+    image = canvas->image;
+    raster = canvas->raster;
+  } else {
+    image = asImage(pen->image);
+    initRaster(&raster, image->pixels, image->width, image->height, image->width);
+  }
+  color = colorToPixel(pen->color);
+  for (i = 0; i < count; i++) {
+    const Glyph *glyph = font->glyphs + run[i].glyph;
+    RasterBounds bounds;
+    double args[4];
+    args[0] = (double)run[i].x;
+    args[1] = (double)run[i].y;
+    args[2] = (double)glyph->width;
+    args[3] = (double)glyph->height;
+    if (!rasterGetBounds(&raster, RASTER_COMMAND_FILL_RECT, args, color, &bounds)) {
+      continue;
+    }
+    markImageDirty(image, &bounds);
+    rasterBlendMask(
+        &raster, run[i].x, run[i].y,
+        font->atlas + glyph->atlasY * ATLAS_WIDTH + glyph->atlasX, ATLAS_WIDTH,
+        glyph->width, glyph->height, color);
+  }
+}
+
+static Status implFontStaticFromFile(i16 argc, Value *argv, Value *out) {
+  return newFont(asString(argv[0])->chars, NULL, 0, out);
+}
+
+static CFunction funcFontStaticFromFile = {implFontStaticFromFile, "fromFile", 1};
+
+static Status implFontStaticFromBuffer(i16 argc, Value *argv, Value *out) {
+  ObjBuffer *buffer = asBuffer(argv[0]);
+  return newFontFromBytes(buffer->handle.data, buffer->handle.length, out);
+}
+
+static CFunction funcFontStaticFromBuffer = {implFontStaticFromBuffer, "fromBuffer", 1};
+
+static Status implFontStaticFromData(i16 argc, Value *argv, Value *out) {
+  DataSourceView view;
+  Status status;
+  if (!dataSourceOpenView(asDataSource(argv[0]), &view)) {
+    return STATUS_ERROR;
+  }
+  status = newFontFromBytes(view.data, view.length, out);
+  dataSourceCloseView(&view);
+  return status;
+}
+
+static CFunction funcFontStaticFromData = {implFontStaticFromData, "fromData", 1};
+
+static Status implFontGetEmWidth(i16 argc, Value *argv, Value *out) {
+  *out = valNumber(asFont(argv[-1])->face->size->metrics.x_ppem);
+  return STATUS_OK;
+}
+
+static CFunction funcFontGetEmWidth = {implFontGetEmWidth, "__get_emWidth"};
+
+static Status implFontSetEmWidth(i16 argc, Value *argv, Value *out) {
+  u32 emWidth = asU32(argv[0]);
+  *out = argv[0];
+  return setFontSize(asFont(argv[-1]), emWidth, emWidth);
+}
+
+static CFunction funcFontSetEmWidth = {implFontSetEmWidth, "__set_emWidth", 1};
+
+static Status implFontGetEmHeight(i16 argc, Value *argv, Value *out) {
+  *out = valNumber(asFont(argv[-1])->face->size->metrics.y_ppem);
+  return STATUS_OK;
+}
+
+static CFunction funcFontGetEmHeight = {implFontGetEmHeight, "__get_emHeight"};
+
+static CFunction funcFontSetEmHeight = {implFontSetEmWidth, "__set_emHeight", 1};
+
+static Status implFontGetAdvanceHeight(i16 argc, Value *argv, Value *out) {
+  *out = valNumber((asFont(argv[-1])->face->size->metrics.height + 32) >> 6);
+  return STATUS_OK;
+}
+
+static CFunction funcFontGetAdvanceHeight = {implFontGetAdvanceHeight, "__get_advanceHeight"};
+
+static Status checkPenImage(Value image) {
+  if (!isNil(image) && !isImage(image) && !isCanvas(image)) {
+    runtimeError("Expected Image, Canvas or nil but got %s", getKindName(image));
+    return STATUS_ERROR;
+  }
+  return STATUS_OK;
+}
+
+static Status implFontNewPen(i16 argc, Value *argv, Value *out) {
+  ObjFont *font = asFont(argv[-1]);
+  Value image = argc > 0 ? argv[0] : valNil();
+  ObjPen *pen;
+  if (!checkPenImage(image)) {
+    return STATUS_ERROR;
+  }
+  pen = NEW_NATIVE(ObjPen, &descriptorPen);
+  pen->font = font;
+  pen->image = image;
+  pen->x = argc > 1 && !isNil(argv[1]) ? asNumber(argv[1]) : 0;
+  pen->y = argc > 2 && !isNil(argv[2]) ?
+      asNumber(argv[2]) : (double)((font->face->size->metrics.ascender + 32) >> 6);
+  pen->lineStartX = pen->x;
+  pen->color = argc > 3 && !isNil(argv[3]) ? asColor(argv[3]) : newColor(255, 255, 255, 255);
+  pen->boundingBox = newRect((float)pen->x, (float)pen->y, 0, 0);
+  *out = valPen(pen);
+  return STATUS_OK;
+}
+
+static const char *argsNewPen[] = {
+    "image",
+    "x",
+    "y",
+    "color",
+    NULL,
+};
+
+static CFunction funcFontNewPen = {
+    implFontNewPen,
+    "newPen",
+    0,
+    sizeof(argsNewPen) / sizeof(argsNewPen[0]) - 1,
+    argsNewPen,
+};
+
+static Status implPenGetFont(i16 argc, Value *argv, Value *out) {
+  *out = valFont(asPen(argv[-1])->font);
+  return STATUS_OK;
+}
+
+static CFunction funcPenGetFont = {implPenGetFont, "__get_font"};
+
+static Status implPenSetFont(i16 argc, Value *argv, Value *out) {
+  asPen(argv[-1])->font = asFont(argv[0]);
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcPenSetFont = {implPenSetFont, "__set_font", 1};
+
+static Status implPenGetImage(i16 argc, Value *argv, Value *out) {
+  *out = asPen(argv[-1])->image;
+  return STATUS_OK;
+}
+
+static CFunction funcPenGetImage = {implPenGetImage, "__get_image"};
+
+static Status implPenSetImage(i16 argc, Value *argv, Value *out) {
+  if (!checkPenImage(argv[0])) {
+    return STATUS_ERROR;
+  }
+  asPen(argv[-1])->image = argv[0];
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcPenSetImage = {implPenSetImage, "__set_image", 1};
+
+static Status implPenGetLineStartX(i16 argc, Value *argv, Value *out) {
+  *out = valNumber(asPen(argv[-1])->lineStartX);
+  return STATUS_OK;
+}
+
+static CFunction funcPenGetLineStartX = {implPenGetLineStartX, "__get_lineStartX"};
+
+static Status implPenSetLineStartX(i16 argc, Value *argv, Value *out) {
+  asPen(argv[-1])->lineStartX = asNumber(argv[0]);
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcPenSetLineStartX = {implPenSetLineStartX, "__set_lineStartX", 1};
+
+static Status implPenGetX(i16 argc, Value *argv, Value *out) {
+  *out = valNumber(asPen(argv[-1])->x);
+  return STATUS_OK;
+}
+
+static CFunction funcPenGetX = {implPenGetX, "__get_x"};
+
+static Status implPenSetX(i16 argc, Value *argv, Value *out) {
+  asPen(argv[-1])->x = asNumber(argv[0]);
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcPenSetX = {implPenSetX, "__set_x", 1};
+
+static Status implPenGetY(i16 argc, Value *argv, Value *out) {
+  *out = valNumber(asPen(argv[-1])->y);
+  return STATUS_OK;
+}
+
+static CFunction funcPenGetY = {implPenGetY, "__get_y"};
+
+static Status implPenSetY(i16 argc, Value *argv, Value *out) {
+  asPen(argv[-1])->y = asNumber(argv[0]);
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcPenSetY = {implPenSetY, "__set_y", 1};
+
+static Status implPenGetColor(i16 argc, Value *argv, Value *out) {
+  *out = valColor(asPen(argv[-1])->color);
+  return STATUS_OK;
+}
+
+static CFunction funcPenGetColor = {implPenGetColor, "__get_color"};
+
+static Status implPenSetColor(i16 argc, Value *argv, Value *out) {
+  asPen(argv[-1])->color = asColor(argv[0]);
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcPenSetColor = {implPenSetColor, "__set_color", 1};
+
+static Status implPenGetBoundingBox(i16 argc, Value *argv, Value *out) {
+  *out = valRect(asPen(argv[-1])->boundingBox);
+  return STATUS_OK;
+}
+
+static CFunction funcPenGetBoundingBox = {implPenGetBoundingBox, "__get_boundingBox"};
+
+/* Lays out the whole text first (which may rasterize new glyphs and
+ * grow the atlas), then draws it as one run */
+static Status implPenWrite(i16 argc, Value *argv, Value *out) {
+  ObjPen *pen = asPen(argv[-1]);
+  ObjFont *font = pen->font;
+  String *text = asString(argv[0]);
+  double lineHeight = (double)((font->face->size->metrics.height + 32) >> 6);
+  GlyphBlit stackRun[RUN_STACK_GLYPHS], *run = stackRun;
+  size_t runLength = 0, runCapacity = RUN_STACK_GLYPHS, i;
+  long minX = 0, minY = 0, maxX = 0, maxY = 0;
+  u32 previous = 0;
+  Status status = STATUS_OK;
+
+  for (i = 0; i < text->codePointCount; i++) {
+    u32 codePoint = text->utf32 ? text->utf32[i] : (u8)text->chars[i];
+    const Glyph *glyph;
+    size_t glyphID;
+    if (codePoint == '\n') {
+      pen->x = pen->lineStartX;
+      pen->y += lineHeight;
+      previous = 0;
+      continue;
+    }
+    if (!loadGlyph(font, codePoint, &glyphID)) {
+      status = STATUS_ERROR;
+      break;
+    }
+    glyph = font->glyphs + glyphID;
+    pen->x += getKerning(font, previous, glyph->glyphIndex) / 64.0;
+    if (glyph->width > 0 && glyph->height > 0) {
+      GlyphBlit *blit;
+      if (runLength == runCapacity) {
+        GlyphBlit *newRun = (GlyphBlit *)malloc(runCapacity * 2 * sizeof(GlyphBlit));
+        if (!newRun) {
+          panic("Failed to allocate glyph run");
+        }
+        memcpy(newRun, run, runLength * sizeof(GlyphBlit));
+        if (run != stackRun) {
+          free(run);
+        }
+        run = newRun;
+        runCapacity *= 2;
+      }
+      blit = run + runLength++;
+      blit->x = roundCoordinate(pen->x) + glyph->left;
+      blit->y = roundCoordinate(pen->y) - glyph->top;
+      blit->glyph = glyphID;
+      if (runLength == 1 || blit->x < minX) {
+        minX = blit->x;
+      }
+      if (runLength == 1 || blit->y < minY) {
+        minY = blit->y;
+      }
+      if (runLength == 1 || blit->x + (long)glyph->width > maxX) {
+        maxX = blit->x + (long)glyph->width;
+      }
+      if (runLength == 1 || blit->y + (long)glyph->height > maxY) {
+        maxY = blit->y + (long)glyph->height;
+      }
+    }
+    pen->x += glyph->advance / 64.0;
+    previous = glyph->glyphIndex;
+  }
+
+  if (status) {
+    drawRun(pen, run, runLength);
+    pen->boundingBox = runLength > 0 ?
+        newRect((float)minX, (float)minY, (float)(maxX - minX), (float)(maxY - minY)) :
+        newRect((float)pen->x, (float)pen->y, 0, 0);
+  }
+  if (run != stackRun) {
+    free(run);
+  }
+  return status;
+}
+
+static CFunction funcPenWrite = {implPenWrite, "write", 1};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *fontMethods[] = {
+      &funcFontGetEmWidth,
+      &funcFontSetEmWidth,
+      &funcFontGetEmHeight,
+      &funcFontSetEmHeight,
+      &funcFontGetAdvanceHeight,
+      &funcFontNewPen,
+      NULL,
+  };
+  CFunction *fontStaticMethods[] = {
+      &funcFontStaticFromData,
+      &funcFontStaticFromFile,
+      &funcFontStaticFromBuffer,
+      NULL,
+  };
+  CFunction *penMethods[] = {
+      &funcPenGetFont,
+      &funcPenSetFont,
+      &funcPenGetImage,
+      &funcPenSetImage,
+      &funcPenGetLineStartX,
+      &funcPenSetLineStartX,
+      &funcPenGetX,
+      &funcPenSetX,
+      &funcPenGetY,
+      &funcPenSetY,
+      &funcPenGetColor,
+      &funcPenSetColor,
+      &funcPenGetBoundingBox,
+      &funcPenWrite,
+      NULL,
+  };
+
+  if (!library) {
+    FT_Error error = FT_Init_FreeType(&library);
+    if (error) {
+      runtimeError("Failed to initialize FreeType (error %d)", (int)error);
+      return STATUS_ERROR;
+    }
+  }
+
+  if (!importModuleAndPop("media.canvas")) {
+    return STATUS_ERROR;
+  }
+
+  newNativeClass(module, &descriptorFont, fontMethods, fontStaticMethods);
+  newNativeClass(module, &descriptorPen, penMethods, NULL);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "media.font", 1};
+
+void addNativeModuleMediaFont(void) {
+  addNativeModule(&func);
+}
+#else
+void addNativeModuleMediaFont(void) {}
+#endif
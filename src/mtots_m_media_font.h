@@ -0,0 +1,14 @@
+#ifndef mtots_m_media_font_h
+#define mtots_m_media_font_h
+
+/* Native Module media.font
+ * Text rendering with FreeType.
+ *
+ * Each (size, glyph) pair is rasterized once into an 8-bit coverage
+ * atlas owned by its Font. Writing text lays out a whole run from the
+ * cached glyphs and kerning, then blends it from the atlas into an
+ * Image or Canvas. Only available when built with FreeType */
+
+void addNativeModuleMediaFont(void);
+
+#endif /*mtots_m_media_font_h*/
@@ -0,0 +1,218 @@
+#include "mtots_m_media_image.h"
+
+#include <stdlib.h>
+
+#include "mtots.h"
+
+static size_t getImagePixelsSize(ObjImage *image) {
+  return image->width * image->height * sizeof(u32);
+}
+
+static void freeImage(ObjNative *n) {
+  ObjImage *image = (ObjImage *)n;
+  if (image->pixels) {
+    trackExternalFree(EXTERNAL_MEMORY_NATIVE, getImagePixelsSize(image));
+    free(image->pixels);
+    image->pixels = NULL;
+  }
+}
+
+NativeObjectDescriptor descriptorImage = {
+    nopBlacken,
+    freeImage,
+    sizeof(ObjImage),
+    "Image",
+};
+
+Value valImage(ObjImage *image) {
+  return valObjExplicit((Obj *)image);
+}
+
+ObjImage *asImage(Value value) {
+  if (!isImage(value)) {
+    panic("Expected Image but got %s", getKindName(value));
+  }
+  return (ObjImage *)value.as.obj;
+}
+
+ObjImage *newImageWithPixels(size_t width, size_t height, u32 *pixels) {
+  ObjImage *image = NEW_NATIVE(ObjImage, &descriptorImage);
+  image->width = width;
+  image->height = height;
+  image->pixels = pixels;
+  markImageAllDirty(image);
+  trackExternalAllocation(EXTERNAL_MEMORY_NATIVE, getImagePixelsSize(image));
+  return image;
+}
+
+/* Returns NULL if the pixels cannot be allocated */
+static u32 *allocImagePixels(size_t width, size_t height) {
+  if (height && width > ((size_t)-1 / sizeof(u32) - 1) / height) {
+    return NULL;
+  }
+  return (u32 *)calloc(width * height + 1, sizeof(u32));
+}
+
+ObjImage *newImage(size_t width, size_t height) {
+  u32 *pixels = allocImagePixels(width, height);
+  if (!pixels) {
+    panic("Failed to allocate %lu x %lu Image", (unsigned long)width, (unsigned long)height);
+  }
+  return newImageWithPixels(width, height, pixels);
+}
+
+void markImageDirty(ObjImage *image, const RasterBounds *bounds) {
+  rasterBoundsUnion(&image->dirty, bounds);
+}
+
+void markImageAllDirty(ObjImage *image) {
+  image->dirty.minX = image->dirty.minY = 0;
+  image->dirty.maxX = image->width;
+  image->dirty.maxY = image->height;
+}
+
+ubool takeImageDirtyBounds(ObjImage *image, RasterBounds *out) {
+  RasterBounds *dirty = &image->dirty;
+  if (dirty->minX >= dirty->maxX || dirty->minY >= dirty->maxY) {
+    return UFALSE;
+  }
+  *out = *dirty;
+  dirty->minX = dirty->minY = dirty->maxX = dirty->maxY = 0;
+  return UTRUE;
+}
+
+u32 colorToPixel(Color color) {
+  return rasterPixel(color.red, color.green, color.blue, color.alpha);
+}
+
+Color pixelToColor(u32 pixel) {
+  Color color;
+  rasterUnpackPixel(pixel, &color.red, &color.green, &color.blue, &color.alpha);
+  return color;
+}
+
+static Status implImageStaticCall(i16 argc, Value *argv, Value *out) {
+  size_t width = asSize(argv[0]), height = asSize(argv[1]);
+  u32 *pixels = allocImagePixels(width, height);
+  if (!pixels) {
+    return runtimeError(
+        "Could not allocate %lu x %lu Image", (unsigned long)width, (unsigned long)height);
+  }
+  *out = valImage(newImageWithPixels(width, height, pixels));
+  return STATUS_OK;
+}
+
+static CFunction funcImageStaticCall = {implImageStaticCall, "__call__", 2};
+
+static Status implImageGetattr(i16 argc, Value *argv, Value *out) {
+  ObjImage *image = asImage(argv[-1]);
+  String *name = asString(argv[0]);
+  CommonStrings *cs = getCommonStrings();
+  if (name == cs->width) {
+    *out = valNumber(image->width);
+  } else if (name == cs->height) {
+    *out = valNumber(image->height);
+  } else {
+    fieldNotFoundError(argv[-1], name->chars);
+    return STATUS_ERROR;
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcImageGetattr = {implImageGetattr, "__getattr__", 1};
+
+static Status implImageGet(i16 argc, Value *argv, Value *out) {
+  ObjImage *image = asImage(argv[-1]);
+  size_t row = asIndex(argv[0], image->height);
+  size_t column = asIndex(argv[1], image->width);
+  *out = valColor(pixelToColor(image->pixels[row * image->width + column]));
+  return STATUS_OK;
+}
+
+static CFunction funcImageGet = {implImageGet, "get", 2};
+
+static Status implImageSet(i16 argc, Value *argv, Value *out) {
+  ObjImage *image = asImage(argv[-1]);
+  size_t row = asIndex(argv[0], image->height);
+  size_t column = asIndex(argv[1], image->width);
+  RasterBounds bounds;
+  image->pixels[row * image->width + column] = colorToPixel(asColor(argv[2]));
+  bounds.minX = column;
+  bounds.minY = row;
+  bounds.maxX = column + 1;
+  bounds.maxY = row + 1;
+  markImageDirty(image, &bounds);
+  return STATUS_OK;
+}
+
+static CFunction funcImageSet = {implImageSet, "set", 3};
+
+static Status implImageGetDirtyRect(i16 argc, Value *argv, Value *out) {
+  RasterBounds *dirty = &asImage(argv[-1])->dirty;
+  if (dirty->minX < dirty->maxX && dirty->minY < dirty->maxY) {
+    *out = valRect(newRect(
+        dirty->minX, dirty->minY, dirty->maxX - dirty->minX, dirty->maxY - dirty->minY));
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcImageGetDirtyRect = {implImageGetDirtyRect, "getDirtyRect"};
+
+static Status implImageMarkDirty(i16 argc, Value *argv, Value *out) {
+  ObjImage *image = asImage(argv[-1]);
+  if (argc > 0 && !isNil(argv[0])) {
+    static const u32 opaque = 0xFFFFFFFFUL;
+    Rect rect = asRect(argv[0]);
+    double args[4];
+    Raster raster;
+    RasterBounds bounds;
+    args[0] = rect.minX;
+    args[1] = rect.minY;
+    args[2] = rect.width;
+    args[3] = rect.height;
+    initRaster(&raster, image->pixels, image->width, image->height, image->width);
+    if (rasterGetBounds(&raster, RASTER_COMMAND_FILL_RECT, args, opaque, &bounds)) {
+      markImageDirty(image, &bounds);
+    }
+  } else {
+    markImageAllDirty(image);
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcImageMarkDirty = {implImageMarkDirty, "markDirty", 0, 1};
+
+static Status implImageClearDirtyRect(i16 argc, Value *argv, Value *out) {
+  RasterBounds bounds;
+  takeImageDirtyBounds(asImage(argv[-1]), &bounds);
+  return STATUS_OK;
+}
+
+static CFunction funcImageClearDirtyRect = {implImageClearDirtyRect, "clearDirtyRect"};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *methods[] = {
+      &funcImageGetattr,
+      &funcImageGet,
+      &funcImageSet,
+      &funcImageGetDirtyRect,
+      &funcImageMarkDirty,
+      &funcImageClearDirtyRect,
+      NULL,
+  };
+  CFunction *staticMethods[] = {
+      &funcImageStaticCall,
+      NULL,
+  };
+
+  newNativeClass(module, &descriptorImage, methods, staticMethods);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "media.image", 1};
+
+void addNativeModuleMediaImage(void) {
+  addNativeModule(&func);
+}
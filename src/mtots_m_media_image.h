@@ -0,0 +1,50 @@
+#ifndef mtots_m_media_image_h
+#define mtots_m_media_image_h
+
+#include "mtots_object.h"
+
+/* Native Module media.image
+ * Images are packed RGBA8 pixels, one u32 per pixel in memory order
+ * (see mtots_util_raster.h).
+ *
+ * Native code that writes to 'pixels' marks the pixels it changed as
+ * dirty, so that consumers like streaming textures only copy the part
+ * of the image that changed since they last took the dirty bounds.
+ * A new image is entirely dirty */
+
+#define isImage(v) (getNativeObjectDescriptor(v) == &descriptorImage)
+
+typedef struct ObjImage {
+  ObjNative obj;
+  size_t width;
+  size_t height;
+  u32 *pixels;
+  RasterBounds dirty;
+} ObjImage;
+
+extern NativeObjectDescriptor descriptorImage;
+
+Value valImage(ObjImage *image);
+ObjImage *asImage(Value value);
+
+/* Creates a new image with every pixel set to transparent black */
+ObjImage *newImage(size_t width, size_t height);
+
+/* Creates a new image that takes ownership of 'pixels', which must hold
+ * width * height pixels and have been allocated with malloc.
+ * Lets decoders hand over their output without copying it */
+ObjImage *newImageWithPixels(size_t width, size_t height, u32 *pixels);
+
+void markImageDirty(ObjImage *image, const RasterBounds *bounds);
+void markImageAllDirty(ObjImage *image);
+
+/* Gets the dirty bounds and clears them.
+ * Returns UFALSE if no pixels are dirty */
+ubool takeImageDirtyBounds(ObjImage *image, RasterBounds *out);
+
+u32 colorToPixel(Color color);
+Color pixelToColor(u32 pixel);
+
+void addNativeModuleMediaImage(void);
+
+#endif /*mtots_m_media_image_h*/
@@ -0,0 +1,185 @@
+#include "mtots_m_media_image_loader.h"
+
+#if MTOTS_ENABLE_STBIMAGE
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mtots.h"
+#include "mtots_m_data.h"
+#include "mtots_m_media_image.h"
+#include "mtotsa_stbimage.h"
+
+#if MTOTS_IS_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* One entry of a 'loadImages' batch. Everything in here is filled in
+ * on a worker thread, so none of it may belong to the VM */
+typedef struct LoadJobItem {
+  const char *path;
+  unsigned char *pixels;
+  int width;
+  int height;
+  const char *error;
+} LoadJobItem;
+
+/* stb_image allocates with malloc, so its output
+ * becomes the Image's pixels as is */
+static Status implLoadImage(i16 argc, Value *argv, Value *out) {
+  DataSourceView view;
+  unsigned char *pixels;
+  int width, height, ok;
+  if (!dataSourceOpenView(asDataSource(argv[0]), &view)) {
+    return STATUS_ERROR;
+  }
+  if (view.length > (size_t)I32_MAX) {
+    dataSourceCloseView(&view);
+    return runtimeError("loadImage(): data too large (%lu bytes)", (unsigned long)view.length);
+  }
+  ok = mtotsa_load_image_from_memory(view.data, (int)view.length, &pixels, &width, &height);
+  dataSourceCloseView(&view);
+  if (!ok) {
+    return STATUS_ERROR;
+  }
+  *out = valImage(newImageWithPixels((size_t)width, (size_t)height, (u32 *)pixels));
+  return STATUS_OK;
+}
+
+static CFunction funcLoadImage = {implLoadImage, "loadImage", 1};
+
+/* Decodes the file at item->path with plain malloc'd (or mapped) memory,
+ * since Buffer's memory accounting may only be used on the VM thread */
+static void decodeFile(LoadJobItem *item) {
+  unsigned char *data = NULL;
+  long length = -1;
+#if MTOTS_IS_POSIX
+  int fd = open(item->path, O_RDONLY);
+  struct stat st;
+  if (fd < 0) {
+    item->error = "cannot open file";
+    return;
+  }
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+      st.st_size <= I32_MAX) {
+    void *mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      close(fd);
+      if (!mtotsa_decode_image(
+              (const unsigned char *)mapped, (int)st.st_size,
+              &item->pixels, &item->width, &item->height, &item->error)) {
+        item->pixels = NULL;
+      }
+      munmap(mapped, (size_t)st.st_size);
+      return;
+    }
+  }
+  close(fd);
+#endif
+  {
+    FILE *file = fopen(item->path, "rb");
+    if (!file) {
+      item->error = "cannot open file";
+      return;
+    }
+    if (fseek(file, 0, SEEK_END) == 0) {
+      length = ftell(file);
+    }
+    if (length < 0 || length > I32_MAX || fseek(file, 0, SEEK_SET) != 0 ||
+        !(data = (unsigned char *)malloc((size_t)length + 1)) ||
+        fread(data, 1, (size_t)length, file) != (size_t)length) {
+      fclose(file);
+      free(data);
+      item->error = "cannot read file";
+      return;
+    }
+    fclose(file);
+  }
+  if (!mtotsa_decode_image(
+          data, (int)length, &item->pixels, &item->width, &item->height, &item->error)) {
+    item->pixels = NULL;
+  }
+  free(data);
+}
+
+static void decodeFileTask(void *context, size_t index) {
+  decodeFile(&((LoadJobItem *)context)[index]);
+}
+
+static Status implLoadImages(i16 argc, Value *argv, Value *out) {
+  Value *paths = isList(argv[0]) ? asList(argv[0])->buffer : asFrozenList(argv[0])->buffer;
+  size_t i, count = isList(argv[0]) ? asList(argv[0])->length : asFrozenList(argv[0])->length;
+  LoadJobItem *items;
+  ObjList *images;
+
+  for (i = 0; i < count; i++) {
+    if (!isString(paths[i])) {
+      return runtimeError("loadImages(): expected String paths but got %s",
+                          getKindName(paths[i]));
+    }
+  }
+  items = (LoadJobItem *)calloc(count + 1, sizeof(LoadJobItem));
+  if (!items) {
+    panic("loadImages(): out of memory");
+  }
+  for (i = 0; i < count; i++) {
+    items[i].path = asString(paths[i])->chars;
+  }
+
+  runParallel(count, decodeFileTask, items);
+
+  for (i = 0; i < count && !items[i].error; i++)
+    ;
+  if (i < count) {
+    runtimeError("loadImages(): %s: %s", items[i].path, items[i].error);
+    for (i = 0; i < count; i++) {
+      free(items[i].pixels);
+    }
+    free(items);
+    return STATUS_ERROR;
+  }
+
+  /* Only the Image objects themselves are created on this thread */
+  images = newList(count);
+  push(valList(images));
+  for (i = 0; i < count; i++) {
+    images->buffer[i] = valImage(newImageWithPixels(
+        (size_t)items[i].width, (size_t)items[i].height, (u32 *)items[i].pixels));
+    items[i].pixels = NULL;
+  }
+  pop(); /* images */
+  free(items);
+  *out = valList(images);
+  return STATUS_OK;
+}
+
+static CFunction funcLoadImages = {implLoadImages, "loadImages", 1};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *functions[] = {
+      &funcLoadImage,
+      &funcLoadImages,
+      NULL,
+  };
+
+  if (!importModuleAndPop("media.image")) {
+    return STATUS_ERROR;
+  }
+
+  moduleAddFunctions(module, functions);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "media.image.loader", 1};
+
+void addNativeModuleMediaImageLoader(void) {
+  addNativeModule(&func);
+}
+
+#else
+void addNativeModuleMediaImageLoader(void) {}
+#endif
@@ -0,0 +1,9 @@
+#ifndef mtots_m_media_image_loader_h
+#define mtots_m_media_image_loader_h
+
+/* Native Module media.image.loader
+ * Only available when built with stb_image (MTOTS_ENABLE_STBIMAGE) */
+
+void addNativeModuleMediaImageLoader(void);
+
+#endif /*mtots_m_media_image_loader_h*/
@@ -0,0 +1,128 @@
+#include "mtots_m_media_png.h"
+
+#if MTOTS_ENABLE_LODEPNG
+#include <stdlib.h>
+
+#include "lodepng.h"
+#include "mtots.h"
+#include "mtots_m_data.h"
+#include "mtots_m_media_image.h"
+
+#define PNG_LEVEL_NONE 0
+#define PNG_LEVEL_FAST 1
+#define PNG_LEVEL_DEFAULT 2
+
+/* lodepng allocates with malloc, so its output
+ * becomes the Image's pixels as is */
+static Status implLoadPNG(i16 argc, Value *argv, Value *out) {
+  DataSourceView view;
+  unsigned char *pixels;
+  unsigned width, height, errorcode;
+  if (!dataSourceOpenView(asDataSource(argv[0]), &view)) {
+    return STATUS_ERROR;
+  }
+  errorcode = lodepng_decode32(&pixels, &width, &height, view.data, view.length);
+  dataSourceCloseView(&view);
+  if (errorcode != 0) {
+    return runtimeError("loadPNG(): %s", lodepng_error_text(errorcode));
+  }
+  *out = valImage(newImageWithPixels(width, height, (u32 *)pixels));
+  return STATUS_OK;
+}
+
+static CFunction funcLoadPNG = {implLoadPNG, "loadPNG", 1};
+
+static void applyLevel(LodePNGEncoderSettings *settings, int level) {
+  switch (level) {
+    case PNG_LEVEL_NONE:
+      settings->zlibsettings.btype = 0;
+      settings->filter_strategy = LFS_ZERO;
+      settings->auto_convert = 0;
+      return;
+    case PNG_LEVEL_FAST:
+      /* A single fixed filter and a short greedy LZ77 search. Output is
+       * always RGBA to skip the scan for a smaller color type */
+      settings->zlibsettings.windowsize = 512;
+      settings->zlibsettings.nicematch = 32;
+      settings->zlibsettings.lazymatching = 0;
+      settings->filter_palette_zero = 0;
+      settings->filter_strategy = LFS_FOUR;
+      settings->auto_convert = 0;
+      return;
+    default:
+      return;
+  }
+}
+
+static Status implSavePNG(i16 argc, Value *argv, Value *out) {
+  ObjImage *image = asImage(argv[0]);
+  ObjDataSink *sink = asDataSink(argv[1]);
+  int level = argc > 2 && !isNil(argv[2]) ? asInt(argv[2]) : PNG_LEVEL_DEFAULT;
+  LodePNGState state;
+  unsigned char *data = NULL;
+  size_t dataSize = 0;
+  unsigned errorcode;
+  ubool ok;
+  if (level < PNG_LEVEL_NONE || level > PNG_LEVEL_DEFAULT) {
+    return runtimeError("savePNG(): level must be 0, 1 or 2 but got %d", level);
+  }
+  lodepng_state_init(&state);
+  applyLevel(&state.encoder, level);
+  errorcode = lodepng_encode(
+      &data, &dataSize, (const unsigned char *)image->pixels,
+      (unsigned)image->width, (unsigned)image->height, &state);
+  lodepng_state_cleanup(&state);
+  if (errorcode != 0) {
+    free(data);
+    return runtimeError("savePNG(): %s", lodepng_error_text(errorcode));
+  }
+  ok = dataSinkWriteBytes(sink, data, dataSize);
+  free(data);
+  return ok ? STATUS_OK : STATUS_ERROR;
+}
+
+static const char *argsSavePNG[] = {
+    "image",
+    "sink",
+    "level",
+    NULL,
+};
+
+static CFunction funcSavePNG = {
+    implSavePNG,
+    "savePNG",
+    2,
+    sizeof(argsSavePNG) / sizeof(argsSavePNG[0]) - 1,
+    argsSavePNG,
+};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *functions[] = {
+      &funcLoadPNG,
+      &funcSavePNG,
+      NULL,
+  };
+
+  if (!importModuleAndPop("media.image")) {
+    return STATUS_ERROR;
+  }
+
+  moduleAddFunctions(module, functions);
+
+  mapSetN(&module->fields, "LEVEL_NONE", valNumber(PNG_LEVEL_NONE));
+  mapSetN(&module->fields, "LEVEL_FAST", valNumber(PNG_LEVEL_FAST));
+  mapSetN(&module->fields, "LEVEL_DEFAULT", valNumber(PNG_LEVEL_DEFAULT));
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "media.png", 1};
+
+void addNativeModuleMediaPng(void) {
+  addNativeModule(&func);
+}
+
+#else
+void addNativeModuleMediaPng(void) {}
+#endif
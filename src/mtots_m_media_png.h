@@ -0,0 +1,9 @@
+#ifndef mtots_m_media_png_h
+#define mtots_m_media_png_h
+
+/* Native Module media.png
+ * Only available when built with lodepng (MTOTS_ENABLE_LODEPNG) */
+
+void addNativeModuleMediaPng(void);
+
+#endif /*mtots_m_media_png_h*/
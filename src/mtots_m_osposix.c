@@ -114,6 +114,21 @@ static Status implWrite(i16 argc, Value *argv, Value *out) {
 
 static CFunction funcWrite = {implWrite, "write", 2, 3};
 
+static Status implPipe(i16 argc, Value *argv, Value *out) {
+  int fds[2];
+  ObjList *list;
+  if (pipe(fds) < 0) {
+    return runtimeError("pipe(): %s", strerror(errno));
+  }
+  list = newList(2);
+  list->buffer[0] = valFileDescriptor(fds[0]);
+  list->buffer[1] = valFileDescriptor(fds[1]);
+  *out = valList(list);
+  return STATUS_OK;
+}
+
+static CFunction funcPipe = {implPipe, "pipe"};
+
 static Status impl(i16 argc, Value *argv, Value *out) {
   ObjModule *module = asModule(argv[0]);
   CFunction *functions[] = {
@@ -121,6 +136,7 @@ static Status impl(i16 argc, Value *argv, Value *out) {
       &funcClose,
       &funcRead,
       &funcWrite,
+      &funcPipe,
       NULL,
   };
 
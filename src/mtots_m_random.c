@@ -5,8 +5,9 @@
 #include <time.h>
 
 #include "mtots.h"
+#include "mtots_m_array.h"
 
-static Random defaultInstance;
+static Xoshiro256 defaultInstance;
 
 ObjRandom *asRandom(Value value) {
   if (!isRandom(value)) {
@@ -16,7 +17,7 @@ ObjRandom *asRandom(Value value) {
 }
 
 static Status implRandom(i16 argc, Value *args, Value *out) {
-  *out = valNumber(randomFloat(&defaultInstance));
+  *out = valNumber(xoshiro256Float(&defaultInstance));
   return STATUS_OK;
 }
 
@@ -114,6 +115,238 @@ static Status implRandomRange(i16 argCount, Value *args, Value *out) {
 
 static CFunction funcRandomRange = {implRandomRange, "range", 1, 2};
 
+NativeObjectDescriptor descriptorXoshiro256 = {
+    nopBlacken,
+    nopFree,
+    sizeof(ObjXoshiro256),
+    "Xoshiro256",
+};
+
+ObjXoshiro256 *asXoshiro256(Value value) {
+  if (!isXoshiro256(value)) {
+    panic("Expected Xoshiro256 but got %s", getKindName(value));
+  }
+  return (ObjXoshiro256 *)AS_OBJ_UNSAFE(value);
+}
+
+static Status implInstantiateXoshiro256(i16 argc, Value *argv, Value *out) {
+  ObjXoshiro256 *x = NEW_NATIVE(ObjXoshiro256, &descriptorXoshiro256);
+  initXoshiro256(&x->handle, argc > 0 ? asU32(argv[0]) : 0);
+  *out = valObjExplicit((Obj *)x);
+  return STATUS_OK;
+}
+
+static CFunction funcInstantiateXoshiro256 = {implInstantiateXoshiro256, "__call__", 0, 1};
+
+static Status implXoshiro256Seed(i16 argc, Value *argv, Value *out) {
+  initXoshiro256(&asXoshiro256(argv[-1])->handle, asU32(argv[0]));
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256Seed = {implXoshiro256Seed, "seed", 1};
+
+static Status implXoshiro256Next(i16 argc, Value *argv, Value *out) {
+  *out = valNumber((u32)(xoshiro256Next(&asXoshiro256(argv[-1])->handle) >> 32));
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256Next = {implXoshiro256Next, "next"};
+
+static Status implXoshiro256Number(i16 argc, Value *argv, Value *out) {
+  *out = valNumber(xoshiro256Float(&asXoshiro256(argv[-1])->handle));
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256Number = {implXoshiro256Number, "number"};
+
+/* Returns an integer uniformly randomly selected from [low, high] */
+static double xoshiro256Between(Xoshiro256 *x, i32 low, i32 high) {
+  u32 count = (u32)high - (u32)low + 1;
+  u32 offset = count == 0 ? (u32)(xoshiro256Next(x) >> 32) : xoshiro256Below(x, count);
+  return (double)low + offset;
+}
+
+/* Reads the inclusive [low, high] bounds shared by 'int' and 'fillInt' */
+static Status getIntBounds(const char *name, i16 argc, Value *argv, i32 *low, i32 *high) {
+  if (argc > 1) {
+    *low = asI32(argv[0]);
+    *high = asI32(argv[1]);
+  } else {
+    *low = 0;
+    *high = asI32(argv[0]);
+  }
+  if (*low > *high) {
+    return runtimeError(
+        "Xoshiro256.%s() requires low <= high, but low = %ld, high = %ld",
+        name, (long)*low, (long)*high);
+  }
+  return STATUS_OK;
+}
+
+static Status implXoshiro256Int(i16 argc, Value *argv, Value *out) {
+  i32 low, high;
+  if (!getIntBounds("int", argc, argv, &low, &high)) {
+    return STATUS_ERROR;
+  }
+  *out = valNumber(xoshiro256Between(&asXoshiro256(argv[-1])->handle, low, high));
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256Int = {implXoshiro256Int, "int", 1, 2};
+
+static Status implXoshiro256Range(i16 argc, Value *argv, Value *out) {
+  i32 start = 0, end;
+  if (argc > 1) {
+    start = asI32(argv[0]);
+    end = asI32(argv[1]);
+  } else {
+    end = asI32(argv[0]);
+  }
+  if (start >= end) {
+    return runtimeError(
+        "Xoshiro256.range() requires start < end but got start = %ld, end = %ld",
+        (long)start, (long)end);
+  }
+  *out = valNumber(xoshiro256Between(&asXoshiro256(argv[-1])->handle, start, end - 1));
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256Range = {implXoshiro256Range, "range", 1, 2};
+
+static Status implXoshiro256Normal(i16 argc, Value *argv, Value *out) {
+  double mean = argc > 0 && !isNil(argv[0]) ? asNumber(argv[0]) : 0;
+  double stddev = argc > 1 && !isNil(argv[1]) ? asNumber(argv[1]) : 1;
+  double a, b;
+  xoshiro256NormalPair(&asXoshiro256(argv[-1])->handle, &a, &b);
+  *out = valNumber(mean + stddev * a);
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256Normal = {implXoshiro256Normal, "normal", 0, 2};
+
+static Status implXoshiro256Jump(i16 argc, Value *argv, Value *out) {
+  xoshiro256Jump(&asXoshiro256(argv[-1])->handle);
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256Jump = {implXoshiro256Jump, "jump"};
+
+static Status implXoshiro256Split(i16 argc, Value *argv, Value *out) {
+  ObjXoshiro256 *x = asXoshiro256(argv[-1]);
+  ObjXoshiro256 *child = NEW_NATIVE(ObjXoshiro256, &descriptorXoshiro256);
+  child->handle = x->handle;
+  xoshiro256Jump(&x->handle);
+  *out = valObjExplicit((Obj *)child);
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256Split = {implXoshiro256Split, "split"};
+
+/* Stores 'expr' into every element of the typed array 'array',
+ * evaluating it once per element */
+#define FILL_TYPED_ARRAY(array, expr)                                    \
+  do {                                                                   \
+    size_t i_, n_ = typedArrayLength(array);                             \
+    void *data_ = (array)->buffer->handle.data;                          \
+    switch ((array)->type) {                                             \
+      case TYPED_ARRAY_F32:                                              \
+        for (i_ = 0; i_ < n_; i_++) ((f32 *)data_)[i_] = (f32)(expr);    \
+        break;                                                           \
+      case TYPED_ARRAY_F64:                                              \
+        for (i_ = 0; i_ < n_; i_++) ((f64 *)data_)[i_] = (f64)(expr);    \
+        break;                                                           \
+      case TYPED_ARRAY_I32:                                              \
+        for (i_ = 0; i_ < n_; i_++) ((i32 *)data_)[i_] = (i32)(expr);    \
+        break;                                                           \
+    }                                                                    \
+  } while (0)
+
+static Status implXoshiro256FillUniform(i16 argc, Value *argv, Value *out) {
+  Xoshiro256 *x = &asXoshiro256(argv[-1])->handle;
+  ObjTypedArray *array = asTypedArray(argv[0]);
+  double low = argc > 1 && !isNil(argv[1]) ? asNumber(argv[1]) : 0;
+  double high = argc > 2 && !isNil(argv[2]) ? asNumber(argv[2]) : 1;
+  double width = high - low;
+  if (array->type == TYPED_ARRAY_I32) {
+    return runtimeError("Xoshiro256.fillUniform() requires a Float32Array or Float64Array");
+  }
+  FILL_TYPED_ARRAY(array, low + width * xoshiro256Float(x));
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256FillUniform = {implXoshiro256FillUniform, "fillUniform", 1, 3};
+
+static Status implXoshiro256FillNormal(i16 argc, Value *argv, Value *out) {
+  Xoshiro256 *x = &asXoshiro256(argv[-1])->handle;
+  ObjTypedArray *array = asTypedArray(argv[0]);
+  double mean = argc > 1 && !isNil(argv[1]) ? asNumber(argv[1]) : 0;
+  double stddev = argc > 2 && !isNil(argv[2]) ? asNumber(argv[2]) : 1;
+  size_t i, n = typedArrayLength(array);
+  void *data = array->buffer->handle.data;
+  double a, b;
+  if (array->type == TYPED_ARRAY_I32) {
+    return runtimeError("Xoshiro256.fillNormal() requires a Float32Array or Float64Array");
+  }
+  /* Samples are generated in pairs, with the last one discarded if 'n' is odd */
+  for (i = 0; i < n; i += 2) {
+    xoshiro256NormalPair(x, &a, &b);
+    a = mean + stddev * a;
+    b = mean + stddev * b;
+    if (array->type == TYPED_ARRAY_F32) {
+      ((f32 *)data)[i] = (f32)a;
+      if (i + 1 < n) {
+        ((f32 *)data)[i + 1] = (f32)b;
+      }
+    } else {
+      ((f64 *)data)[i] = a;
+      if (i + 1 < n) {
+        ((f64 *)data)[i + 1] = b;
+      }
+    }
+  }
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256FillNormal = {implXoshiro256FillNormal, "fillNormal", 1, 3};
+
+static Status implXoshiro256FillInt(i16 argc, Value *argv, Value *out) {
+  Xoshiro256 *x = &asXoshiro256(argv[-1])->handle;
+  ObjTypedArray *array = asTypedArray(argv[0]);
+  i32 low, high;
+  if (!getIntBounds("fillInt", argc - 1, argv + 1, &low, &high)) {
+    return STATUS_ERROR;
+  }
+  FILL_TYPED_ARRAY(array, xoshiro256Between(x, low, high));
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256FillInt = {implXoshiro256FillInt, "fillInt", 2, 3};
+
+static Status implXoshiro256FillBytes(i16 argc, Value *argv, Value *out) {
+  Xoshiro256 *x = &asXoshiro256(argv[-1])->handle;
+  Buffer *buffer = &asBuffer(argv[0])->handle;
+  size_t i, length = buffer->length;
+  u8 *data = buffer->data;
+  if (!bufferCheckWritable(buffer)) {
+    return STATUS_ERROR;
+  }
+  for (i = 0; i + 8 <= length; i += 8) {
+    u64 bits = xoshiro256Next(x);
+    memcpy(data + i, &bits, 8);
+  }
+  if (i < length) {
+    u64 bits = xoshiro256Next(x);
+    memcpy(data + i, &bits, length - i);
+  }
+  *out = argv[0];
+  return STATUS_OK;
+}
+
+static CFunction funcXoshiro256FillBytes = {implXoshiro256FillBytes, "fillBytes", 1};
+
 static Status impl(i16 argCount, Value *args, Value *out) {
   ObjModule *module = asModule(args[0]);
   CFunction *functions[] = {
@@ -132,12 +365,33 @@ static Status impl(i16 argCount, Value *args, Value *out) {
       &funcInstantiateRandom,
       NULL,
   };
+  CFunction *xoshiro256Methods[] = {
+      &funcXoshiro256Seed,
+      &funcXoshiro256Next,
+      &funcXoshiro256Number,
+      &funcXoshiro256Int,
+      &funcXoshiro256Range,
+      &funcXoshiro256Normal,
+      &funcXoshiro256Jump,
+      &funcXoshiro256Split,
+      &funcXoshiro256FillUniform,
+      &funcXoshiro256FillNormal,
+      &funcXoshiro256FillInt,
+      &funcXoshiro256FillBytes,
+      NULL,
+  };
+  CFunction *xoshiro256StaticMethods[] = {
+      &funcInstantiateXoshiro256,
+      NULL,
+  };
 
-  initRandom(&defaultInstance, ((u32)time(NULL)) ^ (u32)rand());
+  initXoshiro256(&defaultInstance, ((u64)time(NULL)) ^ (u64)rand());
 
   moduleAddFunctions(module, functions);
 
   newNativeClass(module, &descriptorRandom, methods, staticMethods);
+  newNativeClass(
+      module, &descriptorXoshiro256, xoshiro256Methods, xoshiro256StaticMethods);
 
   return STATUS_OK;
 }
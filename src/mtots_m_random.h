@@ -16,6 +16,17 @@ extern NativeObjectDescriptor descriptorRandom;
 
 ObjRandom *asRandom(Value value);
 
+#define isXoshiro256(value) (getNativeObjectDescriptor(value) == &descriptorXoshiro256)
+
+typedef struct ObjXoshiro256 {
+  ObjNative obj;
+  Xoshiro256 handle;
+} ObjXoshiro256;
+
+extern NativeObjectDescriptor descriptorXoshiro256;
+
+ObjXoshiro256 *asXoshiro256(Value value);
+
 void addNativeModuleRandom(void);
 
 #endif /*mtots_m_random_h*/
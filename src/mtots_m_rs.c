@@ -0,0 +1,122 @@
+#include "mtots_m_rs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtots.h"
+#include "mtots_archive.h"
+
+/* Appends 'path' to the entry directory already in 'sb' (which is
+ * either empty or ends in '/'), resolving "." and ".." parts */
+static Status resolveEntryName(StringBuilder *sb, const char *resourcePath) {
+  const char *path = resourcePath;
+  while (*path) {
+    const char *end = strchr(path, '/');
+    size_t length = end ? (size_t)(end - path) : strlen(path);
+    if (length == 0 || (length == 1 && path[0] == '.')) {
+      /* skip */
+    } else if (length == 2 && path[0] == '.' && path[1] == '.') {
+      if (sb->length == 0) {
+        return runtimeError("Resource path %s is outside of the archive", resourcePath);
+      }
+      sb->length--;
+      while (sb->length > 0 && sb->buffer[sb->length - 1] != '/') {
+        sb->length--;
+      }
+      sb->buffer[sb->length] = '\0';
+    } else {
+      sbputstrlen(sb, path, length);
+      if (end) {
+        sbputchar(sb, '/');
+      }
+    }
+    path += end ? length + 1 : length;
+  }
+  return STATUS_OK;
+}
+
+static size_t getDirectoryLength(const char *path, char sep) {
+  const char *lastSep = strrchr(path, sep);
+  return lastSep ? (size_t)(lastSep - path) + 1 : 0;
+}
+
+/* Calls 'callback' with the contents of the resource 'path' relative
+ * to the script at 'filePath' */
+static Status readResource(
+    String *filePath, String *path,
+    void (*callback)(const u8 *data, size_t length, Value *out), Value *out) {
+  StringBuilder sb;
+  Archive *archive;
+  const char *entryName;
+
+  initStringBuilder(&sb);
+  if (findArchiveForPath(filePath->chars, &archive, &entryName)) {
+    const u8 *data;
+    size_t length;
+    if (!archive) {
+      freeStringBuilder(&sb);
+      return STATUS_ERROR;
+    }
+    sbputstrlen(&sb, entryName, getDirectoryLength(entryName, '/'));
+    if (!resolveEntryName(&sb, path->chars) ||
+        !archiveGetResource(archive, sb.buffer ? sb.buffer : "", &data, &length)) {
+      freeStringBuilder(&sb);
+      return STATUS_ERROR;
+    }
+    callback(data, length, out);
+  } else {
+    void *data;
+    size_t length;
+    sbputstrlen(&sb, filePath->chars, getDirectoryLength(filePath->chars, PATH_SEP));
+    sbputstr(&sb, path->chars);
+    if (!readFile(sb.buffer, &data, &length)) {
+      freeStringBuilder(&sb);
+      return STATUS_ERROR;
+    }
+    callback((const u8 *)data, length, out);
+    free(data);
+  }
+  freeStringBuilder(&sb);
+  return STATUS_OK;
+}
+
+static void toString(const u8 *data, size_t length, Value *out) {
+  *out = valString(internString((const char *)data, length));
+}
+
+static Status implReadString(i16 argc, Value *argv, Value *out) {
+  return readResource(asString(argv[0]), asString(argv[1]), toString, out);
+}
+
+static CFunction funcReadString = {implReadString, "readString", 2};
+
+static void toBuffer(const u8 *data, size_t length, Value *out) {
+  ObjBuffer *buffer = newBuffer();
+  *out = valBuffer(buffer);
+  bufferAddBytes(&buffer->handle, data, length);
+}
+
+static Status implReadBuffer(i16 argc, Value *argv, Value *out) {
+  return readResource(asString(argv[0]), asString(argv[1]), toBuffer, out);
+}
+
+static CFunction funcReadBuffer = {implReadBuffer, "readBuffer", 2};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *functions[] = {
+      &funcReadString,
+      &funcReadBuffer,
+      NULL,
+  };
+
+  moduleAddFunctions(module, functions);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "rs", 1};
+
+void addNativeModuleRs(void) {
+  addNativeModule(&func);
+}
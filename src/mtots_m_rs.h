@@ -0,0 +1,10 @@
+#ifndef mtots_m_rs_h
+#define mtots_m_rs_h
+
+/* Native Module rs
+ * Reads resources relative to a script, from the script's
+ * archive when it was imported from one */
+
+void addNativeModuleRs(void);
+
+#endif /*mtots_m_rs_h*/
@@ -4,7 +4,9 @@
 #include <string.h>
 
 #include "mtots.h"
+#include "mtots_m_array.h"
 #include "mtots_m_c.h"
+#include "mtots_m_media_image.h"
 
 #if MTOTS_ENABLE_SDL
 #include <SDL2/SDL.h>
@@ -67,26 +69,26 @@ static CFunction *FPointMethods[] = {
     NULL,
 };
 
-WRAP_C_TYPE(Rect, SDL_Rect)
-DEFINE_METHOD_COPY(Rect)
-DEFINE_FIELD_GETTER(Rect, x, valNumber(owner->handle.x))
-DEFINE_FIELD_GETTER(Rect, y, valNumber(owner->handle.y))
-DEFINE_FIELD_GETTER(Rect, w, valNumber(owner->handle.w))
-DEFINE_FIELD_GETTER(Rect, h, valNumber(owner->handle.h))
-DEFINE_FIELD_SETTER(Rect, x, owner->handle.x = asInt(value))
-DEFINE_FIELD_SETTER(Rect, y, owner->handle.y = asInt(value))
-DEFINE_FIELD_SETTER(Rect, w, owner->handle.w = asInt(value))
-DEFINE_FIELD_SETTER(Rect, h, owner->handle.h = asInt(value))
-static CFunction *RectMethods[] = {
-    &funcRect_copy,
-    &funcRect_getx,
-    &funcRect_gety,
-    &funcRect_getw,
-    &funcRect_geth,
-    &funcRect_setx,
-    &funcRect_sety,
-    &funcRect_setw,
-    &funcRect_seth,
+WRAP_C_TYPE_NAMED(SDLRect, "Rect", SDL_Rect)
+DEFINE_METHOD_COPY(SDLRect)
+DEFINE_FIELD_GETTER(SDLRect, x, valNumber(owner->handle.x))
+DEFINE_FIELD_GETTER(SDLRect, y, valNumber(owner->handle.y))
+DEFINE_FIELD_GETTER(SDLRect, w, valNumber(owner->handle.w))
+DEFINE_FIELD_GETTER(SDLRect, h, valNumber(owner->handle.h))
+DEFINE_FIELD_SETTER(SDLRect, x, owner->handle.x = asInt(value))
+DEFINE_FIELD_SETTER(SDLRect, y, owner->handle.y = asInt(value))
+DEFINE_FIELD_SETTER(SDLRect, w, owner->handle.w = asInt(value))
+DEFINE_FIELD_SETTER(SDLRect, h, owner->handle.h = asInt(value))
+static CFunction *SDLRectMethods[] = {
+    &funcSDLRect_copy,
+    &funcSDLRect_getx,
+    &funcSDLRect_gety,
+    &funcSDLRect_getw,
+    &funcSDLRect_geth,
+    &funcSDLRect_setx,
+    &funcSDLRect_sety,
+    &funcSDLRect_setw,
+    &funcSDLRect_seth,
     NULL,
 };
 
@@ -113,26 +115,26 @@ static CFunction *FRectMethods[] = {
     NULL,
 };
 
-WRAP_C_TYPE(Color, SDL_Color)
-DEFINE_METHOD_COPY(Color)
-DEFINE_FIELD_GETTER(Color, r, valNumber(owner->handle.r))
-DEFINE_FIELD_GETTER(Color, g, valNumber(owner->handle.g))
-DEFINE_FIELD_GETTER(Color, b, valNumber(owner->handle.b))
-DEFINE_FIELD_GETTER(Color, a, valNumber(owner->handle.a))
-DEFINE_FIELD_SETTER(Color, r, owner->handle.r = asFloat(value))
-DEFINE_FIELD_SETTER(Color, g, owner->handle.g = asFloat(value))
-DEFINE_FIELD_SETTER(Color, b, owner->handle.b = asFloat(value))
-DEFINE_FIELD_SETTER(Color, a, owner->handle.a = asFloat(value))
-static CFunction *ColorMethods[] = {
-    &funcColor_copy,
-    &funcColor_getr,
-    &funcColor_getg,
-    &funcColor_getb,
-    &funcColor_geta,
-    &funcColor_setr,
-    &funcColor_setg,
-    &funcColor_setb,
-    &funcColor_seta,
+WRAP_C_TYPE_NAMED(SDLColor, "Color", SDL_Color)
+DEFINE_METHOD_COPY(SDLColor)
+DEFINE_FIELD_GETTER(SDLColor, r, valNumber(owner->handle.r))
+DEFINE_FIELD_GETTER(SDLColor, g, valNumber(owner->handle.g))
+DEFINE_FIELD_GETTER(SDLColor, b, valNumber(owner->handle.b))
+DEFINE_FIELD_GETTER(SDLColor, a, valNumber(owner->handle.a))
+DEFINE_FIELD_SETTER(SDLColor, r, owner->handle.r = asFloat(value))
+DEFINE_FIELD_SETTER(SDLColor, g, owner->handle.g = asFloat(value))
+DEFINE_FIELD_SETTER(SDLColor, b, owner->handle.b = asFloat(value))
+DEFINE_FIELD_SETTER(SDLColor, a, owner->handle.a = asFloat(value))
+static CFunction *SDLColorMethods[] = {
+    &funcSDLColor_copy,
+    &funcSDLColor_getr,
+    &funcSDLColor_getg,
+    &funcSDLColor_getb,
+    &funcSDLColor_geta,
+    &funcSDLColor_setr,
+    &funcSDLColor_setg,
+    &funcSDLColor_setb,
+    &funcSDLColor_seta,
     NULL,
 };
 
@@ -145,7 +147,30 @@ static CFunction *EventMethods[] = {
     NULL,
 };
 
-WRAP_C_TYPE(Surface, SDL_Surface *)
+typedef struct ObjSurface {
+  ObjNative obj;
+  SDL_Surface *handle;
+} ObjSurface;
+static size_t getSurfacePixelsSize(SDL_Surface *handle) {
+  return (size_t)handle->pitch * (size_t)handle->h;
+}
+static void freeSurface(ObjNative *n) {
+  ObjSurface *surface = (ObjSurface *)n;
+  if (surface->handle) {
+    trackExternalFree(EXTERNAL_MEMORY_NATIVE, getSurfacePixelsSize(surface->handle));
+    SDL_FreeSurface(surface->handle);
+    surface->handle = NULL;
+  }
+}
+WRAP_C_TYPE_EX(Surface, SDL_Surface *, static, nopBlacken, freeSurface)
+static CFunction *SurfaceStaticMethods[] = {NULL};
+/* Takes ownership of 'handle' and reports its pixels to the GC */
+static ObjSurface *newSurface(SDL_Surface *handle) {
+  ObjSurface *surface = allocSurface();
+  surface->handle = handle;
+  trackExternalAllocation(EXTERNAL_MEMORY_NATIVE, getSurfacePixelsSize(handle));
+  return surface;
+}
 DEFINE_FIELD_GETTER(Surface, w, valNumber(owner->handle->w))
 DEFINE_FIELD_GETTER(Surface, h, valNumber(owner->handle->h))
 static CFunction *SurfaceMethods[] = {
@@ -172,7 +197,48 @@ static CFunction *TextureMethods[] = {NULL};
 WRAP_C_TYPE(Window, SDL_Window *)
 static CFunction *WindowMethods[] = {NULL};
 
-WRAP_C_TYPE(Renderer, SDL_Renderer *)
+typedef struct ObjRenderer {
+  ObjNative obj;
+  SDL_Renderer *handle;
+  Value surface; /* target of a software renderer, or nil */
+
+  /* Geometry built by RenderSprites, kept between calls.
+   * The indices never change, so they are only written when growing */
+  SDL_Vertex *spriteVertices;
+  int *spriteIndices;
+  size_t spriteCapacity;
+} ObjRenderer;
+static void blackenRenderer(ObjNative *n) {
+  ObjRenderer *renderer = (ObjRenderer *)n;
+  markValue(renderer->surface);
+}
+static void freeRenderer(ObjNative *n) {
+  ObjRenderer *renderer = (ObjRenderer *)n;
+  free(renderer->spriteVertices);
+  free(renderer->spriteIndices);
+  renderer->spriteVertices = NULL;
+  renderer->spriteIndices = NULL;
+  renderer->spriteCapacity = 0;
+}
+WRAP_C_TYPE_EX(Renderer, SDL_Renderer *, static, blackenRenderer, freeRenderer)
+static ObjRenderer *newRenderer(SDL_Renderer *handle, Value surface) {
+  ObjRenderer *renderer = allocRenderer();
+  renderer->handle = handle;
+  renderer->surface = surface;
+  renderer->spriteVertices = NULL;
+  renderer->spriteIndices = NULL;
+  renderer->spriteCapacity = 0;
+  return renderer;
+}
+static Status implRendererStaticCall(i16 argc, Value *argv, Value *out) {
+  *out = valRenderer(newRenderer(NULL, valNil()));
+  return STATUS_OK;
+}
+static CFunction funcRendererStaticCall = {implRendererStaticCall, "__call__"};
+static CFunction *RendererStaticMethods[] = {
+    &funcRendererStaticCall,
+    NULL,
+};
 static CFunction *RendererMethods[] = {NULL};
 
 typedef struct ObjRWops {
@@ -304,20 +370,20 @@ WRAP_SDL_FUNCTION(
     RenderFillRect, 2, 0,
     SDL_RenderFillRect(
         asRenderer(argv[0])->handle,
-        &asRect(argv[1])->handle))
+        &asSDLRect(argv[1])->handle))
 WRAP_SDL_FUNCTION(
     RenderCopy, 4, 0,
     SDL_RenderCopy(
         asRenderer(argv[0])->handle,
         asTexture(argv[1])->handle,
-        isNil(argv[2]) ? NULL : &asRect(argv[2])->handle /* srcrect */,
-        isNil(argv[3]) ? NULL : &asRect(argv[3])->handle /* dstrect */))
+        isNil(argv[2]) ? NULL : &asSDLRect(argv[2])->handle /* srcrect */,
+        isNil(argv[3]) ? NULL : &asSDLRect(argv[3])->handle /* dstrect */))
 WRAP_C_FUNCTION(RenderPresent, 1, 0, SDL_RenderPresent(asRenderer(argv[0])->handle))
 WRAP_C_FUNCTION(
     RenderGetViewport, 2, 0,
     SDL_RenderGetViewport(
         asRenderer(argv[0])->handle,
-        &asRect(argv[1])->handle))
+        &asSDLRect(argv[1])->handle))
 WRAP_C_FUNCTION(CreateTextureFromSurface, 2, 0, {
   SDL_Renderer *renderer = asRenderer(argv[0])->handle;
   SDL_Surface *surface = asSurface(argv[1])->handle;
@@ -330,6 +396,71 @@ WRAP_C_FUNCTION(CreateTextureFromSurface, 2, 0, {
   texture->handle = handle;
   *out = valTexture(texture);
 })
+WRAP_C_FUNCTION(CreateTexture, 5, 0, {
+  SDL_Texture *handle = SDL_CreateTexture(
+      asRenderer(argv[0])->handle,
+      asU32(argv[1]) /* format */,
+      asInt(argv[2]) /* access */,
+      asInt(argv[3]) /* w */,
+      asInt(argv[4]) /* h */);
+  ObjTexture *texture;
+  if (!handle) {
+    return sdlError("SDL_CreateTexture");
+  }
+  texture = allocTexture();
+  texture->handle = handle;
+  *out = valTexture(texture);
+})
+
+/* Uploads the pixels of the Image that changed since the last upload
+ * (see mtots_m_media_image.h) with a single SDL_UpdateTexture call on
+ * the union of the dirty rectangles */
+static Status implUpdateTextureFromImage(i16 argc, Value *argv, Value *out) {
+  SDL_Texture *texture = asTexture(argv[0])->handle;
+  ObjImage *image = asImage(argv[1]);
+  ubool full = argc > 2 && !isNil(argv[2]) && asBool(argv[2]);
+  RasterBounds bounds;
+  SDL_Rect rect;
+  Uint32 format;
+  int width, height;
+  if (SDL_QueryTexture(texture, &format, NULL, &width, &height) != 0) {
+    return sdlError("SDL_QueryTexture");
+  }
+  if (format != SDL_PIXELFORMAT_RGBA32) {
+    runtimeError(
+        "UpdateTextureFromImage: texture format must be PIXELFORMAT_RGBA32 but got %s",
+        SDL_GetPixelFormatName(format));
+    return STATUS_ERROR;
+  }
+  if ((size_t)width != image->width || (size_t)height != image->height) {
+    runtimeError(
+        "UpdateTextureFromImage: texture is %dx%d but image is %lux%lu",
+        width, height, (unsigned long)image->width, (unsigned long)image->height);
+    return STATUS_ERROR;
+  }
+  if (full) {
+    markImageAllDirty(image);
+  }
+  if (!takeImageDirtyBounds(image, &bounds)) {
+    return STATUS_OK;
+  }
+  rect.x = (int)bounds.minX;
+  rect.y = (int)bounds.minY;
+  rect.w = (int)(bounds.maxX - bounds.minX);
+  rect.h = (int)(bounds.maxY - bounds.minY);
+  if (SDL_UpdateTexture(
+          texture, &rect,
+          image->pixels + bounds.minY * image->width + bounds.minX,
+          (int)(image->width * sizeof(u32))) != 0) {
+    markImageDirty(image, &bounds);
+    return sdlError("SDL_UpdateTexture (UpdateTextureFromImage)");
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcUpdateTextureFromImage = {
+    implUpdateTextureFromImage, "UpdateTextureFromImage", 2, 3};
+
 WRAP_C_FUNCTION(DestroyTexture, 1, 0, {
   ObjTexture *texture = asTexture(argv[0]);
   if (texture->handle) {
@@ -345,6 +476,229 @@ WRAP_SDL_FUNCTION(
         isNil(argv[2]) ? NULL : asIntPointer(argv[2]),
         isNil(argv[3]) ? NULL : asIntPointer(argv[3]),
         isNil(argv[4]) ? NULL : asIntPointer(argv[4])))
+WRAP_C_FUNCTION(CreateRGBSurfaceWithFormat, 3, 0, {
+  SDL_Surface *handle = SDL_CreateRGBSurfaceWithFormat(
+      0, asInt(argv[0]) /* width */, asInt(argv[1]) /* height */, 32, asU32(argv[2]) /* format */);
+  if (!handle) {
+    return sdlError("SDL_CreateRGBSurfaceWithFormat");
+  }
+  *out = valSurface(newSurface(handle));
+})
+WRAP_C_FUNCTION(CreateSoftwareRenderer, 1, 0, {
+  ObjSurface *surface = asSurface(argv[0]);
+  SDL_Renderer *handle = SDL_CreateSoftwareRenderer(surface->handle);
+  ObjRenderer *renderer;
+  if (!handle) {
+    return sdlError("SDL_CreateSoftwareRenderer");
+  }
+  /* The renderer draws into the surface's pixels, so it keeps the
+   * surface alive */
+  renderer = newRenderer(handle, argv[0]);
+  *out = valRenderer(renderer);
+})
+
+/* Vertices are passed as a Buffer of packed SDL_Vertex values, so that
+ * a whole mesh is submitted in one call */
+static Status implRenderGeometry(i16 argc, Value *argv, Value *out) {
+  SDL_Renderer *renderer = asRenderer(argv[0])->handle;
+  SDL_Texture *texture = isNil(argv[1]) ? NULL : asTexture(argv[1])->handle;
+  Buffer *vertices = &asBuffer(argv[2])->handle;
+  ObjTypedArray *indices = argc > 3 && !isNil(argv[3]) ? asTypedArray(argv[3]) : NULL;
+  size_t vertexCount = vertices->length / sizeof(SDL_Vertex);
+  size_t indexCount = indices ? typedArrayLength(indices) : 0;
+  if (vertices->length % sizeof(SDL_Vertex) != 0) {
+    runtimeError(
+        "RenderGeometry: vertex Buffer length %lu is not a multiple of %lu",
+        (unsigned long)vertices->length, (unsigned long)sizeof(SDL_Vertex));
+    return STATUS_ERROR;
+  }
+  if (indices && indices->type != TYPED_ARRAY_I32) {
+    runtimeError("RenderGeometry: indices must be an Int32Array");
+    return STATUS_ERROR;
+  }
+  if (vertexCount > INT_MAX || indexCount > INT_MAX) {
+    runtimeError("RenderGeometry: too many vertices or indices");
+    return STATUS_ERROR;
+  }
+  if (SDL_RenderGeometry(
+          renderer, texture,
+          (const SDL_Vertex *)vertices->data, (int)vertexCount,
+          indices ? (const int *)indices->buffer->handle.data : NULL, (int)indexCount) != 0) {
+    return sdlError("SDL_RenderGeometry");
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcRenderGeometry = {implRenderGeometry, "RenderGeometry", 3, 4};
+
+/* Number of floats describing each sprite passed to RenderSprites:
+ * x, y, scaleX, scaleY, frame, flags */
+#define SPRITE_STRIDE 6
+#define SPRITE_FLIP_X 1
+#define SPRITE_FLIP_Y 2
+
+static void reserveSprites(ObjRenderer *renderer, size_t count) {
+  size_t newCapacity = renderer->spriteCapacity ? renderer->spriteCapacity : 64, i;
+  SDL_Vertex *vertices;
+  int *indices;
+  if (count <= renderer->spriteCapacity) {
+    return;
+  }
+  while (newCapacity < count) {
+    newCapacity *= 2;
+  }
+  vertices = (SDL_Vertex *)realloc(
+      renderer->spriteVertices, newCapacity * 4 * sizeof(SDL_Vertex));
+  if (!vertices) {
+    panic("Failed to allocate geometry for %lu sprites", (unsigned long)newCapacity);
+  }
+  renderer->spriteVertices = vertices;
+  indices = (int *)realloc(renderer->spriteIndices, newCapacity * 6 * sizeof(int));
+  if (!indices) {
+    panic("Failed to allocate geometry for %lu sprites", (unsigned long)newCapacity);
+  }
+  renderer->spriteIndices = indices;
+  for (i = renderer->spriteCapacity; i < newCapacity; i++) {
+    int *index = indices + i * 6;
+    int first = (int)(i * 4);
+    index[0] = first;
+    index[1] = first + 1;
+    index[2] = first + 2;
+    index[3] = first;
+    index[4] = first + 2;
+    index[5] = first + 3;
+  }
+  renderer->spriteCapacity = newCapacity;
+}
+
+static void setSpriteVertex(SDL_Vertex *vertex, float x, float y, float u, float v) {
+  vertex->position.x = x;
+  vertex->position.y = y;
+  vertex->color.r = vertex->color.g = vertex->color.b = vertex->color.a = 255;
+  vertex->tex_coord.x = u;
+  vertex->tex_coord.y = v;
+}
+
+/* Draws every sprite in a Float32Array of (x, y, scaleX, scaleY, frame, flags)
+ * entries with a single SDL_RenderGeometry call. Frames are numbered like
+ * SpriteSheet.blit: left to right, then top to bottom */
+static Status implRenderSprites(i16 argc, Value *argv, Value *out) {
+  ObjRenderer *renderer = asRenderer(argv[0]);
+  SDL_Texture *texture = asTexture(argv[1])->handle;
+  int spriteWidth = asInt(argv[2]);
+  int spriteHeight = asInt(argv[3]);
+  ObjTypedArray *sprites = asTypedArray(argv[4]);
+  size_t count, i;
+  int textureWidth, textureHeight, columns;
+  double frameCount;
+  float du, dv;
+  const float *sprite;
+
+  if (sprites->type != TYPED_ARRAY_F32 || typedArrayLength(sprites) % SPRITE_STRIDE != 0) {
+    runtimeError("RenderSprites: sprites must be a Float32Array of %d values per sprite",
+                 SPRITE_STRIDE);
+    return STATUS_ERROR;
+  }
+  if (SDL_QueryTexture(texture, NULL, NULL, &textureWidth, &textureHeight) != 0) {
+    return sdlError("SDL_QueryTexture");
+  }
+  if (spriteWidth <= 0 || spriteHeight <= 0 ||
+      spriteWidth > textureWidth || spriteHeight > textureHeight) {
+    runtimeError("RenderSprites: invalid sprite size %dx%d", spriteWidth, spriteHeight);
+    return STATUS_ERROR;
+  }
+  count = typedArrayLength(sprites) / SPRITE_STRIDE;
+  if (count == 0) {
+    return STATUS_OK;
+  }
+  if (count > INT_MAX / 6) {
+    runtimeError("RenderSprites: too many sprites (%lu)", (unsigned long)count);
+    return STATUS_ERROR;
+  }
+  columns = textureWidth / spriteWidth;
+  frameCount = (double)columns * (double)(textureHeight / spriteHeight);
+  du = (float)spriteWidth / (float)textureWidth;
+  dv = (float)spriteHeight / (float)textureHeight;
+  reserveSprites(renderer, count);
+
+  sprite = (const float *)sprites->buffer->handle.data;
+  for (i = 0; i < count; i++, sprite += SPRITE_STRIDE) {
+    SDL_Vertex *vertex = renderer->spriteVertices + i * 4;
+    float x0 = sprite[0], y0 = sprite[1];
+    float x1 = x0 + sprite[2] * (float)spriteWidth;
+    float y1 = y0 + sprite[3] * (float)spriteHeight;
+    float u0, v0, u1, v1, swap;
+    int frame, flags;
+    if (!(sprite[4] >= 0 && sprite[4] < frameCount)) {
+      runtimeError("RenderSprites: sprite frame %g out of range", (double)sprite[4]);
+      return STATUS_ERROR;
+    }
+    frame = (int)sprite[4];
+    flags = (int)sprite[5];
+    u0 = (float)(frame % columns) * du;
+    v0 = (float)(frame / columns) * dv;
+    u1 = u0 + du;
+    v1 = v0 + dv;
+    if (flags & SPRITE_FLIP_X) {
+      swap = u0;
+      u0 = u1;
+      u1 = swap;
+    }
+    if (flags & SPRITE_FLIP_Y) {
+      swap = v0;
+      v0 = v1;
+      v1 = swap;
+    }
+    setSpriteVertex(vertex, x0, y0, u0, v0);
+    setSpriteVertex(vertex + 1, x1, y0, u1, v0);
+    setSpriteVertex(vertex + 2, x1, y1, u1, v1);
+    setSpriteVertex(vertex + 3, x0, y1, u0, v1);
+  }
+
+  if (SDL_RenderGeometry(
+          renderer->handle, texture,
+          renderer->spriteVertices, (int)(count * 4),
+          renderer->spriteIndices, (int)(count * 6)) != 0) {
+    return sdlError("SDL_RenderGeometry (RenderSprites)");
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcRenderSprites = {implRenderSprites, "RenderSprites", 5};
+
+/* Reads into a Buffer, checked to be large enough for 'pitch' bytes
+ * per row of the rectangle (or of the whole render target) */
+static Status implRenderReadPixels(i16 argc, Value *argv, Value *out) {
+  SDL_Renderer *renderer = asRenderer(argv[0])->handle;
+  SDL_Rect *rect = isNil(argv[1]) ? NULL : &asSDLRect(argv[1])->handle;
+  u32 format = asU32(argv[2]);
+  Buffer *pixels = &asBuffer(argv[3])->handle;
+  int pitch = asInt(argv[4]);
+  int width, height;
+  if (bufferCheckWritable(pixels) != STATUS_OK) {
+    return STATUS_ERROR;
+  }
+  if (rect) {
+    width = rect->w;
+    height = rect->h;
+  } else if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0) {
+    return sdlError("SDL_GetRendererOutputSize");
+  }
+  if (width < 0 || height < 0 || pitch < width * SDL_BYTESPERPIXEL(format) ||
+      (double)pitch * (double)height > (double)pixels->length) {
+    runtimeError(
+        "RenderReadPixels: %dx%d pixels with pitch %d do not fit in %lu bytes",
+        width, height, pitch, (unsigned long)pixels->length);
+    return STATUS_ERROR;
+  }
+  if (SDL_RenderReadPixels(renderer, rect, format, pixels->data, pitch) != 0) {
+    return sdlError("SDL_RenderReadPixels");
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcRenderReadPixels = {implRenderReadPixels, "RenderReadPixels", 5};
+
 WRAP_C_FUNCTION(
     GetMouseState, 2, 0,
     *out = valNumber(SDL_GetMouseState(
@@ -411,29 +765,27 @@ WRAP_C_FUNCTION(CloseFont, 1, 0, {
 WRAP_C_FUNCTION(RenderUTF8_Blended, 3, 0, {
   TTF_Font *font = asFont(argv[0])->handle;
   const char *text = asString(argv[1])->chars;
-  SDL_Color fg = asColor(argv[2])->handle;
+  SDL_Color fg = asSDLColor(argv[2])->handle;
   SDL_Surface *handle = TTF_RenderUTF8_Blended(font, text, fg);
   ObjSurface *surface;
   if (!handle) {
     return sdlError("TTF_RenderUTF8_Blended");
   }
-  surface = allocSurface();
-  surface->handle = handle;
+  surface = newSurface(handle);
   *out = valSurface(surface);
 })
 
 WRAP_C_FUNCTION(RenderUTF8_Blended_Wrapped, 4, 0, {
   TTF_Font *font = asFont(argv[0])->handle;
   const char *text = asString(argv[1])->chars;
-  SDL_Color fg = asColor(argv[2])->handle;
+  SDL_Color fg = asSDLColor(argv[2])->handle;
   Uint32 wrapLength = asU32(argv[3]);
   SDL_Surface *handle = TTF_RenderUTF8_Blended_Wrapped(font, text, fg, wrapLength);
   ObjSurface *surface;
   if (!handle) {
     return sdlError("TTF_RenderUTF8_Blended_Wrapped");
   }
-  surface = allocSurface();
-  surface->handle = handle;
+  surface = newSurface(handle);
   *out = valSurface(surface);
 })
 
@@ -465,8 +817,7 @@ WRAP_C_FUNCTION_EX(Load, IMGLoad, 1, 0, {
   if (!handle) {
     return sdlError("IMG_Load");
   }
-  surface = allocSurface();
-  surface->handle = handle;
+  surface = newSurface(handle);
   *out = valSurface(surface);
 })
 
@@ -482,8 +833,7 @@ WRAP_C_FUNCTION_EX(Load_RW, IMGLoad_RW, 2, 0, {
   if (!handle) {
     return sdlError("IMG_Load_RW");
   }
-  surface = allocSurface();
-  surface->handle = handle;
+  surface = newSurface(handle);
   *out = valSurface(surface);
 })
 
@@ -688,8 +1038,15 @@ static Status impl(i16 argc, Value *argv, Value *out) {
       &funcRenderPresent,
       &funcRenderGetViewport,
       &funcCreateTextureFromSurface,
+      &funcCreateTexture,
+      &funcUpdateTextureFromImage,
       &funcDestroyTexture,
       &funcQueryTexture,
+      &funcCreateRGBSurfaceWithFormat,
+      &funcCreateSoftwareRenderer,
+      &funcRenderGeometry,
+      &funcRenderSprites,
+      &funcRenderReadPixels,
       &funcGetMouseState,
       &funcGetKeyboardState,
       NULL,
@@ -699,9 +1056,9 @@ static Status impl(i16 argc, Value *argv, Value *out) {
 
   ADD_TYPE_TO_MODULE(Point);
   ADD_TYPE_TO_MODULE(FPoint);
-  ADD_TYPE_TO_MODULE(Rect);
+  ADD_TYPE_TO_MODULE(SDLRect);
   ADD_TYPE_TO_MODULE(FRect);
-  ADD_TYPE_TO_MODULE(Color);
+  ADD_TYPE_TO_MODULE(SDLColor);
   ADD_TYPE_TO_MODULE(Event);
   ADD_TYPE_TO_MODULE(Surface);
   ADD_TYPE_TO_MODULE(Texture);
@@ -724,6 +1081,15 @@ static Status impl(i16 argc, Value *argv, Value *out) {
   WRAP_CONST(WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
   WRAP_CONST(WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED);
 
+  WRAP_CONST(PIXELFORMAT_RGBA32, SDL_PIXELFORMAT_RGBA32);
+  WRAP_CONST(PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ARGB8888);
+
+  WRAP_CONST(TEXTUREACCESS_STATIC, SDL_TEXTUREACCESS_STATIC);
+  WRAP_CONST(TEXTUREACCESS_STREAMING, SDL_TEXTUREACCESS_STREAMING);
+
+  WRAP_CONST(SPRITE_FLIP_X, SPRITE_FLIP_X);
+  WRAP_CONST(SPRITE_FLIP_Y, SPRITE_FLIP_Y);
+
   WRAP_CONST(BUTTON_LMASK, SDL_BUTTON_LMASK);
   WRAP_CONST(BUTTON_MMASK, SDL_BUTTON_MMASK);
   WRAP_CONST(BUTTON_RMASK, SDL_BUTTON_RMASK);
@@ -0,0 +1,503 @@
+#include "mtots_m_struct.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtots.h"
+#include "mtots_m_array.h"
+
+typedef enum FieldType {
+  FIELD_I8,
+  FIELD_U8,
+  FIELD_I16,
+  FIELD_U16,
+  FIELD_I32,
+  FIELD_U32,
+  FIELD_F32,
+  FIELD_F64
+} FieldType;
+
+typedef struct Field {
+  FieldType type;
+  size_t offset; /* from the start of the record */
+} Field;
+
+/* A compiled format string */
+typedef struct StructFormat {
+  String *format;
+  Field *fields;
+  size_t fieldCount;
+  size_t size; /* bytes per record, including padding */
+} StructFormat;
+
+typedef struct ObjStruct {
+  ObjNative obj;
+  StructFormat handle;
+} ObjStruct;
+
+static void blackenStruct(ObjNative *n) {
+  markString(((ObjStruct *)n)->handle.format);
+}
+
+static void freeStruct(ObjNative *n) {
+  free(((ObjStruct *)n)->handle.fields);
+}
+
+WRAP_C_TYPE_EX(Struct, StructFormat, static, blackenStruct, freeStruct)
+
+static size_t fieldSize(FieldType type) {
+  switch (type) {
+    case FIELD_I8:
+    case FIELD_U8:
+      return 1;
+    case FIELD_I16:
+    case FIELD_U16:
+      return 2;
+    case FIELD_I32:
+    case FIELD_U32:
+    case FIELD_F32:
+      return 4;
+    case FIELD_F64:
+      return 8;
+  }
+  panic("Invalid FieldType %d", type);
+}
+
+/* Format characters follow Python's struct module, without
+ * byte order prefixes (the Buffer's byteOrder is used instead)
+ * and without alignment between fields */
+static Status compileFormat(StructFormat *sf, String *format) {
+  const char *p = format->chars, *end = format->chars + format->byteLength;
+  size_t capacity = 0;
+  sf->format = format;
+  while (p < end) {
+    size_t i, count = 1;
+    FieldType type;
+    ubool isPadding = UFALSE;
+    if (*p == ' ') {
+      p++;
+      continue;
+    }
+    if (*p >= '0' && *p <= '9') {
+      count = 0;
+      while (p < end && *p >= '0' && *p <= '9') {
+        count = count * 10 + (size_t)(*p++ - '0');
+        if (count > U32_MAX) {
+          return runtimeError("Struct: repeat count too large in %s", format->chars);
+        }
+      }
+      if (p == end) {
+        return runtimeError("Struct: repeat count without a format character in %s", format->chars);
+      }
+    }
+    switch (*p) {
+      case 'x':
+        isPadding = UTRUE;
+        type = FIELD_U8;
+        break;
+      case 'b':
+        type = FIELD_I8;
+        break;
+      case 'B':
+        type = FIELD_U8;
+        break;
+      case 'h':
+        type = FIELD_I16;
+        break;
+      case 'H':
+        type = FIELD_U16;
+        break;
+      case 'i':
+      case 'l':
+        type = FIELD_I32;
+        break;
+      case 'I':
+      case 'L':
+        type = FIELD_U32;
+        break;
+      case 'f':
+        type = FIELD_F32;
+        break;
+      case 'd':
+        type = FIELD_F64;
+        break;
+      default:
+        return runtimeError("Struct: invalid format character '%c' in %s", *p, format->chars);
+    }
+    p++;
+    if (isPadding) {
+      sf->size += count;
+      continue;
+    }
+    if (sf->fieldCount + count > capacity) {
+      capacity = capacity < 8 ? 8 : capacity;
+      while (capacity < sf->fieldCount + count) {
+        capacity *= 2;
+      }
+      sf->fields = (Field *)realloc(sf->fields, sizeof(Field) * capacity);
+      if (!sf->fields) {
+        panic("out of memory");
+      }
+    }
+    for (i = 0; i < count; i++) {
+      sf->fields[sf->fieldCount].type = type;
+      sf->fields[sf->fieldCount].offset = sf->size;
+      sf->fieldCount++;
+      sf->size += fieldSize(type);
+    }
+  }
+  if (sf->fieldCount == 0) {
+    return runtimeError("Struct: format %s has no fields", format->chars);
+  }
+  return STATUS_OK;
+}
+
+static void copyBytes(u8 *dst, const u8 *src, size_t size, ubool swap) {
+  if (swap) {
+    size_t i;
+    for (i = 0; i < size; i++) {
+      dst[i] = src[size - 1 - i];
+    }
+  } else {
+    memcpy(dst, src, size);
+  }
+}
+
+static double readField(const u8 *p, FieldType type, ubool swap) {
+  union {
+    u8 bytes[8];
+    i8 i8;
+    u8 u8;
+    i16 i16;
+    u16 u16;
+    i32 i32;
+    u32 u32;
+    f32 f32;
+    f64 f64;
+  } value;
+  copyBytes(value.bytes, p, fieldSize(type), swap);
+  switch (type) {
+    case FIELD_I8:
+      return value.i8;
+    case FIELD_U8:
+      return value.u8;
+    case FIELD_I16:
+      return value.i16;
+    case FIELD_U16:
+      return value.u16;
+    case FIELD_I32:
+      return value.i32;
+    case FIELD_U32:
+      return value.u32;
+    case FIELD_F32:
+      return value.f32;
+    case FIELD_F64:
+      return value.f64;
+  }
+  panic("Invalid FieldType %d", type);
+}
+
+static Status checkInteger(double x, double min, double max, const char *typeName) {
+  if (x != floor(x) || x < min || x > max) {
+    return runtimeError("Struct: %f does not fit in field of type %s", x, typeName);
+  }
+  return STATUS_OK;
+}
+
+static Status writeField(u8 *p, FieldType type, double x, ubool swap) {
+  union {
+    u8 bytes[8];
+    i8 i8;
+    u8 u8;
+    i16 i16;
+    u16 u16;
+    i32 i32;
+    u32 u32;
+    f32 f32;
+    f64 f64;
+  } value;
+  switch (type) {
+    case FIELD_I8:
+      if (!checkInteger(x, I8_MIN, I8_MAX, "i8")) {
+        return STATUS_ERROR;
+      }
+      value.i8 = (i8)x;
+      break;
+    case FIELD_U8:
+      if (!checkInteger(x, 0, U8_MAX, "u8")) {
+        return STATUS_ERROR;
+      }
+      value.u8 = (u8)x;
+      break;
+    case FIELD_I16:
+      if (!checkInteger(x, I16_MIN, I16_MAX, "i16")) {
+        return STATUS_ERROR;
+      }
+      value.i16 = (i16)x;
+      break;
+    case FIELD_U16:
+      if (!checkInteger(x, 0, U16_MAX, "u16")) {
+        return STATUS_ERROR;
+      }
+      value.u16 = (u16)x;
+      break;
+    case FIELD_I32:
+      if (!checkInteger(x, I32_MIN, I32_MAX, "i32")) {
+        return STATUS_ERROR;
+      }
+      value.i32 = (i32)x;
+      break;
+    case FIELD_U32:
+      if (!checkInteger(x, 0, U32_MAX, "u32")) {
+        return STATUS_ERROR;
+      }
+      value.u32 = (u32)x;
+      break;
+    case FIELD_F32:
+      value.f32 = (f32)x;
+      break;
+    case FIELD_F64:
+      value.f64 = x;
+      break;
+  }
+  copyBytes(p, value.bytes, fieldSize(type), swap);
+  return STATUS_OK;
+}
+
+static ubool needsSwap(Buffer *buffer) {
+  /* The platform is assumed to be little endian (see mtots_util_buffer.c) */
+  return buffer->byteOrder == MTOTS_BIG_ENDIAN;
+}
+
+/* A flat sequence of numbers: a List, FrozenList or typed array */
+typedef struct NumberSequence {
+  Value *values;
+  ObjTypedArray *typedArray;
+  size_t length;
+} NumberSequence;
+
+static void initNumberSequence(NumberSequence *seq, Value value) {
+  seq->values = NULL;
+  seq->typedArray = NULL;
+  if (isTypedArray(value)) {
+    seq->typedArray = asTypedArray(value);
+    seq->length = typedArrayLength(seq->typedArray);
+  } else if (isList(value)) {
+    ObjList *list = asList(value);
+    seq->values = list->buffer;
+    seq->length = list->length;
+  } else {
+    ObjFrozenList *frozenList = asFrozenList(value);
+    seq->values = frozenList->buffer;
+    seq->length = frozenList->length;
+  }
+}
+
+static Status getSequenceNumber(NumberSequence *seq, size_t i, double *out) {
+  if (seq->typedArray) {
+    *out = typedArrayGetNumber(seq->typedArray, i);
+    return STATUS_OK;
+  }
+  if (!isNumber(seq->values[i])) {
+    return runtimeError(
+        "Struct: expected a Number but got %s", getKindName(seq->values[i]));
+  }
+  *out = seq->values[i].as.number;
+  return STATUS_OK;
+}
+
+static Status getRecordCount(StructFormat *sf, NumberSequence *seq, size_t *out) {
+  if (seq->length % sf->fieldCount != 0) {
+    return runtimeError(
+        "Struct: %lu values is not a whole number of records of %lu fields",
+        (unsigned long)seq->length,
+        (unsigned long)sf->fieldCount);
+  }
+  *out = seq->length / sf->fieldCount;
+  return STATUS_OK;
+}
+
+static Status packRecords(StructFormat *sf, Buffer *buffer, size_t offset, NumberSequence *seq) {
+  ubool swap = needsSwap(buffer);
+  size_t r, f, recordCount = seq->length / sf->fieldCount, k = 0;
+  for (r = 0; r < recordCount; r++) {
+    u8 *record = buffer->data + offset + r * sf->size;
+    for (f = 0; f < sf->fieldCount; f++, k++) {
+      double x = 0;
+      if (!getSequenceNumber(seq, k, &x) ||
+          !writeField(record + sf->fields[f].offset, sf->fields[f].type, x, swap)) {
+        return STATUS_ERROR;
+      }
+    }
+  }
+  return STATUS_OK;
+}
+
+static Status implStructStaticCall(i16 argc, Value *argv, Value *out) {
+  ObjStruct *st = allocStruct();
+  *out = valStruct(st);
+  return compileFormat(&st->handle, asString(argv[0]));
+}
+
+static CFunction funcStructStaticCall = {implStructStaticCall, "__call__", 1};
+
+DEFINE_FIELD_GETTER(Struct, format, valString(owner->handle.format))
+DEFINE_FIELD_GETTER(Struct, size, valNumber(owner->handle.size))
+DEFINE_FIELD_GETTER(Struct, fieldCount, valNumber(owner->handle.fieldCount))
+
+static Status implStructPack(i16 argc, Value *argv, Value *out) {
+  StructFormat *sf = &asStruct(argv[-1])->handle;
+  Buffer *buffer = &asBuffer(argv[0])->handle;
+  NumberSequence seq;
+  size_t recordCount = 0, offset = buffer->length;
+  initNumberSequence(&seq, argv[1]);
+  if (!bufferCheckWritable(buffer) || !getRecordCount(sf, &seq, &recordCount)) {
+    return STATUS_ERROR;
+  }
+  bufferSetLength(buffer, offset + recordCount * sf->size);
+  if (!packRecords(sf, buffer, offset, &seq)) {
+    bufferSetLength(buffer, offset);
+    return STATUS_ERROR;
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcStructPack = {implStructPack, "pack", 2};
+
+static Status implStructPackInto(i16 argc, Value *argv, Value *out) {
+  StructFormat *sf = &asStruct(argv[-1])->handle;
+  Buffer *buffer = &asBuffer(argv[0])->handle;
+  size_t offset = asSize(argv[1]);
+  NumberSequence seq;
+  size_t recordCount = 0;
+  initNumberSequence(&seq, argv[2]);
+  if (!bufferCheckWritable(buffer) || !getRecordCount(sf, &seq, &recordCount)) {
+    return STATUS_ERROR;
+  }
+  if (offset > buffer->length || recordCount * sf->size > buffer->length - offset) {
+    return runtimeError(
+        "Struct.packInto(): %lu records at offset %lu do not fit in a Buffer of length %lu",
+        (unsigned long)recordCount,
+        (unsigned long)offset,
+        (unsigned long)buffer->length);
+  }
+  return packRecords(sf, buffer, offset, &seq);
+}
+
+static CFunction funcStructPackInto = {implStructPackInto, "packInto", 3};
+
+/* Returns the number of whole records available at 'offset' */
+static Status getAvailableRecords(StructFormat *sf, Buffer *buffer, size_t offset, size_t *out) {
+  if (offset > buffer->length) {
+    return runtimeError(
+        "Struct: offset %lu is past the end of the Buffer (length %lu)",
+        (unsigned long)offset,
+        (unsigned long)buffer->length);
+  }
+  *out = (buffer->length - offset) / sf->size;
+  return STATUS_OK;
+}
+
+static Status implStructUnpack(i16 argc, Value *argv, Value *out) {
+  StructFormat *sf = &asStruct(argv[-1])->handle;
+  Buffer *buffer = &asBuffer(argv[0])->handle;
+  size_t offset = argc > 1 && !isNil(argv[1]) ? asSize(argv[1]) : 0;
+  size_t r, f, k = 0, recordCount = 0;
+  ubool swap = needsSwap(buffer);
+  ObjList *list;
+  if (!getAvailableRecords(sf, buffer, offset, &recordCount)) {
+    return STATUS_ERROR;
+  }
+  if (argc > 2 && !isNil(argv[2])) {
+    size_t count = asSize(argv[2]);
+    if (count > recordCount) {
+      return runtimeError(
+          "Struct.unpack(): requested %lu records but only %lu are available",
+          (unsigned long)count,
+          (unsigned long)recordCount);
+    }
+    recordCount = count;
+  }
+  list = newList(recordCount * sf->fieldCount);
+  for (r = 0; r < recordCount; r++) {
+    const u8 *record = buffer->data + offset + r * sf->size;
+    for (f = 0; f < sf->fieldCount; f++) {
+      list->buffer[k++] = valNumber(
+          readField(record + sf->fields[f].offset, sf->fields[f].type, swap));
+    }
+  }
+  *out = valList(list);
+  return STATUS_OK;
+}
+
+static CFunction funcStructUnpack = {implStructUnpack, "unpack", 1, 3};
+
+static Status implStructUnpackInto(i16 argc, Value *argv, Value *out) {
+  StructFormat *sf = &asStruct(argv[-1])->handle;
+  Buffer *buffer = &asBuffer(argv[1])->handle;
+  size_t offset = argc > 2 && !isNil(argv[2]) ? asSize(argv[2]) : 0;
+  size_t r, f, k = 0, recordCount = 0, availableCount = 0;
+  ubool swap = needsSwap(buffer);
+  NumberSequence seq;
+  if (!isTypedArray(argv[0]) && !isList(argv[0])) {
+    panic("Struct.unpackInto() requires a List or typed array but got %s", getKindName(argv[0]));
+  }
+  initNumberSequence(&seq, argv[0]);
+  if (!getRecordCount(sf, &seq, &recordCount) ||
+      !getAvailableRecords(sf, buffer, offset, &availableCount)) {
+    return STATUS_ERROR;
+  }
+  if (recordCount > availableCount) {
+    return runtimeError(
+        "Struct.unpackInto(): needs %lu records but only %lu are available",
+        (unsigned long)recordCount,
+        (unsigned long)availableCount);
+  }
+  for (r = 0; r < recordCount; r++) {
+    const u8 *record = buffer->data + offset + r * sf->size;
+    for (f = 0; f < sf->fieldCount; f++, k++) {
+      double x = readField(record + sf->fields[f].offset, sf->fields[f].type, swap);
+      if (seq.typedArray) {
+        if (!typedArraySetNumber(seq.typedArray, k, x)) {
+          return STATUS_ERROR;
+        }
+      } else {
+        seq.values[k] = valNumber(x);
+      }
+    }
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcStructUnpackInto = {implStructUnpackInto, "unpackInto", 2, 3};
+
+static CFunction *StructStaticMethods[] = {
+    &funcStructStaticCall,
+    NULL,
+};
+
+static CFunction *StructMethods[] = {
+    &funcStruct_getformat,
+    &funcStruct_getsize,
+    &funcStruct_getfieldCount,
+    &funcStructPack,
+    &funcStructPackInto,
+    &funcStructUnpack,
+    &funcStructUnpackInto,
+    NULL,
+};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+
+  ADD_TYPE_TO_MODULE(Struct);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "struct", 1};
+
+void addNativeModuleStruct(void) {
+  addNativeModule(&func);
+}
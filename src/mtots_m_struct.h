@@ -0,0 +1,9 @@
+#ifndef mtots_m_struct_h
+#define mtots_m_struct_h
+
+/* Native Module struct
+ * Packs and unpacks arrays of binary records to and from Buffers */
+
+void addNativeModuleStruct(void);
+
+#endif /*mtots_m_struct_h*/
@@ -20,6 +20,33 @@ static Status implGetMallocCount(i16 argc, Value *args, Value *out) {
 
 static CFunction funcGetMallocCount = {implGetMallocCount, "getMallocCount"};
 
+static void setMemoryUsageEntry(ObjDict *dict, const char *name, size_t size) {
+  mapSetN(&dict->map, name, valNumber(size));
+}
+
+static Status implGetMemoryUsage(i16 argc, Value *args, Value *out) {
+  ObjDict *dict = newDict();
+  size_t i;
+  push(valDict(dict));
+  setMemoryUsageEntry(dict, "objects", vm.memory.bytesAllocated);
+  setMemoryUsageEntry(dict, "strings", getInternedStringsAllocationSize());
+  for (i = 0; i < EXTERNAL_MEMORY_CATEGORY_COUNT; i++) {
+    setMemoryUsageEntry(
+        dict,
+        getExternalMemoryCategoryName((ExternalMemoryCategory)i),
+        getExternalMemoryUsage((ExternalMemoryCategory)i));
+  }
+  setMemoryUsageEntry(
+      dict, "total",
+      vm.memory.bytesAllocated + getInternedStringsAllocationSize() +
+          getExternalMemoryTotal());
+  setMemoryUsageEntry(dict, "nextGC", vm.memory.nextGC);
+  *out = pop();
+  return STATUS_OK;
+}
+
+static CFunction funcGetMemoryUsage = {implGetMemoryUsage, "getMemoryUsage"};
+
 static Status implEnableGCLogs(i16 argc, Value *args, Value *out) {
   vm.enableGCLogs = asBool(args[0]);
   return STATUS_OK;
@@ -42,13 +69,29 @@ static Status implEnableLogOnGC(i16 argc, Value *args, Value *out) {
 
 static CFunction funcEnableLogOnGC = {implEnableLogOnGC, "enableLogOnGC", 1, 0};
 
+static Status implGetRecursionLimit(i16 argc, Value *args, Value *out) {
+  *out = valNumber(vm.maxFrameCount);
+  return STATUS_OK;
+}
+
+static CFunction funcGetRecursionLimit = {implGetRecursionLimit, "getRecursionLimit"};
+
+static Status implSetRecursionLimit(i16 argc, Value *args, Value *out) {
+  return setMaxFrameCount(asI32(args[0]));
+}
+
+static CFunction funcSetRecursionLimit = {implSetRecursionLimit, "setRecursionLimit", 1, 0};
+
 static Status impl(i16 argc, Value *args, Value *out) {
   ObjModule *module = asModule(args[0]);
   CFunction *functions[] = {
       &funcGetMallocCount,
+      &funcGetMemoryUsage,
       &funcEnableGCLogs,
       &funcEnableMallocFreeLogs,
       &funcEnableLogOnGC,
+      &funcGetRecursionLimit,
+      &funcSetRecursionLimit,
       NULL,
   };
   CFunction **function;
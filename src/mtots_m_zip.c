@@ -0,0 +1,302 @@
+#include "mtots_m_zip.h"
+
+#if MTOTS_ENABLE_MINIZ
+#include <stdlib.h>
+
+#include "miniz.h"
+#include "mtots.h"
+#include "mtots_m_data.h"
+
+#define isZipArchive(v) (getNativeObjectDescriptor(v) == &descriptorZipArchive)
+
+/* Deflate cannot expand data by more than about 1032:1, so an entry
+ * claiming more than that is corrupt. Buffers are presized up to
+ * ZIP_PRESIZE_LIMIT bytes, and grow as the data arrives past that */
+#define ZIP_MAX_DEFLATE_RATIO 1032
+#define ZIP_PRESIZE_LIMIT (64 * 1024 * 1024)
+
+/* The archive is memory mapped when possible, so that entries are
+ * inflated straight out of the mapping and only the pages that are
+ * actually read are ever loaded. Otherwise miniz reads the file
+ * through a FILE handle.
+ *
+ * Names are looked up through 'index' (name -> file index), which
+ * is built from the central directory the first time it is needed.
+ * This replaces miniz's own sorted directory, so the archive is
+ * opened without sorting it */
+typedef struct ObjZipArchive {
+  ObjNative obj;
+  mz_zip_archive archive;
+  ubool open;
+  DataSourceView view;
+  ubool indexed;
+  Map index;
+} ObjZipArchive;
+
+static void blackenZipArchive(ObjNative *n) {
+  ObjZipArchive *zip = (ObjZipArchive *)n;
+  markMap(&zip->index);
+}
+
+static void freeZipArchive(ObjNative *n) {
+  ObjZipArchive *zip = (ObjZipArchive *)n;
+  if (zip->open) {
+    mz_zip_reader_end(&zip->archive);
+    zip->open = UFALSE;
+  }
+  dataSourceCloseView(&zip->view);
+  freeMap(&zip->index);
+}
+
+static NativeObjectDescriptor descriptorZipArchive = {
+    blackenZipArchive,
+    freeZipArchive,
+    sizeof(ObjZipArchive),
+    "ZipArchive",
+};
+
+static Value valZipArchive(ObjZipArchive *zip) {
+  return valObjExplicit((Obj *)zip);
+}
+
+static ObjZipArchive *asZipArchive(Value value) {
+  if (!isZipArchive(value)) {
+    panic("Expected ZipArchive but got %s", getKindName(value));
+  }
+  return (ObjZipArchive *)value.as.obj;
+}
+
+static ObjZipArchive *newZipArchive(void) {
+  ObjZipArchive *zip = NEW_NATIVE(ObjZipArchive, &descriptorZipArchive);
+  mz_zip_zero_struct(&zip->archive);
+  zip->open = UFALSE;
+  zip->view.data = NULL;
+  zip->view.length = 0;
+  zip->view.mapped = UFALSE;
+  initBuffer(&zip->view.buffer);
+  zip->indexed = UFALSE;
+  initMap(&zip->index);
+  return zip;
+}
+
+static Status zipError(ObjZipArchive *zip, const char *functionName) {
+  return runtimeError(
+      "ZipArchive.%s(): %s", functionName,
+      mz_zip_get_error_string(mz_zip_get_last_error(&zip->archive)));
+}
+
+static size_t asFileIndex(ObjZipArchive *zip, Value value) {
+  return asIndex(value, mz_zip_reader_get_num_files(&zip->archive));
+}
+
+static String *getFileName(ObjZipArchive *zip, mz_uint fileIndex) {
+  char smallBuffer[256], *name = smallBuffer;
+  mz_uint size = mz_zip_reader_get_filename(&zip->archive, fileIndex, NULL, 0);
+  String *string;
+  if (size > sizeof(smallBuffer)) {
+    name = (char *)malloc(size);
+    if (!name) {
+      panic("Failed to allocate zip file name");
+    }
+  }
+  mz_zip_reader_get_filename(&zip->archive, fileIndex, name, size);
+  string = internString(name, size ? size - 1 : 0);
+  if (name != smallBuffer) {
+    free(name);
+  }
+  return string;
+}
+
+/* The archive must be reachable from the stack while this runs */
+static void buildIndex(ObjZipArchive *zip) {
+  mz_uint i, count = mz_zip_reader_get_num_files(&zip->archive);
+  for (i = 0; i < count; i++) {
+    String *name = getFileName(zip, i);
+    Value existing;
+    /* Like 'unzip', the first entry wins if a name is repeated */
+    if (!mapGetStr(&zip->index, name, &existing)) {
+      push(valString(name));
+      mapSetStr(&zip->index, name, valNumber(i));
+      pop(); /* name */
+    }
+  }
+  zip->indexed = UTRUE;
+}
+
+static Status implZipArchiveStaticFromFile(i16 argc, Value *argv, Value *out) {
+  String *path = asString(argv[0]);
+  ObjZipArchive *zip = newZipArchive();
+  mz_bool ok;
+  if (!openMappedFileView(path->chars, &zip->view)) {
+    return STATUS_ERROR;
+  }
+  if (zip->view.mapped) {
+    ok = mz_zip_reader_init_mem(
+        &zip->archive, zip->view.data, zip->view.length,
+        MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY);
+  } else {
+    ok = mz_zip_reader_init_file(
+        &zip->archive, path->chars, MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY);
+  }
+  if (!ok) {
+    return runtimeError(
+        "ZipArchive.fromFile(): %s: %s", path->chars,
+        mz_zip_get_error_string(mz_zip_get_last_error(&zip->archive)));
+  }
+  zip->open = UTRUE;
+  *out = valZipArchive(zip);
+  return STATUS_OK;
+}
+
+static CFunction funcZipArchiveStaticFromFile = {
+    implZipArchiveStaticFromFile, "fromFile", 1};
+
+static Status implZipArchiveGetFileCount(i16 argc, Value *argv, Value *out) {
+  ObjZipArchive *zip = asZipArchive(argv[-1]);
+  *out = valNumber(mz_zip_reader_get_num_files(&zip->archive));
+  return STATUS_OK;
+}
+
+static CFunction funcZipArchiveGetFileCount = {
+    implZipArchiveGetFileCount, "getFileCount"};
+
+static Status implZipArchiveGetFileName(i16 argc, Value *argv, Value *out) {
+  ObjZipArchive *zip = asZipArchive(argv[-1]);
+  size_t fileIndex = asFileIndex(zip, argv[0]);
+  *out = valString(getFileName(zip, (mz_uint)fileIndex));
+  return STATUS_OK;
+}
+
+static CFunction funcZipArchiveGetFileName = {
+    implZipArchiveGetFileName, "getFileName", 1};
+
+static Status implZipArchiveGetFileSize(i16 argc, Value *argv, Value *out) {
+  ObjZipArchive *zip = asZipArchive(argv[-1]);
+  size_t fileIndex = asFileIndex(zip, argv[0]);
+  mz_zip_archive_file_stat stat;
+  if (!mz_zip_reader_file_stat(&zip->archive, (mz_uint)fileIndex, &stat)) {
+    return zipError(zip, "getFileSize");
+  }
+  *out = valNumber((double)stat.m_uncomp_size);
+  return STATUS_OK;
+}
+
+static CFunction funcZipArchiveGetFileSize = {
+    implZipArchiveGetFileSize, "getFileSize", 1};
+
+static Status implZipArchiveIsDirectory(i16 argc, Value *argv, Value *out) {
+  ObjZipArchive *zip = asZipArchive(argv[-1]);
+  size_t fileIndex = asFileIndex(zip, argv[0]);
+  *out = valBool(mz_zip_reader_is_file_a_directory(&zip->archive, (mz_uint)fileIndex));
+  return STATUS_OK;
+}
+
+static CFunction funcZipArchiveIsDirectory = {
+    implZipArchiveIsDirectory, "isDirectory", 1};
+
+static Status implZipArchiveLocate(i16 argc, Value *argv, Value *out) {
+  ObjZipArchive *zip = asZipArchive(argv[-1]);
+  String *name = asString(argv[0]);
+  if (!zip->indexed) {
+    buildIndex(zip);
+  }
+  if (!mapGetStr(&zip->index, name, out)) {
+    *out = valNil();
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcZipArchiveLocate = {implZipArchiveLocate, "locate", 1};
+
+static Status implZipArchiveExtractToFile(i16 argc, Value *argv, Value *out) {
+  ObjZipArchive *zip = asZipArchive(argv[-1]);
+  size_t fileIndex = asFileIndex(zip, argv[0]);
+  String *path = asString(argv[1]);
+  if (!mz_zip_reader_extract_to_file(&zip->archive, (mz_uint)fileIndex, path->chars, 0)) {
+    return zipError(zip, "extractToFile");
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcZipArchiveExtractToFile = {
+    implZipArchiveExtractToFile, "extractToFile", 2};
+
+static size_t writeToBuffer(void *opaque, mz_uint64 offset, const void *data, size_t length) {
+  bufferAddBytes((Buffer *)opaque, data, length);
+  return length;
+}
+
+/* Inflates in chunks: a Buffer sink grows as the data comes in,
+ * and a file sink is written through a FILE handle */
+static Status implZipArchiveExtract(i16 argc, Value *argv, Value *out) {
+  ObjZipArchive *zip = asZipArchive(argv[-1]);
+  size_t fileIndex = asFileIndex(zip, argv[0]);
+  ObjDataSink *sink = asDataSink(argv[1]);
+  mz_bool ok = MZ_FALSE;
+  switch (sink->type) {
+    case DATA_SINK_BUFFER: {
+      Buffer *buffer = &sink->as.buffer->handle;
+      mz_zip_archive_file_stat stat;
+      if (!mz_zip_reader_file_stat(&zip->archive, (mz_uint)fileIndex, &stat)) {
+        return zipError(zip, "extract");
+      }
+      if (stat.m_comp_size > zip->archive.m_archive_size ||
+          stat.m_uncomp_size > stat.m_comp_size * ZIP_MAX_DEFLATE_RATIO ||
+          stat.m_uncomp_size > (mz_uint64)((size_t)-1 - buffer->length)) {
+        return runtimeError(
+            "ZipArchive.extract(): %s claims an impossible size (%.0f bytes)",
+            stat.m_filename, (double)stat.m_uncomp_size);
+      }
+      bufferSetMinCapacity(
+          buffer, buffer->length +
+                      (stat.m_uncomp_size < ZIP_PRESIZE_LIMIT
+                           ? (size_t)stat.m_uncomp_size
+                           : ZIP_PRESIZE_LIMIT));
+      ok = mz_zip_reader_extract_to_callback(
+          &zip->archive, (mz_uint)fileIndex, writeToBuffer, buffer, 0);
+      break;
+    }
+    case DATA_SINK_FILE:
+      ok = mz_zip_reader_extract_to_file(
+          &zip->archive, (mz_uint)fileIndex, sink->as.file.path->chars, 0);
+      break;
+  }
+  if (!ok) {
+    return zipError(zip, "extract");
+  }
+  return STATUS_OK;
+}
+
+static CFunction funcZipArchiveExtract = {implZipArchiveExtract, "extract", 2};
+
+static Status impl(i16 argc, Value *argv, Value *out) {
+  ObjModule *module = asModule(argv[0]);
+  CFunction *methods[] = {
+      &funcZipArchiveGetFileCount,
+      &funcZipArchiveGetFileName,
+      &funcZipArchiveGetFileSize,
+      &funcZipArchiveIsDirectory,
+      &funcZipArchiveLocate,
+      &funcZipArchiveExtractToFile,
+      &funcZipArchiveExtract,
+      NULL,
+  };
+  CFunction *staticMethods[] = {
+      &funcZipArchiveStaticFromFile,
+      NULL,
+  };
+
+  newNativeClass(module, &descriptorZipArchive, methods, staticMethods);
+
+  return STATUS_OK;
+}
+
+static CFunction func = {impl, "zip", 1};
+
+void addNativeModuleZip(void) {
+  addNativeModule(&func);
+}
+
+#else
+void addNativeModuleZip(void) {}
+#endif
@@ -0,0 +1,10 @@
+#ifndef mtots_m_zip_h
+#define mtots_m_zip_h
+
+/* Native Module zip
+ * Read only access to zip archives.
+ * Only available when built with miniz (MTOTS_ENABLE_MINIZ) */
+
+void addNativeModuleZip(void);
+
+#endif /*mtots_m_zip_h*/
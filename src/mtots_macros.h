@@ -6,31 +6,34 @@
 #include "mtots_macros_public.h"
 
 /* Helper macros for creating bindings */
-#define WRAP_C_TYPE_EX(name, ctype, prefix, blackenFunc, freeFunc) \
-  prefix NativeObjectDescriptor descriptor##name = {               \
-      blackenFunc,                                                 \
-      freeFunc,                                                    \
-      sizeof(Obj##name),                                           \
-      #name,                                                       \
-  };                                                               \
-  prefix ubool is##name(Value value) {                             \
-    return getNativeObjectDescriptor(value) == &descriptor##name;  \
-  }                                                                \
-  prefix Value val##name(Obj##name *x) {                           \
-    return valObjExplicit((Obj *)x);                               \
-  }                                                                \
-  prefix Obj##name *as##name(Value value) {                        \
-    if (!is##name(value)) {                                        \
-      panic("Expected " #name " but got %s", getKindName(value));  \
-    }                                                              \
-    return (Obj##name *)AS_OBJ_UNSAFE(value);                      \
-  }                                                                \
-  prefix Obj##name *alloc##name(void) {                            \
-    Obj##name *ret = NEW_NATIVE(Obj##name, &descriptor##name);     \
-    memset(&ret->handle, 0, sizeof(ret->handle));                  \
-    return ret;                                                    \
+#define WRAP_C_TYPE_NAMED_EX(name, className, ctype, prefix, blackenFunc, freeFunc) \
+  prefix NativeObjectDescriptor descriptor##name = {                             \
+      blackenFunc,                                                               \
+      freeFunc,                                                                  \
+      sizeof(Obj##name),                                                         \
+      className,                                                                 \
+  };                                                                             \
+  prefix ubool is##name(Value value) {                                           \
+    return getNativeObjectDescriptor(value) == &descriptor##name;                \
+  }                                                                              \
+  prefix Value val##name(Obj##name *x) {                                         \
+    return valObjExplicit((Obj *)x);                                             \
+  }                                                                              \
+  prefix Obj##name *as##name(Value value) {                                      \
+    if (!is##name(value)) {                                                      \
+      panic("Expected " #name " but got %s", getKindName(value));                \
+    }                                                                            \
+    return (Obj##name *)AS_OBJ_UNSAFE(value);                                    \
+  }                                                                              \
+  prefix Obj##name *alloc##name(void) {                                          \
+    Obj##name *ret = NEW_NATIVE(Obj##name, &descriptor##name);                   \
+    memset(&ret->handle, 0, sizeof(ret->handle));                                \
+    return ret;                                                                  \
   }
 
+#define WRAP_C_TYPE_EX(name, ctype, prefix, blackenFunc, freeFunc) \
+  WRAP_C_TYPE_NAMED_EX(name, #name, ctype, prefix, blackenFunc, freeFunc)
+
 #define WRAP_C_TYPE_DEFAULT_STATIC_METHODS(name)                                  \
   static Status impl##name##StaticCall(i16 argc, Value *argv, Value *out) {       \
     *out = val##name(alloc##name());                                              \
@@ -49,14 +52,18 @@
   WRAP_PUBLIC_C_TYPE_EX(name, ctype, nopBlacken, nopFree) \
   WRAP_C_TYPE_DEFAULT_STATIC_METHODS(name)
 
-#define WRAP_C_TYPE(name, ctype)                           \
-  typedef struct Obj##name {                               \
-    ObjNative obj;                                         \
-    ctype handle;                                          \
-  } Obj##name;                                             \
-  WRAP_C_TYPE_EX(name, ctype, static, nopBlacken, nopFree) \
+/* Like WRAP_C_TYPE, but the class seen from mtots is named 'className'
+ * (e.g. to avoid clashing with the C names of builtin types) */
+#define WRAP_C_TYPE_NAMED(name, className, ctype)                            \
+  typedef struct Obj##name {                                                 \
+    ObjNative obj;                                                           \
+    ctype handle;                                                            \
+  } Obj##name;                                                               \
+  WRAP_C_TYPE_NAMED_EX(name, className, ctype, static, nopBlacken, nopFree) \
   WRAP_C_TYPE_DEFAULT_STATIC_METHODS(name)
 
+#define WRAP_C_TYPE(name, ctype) WRAP_C_TYPE_NAMED(name, #name, ctype)
+
 #define DEFINE_METHOD_COPY(className)                                       \
   static Status impl##className##_copy(i16 argc, Value *argv, Value *out) { \
     Obj##className *owner = as##className(argv[-1]);                        \
@@ -1,5 +1,6 @@
 #include "mtots_main.h"
 
+#include "mtots_archive.h"
 #include "mtots_env.h"
 #include "mtots_repl.h"
 #include "mtots_vm.h"
@@ -18,7 +19,19 @@ static Status runMainModule(int argc, const char **argv) {
   mainModuleName = internCString("__main__");
   push(valString(mainModuleName));
 
-  if (!importModuleWithPath(mainModuleName, argv[1])) {
+  if (isArchivePath(argv[1], strlen(argv[1]))) {
+    /* The main module of an archive is its "__main__.mtots" */
+    StringBuilder sb;
+    ubool ok;
+    initStringBuilder(&sb);
+    sbputstr(&sb, argv[1]);
+    sbputstr(&sb, "/__main__" MTOTS_FILE_EXTENSION);
+    ok = importModuleWithPath(mainModuleName, sb.buffer);
+    freeStringBuilder(&sb);
+    if (!ok) {
+      return STATUS_ERROR;
+    }
+  } else if (!importModuleWithPath(mainModuleName, argv[1])) {
     return STATUS_ERROR;
   }
 
@@ -75,6 +75,17 @@ u32 hashval(Value value) {
       break;
     case VAL_VECTOR:
       return hashVector(asVector(value));
+    case VAL_COLOR: {
+      Color color = asColor(value);
+      return hashNumber(
+          ((u32)color.red << 24) | ((u32)color.green << 16) |
+          ((u32)color.blue << 8) | color.alpha);
+    }
+    case VAL_RECT: {
+      Rect rect = asRect(value);
+      return hashVector(newVector(rect.minX, rect.minY, rect.width)) ^
+             hashNumber(rect.height);
+    }
     case VAL_POINTER:
       /* TODO: come up with better hashing */
       return (u32)(size_t)(value.extra.tpm.isConst
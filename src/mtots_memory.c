@@ -17,6 +17,13 @@ void initMemory(Memory *memory) {
   memory->mallocCount = 0;
 }
 
+/* Total size of the memory the garbage collector paces itself against */
+static size_t getTrackedMemorySize(void) {
+  return vm.memory.bytesAllocated +
+         getInternedStringsAllocationSize() +
+         getExternalMemoryTotal();
+}
+
 void addForeverValue(Value value) {
   if (vm.memory.foreverValueCount >= MAX_FOREVER_VALUE_COUNT) {
     panic("Too many forever objects (max=%d)", MAX_FOREVER_VALUE_COUNT);
@@ -30,7 +37,7 @@ void *reallocate(void *pointer, size_t oldSize, size_t newSize) {
   vm.memory.bytesAllocated += newSize - oldSize;
   if (newSize > oldSize) {
     vm.memory.mallocCount++;
-    if (vm.memory.bytesAllocated + getInternedStringsAllocationSize() > vm.memory.nextGC) {
+    if (getTrackedMemorySize() > vm.memory.nextGC) {
       collectGarbage();
     }
 #if DEBUG_STRESS_GC
@@ -253,7 +260,7 @@ static void freeObject(Obj *object) {
 
 static void markRoots(void) {
   Value *slot;
-  i16 i;
+  i32 i;
   ObjUpvalue *upvalue;
   for (slot = vm.stack; slot < vm.stackTop; slot++) {
     markValue(*slot);
@@ -266,7 +273,7 @@ static void markRoots(void) {
   }
 
   for (i = 0; i < vm.frameCount; i++) {
-    markObject((Obj *)vm.frames[i].closure);
+    markObject((Obj *)VM_FRAME(i)->closure);
   }
 
   for (upvalue = vm.openUpvalues;
@@ -342,7 +349,7 @@ void collectGarbage(void) {
   }
 
   if (emitLog) {
-    before = vm.memory.bytesAllocated + getInternedStringsAllocationSize();
+    before = getTrackedMemorySize();
     objectCountBefore = countObjects();
     eprintln("DEBUG: Starting garbage collector");
   }
@@ -354,20 +361,16 @@ void collectGarbage(void) {
   mapRemoveWhite(&vm.frozenDicts);
   sweep();
 
-  vm.memory.nextGC =
-      (vm.memory.bytesAllocated + getInternedStringsAllocationSize()) *
-      GC_HEAP_GROW_FACTOR;
+  vm.memory.nextGC = getTrackedMemorySize() * GC_HEAP_GROW_FACTOR;
 
   if (emitLog) {
     eprintln(
         "DEBUG: Finished collecting garbage\n"
         "       collected %lu bytes (from %lu to %lu) next at %lu\n"
         "       object-count = %lu -> %lu",
-        (unsigned long)before - (vm.memory.bytesAllocated +
-                                 getInternedStringsAllocationSize()),
+        (unsigned long)(before - getTrackedMemorySize()),
         (unsigned long)before,
-        (unsigned long)vm.memory.bytesAllocated +
-            getInternedStringsAllocationSize(),
+        (unsigned long)getTrackedMemorySize(),
         (unsigned long)vm.memory.nextGC,
         (unsigned long)objectCountBefore,
         (unsigned long)countObjects());
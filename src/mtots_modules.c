@@ -1,41 +1,65 @@
 #include "mtots_modules.h"
 
+#include "mtots_m_array.h"
+#include "mtots_m_base64.h"
 #include "mtots_m_bmon.h"
 #include "mtots_m_c.h"
 #include "mtots_m_data.h"
+#include "mtots_m_eventloop.h"
 #include "mtots_m_fs.h"
 #include "mtots_m_json.h"
+#include "mtots_m_media_audio.h"
+#include "mtots_m_media_canvas.h"
+#include "mtots_m_media_font.h"
+#include "mtots_m_media_image.h"
+#include "mtots_m_media_image_loader.h"
+#include "mtots_m_media_png.h"
 #include "mtots_m_os.h"
 #include "mtots_m_os_path.h"
 #include "mtots_m_osposix.h"
 #include "mtots_m_platform.h"
 #include "mtots_m_random.h"
+#include "mtots_m_rs.h"
 #include "mtots_m_sdl.h"
 #include "mtots_m_signal.h"
 #include "mtots_m_stat.h"
+#include "mtots_m_struct.h"
 #include "mtots_m_subprocess.h"
 #include "mtots_m_sys.h"
 #include "mtots_m_termios.h"
 #include "mtots_m_time.h"
 #include "mtots_m_xlodepng.h"
+#include "mtots_m_zip.h"
 
 void addNativeModules(void) {
+  addNativeModuleArray();
+  addNativeModuleBase64();
   addNativeModuleBmon();
   addNativeModuleC();
   addNativeModuleData();
+  addNativeModuleEventLoop();
   addNativeModuleFs();
   addNativeModuleJson();
+  addNativeModuleMediaAudio();
+  addNativeModuleMediaCanvas();
+  addNativeModuleMediaFont();
+  addNativeModuleMediaImage();
+  addNativeModuleMediaImageLoader();
+  addNativeModuleMediaPng();
   addNativeModuleOs();
   addNativeModuleOsPath();
   addNativeModuleOsPosix();
   addNativeModulePlatform();
   addNativeModuleRandom();
+  addNativeModuleRs();
   addNativeModuleSDL();
   addNativeModuleSignal();
   addNativeModuleStat();
+  addNativeModuleStruct();
   addNativeModuleSubprocess();
   addNativeModuleSys();
   addNativeModuleTermios();
   addNativeModuleTime();
   addNativeModuleXLodepng();
+  addNativeModuleZip();
 }
@@ -312,6 +312,7 @@ ObjThunk *newThunk(void) {
   thunk->defaultArgsCount = 0;
   thunk->parameterNames = NULL;
   thunk->moduleName = NULL;
+  thunk->maxStackSize = 0;
   initChunk(&thunk->chunk);
   return thunk;
 }
@@ -628,6 +629,10 @@ ObjClass *getClassOfValue(Value value) {
       return vm.rangeIteratorClass;
     case VAL_VECTOR:
       return vm.vectorClass;
+    case VAL_COLOR:
+      return vm.colorClass;
+    case VAL_RECT:
+      return vm.rectClass;
     case VAL_POINTER:
       return vm.pointerClass;
     case VAL_FILE_DESCRIPTOR:
@@ -73,6 +73,7 @@ typedef struct ObjThunk {
   i16 defaultArgsCount;
   String **parameterNames; /* Length must match arity, or be NULL */
   String *moduleName;
+  i32 maxStackSize; /* counted from the callee's slot */
 } ObjThunk;
 
 /**
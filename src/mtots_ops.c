@@ -13,6 +13,18 @@ static ubool vectorsEqual(Vector a, Vector b) {
   return a.x == b.x && a.y == b.y && a.z == b.z;
 }
 
+static ubool colorsEqual(Color a, Color b) {
+  return a.red == b.red && a.green == b.green && a.blue == b.blue &&
+         a.alpha == b.alpha;
+}
+
+/* Rect components are normalized when packed, so equal
+ * rects always have the same packed representation */
+static ubool rectsEqual(Value a, Value b) {
+  return memcmp(a.extra.exponents, b.extra.exponents, 4) == 0 &&
+         memcmp(&a.as.rect, &b.as.rect, sizeof(RectPartial)) == 0;
+}
+
 static const void *getConstPointerUnsafe(Value v) {
   return v.extra.tpm.isConst ? v.as.constVoidPointer : v.as.voidPointer;
 }
@@ -40,6 +52,10 @@ ubool valuesIs(Value a, Value b) {
       return rangesEqual(asRange(a), asRange(b));
     case VAL_VECTOR:
       return vectorsEqual(asVector(a), asVector(b));
+    case VAL_COLOR:
+      return colorsEqual(asColor(a), asColor(b));
+    case VAL_RECT:
+      return rectsEqual(a, b);
     case VAL_POINTER:
       return getConstPointerUnsafe(a) == getConstPointerUnsafe(b);
     case VAL_FILE_DESCRIPTOR:
@@ -95,6 +111,10 @@ ubool valuesEqual(Value a, Value b) {
       return rangesEqual(asRange(a), asRange(b));
     case VAL_VECTOR:
       return vectorsEqual(asVector(a), asVector(b));
+    case VAL_COLOR:
+      return colorsEqual(asColor(a), asColor(b));
+    case VAL_RECT:
+      return rectsEqual(a, b);
     case VAL_POINTER:
       return getConstPointerUnsafe(a) == getConstPointerUnsafe(b);
     case VAL_FILE_DESCRIPTOR:
@@ -208,6 +228,10 @@ ubool valueLessThan(Value a, Value b) {
       return va.x < vb.x ||
              (va.x == vb.x && (va.y < vb.y || (va.y == vb.y && va.z < vb.z)));
     }
+    case VAL_COLOR:
+      break;
+    case VAL_RECT:
+      break;
     case VAL_POINTER:
       return getConstPointerUnsafe(a) < getConstPointerUnsafe(b);
     case VAL_FILE_DESCRIPTOR:
@@ -330,29 +354,59 @@ void sortList(ObjList *list, ObjList *keys) {
   free(buffer);
 }
 
-Status sortListWithKeyFunc(ObjList *list, Value keyfunc) {
-  if (!isNil(keyfunc)) {
-    ObjList *keys = newList(list->length);
-    size_t i = 0;
-    push(valList(keys));
-    for (i = 0; i < list->length; i++) {
-      push(keyfunc);
-      push(list->buffer[i]);
-      if (!callFunction(1)) {
-        return STATUS_ERROR;
-      }
-      keys->buffer[i] = pop();
-    }
-    sortList(list, keys);
-    pop(); /* keys */
-    return STATUS_OK;
+static Status resumeSortListWithKeyFunc(i16 argc, Value *argv, Value key, Value *out);
+
+static NativeContinuation sortListWithKeyFuncContinuation = {
+    resumeSortListWithKeyFunc, NULL};
+
+/* The top of the stack holds: returnValue, list, keyfunc, keys, index */
+#define SORT_STATE_SIZE 5
+
+static Status scheduleSortKeyCall(Value *state, size_t i) {
+  state[4] = valNumber(i);
+  push(state[2]);
+  push(AS_LIST_UNSAFE(state[1])->buffer[i]);
+  return scheduleCall(1, &sortListWithKeyFuncContinuation);
+}
+
+static Status resumeSortListWithKeyFunc(i16 argc, Value *argv, Value key, Value *out) {
+  Value *state = vm.stackTop - SORT_STATE_SIZE;
+  ObjList *list = AS_LIST_UNSAFE(state[1]);
+  ObjList *keys = AS_LIST_UNSAFE(state[3]);
+  size_t i = (size_t)state[4].as.number;
+  if (list->length != keys->length) {
+    runtimeError("List was modified while computing its sort keys");
+    return STATUS_ERROR;
+  }
+  keys->buffer[i++] = key;
+  if (i < list->length) {
+    return scheduleSortKeyCall(state, i);
+  }
+  sortList(list, keys);
+  *out = state[0];
+  return STATUS_OK;
+}
+
+Status sortListWithKeyFunc(ObjList *list, Value keyfunc, Value returnValue, Value *out) {
+  if (!isNil(keyfunc) && list->length > 0) {
+    Value *state;
+    push(returnValue);
+    push(valList(list));
+    push(keyfunc);
+    push(valList(newList(list->length))); /* keys */
+    push(valNumber(0));
+    state = vm.stackTop - SORT_STATE_SIZE;
+    return scheduleSortKeyCall(state, 0);
   }
 
   /* If keyfunc is nil, we can call sortList directly */
   sortList(list, NULL);
+  *out = returnValue;
   return STATUS_OK;
 }
 
+#undef SORT_STATE_SIZE
+
 static Status listBodyRepr(StringBuilder *out, Value *buffer, size_t length) {
   size_t i;
   for (i = 0; i < length; i++) {
@@ -431,11 +485,30 @@ Status valueRepr(StringBuilder *out, Value value) {
     case VAL_VECTOR: {
       Vector vector = asVector(value);
       sbprintf(out, "Vector(");
-      sbputnumber(out, vector.x);
+      sbputfloat(out, vector.x);
+      sbprintf(out, ", ");
+      sbputfloat(out, vector.y);
+      sbprintf(out, ", ");
+      sbputfloat(out, vector.z);
+      sbprintf(out, ")");
+      return STATUS_OK;
+    }
+    case VAL_COLOR: {
+      Color color = asColor(value);
+      sbprintf(out, "Color(%d, %d, %d, %d)",
+               color.red, color.green, color.blue, color.alpha);
+      return STATUS_OK;
+    }
+    case VAL_RECT: {
+      Rect rect = asRect(value);
+      sbprintf(out, "Rect(");
+      sbputfloat(out, rect.minX);
+      sbprintf(out, ", ");
+      sbputfloat(out, rect.minY);
       sbprintf(out, ", ");
-      sbputnumber(out, vector.y);
+      sbputfloat(out, rect.width);
       sbprintf(out, ", ");
-      sbputnumber(out, vector.z);
+      sbputfloat(out, rect.height);
       sbprintf(out, ")");
       return STATUS_OK;
     }
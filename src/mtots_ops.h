@@ -9,7 +9,10 @@ ubool valuesEqual(Value a, Value b);
 ubool valueLessThan(Value a, Value b);
 void listAppend(ObjList *list, Value value);
 void sortList(ObjList *list, ObjList *keys);
-Status sortListWithKeyFunc(ObjList *list, Value keyfunc);
+/* Sorts 'list' by the keys 'keyfunc' returns for each item.
+ * The key function is called with 'scheduleCall', so this must be
+ * returned from a CFunction, which will then return 'returnValue' */
+Status sortListWithKeyFunc(ObjList *list, Value keyfunc, Value returnValue, Value *out);
 Status valueRepr(StringBuilder *out, Value value);
 Status valueStr(StringBuilder *out, Value value);
 Status strMod(StringBuilder *out, const char *format, ObjList *args);
@@ -356,6 +356,199 @@ static Status patchJump(Parser *parser, i32 offset) {
   return STATUS_OK;
 }
 
+/* Queues the instruction at 'offset' to be looked at with the given
+ * stack depth, unless it has already been seen with a depth at least
+ * as large */
+static void queueStackDepth(
+    i32 *depths, ubool *queued, i32 *worklist, i32 *worklistSize,
+    i32 offset, i32 depth) {
+  if (depths[offset] < depth) {
+    depths[offset] = depth;
+    if (!queued[offset]) {
+      queued[offset] = UTRUE;
+      worklist[(*worklistSize)++] = offset;
+    }
+  }
+}
+
+/* Computes the deepest the value stack can get while running the
+ * finished thunk, counted from the frame's first slot (the callee).
+ * Calls reserve this much up front so that push() does not need to check
+ * for overflow */
+static i32 computeMaxStackSize(ObjThunk *thunk) {
+  Chunk *chunk = &thunk->chunk;
+  u8 *code = chunk->code;
+  i32 *depths = (i32 *)malloc(sizeof(i32) * chunk->count);
+  i32 *worklist = (i32 *)malloc(sizeof(i32) * chunk->count);
+  ubool *queued = (ubool *)malloc(sizeof(ubool) * chunk->count);
+  i32 worklistSize = 0, maxDepth = thunk->arity + 1, i;
+
+  if (depths == NULL || worklist == NULL || queued == NULL) {
+    panic("out of memory (while computing the stack size)");
+  }
+  for (i = 0; i < chunk->count; i++) {
+    depths[i] = -1;
+    queued[i] = UFALSE;
+  }
+  queueStackDepth(depths, queued, worklist, &worklistSize, 0, maxDepth);
+
+  while (worklistSize > 0) {
+    i32 offset = worklist[--worklistSize];
+    i32 depth = depths[offset];
+    i32 length = 1, effect = 0, peak = 0, jump = -1;
+    ubool fallsThrough = UTRUE;
+    queued[offset] = UFALSE;
+    switch (code[offset]) {
+      case OP_NIL:
+      case OP_TRUE:
+      case OP_FALSE:
+      case OP_GET_NEXT:
+        effect = 1;
+        break;
+      case OP_CONSTANT:
+      case OP_GET_GLOBAL:
+      case OP_IMPORT:
+      case OP_CLASS:
+        length = 3;
+        effect = 1;
+        break;
+      case OP_GET_LOCAL:
+      case OP_GET_UPVALUE:
+        length = 2;
+        effect = 1;
+        break;
+      case OP_SET_LOCAL:
+      case OP_SET_UPVALUE:
+        length = 2;
+        break;
+      case OP_SET_GLOBAL:
+        length = 3;
+        break;
+      case OP_GET_FIELD:
+        /* a class with 'getattr' gets the name pushed */
+        length = 3;
+        peak = 1;
+        break;
+      case OP_SET_FIELD:
+        /* a class with 'setattr' gets the name pushed under the value */
+        length = 3;
+        effect = -1;
+        peak = 1;
+        break;
+      case OP_DEFINE_GLOBAL:
+      case OP_METHOD:
+      case OP_STATIC_METHOD:
+        length = 3;
+        effect = -1;
+        break;
+      case OP_POP:
+      case OP_IS:
+      case OP_EQUAL:
+      case OP_GREATER:
+      case OP_LESS:
+      case OP_ADD:
+      case OP_SUBTRACT:
+      case OP_MULTIPLY:
+      case OP_DIVIDE:
+      case OP_FLOOR_DIVIDE:
+      case OP_MODULO:
+      case OP_POWER:
+      case OP_SHIFT_LEFT:
+      case OP_SHIFT_RIGHT:
+      case OP_BITWISE_OR:
+      case OP_BITWISE_AND:
+      case OP_BITWISE_XOR:
+      case OP_IN:
+      case OP_CLOSE_UPVALUE:
+      case OP_INHERIT:
+        effect = -1;
+        break;
+      case OP_BITWISE_NOT:
+      case OP_NOT:
+      case OP_NEGATE:
+      case OP_NIL_CHECK:
+      case OP_GET_ITER:
+        break;
+      case OP_JUMP:
+        fallsThrough = UFALSE;
+        /* fallthrough */
+      case OP_JUMP_IF_FALSE:
+      case OP_JUMP_IF_NOT_NIL:
+      case OP_JUMP_IF_STOP_ITERATION:
+        length = 3;
+        jump = offset + 3 + ((code[offset + 1] << 8) | code[offset + 2]);
+        break;
+      case OP_LOOP:
+        length = 3;
+        jump = offset + 3 - ((code[offset + 1] << 8) | code[offset + 2]);
+        fallsThrough = UFALSE;
+        break;
+      case OP_RAISE:
+      case OP_RETURN:
+        fallsThrough = UFALSE;
+        break;
+      case OP_CALL:
+        length = 2;
+        effect = -code[offset + 1];
+        break;
+      case OP_CALL_KW:
+        length = 2;
+        effect = -code[offset + 1] - 1;
+        break;
+      case OP_INVOKE:
+        length = 4;
+        effect = -code[offset + 3];
+        break;
+      case OP_SUPER_INVOKE:
+      case OP_INVOKE_KW:
+        length = 4;
+        effect = -code[offset + 3] - 1;
+        break;
+      case OP_CLOSURE: {
+        ObjThunk *inner = AS_THUNK_UNSAFE(
+            chunk->constants.values[(code[offset + 1] << 8) | code[offset + 2]]);
+        length = 3 + 2 * inner->upvalueCount;
+        effect = 1;
+        break;
+      }
+      case OP_CLOSE_UPVALUES:
+        length = 2;
+        effect = -code[offset + 1];
+        break;
+      case OP_NEW_LIST:
+      case OP_NEW_FROZEN_LIST:
+        length = 2;
+        effect = 1 - code[offset + 1];
+        break;
+      case OP_NEW_DICT:
+      case OP_NEW_FROZEN_DICT:
+        length = 2;
+        effect = 1 - 2 * code[offset + 1];
+        break;
+      default:
+        panic("computeMaxStackSize(): unrecognized opcode %d", code[offset]);
+    }
+    if (depth + peak > maxDepth) {
+      maxDepth = depth + peak;
+    }
+    if (depth + effect > maxDepth) {
+      maxDepth = depth + effect;
+    }
+    if (jump >= 0) {
+      queueStackDepth(depths, queued, worklist, &worklistSize, jump, depth + effect);
+    }
+    if (fallsThrough && offset + length < chunk->count) {
+      queueStackDepth(
+          depths, queued, worklist, &worklistSize, offset + length, depth + effect);
+    }
+  }
+
+  free(depths);
+  free(worklist);
+  free(queued);
+  return maxDepth;
+}
+
 static Status emitConst(Parser *parser, Value value) {
   ConstID constID;
   ADD_CONST_VALUE(value, &constID);
@@ -756,14 +949,14 @@ static Status parseDefaultArgument(Parser *parser, DefaultArgument *out) {
     case TOKEN_NUMBER:
       ADVANCE();
       out->type = DEFARG_NUMBER;
-      out->as.number = strtod(parser->previous.start, NULL);
+      out->as.number = parseDouble(parser->previous.start, NULL);
       return STATUS_OK;
     case TOKEN_MINUS:
       ADVANCE();
       if (AT(TOKEN_NUMBER)) {
         ADVANCE();
         out->type = DEFARG_NUMBER;
-        out->as.number = -strtod(parser->previous.start, NULL);
+        out->as.number = -parseDouble(parser->previous.start, NULL);
         return STATUS_OK;
       } else {
         runtimeError(
@@ -929,6 +1122,8 @@ static Status parseFunctionCore(Parser *parser, StringSlice name, ThunkContext *
     }
   }
 
+  thunk->maxStackSize = computeMaxStackSize(thunk);
+
   /* Pop the Thunk and Environment for this function */
   parser->env = parser->env->enclosing;
   ADD_CONST_VALUE(valThunk(thunk), &thunkID);
@@ -1112,7 +1307,7 @@ static Status parseStringLiteral(Parser *parser) {
 static Status parseNumber(Parser *parser) {
   double value;
   EXPECT(TOKEN_NUMBER);
-  value = strtod(parser->previous.start, NULL);
+  value = parseDouble(parser->previous.start, NULL);
   EMIT_CONST(valNumber(value));
   return STATUS_OK;
 }
@@ -2041,6 +2236,7 @@ ubool parse(const char *source, String *moduleName, ObjThunk **out) {
   if (!emit2(&parser, OP_NIL, OP_RETURN)) {
     return STATUS_ERROR;
   }
+  thunk->maxStackSize = computeMaxStackSize(thunk);
 
   activeParser = NULL;
   *out = thunk;
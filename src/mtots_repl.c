@@ -13,17 +13,17 @@
  * whether I should be worrying about the try-stack or vm.frames,
  * or anything else.
  */
-static Value *replStackTop;
-static i16 replFrameCount;
+static ptrdiff_t replStackTopOffset;
+static i32 replFrameCount;
 
 static void saveState(void) {
-  replStackTop = vm.stackTop;
+  replStackTopOffset = vm.stackTop - vm.stack;
   replFrameCount = vm.frameCount;
 }
 
 static void restoreState(void) {
-  closeUpvalues(replStackTop);
-  vm.stackTop = replStackTop;
+  closeUpvalues(vm.stack + replStackTopOffset);
+  vm.stackTop = vm.stack + replStackTopOffset;
   vm.frameCount = replFrameCount;
 }
 
@@ -7,13 +7,18 @@
 /* Utilities that would be useful in any C program */
 #include "mtots_util_base64.h"
 #include "mtots_util_buffer.h"
+#include "mtots_util_convert.h"
+#include "mtots_util_dtoa.h"
 #include "mtots_util_error.h"
 #include "mtots_util_escape.h"
+#include "mtots_util_extmem.h"
 #include "mtots_util_fd.h"
 #include "mtots_util_fs.h"
 #include "mtots_util_number.h"
+#include "mtots_util_parallel.h"
 #include "mtots_util_printf.h"
 #include "mtots_util_random.h"
+#include "mtots_util_raster.h"
 #include "mtots_util_readfile.h"
 #include "mtots_util_sb.h"
 #include "mtots_util_string.h"
@@ -138,38 +138,100 @@ static const u8 base64Rmap[] = {
     INVALID_CHAR,
 };
 
-Status encodeBase64(const u8 *input, size_t length, StringBuilder *out) {
-  size_t i;
-  size_t lenRem = length % 3;
-  size_t roundLen = length - lenRem;
-  for (i = 0; i < roundLen; i += 3) {
+/* Lookup tables built from 'base64Alphabet' and 'base64Rmap' on first use.
+ *
+ * 'encodePairs' maps 12 bits of input to the two output characters,
+ * so that every 3 input bytes need only two lookups.
+ *
+ * 'decodeShifted[k]' maps a character to its 6 bit value already
+ * shifted into position k of a 24 bit chunk, so that a 4 char chunk
+ * decodes to the bitwise OR of four lookups. Invalid characters
+ * (including '=') map to DECODE_INVALID, which survives the OR */
+#define DECODE_INVALID 0x01000000
+
+static ubool tablesReady;
+static char encodePairs[4096][2];
+static u32 decodeShifted[4][256];
+
+static void initTables(void) {
+  size_t i, k;
+  if (tablesReady) {
+    return;
+  }
+  for (i = 0; i < 4096; i++) {
+    encodePairs[i][0] = base64Alphabet[i >> 6];
+    encodePairs[i][1] = base64Alphabet[i & 63];
+  }
+  for (i = 0; i < 256; i++) {
+    u32 value = i >= 43 && i <= 122 && i != '=' ? base64Rmap[i] : INVALID_CHAR;
+    for (k = 0; k < 4; k++) {
+      decodeShifted[k][i] = value == INVALID_CHAR ? DECODE_INVALID : value << (18 - 6 * k);
+    }
+  }
+  tablesReady = UTRUE;
+}
+
+size_t base64EncodedLength(size_t length) {
+  return (length + 2) / 3 * 4;
+}
+
+/* Encodes the input into 'out', which must have room for
+ * base64EncodedLength(length) chars */
+static void encodeInto(const u8 *input, size_t length, char *out) {
+  size_t i, lenRem = length % 3, roundLen = length - lenRem;
+  initTables();
+  for (i = 0; i < roundLen; i += 3, out += 4) {
     u32 chunk =
         (((u32)input[i]) << 16) |
         (((u32)input[i + 1]) << 8) |
         (((u32)input[i + 2]));
-    sbputchar(out, base64Alphabet[chunk >> 18]);
-    sbputchar(out, base64Alphabet[(chunk >> 12) & 63]);
-    sbputchar(out, base64Alphabet[(chunk >> 6) & 63]);
-    sbputchar(out, base64Alphabet[chunk & 63]);
+    const char *hi = encodePairs[chunk >> 12];
+    const char *lo = encodePairs[chunk & 4095];
+    out[0] = hi[0];
+    out[1] = hi[1];
+    out[2] = lo[0];
+    out[3] = lo[1];
   }
   if (lenRem == 1) {
     u32 chunk = ((u32)input[i]) << 16;
-    sbputchar(out, base64Alphabet[chunk >> 18]);
-    sbputchar(out, base64Alphabet[(chunk >> 12) & 63]);
-    sbputchar(out, '=');
-    sbputchar(out, '=');
+    out[0] = base64Alphabet[chunk >> 18];
+    out[1] = base64Alphabet[(chunk >> 12) & 63];
+    out[2] = '=';
+    out[3] = '=';
   } else if (lenRem == 2) {
     u32 chunk =
         (((u32)input[i]) << 16) |
         (((u32)input[i + 1]) << 8);
-    sbputchar(out, base64Alphabet[chunk >> 18]);
-    sbputchar(out, base64Alphabet[(chunk >> 12) & 63]);
-    sbputchar(out, base64Alphabet[(chunk >> 6) & 63]);
-    sbputchar(out, '=');
+    out[0] = base64Alphabet[chunk >> 18];
+    out[1] = base64Alphabet[(chunk >> 12) & 63];
+    out[2] = base64Alphabet[(chunk >> 6) & 63];
+    out[3] = '=';
+  }
+}
+
+Status encodeBase64(const u8 *input, size_t length, StringBuilder *out) {
+  /* Encode in blocks through a local buffer, so that the StringBuilder
+   * is appended to once per block instead of once per char */
+  char block[1024];
+  size_t blockInputLength = sizeof(block) / 4 * 3;
+  while (length > 0) {
+    size_t n = length < blockInputLength ? length : blockInputLength;
+    encodeInto(input, n, block);
+    sbputstrlen(out, block, base64EncodedLength(n));
+    input += n;
+    length -= n;
   }
   return STATUS_OK;
 }
 
+void encodeBase64ToBuffer(const u8 *input, size_t length, Buffer *out) {
+  size_t start = out->length;
+  size_t encodedLength = base64EncodedLength(length);
+  bufferSetMinCapacity(out, start + encodedLength);
+  encodeInto(input, length, (char *)out->data + start);
+  out->length = start + encodedLength;
+}
+
 static Status decodeBase64Char(char ch, u32 *out) {
   if (ch >= 43 && ch <= 122) {
     u32 value = (u32)base64Rmap[(u8)ch];
@@ -182,8 +244,9 @@ static Status decodeBase64Char(char ch, u32 *out) {
   return STATUS_ERROR;
 }
 
-/* Decode a 4 char chunk from the input */
-static Status decodeBase64Chunk(const char *input, Buffer *out) {
+/* Decode a 4 char chunk that may contain padding or invalid characters.
+ * Writes up to 3 bytes to 'out' and sets 'outLength' to the number written */
+static Status decodeBase64Chunk(const char *input, u8 *out, size_t *outLength) {
   u32 chunk = 0, charVal;
 
   /* Validation */
@@ -212,21 +275,46 @@ static Status decodeBase64Chunk(const char *input, Buffer *out) {
 
   /* emit data */
   /* TODO: Consider adding error handling based on invalid values */
-  if (input[2] == '=') {
-    bufferAddU8(out, chunk >> 16);
-  } else if (input[3] == '=') {
-    bufferAddU8(out, chunk >> 16);
-    bufferAddU8(out, (chunk >> 8) & 255);
-  } else {
-    bufferAddU8(out, chunk >> 16);
-    bufferAddU8(out, (chunk >> 8) & 255);
-    bufferAddU8(out, chunk & 255);
+  out[0] = (u8)(chunk >> 16);
+  out[1] = (u8)((chunk >> 8) & 255);
+  out[2] = (u8)(chunk & 255);
+  *outLength = input[2] == '=' ? 1 : input[3] == '=' ? 2 : 3;
+  return STATUS_OK;
+}
+
+/* Decodes 'length' chars, which must be a multiple of 4, and appends
+ * the bytes to 'out' */
+static Status decodeChunks(const char *input, size_t length, Buffer *out) {
+  size_t i, written = out->length;
+  u8 *dst;
+  initTables();
+  bufferSetMinCapacity(out, written + length / 4 * 3);
+  dst = out->data;
+  for (i = 0; i < length; i += 4) {
+    u32 chunk =
+        decodeShifted[0][(u8)input[i]] |
+        decodeShifted[1][(u8)input[i + 1]] |
+        decodeShifted[2][(u8)input[i + 2]] |
+        decodeShifted[3][(u8)input[i + 3]];
+    if (chunk & DECODE_INVALID) {
+      size_t chunkLength;
+      if (!decodeBase64Chunk(input + i, dst + written, &chunkLength)) {
+        out->length = written;
+        return STATUS_ERROR;
+      }
+      written += chunkLength;
+    } else {
+      dst[written] = (u8)(chunk >> 16);
+      dst[written + 1] = (u8)(chunk >> 8);
+      dst[written + 2] = (u8)chunk;
+      written += 3;
+    }
   }
+  out->length = written;
   return STATUS_OK;
 }
 
 Status decodeBase64(const char *input, size_t length, Buffer *out) {
-  size_t i;
   if (length % 4 != 0) {
     runtimeError(
         "decodeBase64 requires input length that is a multiple of 4, "
@@ -234,10 +322,78 @@ Status decodeBase64(const char *input, size_t length, Buffer *out) {
         (unsigned long)length);
     return STATUS_ERROR;
   }
-  for (i = 0; i < length; i += 4) {
-    if (!decodeBase64Chunk(input + i, out)) {
+  return decodeChunks(input, length, out);
+}
+
+void initBase64Encoder(Base64Encoder *encoder) {
+  encoder->pendingLength = 0;
+}
+
+void base64EncoderUpdate(
+    Base64Encoder *encoder, const u8 *input, size_t length, Buffer *out) {
+  size_t roundLength;
+  if (encoder->pendingLength > 0) {
+    while (encoder->pendingLength < 3 && length > 0) {
+      encoder->pending[encoder->pendingLength++] = *input++;
+      length--;
+    }
+    if (encoder->pendingLength < 3) {
+      return;
+    }
+    encodeBase64ToBuffer(encoder->pending, 3, out);
+    encoder->pendingLength = 0;
+  }
+  roundLength = length - length % 3;
+  encodeBase64ToBuffer(input, roundLength, out);
+  for (; roundLength < length; roundLength++) {
+    encoder->pending[encoder->pendingLength++] = input[roundLength];
+  }
+}
+
+void base64EncoderFinish(Base64Encoder *encoder, Buffer *out) {
+  encodeBase64ToBuffer(encoder->pending, encoder->pendingLength, out);
+  encoder->pendingLength = 0;
+}
+
+void initBase64Decoder(Base64Decoder *decoder) {
+  decoder->pendingLength = 0;
+}
+
+Status base64DecoderUpdate(
+    Base64Decoder *decoder, const char *input, size_t length, Buffer *out) {
+  size_t roundLength;
+  if (decoder->pendingLength > 0) {
+    while (decoder->pendingLength < 4 && length > 0) {
+      decoder->pending[decoder->pendingLength++] = *input++;
+      length--;
+    }
+    if (decoder->pendingLength < 4) {
+      return STATUS_OK;
+    }
+    decoder->pendingLength = 0;
+    if (!decodeChunks(decoder->pending, 4, out)) {
       return STATUS_ERROR;
     }
   }
+  roundLength = length - length % 4;
+  if (!decodeChunks(input, roundLength, out)) {
+    return STATUS_ERROR;
+  }
+  for (; roundLength < length; roundLength++) {
+    decoder->pending[decoder->pendingLength++] = input[roundLength];
+  }
+  return STATUS_OK;
+}
+
+Status base64DecoderFinish(Base64Decoder *decoder) {
+  if (decoder->pendingLength > 0) {
+    size_t pendingLength = decoder->pendingLength;
+    decoder->pendingLength = 0;
+    runtimeError(
+        "base64 input ended in the middle of a 4 char chunk "
+        "(%lu chars left over)",
+        (unsigned long)pendingLength);
+    return STATUS_ERROR;
+  }
   return STATUS_OK;
 }
@@ -4,7 +4,41 @@
 #include "mtots_util_buffer.h"
 #include "mtots_util_sb.h"
 
+/* Number of chars in the base64 encoding of 'length' bytes */
+size_t base64EncodedLength(size_t length);
+
 Status encodeBase64(const u8 *input, size_t length, StringBuilder *out);
 Status decodeBase64(const char *input, size_t length, Buffer *out);
 
+/* Appends the base64 encoding of the input to 'out' as ASCII bytes */
+void encodeBase64ToBuffer(const u8 *input, size_t length, Buffer *out);
+
+/* Incremental encoder. Input may be fed in chunks of any size,
+ * and the encoded output is the same as encoding it all at once */
+typedef struct Base64Encoder {
+  u8 pending[3];
+  size_t pendingLength;
+} Base64Encoder;
+
+void initBase64Encoder(Base64Encoder *encoder);
+void base64EncoderUpdate(
+    Base64Encoder *encoder, const u8 *input, size_t length, Buffer *out);
+
+/* Encodes any leftover bytes with padding, and resets the encoder */
+void base64EncoderFinish(Base64Encoder *encoder, Buffer *out);
+
+/* Incremental decoder. Input may be fed in chunks of any size */
+typedef struct Base64Decoder {
+  char pending[4];
+  size_t pendingLength;
+} Base64Decoder;
+
+void initBase64Decoder(Base64Decoder *decoder);
+Status base64DecoderUpdate(
+    Base64Decoder *decoder, const char *input, size_t length, Buffer *out);
+
+/* Fails if the input fed so far did not end on a 4 char boundary.
+ * Resets the decoder */
+Status base64DecoderFinish(Base64Decoder *decoder);
+
 #endif /*mtots_util_base64_h*/
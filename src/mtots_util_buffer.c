@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "mtots_util_error.h"
+#include "mtots_util_extmem.h"
 
 /**
  * For now, we assume that we're always little endian.
@@ -43,6 +44,12 @@ static void checkIndex(Buffer *buf, size_t pos, size_t length) {
   }
 }
 
+static void checkNotReadOnly(Buffer *buf) {
+  if (buf->isReadOnly) {
+    panic("Cannot modify a read only Buffer");
+  }
+}
+
 static void addByte(Buffer *buf, u8 byte) {
   bufferSetMinCapacity(buf, buf->length + 1);
   buf->data[buf->length++] = byte;
@@ -70,6 +77,7 @@ void initBuffer(Buffer *buf) {
   buf->length = buf->capacity = 0;
   buf->byteOrder = MTOTS_LITTLE_ENDIAN;
   buf->isLocked = UFALSE;
+  buf->isReadOnly = UFALSE;
   buf->ownsData = UTRUE;
 }
 
@@ -78,6 +86,7 @@ void initBufferWithExternalData(Buffer *buf, u8 *data, size_t length) {
   buf->length = buf->capacity = length;
   buf->byteOrder = MTOTS_LITTLE_ENDIAN;
   buf->isLocked = UTRUE;
+  buf->isReadOnly = UFALSE;
   buf->ownsData = UFALSE;
 }
 
@@ -85,6 +94,18 @@ void bufferLock(Buffer *buf) {
   buf->isLocked = UTRUE;
 }
 
+void bufferLockReadOnly(Buffer *buf) {
+  buf->isLocked = UTRUE;
+  buf->isReadOnly = UTRUE;
+}
+
+Status bufferCheckWritable(Buffer *buf) {
+  if (buf->isReadOnly) {
+    return runtimeError("Buffer is read only");
+  }
+  return STATUS_OK;
+}
+
 /* Tries to reserve the given capacity in the buffer.
  * Panics if there is not enough memory */
 void bufferSetMinCapacity(Buffer *buf, size_t minCap) {
@@ -101,6 +122,7 @@ void bufferSetMinCapacity(Buffer *buf, size_t minCap) {
     if (data == NULL) {
       panic("Buffer: out of memory");
     }
+    trackExternalAllocation(EXTERNAL_MEMORY_BUFFER, newCap - buf->capacity);
     buf->data = data;
     buf->capacity = newCap;
   }
@@ -109,6 +131,7 @@ void bufferSetMinCapacity(Buffer *buf, size_t minCap) {
 void bufferSetLength(Buffer *buf, size_t newLength) {
   size_t oldLength = buf->length;
   if (oldLength < newLength) {
+    checkNotReadOnly(buf);
     bufferSetMinCapacity(buf, newLength);
     memset(buf->data + oldLength, 0, newLength - oldLength);
   }
@@ -126,6 +149,7 @@ String *bufferToString(Buffer *buf) {
 void freeBuffer(Buffer *buf) {
   if (buf->ownsData) {
     free(buf->data);
+    trackExternalFree(EXTERNAL_MEMORY_BUFFER, buf->capacity);
   }
 }
 
@@ -208,6 +232,7 @@ void bufferSetF64(Buffer *buf, size_t pos, f64 value) {
 }
 
 void bufferSetBytes(Buffer *buf, size_t pos, void *data, size_t length) {
+  checkNotReadOnly(buf);
   checkIndex(buf, pos, length);
   memcpy((void *)(buf->data + pos), data, length);
 }
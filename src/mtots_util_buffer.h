@@ -25,6 +25,13 @@ typedef struct Buffer {
    */
   ubool isLocked;
 
+  /**
+   * When a Buffer is read only, its contents may not be modified
+   * (e.g. the memory is a read only file mapping).
+   * A read only Buffer is always also locked.
+   */
+  ubool isReadOnly;
+
   /**
    * If true, when this Buffer is freed, its data field will also be freed.
    * Otherwise, it is up to the caller who initialized the Buffer to ensure
@@ -37,6 +44,10 @@ void initBuffer(Buffer *buf);
 void initBufferWithExternalData(Buffer *buf, u8 *data, size_t length);
 void freeBuffer(Buffer *buf);
 void bufferLock(Buffer *buf);
+void bufferLockReadOnly(Buffer *buf);
+
+/* Fails with a runtime error if the Buffer is read only */
+Status bufferCheckWritable(Buffer *buf);
 void bufferSetMinCapacity(Buffer *buf, size_t minCap);
 void bufferSetLength(Buffer *buf, size_t newLength);
 void bufferClear(Buffer *buf);
@@ -0,0 +1,198 @@
+#include "mtots_util_convert.h"
+
+#include <math.h>
+#include <string.h>
+
+/* X(name, ctype, lowest, exclusive upper bound, highest, kind)
+ * The bounds are exact as doubles. Two copies are needed because
+ * a macro cannot expand itself when the lists are nested */
+#define SCALAR_TYPES_DST(X, SN, ST, SKIND)                                  \
+  X(SN, ST, SKIND, I8, i8, -128.0, 128.0, I8_MAX, INT)                      \
+  X(SN, ST, SKIND, U8, u8, 0.0, 256.0, U8_MAX, INT)                         \
+  X(SN, ST, SKIND, I16, i16, -32768.0, 32768.0, I16_MAX, INT)               \
+  X(SN, ST, SKIND, U16, u16, 0.0, 65536.0, U16_MAX, INT)                    \
+  X(SN, ST, SKIND, I32, i32, -2147483648.0, 2147483648.0, I32_MAX, INT)     \
+  X(SN, ST, SKIND, U32, u32, 0.0, 4294967296.0, U32_MAX, INT)               \
+  X(SN, ST, SKIND, I64, i64, -9223372036854775808.0, 9223372036854775808.0, \
+    I64_MAX, INT)                                                           \
+  X(SN, ST, SKIND, U64, u64, 0.0, 18446744073709551616.0, U64_MAX, INT)     \
+  X(SN, ST, SKIND, F32, float, 0, 0, 0, FLOAT)                              \
+  X(SN, ST, SKIND, F64, double, 0, 0, 0, FLOAT)
+
+#define SCALAR_TYPES_SRC(X) \
+  X(I8, i8, INT)            \
+  X(U8, u8, INT)            \
+  X(I16, i16, INT)          \
+  X(U16, u16, INT)          \
+  X(I32, i32, INT)          \
+  X(U32, u32, INT)          \
+  X(I64, i64, INT)          \
+  X(U64, u64, INT)          \
+  X(F32, float, FLOAT)      \
+  X(F64, double, FLOAT)
+
+typedef void (*ConvertFunction)(
+    void *dst, const void *src, size_t count,
+    double scale, double bias, ubool direct);
+
+typedef struct ScalarTypeInfo {
+  size_t size;
+  ubool isFloat;
+  double lowest;
+  double upperBound; /* exclusive */
+} ScalarTypeInfo;
+
+static const ScalarTypeInfo scalarTypeInfos[] = {
+    {1, UFALSE, -128.0, 128.0},
+    {1, UFALSE, 0.0, 256.0},
+    {2, UFALSE, -32768.0, 32768.0},
+    {2, UFALSE, 0.0, 65536.0},
+    {4, UFALSE, -2147483648.0, 2147483648.0},
+    {4, UFALSE, 0.0, 4294967296.0},
+    {8, UFALSE, -9223372036854775808.0, 9223372036854775808.0},
+    {8, UFALSE, 0.0, 18446744073709551616.0},
+    {4, UTRUE, 0, 0},
+    {8, UTRUE, 0, 0},
+};
+
+#define STORE_INT(DT, LO, HI, MAX)                 \
+  do {                                             \
+    double r_ = x < 0 ? -floor(0.5 - x) : floor(x + 0.5); \
+    d[i] = r_ >= (HI)   ? (DT)(MAX)                \
+           : r_ >= (LO) ? (DT)r_                   \
+           : r_ < (LO)  ? (DT)(LO)                 \
+                        : (DT)0; /* NaN */         \
+  } while (0)
+
+#define STORE_FLOAT(DT, LO, HI, MAX) d[i] = (DT)x
+
+#define DEFINE_CONVERT(SN, ST, SKIND, DN, DT, LO, HI, MAX, DKIND)     \
+  static void convert##SN##To##DN(                                   \
+      void *dst, const void *src, size_t count,                      \
+      double scale, double bias, ubool direct) {                     \
+    DT *d = (DT *)dst;                                               \
+    const ST *s = (const ST *)src;                                   \
+    size_t i;                                                        \
+    if (direct) {                                                    \
+      for (i = 0; i < count; i++) {                                  \
+        d[i] = (DT)s[i];                                             \
+      }                                                              \
+    } else if (scale == 1 && bias == 0) {                            \
+      for (i = 0; i < count; i++) {                                  \
+        double x = (double)s[i];                                     \
+        STORE_##DKIND(DT, LO, HI, MAX);                              \
+      }                                                              \
+    } else {                                                         \
+      for (i = 0; i < count; i++) {                                  \
+        double x = (double)s[i] * scale + bias;                      \
+        STORE_##DKIND(DT, LO, HI, MAX);                              \
+      }                                                              \
+    }                                                                \
+  }
+
+#define DEFINE_CONVERTS_FROM(SN, ST, SKIND) \
+  SCALAR_TYPES_DST(DEFINE_CONVERT, SN, ST, SKIND)
+
+SCALAR_TYPES_SRC(DEFINE_CONVERTS_FROM)
+
+#define CONVERT_ENTRY(SN, ST, SKIND, DN, DT, LO, HI, MAX, DKIND) \
+  convert##SN##To##DN,
+
+#define CONVERT_ROW(SN, ST, SKIND) \
+  {SCALAR_TYPES_DST(CONVERT_ENTRY, SN, ST, SKIND)},
+
+static const ConvertFunction convertTable[SCALAR_TYPE_COUNT][SCALAR_TYPE_COUNT] = {
+    SCALAR_TYPES_SRC(CONVERT_ROW)};
+
+/* Misaligned arrays are converted through these aligned buffers,
+ * this many items at a time */
+#define CONVERT_CHUNK_SIZE 256
+
+#define IS_ALIGNED(pointer, size) (((size_t)(pointer)) % (size) == 0)
+
+size_t getScalarTypeSize(ScalarType type) {
+  return scalarTypeInfos[type].size;
+}
+
+void convertScalars(
+    void *dst, ScalarType dstType,
+    const void *src, ScalarType srcType,
+    size_t count, double scale, double bias) {
+  const ScalarTypeInfo *d = &scalarTypeInfos[dstType];
+  const ScalarTypeInfo *s = &scalarTypeInfos[srcType];
+  ubool direct = UFALSE, backward;
+  if (scale == 1 && bias == 0) {
+    if (dstType == srcType) {
+      memmove(dst, src, count * d->size);
+      return;
+    }
+    /* Conversions that can't go out of range are plain casts */
+    direct = d->isFloat ||
+             (!s->isFloat && d->lowest <= s->lowest &&
+              s->upperBound <= d->upperBound);
+  }
+  /* Widening in place would overwrite items before they are read,
+   * so it goes through the buffers starting from the last chunk */
+  backward = dst == src && d->size > s->size;
+  if (backward || !IS_ALIGNED(dst, d->size) || !IS_ALIGNED(src, s->size)) {
+    u64 dstChunk[CONVERT_CHUNK_SIZE], srcChunk[CONVERT_CHUNK_SIZE];
+    size_t done, start, n;
+    for (done = 0; done < count; done += n) {
+      n = count - done < CONVERT_CHUNK_SIZE ? count - done : CONVERT_CHUNK_SIZE;
+      start = backward ? count - done - n : done;
+      memcpy(srcChunk, (const u8 *)src + start * s->size, n * s->size);
+      convertTable[srcType][dstType](dstChunk, srcChunk, n, scale, bias, direct);
+      memcpy((u8 *)dst + start * d->size, dstChunk, n * d->size);
+    }
+    return;
+  }
+  convertTable[srcType][dstType](dst, src, count, scale, bias, direct);
+}
+
+#define DEFINE_STRIDED_LOOP(T, dstIndex, srcIndex) \
+  {                                                \
+    T *d = (T *)dst;                               \
+    const T *s = (const T *)src;                   \
+    for (i = 0; i < count; i++) {                  \
+      d[dstIndex] = s[srcIndex];                   \
+    }                                              \
+  }                                                \
+  return
+
+/* The typed loops are only used when both arrays are aligned for the
+ * item type, anything else is copied with memcpy */
+#define STRIDED_COPY(dstIndex, srcIndex)                               \
+  do {                                                                 \
+    size_t i;                                                          \
+    switch (itemSize > 0 && IS_ALIGNED(dst, itemSize) &&              \
+            IS_ALIGNED(src, itemSize)                                  \
+                ? itemSize                                             \
+                : 0) {                                                 \
+      case 1:                                                          \
+        DEFINE_STRIDED_LOOP(u8, dstIndex, srcIndex);                   \
+      case 2:                                                          \
+        DEFINE_STRIDED_LOOP(u16, dstIndex, srcIndex);                  \
+      case 4:                                                          \
+        DEFINE_STRIDED_LOOP(u32, dstIndex, srcIndex);                  \
+      case 8:                                                          \
+        DEFINE_STRIDED_LOOP(u64, dstIndex, srcIndex);                  \
+    }                                                                  \
+    for (i = 0; i < count; i++) {                                      \
+      memcpy(                                                          \
+          (u8 *)dst + (dstIndex) * itemSize,                           \
+          (const u8 *)src + (srcIndex) * itemSize,                     \
+          itemSize);                                                   \
+    }                                                                  \
+  } while (0)
+
+void gatherItems(
+    void *dst, const void *src, size_t itemSize,
+    size_t count, size_t srcStride) {
+  STRIDED_COPY(i, i * srcStride);
+}
+
+void scatterItems(
+    void *dst, const void *src, size_t itemSize,
+    size_t count, size_t dstStride) {
+  STRIDED_COPY(i * dstStride, i);
+}
@@ -0,0 +1,55 @@
+#ifndef mtots_util_convert_h
+#define mtots_util_convert_h
+
+#include "mtots_common.h"
+
+/* Bulk conversion between arrays of fixed size numeric types.
+ * Each source/destination pair gets its own specialized loop */
+
+typedef enum ScalarType {
+  SCALAR_I8,
+  SCALAR_U8,
+  SCALAR_I16,
+  SCALAR_U16,
+  SCALAR_I32,
+  SCALAR_U32,
+  SCALAR_I64,
+  SCALAR_U64,
+  SCALAR_F32,
+  SCALAR_F64,
+  SCALAR_TYPE_COUNT
+} ScalarType;
+
+size_t getScalarTypeSize(ScalarType type);
+
+/* Computes `dst[i] = src[i] * scale + bias` for each of the 'count' items.
+ * Values stored into integer types are rounded to the nearest integer
+ * (halfway cases away from zero) and clamped to the range of the type.
+ * NaN becomes 0.
+ *
+ * When scale is 1 and bias is 0, conversions that cannot lose
+ * information are plain casts and copies of the same type are a memmove.
+ * Otherwise values pass through a double, so 64-bit integers beyond
+ * 2^53 may lose precision.
+ *
+ * 'dst' and 'src' may only overlap if they are the same address,
+ * in which case the types may have different sizes.
+ * They need not be aligned for their types */
+void convertScalars(
+    void *dst, ScalarType dstType,
+    const void *src, ScalarType srcType,
+    size_t count, double scale, double bias);
+
+/* dst[i] = src[i * srcStride] for 'count' items of 'itemSize' bytes each.
+ * The stride is in items. 'dst' and 'src' need not be aligned */
+void gatherItems(
+    void *dst, const void *src, size_t itemSize,
+    size_t count, size_t srcStride);
+
+/* dst[i * dstStride] = src[i] for 'count' items of 'itemSize' bytes each.
+ * The stride is in items. 'dst' and 'src' need not be aligned */
+void scatterItems(
+    void *dst, const void *src, size_t itemSize,
+    size_t count, size_t dstStride);
+
+#endif /*mtots_util_convert_h*/
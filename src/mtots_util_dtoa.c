@@ -0,0 +1,421 @@
+#include "mtots_util_dtoa.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Grisu2, as described in "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers" by Florian Loitsch, following the layout
+ * of Milo Yip's implementation in RapidJSON.
+ *
+ * The output always reads back as the same double, and is the shortest
+ * such output for all but a tiny fraction of inputs */
+
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_MIN_EXPONENT (-DP_EXPONENT_BIAS)
+#define DP_EXPONENT_MASK (((u64)0x7FF) << DP_SIGNIFICAND_SIZE)
+#define DP_SIGNIFICAND_MASK ((((u64)1) << DP_SIGNIFICAND_SIZE) - 1)
+#define DP_HIDDEN_BIT (((u64)1) << DP_SIGNIFICAND_SIZE)
+#define FP_SIGNIFICAND_SIZE 23
+#define FP_EXPONENT_BIAS (0x7F + FP_SIGNIFICAND_SIZE)
+#define FP_HIDDEN_BIT (((u32)1) << FP_SIGNIFICAND_SIZE)
+
+typedef struct DiyFp {
+  u64 f;
+  int e;
+} DiyFp;
+
+/* Normalized powers of ten 10^-348, 10^-340, ..., 10^340 */
+static const u64 cachedPowersF[] = {
+    0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76,
+    0xcf42894a5dce35ea, 0x9a6bb0aa55653b2d, 0xe61acf033d1a45df,
+    0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f, 0xbe5691ef416bd60c,
+    0x8dd01fad907ffc3c, 0xd3515c2831559a83, 0x9d71ac8fada6c9b5,
+    0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57,
+    0xc21094364dfb5637, 0x9096ea6f3848984f, 0xd77485cb25823ac7,
+    0xa086cfcd97bf97f4, 0xef340a98172aace5, 0xb23867fb2a35b28e,
+    0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996,
+    0xdbac6c247d62a584, 0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126,
+    0xb5b5ada8aaff80b8, 0x87625f056c7c4a8b, 0xc9bcff6034c13053,
+    0x964e858c91ba2655, 0xdff9772470297ebd, 0xa6dfbd9fb8e5b88f,
+    0xf8a95fcf88747d94, 0xb94470938fa89bcf, 0x8a08f0f8bf0f156b,
+    0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06,
+    0xaa242499697392d3, 0xfd87b5f28300ca0e, 0xbce5086492111aeb,
+    0x8cbccc096f5088cc, 0xd1b71758e219652c, 0x9c40000000000000,
+    0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984,
+    0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70, 0xd5d238a4abe98068,
+    0x9f4f2726179a2245, 0xed63a231d4c4fb27, 0xb0de65388cc8ada8,
+    0x83c7088e1aab65db, 0xc45d1df942711d9a, 0x924d692ca61be758,
+    0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+    0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d,
+    0x952ab45cfa97a0b3, 0xde469fbd99a05fe3, 0xa59bc234db398c25,
+    0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece, 0x88fcf317f22241e2,
+    0xcc20ce9bd35c78a5, 0x98165af37b2153df, 0xe2a0b5dc971f303a,
+    0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410,
+    0x8bab8eefb6409c1a, 0xd01fef10a657842c, 0x9b10a4e5e9913129,
+    0xe7109bfba19c0c9d, 0xac2820d9623bf429, 0x80444b5e7aa7cf85,
+    0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841,
+    0x9e19db92b4e31ba9, 0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b,
+};
+
+static const i16 cachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static const u32 pow10s[] = {
+    1, 10, 100, 1000, 10000, 100000,
+    1000000, 10000000, 100000000, 1000000000};
+
+static const u64 pow10s64[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000, 10000000000, 100000000000, 1000000000000, 10000000000000,
+    100000000000000, 1000000000000000, 10000000000000000,
+    100000000000000000, 1000000000000000000, 10000000000000000000U};
+
+static u64 doubleToBits(double value) {
+  u64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static DiyFp newDiyFp(u64 f, int e) {
+  DiyFp fp;
+  fp.f = f;
+  fp.e = e;
+  return fp;
+}
+
+static DiyFp diyFpFromFloat(float value) {
+  u32 bits;
+  int biasedE;
+  u32 significand;
+  memcpy(&bits, &value, sizeof(bits));
+  biasedE = (int)((bits >> FP_SIGNIFICAND_SIZE) & 0xFF);
+  significand = bits & (FP_HIDDEN_BIT - 1);
+  return biasedE != 0 ?
+      newDiyFp(significand + FP_HIDDEN_BIT, biasedE - FP_EXPONENT_BIAS) :
+      newDiyFp(significand, 1 - FP_EXPONENT_BIAS);
+}
+
+static DiyFp diyFpFromDouble(double value) {
+  u64 bits = doubleToBits(value);
+  int biasedE = (int)((bits & DP_EXPONENT_MASK) >> DP_SIGNIFICAND_SIZE);
+  u64 significand = bits & DP_SIGNIFICAND_MASK;
+  return biasedE != 0 ?
+      newDiyFp(significand + DP_HIDDEN_BIT, biasedE - DP_EXPONENT_BIAS) :
+      newDiyFp(significand, DP_MIN_EXPONENT + 1);
+}
+
+/* Upper 64 bits of the 128-bit product, rounded */
+static DiyFp diyFpMultiply(DiyFp x, DiyFp y) {
+  const u64 m32 = 0xFFFFFFFF;
+  u64 a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+  u64 ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+  u64 tmp = (bd >> 32) + (ad & m32) + (bc & m32);
+  tmp += ((u64)1) << 31;
+  return newDiyFp(
+      ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+
+static DiyFp diyFpNormalize(DiyFp fp) {
+  while (!(fp.f & (((u64)1) << 63))) {
+    fp.f <<= 1;
+    fp.e--;
+  }
+  return fp;
+}
+
+/* The boundaries halfway to the neighbouring values of 'v', which
+ * has 'hiddenBit' set unless it is subnormal */
+static void diyFpNormalizedBoundaries(
+    DiyFp v, u64 hiddenBit, DiyFp *minus, DiyFp *plus) {
+  DiyFp pl = diyFpNormalize(newDiyFp((v.f << 1) + 1, v.e - 1));
+  DiyFp mi = v.f == hiddenBit ?
+      newDiyFp((v.f << 2) - 1, v.e - 2) :
+      newDiyFp((v.f << 1) - 1, v.e - 1);
+  mi.f <<= mi.e - pl.e;
+  mi.e = pl.e;
+  *plus = pl;
+  *minus = mi;
+}
+
+static DiyFp getCachedPower(int e, int *K) {
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int k = (int)dk;
+  size_t index;
+  if (dk - k > 0.0) {
+    k++;
+  }
+  index = (size_t)((k >> 3) + 1);
+  *K = -(-348 + (int)(index << 3));
+  return newDiyFp(cachedPowersF[index], cachedPowersE[index]);
+}
+
+static void grisuRound(
+    char *buffer, int len, u64 delta, u64 rest, u64 tenKappa, u64 wpw) {
+  while (rest < wpw && delta - rest >= tenKappa &&
+         (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+    buffer[len - 1]--;
+    rest += tenKappa;
+  }
+}
+
+static int countDecimalDigits(u32 n) {
+  int count = 1;
+  while (count < 10 && n >= pow10s[count]) {
+    count++;
+  }
+  return count;
+}
+
+static void digitGen(DiyFp w, DiyFp mp, u64 delta, char *buffer, int *len, int *K) {
+  DiyFp one = newDiyFp(((u64)1) << -mp.e, mp.e);
+  u64 wpw = mp.f - w.f;
+  u32 p1 = (u32)(mp.f >> -one.e);
+  u64 p2 = mp.f & (one.f - 1);
+  int kappa = countDecimalDigits(p1);
+  *len = 0;
+
+  while (kappa > 0) {
+    u32 d = p1 / pow10s[kappa - 1];
+    u64 tmp;
+    p1 %= pow10s[kappa - 1];
+    if (d || *len) {
+      buffer[(*len)++] = (char)('0' + d);
+    }
+    kappa--;
+    tmp = (((u64)p1) << -one.e) + p2;
+    if (tmp <= delta) {
+      *K += kappa;
+      grisuRound(
+          buffer, *len, delta, tmp, ((u64)pow10s[kappa]) << -one.e, wpw);
+      return;
+    }
+  }
+
+  for (;;) {
+    char d;
+    p2 *= 10;
+    delta *= 10;
+    d = (char)(p2 >> -one.e);
+    if (d || *len) {
+      buffer[(*len)++] = (char)('0' + d);
+    }
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *K += kappa;
+      grisuRound(
+          buffer, *len, delta, p2, one.f,
+          -kappa < 20 ? wpw * pow10s64[-kappa] : 0);
+      return;
+    }
+  }
+}
+
+/* Writes the digits of a positive, finite value 'v' into 'buffer', so that
+ * v ~= buffer * 10^K */
+static void grisu2(DiyFp v, u64 hiddenBit, char *buffer, int *length, int *K) {
+  DiyFp wm, wp, cmk, w, mp, mm;
+  diyFpNormalizedBoundaries(v, hiddenBit, &wm, &wp);
+  cmk = getCachedPower(wp.e, K);
+  w = diyFpMultiply(diyFpNormalize(v), cmk);
+  mp = diyFpMultiply(wp, cmk);
+  mm = diyFpMultiply(wm, cmk);
+  mm.f++;
+  mp.f--;
+  digitGen(w, mp, mp.f - mm.f, buffer, length, K);
+}
+
+static size_t writeUnsigned(char *out, u64 value) {
+  char digits[20];
+  size_t count = 0, i;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value);
+  for (i = 0; i < count; i++) {
+    out[i] = digits[count - 1 - i];
+  }
+  return count;
+}
+
+/* Lays out 'length' digits with the decimal point at 'point',
+ * i.e. the value is 0.DIGITS * 10^point */
+static size_t layoutDigits(char *out, const char *digits, int length, int point) {
+  size_t n = 0;
+  int i;
+  if (length <= point && point <= 21) {
+    memcpy(out, digits, length);
+    n = length;
+    for (i = length; i < point; i++) {
+      out[n++] = '0';
+    }
+  } else if (0 < point && point <= 21) {
+    memcpy(out, digits, point);
+    n = point;
+    out[n++] = '.';
+    memcpy(out + n, digits + point, length - point);
+    n += length - point;
+  } else if (-6 < point && point <= 0) {
+    out[n++] = '0';
+    out[n++] = '.';
+    for (i = point; i < 0; i++) {
+      out[n++] = '0';
+    }
+    memcpy(out + n, digits, length);
+    n += length;
+  } else {
+    int exponent = point - 1;
+    out[n++] = digits[0];
+    if (length > 1) {
+      out[n++] = '.';
+      memcpy(out + n, digits + 1, length - 1);
+      n += length - 1;
+    }
+    out[n++] = 'e';
+    out[n++] = exponent < 0 ? '-' : '+';
+    n += writeUnsigned(out + n, (u64)(exponent < 0 ? -exponent : exponent));
+  }
+  return n;
+}
+
+static size_t formatNumber(double value, ubool single, char *out) {
+  size_t n = 0;
+  char digits[20];
+  int length, K;
+  if (value != value) {
+    strcpy(out, "nan");
+    return 3;
+  }
+  if (doubleToBits(value) >> 63) {
+    out[n++] = '-';
+    value = -value;
+  }
+  if (value > DBL_MAX) {
+    strcpy(out + n, "inf");
+    return n + 3;
+  }
+  if (value < (single ? 16777216.0 : 9007199254740992.0) &&
+      value == (double)(u64)value) {
+    /* Integers that are exactly representable, including zero,
+     * need no digit generation */
+    n += writeUnsigned(out + n, (u64)value);
+  } else {
+    if (single) {
+      grisu2(diyFpFromFloat((float)value), FP_HIDDEN_BIT, digits, &length, &K);
+    } else {
+      grisu2(diyFpFromDouble(value), DP_HIDDEN_BIT, digits, &length, &K);
+    }
+    n += layoutDigits(out + n, digits, length, length + K);
+  }
+  out[n] = '\0';
+  return n;
+}
+
+size_t formatDouble(double value, char *out) {
+  return formatNumber(value, UFALSE, out);
+}
+
+size_t formatFloat(float value, char *out) {
+  return formatNumber(value, UTRUE, out);
+}
+
+/* Exactly representable powers of ten */
+static const double exactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+#define isDigit(c) ((c) >= '0' && (c) <= '9')
+
+double parseDouble(const char *chars, const char **end) {
+  const char *p = chars;
+  ubool negative = UFALSE, exponentNegative = UFALSE;
+  u64 mantissa = 0;
+  int digitCount = 0, exponent = 0, explicitExponent = 0;
+  double result;
+
+  if (*p == '-' || *p == '+') {
+    negative = *p++ == '-';
+  }
+  if (!isDigit(*p) && !(*p == '.' && isDigit(p[1]))) {
+    goto fallback; /* inf, nan, leading whitespace, or not a number */
+  }
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+    goto fallback; /* hexadecimal */
+  }
+  for (; isDigit(*p); p++) {
+    if (digitCount < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa) {
+        digitCount++;
+      }
+    } else {
+      goto fallback;
+    }
+  }
+  if (*p == '.') {
+    for (p++; isDigit(*p); p++) {
+      if (digitCount < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa) {
+          digitCount++;
+        }
+        exponent--;
+      } else if (*p != '0') {
+        goto fallback;
+      }
+    }
+  }
+  if ((*p == 'e' || *p == 'E') &&
+      (isDigit(p[1]) ||
+       ((p[1] == '-' || p[1] == '+') && isDigit(p[2])))) {
+    p++;
+    if (*p == '-' || *p == '+') {
+      exponentNegative = *p++ == '-';
+    }
+    for (; isDigit(*p); p++) {
+      if (explicitExponent < 100000) {
+        explicitExponent = explicitExponent * 10 + (*p - '0');
+      }
+    }
+    exponent += exponentNegative ? -explicitExponent : explicitExponent;
+  }
+
+  /* Clinger's fast path: when both the mantissa and the power of ten
+   * are exactly representable, a single multiply or divide is
+   * correctly rounded */
+  if (mantissa == 0) {
+    result = 0;
+  } else if (mantissa <= (((u64)1) << 53) && -22 <= exponent && exponent <= 22) {
+    result = (double)mantissa;
+    result = exponent < 0 ?
+        result / exactPowersOfTen[-exponent] :
+        result * exactPowersOfTen[exponent];
+  } else {
+    goto fallback;
+  }
+  if (end) {
+    *end = p;
+  }
+  return negative ? -result : result;
+
+fallback:
+  {
+    char *fallbackEnd;
+    result = strtod(chars, &fallbackEnd);
+    if (end) {
+      *end = fallbackEnd;
+    }
+    return result;
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef mtots_util_dtoa_h
+#define mtots_util_dtoa_h
+
+#include "mtots_common.h"
+
+/* Conversions between doubles and their decimal representations */
+
+/* Large enough for any output of formatDouble, including the '\0' */
+#define FORMAT_DOUBLE_BUFFER_SIZE 32
+
+/* Writes the shortest decimal string that reads back as 'value'.
+ *
+ * Integers below 2^53 are written without a fraction or exponent.
+ * Otherwise the notation matches JavaScript's Number.prototype.toString:
+ * plain decimals are used when the decimal point falls within 21 digits
+ * of the first digit, and exponential notation (e.g. 1e+21, 1.5e-7)
+ * otherwise. NaN and infinities are written as 'nan', 'inf' and '-inf'.
+ *
+ * Returns the length of the string written to 'out', not counting
+ * the terminating '\0' */
+size_t formatDouble(double value, char *out);
+
+/* Like formatDouble, but writes the shortest string that reads
+ * back as 'value' when rounded to a float */
+size_t formatFloat(float value, char *out);
+
+/* Parses a double like strtod, but handles the common case of a decimal
+ * with at most 19 significant digits and a small exponent without
+ * going through strtod. 'end' may be NULL */
+double parseDouble(const char *chars, const char **end);
+
+#endif /*mtots_util_dtoa_h*/
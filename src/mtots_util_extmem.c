@@ -0,0 +1,39 @@
+#include "mtots_util_extmem.h"
+
+#include "mtots_util_error.h"
+
+static size_t categoryTotals[EXTERNAL_MEMORY_CATEGORY_COUNT];
+static size_t total;
+
+static const char *categoryNames[EXTERNAL_MEMORY_CATEGORY_COUNT] = {
+    "buffer",
+    "stringBuilder",
+    "native",
+};
+
+void trackExternalAllocation(ExternalMemoryCategory category, size_t size) {
+  categoryTotals[category] += size;
+  total += size;
+}
+
+void trackExternalFree(ExternalMemoryCategory category, size_t size) {
+  if (categoryTotals[category] < size) {
+    panic(
+        "trackExternalFree: freeing more %s memory than was allocated",
+        categoryNames[category]);
+  }
+  categoryTotals[category] -= size;
+  total -= size;
+}
+
+size_t getExternalMemoryUsage(ExternalMemoryCategory category) {
+  return categoryTotals[category];
+}
+
+size_t getExternalMemoryTotal(void) {
+  return total;
+}
+
+const char *getExternalMemoryCategoryName(ExternalMemoryCategory category) {
+  return categoryNames[category];
+}
@@ -0,0 +1,37 @@
+#ifndef mtots_util_extmem_h
+#define mtots_util_extmem_h
+
+#include "mtots_common.h"
+
+/* Accounting for memory that is allocated outside of 'reallocate'
+ * (e.g. Buffer and StringBuilder storage, or memory owned by a
+ * C library on behalf of a native object).
+ *
+ * The totals are included when deciding whether to run the garbage
+ * collector, so objects that hold on to large external allocations
+ * still cause collections to happen.
+ *
+ * These counters are not synchronized and should only be updated
+ * from the thread running the VM. */
+
+typedef enum ExternalMemoryCategory {
+  EXTERNAL_MEMORY_BUFFER,
+  EXTERNAL_MEMORY_STRING_BUILDER,
+  EXTERNAL_MEMORY_NATIVE,
+  EXTERNAL_MEMORY_CATEGORY_COUNT
+} ExternalMemoryCategory;
+
+/* Record that 'size' bytes were allocated outside of 'reallocate' */
+void trackExternalAllocation(ExternalMemoryCategory category, size_t size);
+
+/* Record that 'size' bytes previously passed to
+ * 'trackExternalAllocation' were freed */
+void trackExternalFree(ExternalMemoryCategory category, size_t size);
+
+size_t getExternalMemoryUsage(ExternalMemoryCategory category);
+size_t getExternalMemoryTotal(void);
+
+/* Short camelCase name of the category, as reported by 'sys' */
+const char *getExternalMemoryCategoryName(ExternalMemoryCategory category);
+
+#endif /*mtots_util_extmem_h*/
@@ -1,5 +1,6 @@
 #include "mtots_util_fd.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "mtots_util_error.h"
@@ -12,213 +13,422 @@
 #include <unistd.h>
 #endif
 
-#define MAX_NJOBS 8
-#define MAX_NFDS 8
+#if MTOTS_IS_LINUX
+#include <sys/epoll.h>
+#endif
+
 #define MIN_READ_SIZE 4096
+#define INITIAL_READY_CAPACITY 64
 
-Status MTOTSRunFDJobs(MTOTSFDJob *jobs, size_t njobs) {
 #if MTOTS_IS_POSIX
-  struct pollfd pfds[MAX_NJOBS];
-  size_t i, finished = 0;
-  if (njobs > MAX_NJOBS) {
-    runtimeError("Too many file descriptors njobs = %lu, MAX_NJOBS = %d",
-                 (unsigned long)njobs, MAX_NJOBS);
+
+static void *reallocOrPanic(void *ptr, size_t size) {
+  void *result = realloc(ptr, size);
+  if (!result && size) {
+    panic("out of memory");
+  }
+  return result;
+}
+
+static short toPollEvents(int events) {
+  return (events & MTOTS_POLL_IN ? POLLIN : 0) |
+         (events & MTOTS_POLL_OUT ? POLLOUT : 0);
+}
+
+static int fromPollEvents(short revents) {
+  return (revents & (POLLIN | POLLPRI) ? MTOTS_POLL_IN : 0) |
+         (revents & POLLOUT ? MTOTS_POLL_OUT : 0) |
+         (revents & (POLLERR | POLLHUP | POLLNVAL) ? MTOTS_POLL_ERR : 0);
+}
+
+#if MTOTS_IS_LINUX
+static u32 toEpollEvents(int events) {
+  return (events & MTOTS_POLL_IN ? EPOLLIN : 0) |
+         (events & MTOTS_POLL_OUT ? EPOLLOUT : 0);
+}
+
+static int fromEpollEvents(u32 events) {
+  return (events & (EPOLLIN | EPOLLPRI) ? MTOTS_POLL_IN : 0) |
+         (events & EPOLLOUT ? MTOTS_POLL_OUT : 0) |
+         (events & (EPOLLERR | EPOLLHUP) ? MTOTS_POLL_ERR : 0);
+}
+#endif
+
+static void reserveReady(MTOTSPoller *poller, size_t minCapacity) {
+  if (poller->readyCapacity < minCapacity) {
+    size_t newCapacity = poller->readyCapacity ? poller->readyCapacity : INITIAL_READY_CAPACITY;
+    while (newCapacity < minCapacity) {
+      newCapacity *= 2;
+    }
+    poller->ready = (MTOTSPollEvent *)reallocOrPanic(
+        poller->ready, sizeof(MTOTSPollEvent) * newCapacity);
+#if MTOTS_IS_LINUX
+    poller->epollEvents = reallocOrPanic(
+        poller->epollEvents, sizeof(struct epoll_event) * newCapacity);
+#endif
+    poller->readyCapacity = newCapacity;
+  }
+}
+
+#endif
+
+Status MTOTSPollerInit(MTOTSPoller *poller) {
+  memset(poller, 0, sizeof(*poller));
+  poller->epollFD = -1;
+#if MTOTS_IS_POSIX
+#if MTOTS_IS_LINUX
+  poller->epollFD = epoll_create1(EPOLL_CLOEXEC);
+  if (poller->epollFD < 0) {
+    return runtimeError("epoll_create1(): %s", strerror(errno));
+  }
+#endif
+  reserveReady(poller, INITIAL_READY_CAPACITY);
+  return STATUS_OK;
+#else
+  return runtimeError("Operation not supported on this platform (MTOTSPollerInit)");
+#endif
+}
+
+void MTOTSPollerFree(MTOTSPoller *poller) {
+#if MTOTS_IS_POSIX
+  if (poller->epollFD >= 0) {
+    close(poller->epollFD);
+  }
+#endif
+  free(poller->entries);
+  free(poller->slots);
+  free(poller->epollEvents);
+  free(poller->ready);
+  memset(poller, 0, sizeof(*poller));
+  poller->epollFD = -1;
+}
+
+#if MTOTS_IS_POSIX && MTOTS_IS_LINUX
+/* Switch over to poll(). All registered file descriptors are
+ * already in 'entries', so there is nothing else to migrate */
+static void fallBackToPoll(MTOTSPoller *poller) {
+  close(poller->epollFD);
+  poller->epollFD = -1;
+}
+
+static Status epollSet(MTOTSPoller *poller, int fd, int events, ubool isNew) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = toEpollEvents(events);
+  event.data.fd = fd;
+  if (events == 0) {
+    /* The fd may already be closed, which removes it from the epoll set */
+    if (epoll_ctl(poller->epollFD, EPOLL_CTL_DEL, fd, &event) < 0 &&
+        errno != EBADF && errno != ENOENT) {
+      return runtimeError("epoll_ctl(%d, DEL): %s", fd, strerror(errno));
+    }
+    return STATUS_OK;
+  }
+  if (epoll_ctl(poller->epollFD, isNew ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event) < 0) {
+    if (errno == EPERM) {
+      /* epoll does not support this kind of file (e.g. regular files) */
+      fallBackToPoll(poller);
+      return STATUS_OK;
+    }
+    return runtimeError("epoll_ctl(%d): %s", fd, strerror(errno));
+  }
+  return STATUS_OK;
+}
+#endif
+
+Status MTOTSPollerSet(MTOTSPoller *poller, int fd, int events) {
+#if MTOTS_IS_POSIX
+  struct pollfd *entries;
+  int slot;
+  if (fd < 0) {
+    return runtimeError("MTOTSPollerSet(): invalid file descriptor %d", fd);
+  }
+  events &= MTOTS_POLL_IN | MTOTS_POLL_OUT;
+  if ((size_t)fd >= poller->slotCount) {
+    size_t i, newCount = poller->slotCount < 64 ? 64 : poller->slotCount;
+    while (newCount <= (size_t)fd) {
+      newCount *= 2;
+    }
+    poller->slots = (int *)reallocOrPanic(poller->slots, sizeof(int) * newCount);
+    for (i = poller->slotCount; i < newCount; i++) {
+      poller->slots[i] = -1;
+    }
+    poller->slotCount = newCount;
+  }
+  slot = poller->slots[fd];
+
+#if MTOTS_IS_LINUX
+  if (poller->epollFD >= 0 && (events || slot >= 0)) {
+    if (!epollSet(poller, fd, events, slot < 0)) {
+      return STATUS_ERROR;
+    }
+  }
+#endif
+
+  if (events == 0) {
+    if (slot >= 0) {
+      /* swap-remove from 'entries' */
+      entries = (struct pollfd *)poller->entries;
+      entries[slot] = entries[--poller->count];
+      poller->slots[entries[slot].fd] = slot;
+      poller->slots[fd] = -1;
+    }
+    return STATUS_OK;
+  }
+
+  if (slot < 0) {
+    if (poller->count == poller->capacity) {
+      poller->capacity = poller->capacity < 8 ? 8 : poller->capacity * 2;
+      poller->entries = reallocOrPanic(
+          poller->entries, sizeof(struct pollfd) * poller->capacity);
+    }
+    slot = poller->slots[fd] = (int)poller->count++;
+    reserveReady(poller, poller->count);
+  }
+  entries = (struct pollfd *)poller->entries;
+  entries[slot].fd = fd;
+  entries[slot].events = toPollEvents(events);
+  entries[slot].revents = 0;
+  return STATUS_OK;
+#else
+  return runtimeError("Operation not supported on this platform (MTOTSPollerSet)");
+#endif
+}
+
+Status MTOTSPollerWait(
+    MTOTSPoller *poller,
+    int timeoutMillis,
+    MTOTSPollEvent **events,
+    size_t *count) {
+#if MTOTS_IS_POSIX
+  size_t i, readyCount = 0;
+  int result;
+
+  *events = poller->ready;
+  *count = 0;
+
+#if MTOTS_IS_LINUX
+  if (poller->epollFD >= 0) {
+    struct epoll_event *epollEvents = (struct epoll_event *)poller->epollEvents;
+    result = epoll_wait(
+        poller->epollFD, epollEvents, (int)poller->readyCapacity, timeoutMillis);
+    if (result < 0) {
+      if (errno == EINTR) {
+        return STATUS_OK;
+      }
+      return runtimeError("epoll_wait(): %s", strerror(errno));
+    }
+    for (i = 0; i < (size_t)result; i++) {
+      poller->ready[i].fd = epollEvents[i].data.fd;
+      poller->ready[i].events = fromEpollEvents(epollEvents[i].events);
+    }
+    *count = (size_t)result;
+    return STATUS_OK;
+  }
+#endif
+
+  result = poll((struct pollfd *)poller->entries, (nfds_t)poller->count, timeoutMillis);
+  if (result < 0) {
+    if (errno == EINTR) {
+      return STATUS_OK;
+    }
+    return runtimeError("poll(): %s", strerror(errno));
+  }
+  for (i = 0; i < poller->count && readyCount < (size_t)result; i++) {
+    struct pollfd *entry = ((struct pollfd *)poller->entries) + i;
+    if (entry->revents) {
+      poller->ready[readyCount].fd = entry->fd;
+      poller->ready[readyCount].events = fromPollEvents(entry->revents);
+      readyCount++;
+    }
+  }
+  *count = readyCount;
+  return STATUS_OK;
+#else
+  return runtimeError("Operation not supported on this platform (MTOTSPollerWait)");
+#endif
+}
+
+#if MTOTS_IS_POSIX
+static Status finishFDJob(MTOTSPoller *poller, MTOTSFDJob *job, size_t *finished) {
+  Status status = MTOTSPollerSet(poller, job->fd, 0);
+  close(job->fd);
+  job->fd = -1;
+  (*finished)++;
+  return status;
+}
+
+static Status runReadJob(MTOTSPoller *poller, MTOTSFDJob *job, size_t *finished) {
+  Buffer *buffer = job->as.read;
+  ssize_t bytesRead;
+  bufferSetMinCapacity(buffer, buffer->length + MIN_READ_SIZE);
+  bytesRead = read(job->fd, buffer->data + buffer->length, buffer->capacity - buffer->length);
+  if (bytesRead > 0) {
+    buffer->length += (size_t)bytesRead;
+    return STATUS_OK;
+  }
+  if (bytesRead < 0) {
+    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+      return STATUS_OK;
+    }
+    runtimeError("read(%d): %s", job->fd, strerror(errno));
+    finishFDJob(poller, job, finished);
     return STATUS_ERROR;
   }
+  /* end of file */
+  return finishFDJob(poller, job, finished);
+}
 
+static Status runWriteJob(MTOTSPoller *poller, MTOTSFDJob *job, int events, size_t *finished) {
+  ByteSlice *slice = job->as.write;
+  if (slice->start < slice->end) {
+    ssize_t bytesWritten;
+    if (!(events & MTOTS_POLL_OUT)) {
+      /* error or hangup without being writable - the reader is gone */
+      return finishFDJob(poller, job, finished);
+    }
+    bytesWritten = write(job->fd, slice->start, slice->end - slice->start);
+    if (bytesWritten < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+        return STATUS_OK;
+      }
+      if (errno == EPIPE) {
+        /* The reader went away. Like Python's communicate(),
+         * this is not considered an error */
+        return finishFDJob(poller, job, finished);
+      }
+      runtimeError("write(%d): %s", job->fd, strerror(errno));
+      finishFDJob(poller, job, finished);
+      return STATUS_ERROR;
+    }
+    slice->start += bytesWritten;
+  }
+  if (slice->start >= slice->end) {
+    return finishFDJob(poller, job, finished);
+  }
+  return STATUS_OK;
+}
+
+static void closeUnfinishedFDJobs(MTOTSFDJob *jobs, size_t njobs) {
+  size_t i;
   for (i = 0; i < njobs; i++) {
-    int fd = pfds[i].fd = jobs[i].fd;
-    pfds[i].revents = 0;
+    if (jobs[i].fd >= 0) {
+      close(jobs[i].fd);
+      jobs[i].fd = -1;
+    }
+  }
+}
+#endif
+
+Status MTOTSRunFDJobs(MTOTSFDJob *jobs, size_t njobs) {
+#if MTOTS_IS_POSIX
+  MTOTSPoller poller;
+  MTOTSFDJob **jobByFD = NULL;
+  size_t i, finished = 0, jobByFDCount = 0;
+
+  for (i = 0; i < njobs; i++) {
+    int fd = jobs[i].fd;
     if (fd < 0) {
-      pfds[i].events = 0;
       finished++;
       continue;
     }
     switch (jobs[i].type) {
       case MTOTSFD_READ:
-        pfds[i].events = POLLIN;
         break;
       case MTOTSFD_WRITE: {
         int flags = fcntl(fd, F_GETFL, 0);
         if (flags < 0) {
-          runtimeError("fntcl(%d, F_GETFL, 0): %s", fd, strerror(errno));
-          return STATUS_ERROR;
+          return runtimeError("fntcl(%d, F_GETFL, 0): %s", fd, strerror(errno));
         }
         if (!(flags & O_NONBLOCK)) {
-          runtimeError(
+          return runtimeError(
               "MTOTSRunFDJobs(): write jobs require the file descriptor "
               "to be non-blocking, but got a blocking one");
-          return STATUS_ERROR;
         }
-        pfds[i].events = POLLOUT;
         break;
       }
       default:
-        runtimeError("Invalid FDJob type %d", jobs[i].type);
-        return STATUS_ERROR;
+        return runtimeError("Invalid FDJob type %d", jobs[i].type);
     }
-  }
-
-  while (finished < njobs) {
-    int pollResult;
-    errno = 0;
-    pollResult = poll(pfds, njobs, -1);
-    if (pollResult < 0) {
-      /* error */
-      if (errno == EINTR) {
-        /* signal/interrupt - we should retry */
-        continue;
-      }
-      runtimeError("poll(): %s", strerror(errno));
-      return STATUS_ERROR;
-    }
-
-    /* some file descriptors are ready */
-    for (i = 0; i < njobs; i++) {
-      struct pollfd *pfd = &pfds[i];
-      if (pfd->revents == 0) {
-        continue;
-      }
-      if (pfd->revents & POLLIN) {
-        /* read some data */
-        Buffer *buffer = jobs[i].as.read;
-        ssize_t bytesRead;
-        bufferSetMinCapacity(
-            buffer,
-            buffer->length < MIN_READ_SIZE
-                ? buffer->length + MIN_READ_SIZE
-                : buffer->length * 2);
-        errno = 0;
-        bytesRead = read(
-            pfd->fd,
-            buffer->data + buffer->length,
-            buffer->capacity - buffer->length);
-        if (bytesRead < 0) {
-          /* TODO: figure out how to handle errors
-           * for now, we just ignore them */
-        } else {
-          buffer->length += (size_t)bytesRead;
-        }
-      }
-      if (pfd->revents & POLLOUT) {
-        /* write some data */
-        ByteSlice *slice = jobs[i].as.write;
-        if (slice->start < slice->end) {
-          ssize_t bytesWritten;
-          errno = 0;
-          bytesWritten = write(pfd->fd, slice->start, slice->end - slice->start);
-          if (bytesWritten <= 0) {
-            /* TODO: figure out how to handle errors
-             * for now, we just ignore them */
-          } else {
-            slice->start += bytesWritten;
-          }
-        }
-        if (slice->start >= slice->end) {
-          close(pfd->fd);
-          pfd->fd = -1;
-          finished++;
-          continue;
-        }
-      }
-      if (pfd->revents & POLLERR ||
-          pfd->revents & POLLNVAL ||
-          pfd->revents & POLLHUP) {
-        /* TODO: signal errors in some way */
-        /* Ignore any errors for now */
-        if (pfd->fd >= 0) {
-          close(pfd->fd);
-          pfd->fd = -1;
-          finished++;
-        }
+    if ((size_t)fd >= jobByFDCount) {
+      size_t j = jobByFDCount;
+      jobByFDCount = (size_t)fd + 1;
+      jobByFD = (MTOTSFDJob **)reallocOrPanic(jobByFD, sizeof(MTOTSFDJob *) * jobByFDCount);
+      for (; j < jobByFDCount; j++) {
+        jobByFD[j] = NULL;
       }
     }
+    jobByFD[fd] = &jobs[i];
   }
 
-  return STATUS_OK;
-#endif
-}
-
-Status readFromMultipleFDs(int *fds, Buffer *buffers, size_t nfds) {
-#if MTOTS_IS_POSIX
-  struct pollfd pfds[MAX_NFDS];
-  size_t i, finished = 0;
-  int pollResult;
+  if (finished == njobs) {
+    free(jobByFD);
+    return STATUS_OK;
+  }
 
-  if (nfds > MAX_NFDS) {
-    runtimeError("Too many file descriptors nfds = %lu, MAX_NFDS = %d",
-                 (unsigned long)nfds, MAX_NFDS);
+  if (!MTOTSPollerInit(&poller)) {
+    free(jobByFD);
     return STATUS_ERROR;
   }
 
-  for (i = 0; i < nfds; i++) {
-    pfds[i].fd = fds[i];
-    pfds[i].events = POLLIN;
-    pfds[i].revents = 0;
-    if (fds[i] < 0) {
-      finished++;
+  for (i = 0; i < njobs; i++) {
+    if (jobs[i].fd >= 0 &&
+        !MTOTSPollerSet(
+            &poller,
+            jobs[i].fd,
+            jobs[i].type == MTOTSFD_READ ? MTOTS_POLL_IN : MTOTS_POLL_OUT)) {
+      goto error;
     }
   }
 
-  while (finished < nfds) {
-    errno = 0;
-    pollResult = poll(pfds, nfds, -1);
-    if (pollResult < 0) {
-      /* error */
-      if (errno == EINTR) {
-        /* signal/interrupt - we should retry */
-        continue;
-      }
-      runtimeError("poll(): %s", strerror(errno));
-      return STATUS_ERROR;
-    } else if (pollResult == 0) {
-      /* timeout. This should be impossible */
-      panic("poll() timed out with infinite timeout");
-    }
-    /* some file descriptors are ready */
-    for (i = 0; i < nfds; i++) {
-      struct pollfd *pfd = &pfds[i];
-      if (pfd->revents == 0) {
+  while (finished < njobs) {
+    MTOTSPollEvent *events;
+    size_t count;
+    if (!MTOTSPollerWait(&poller, -1, &events, &count)) {
+      goto error;
+    }
+    for (i = 0; i < count; i++) {
+      MTOTSFDJob *job = jobByFD[events[i].fd];
+      if (!job || job->fd < 0) {
         continue;
       }
-      if (pfd->revents & POLLIN) {
-        /* read some data */
-        Buffer *buffer = &buffers[i];
-        ssize_t bytesRead;
-        bufferSetMinCapacity(
-            buffer,
-            buffer->length < MIN_READ_SIZE
-                ? buffer->length + MIN_READ_SIZE
-                : buffer->length * 2);
-        errno = 0;
-        bytesRead = read(
-            pfd->fd,
-            buffer->data + buffer->length,
-            buffer->capacity - buffer->length);
-        if (bytesRead < 0) {
-          /* TODO: figure out how to handle errors
-           * for now, we just ignore them */
-        } else {
-          buffer->length += (size_t)bytesRead;
-        }
-      }
-      if (pfd->revents & POLLERR ||
-          pfd->revents & POLLNVAL ||
-          pfd->revents & POLLHUP) {
-        /* TODO: signal errors in some way */
-        /* Ignore any errors for now */
-        if (pfds[i].fd >= 0) {
-          close(pfds[i].fd);
-          pfds[i].fd = -1;
-          finished++;
+      if (job->type == MTOTSFD_READ) {
+        if (!runReadJob(&poller, job, &finished)) {
+          goto error;
         }
+      } else if (!runWriteJob(&poller, job, events[i].events, &finished)) {
+        goto error;
       }
     }
   }
 
+  MTOTSPollerFree(&poller);
+  free(jobByFD);
   return STATUS_OK;
-#else
-  runtimeError("Operation not supported in this platform (readFromTwoFDs)");
+
+error:
+  closeUnfinishedFDJobs(jobs, njobs);
+  MTOTSPollerFree(&poller);
+  free(jobByFD);
   return STATUS_ERROR;
+#else
+  return runtimeError("Operation not supported on this platform (MTOTSRunFDJobs)");
 #endif
 }
+
+Status readFromMultipleFDs(int *fds, Buffer *buffers, size_t nfds) {
+  MTOTSFDJob *jobs = (MTOTSFDJob *)malloc(sizeof(MTOTSFDJob) * (nfds ? nfds : 1));
+  Status status;
+  size_t i;
+  if (!jobs) {
+    panic("out of memory");
+  }
+  for (i = 0; i < nfds; i++) {
+    jobs[i].type = MTOTSFD_READ;
+    jobs[i].fd = fds[i];
+    jobs[i].as.read = &buffers[i];
+  }
+  status = MTOTSRunFDJobs(jobs, nfds);
+  free(jobs);
+  return status;
+}
@@ -21,7 +21,10 @@ typedef struct MTOTSFDJob {
   } as;
 } MTOTSFDJob;
 
-/** Read and write to some file descriptors at the same time on a single thread */
+/** Read and write to some file descriptors at the same time on a single thread.
+ * There is no limit on the number of jobs. Read jobs finish at end of file,
+ * write jobs finish once all their data is written or the reader goes away.
+ * Every file descriptor is closed when its job finishes */
 Status MTOTSRunFDJobs(MTOTSFDJob *jobs, size_t njobs);
 
 /* Read the all the data from each file descriptor into its corresponding
@@ -29,4 +32,49 @@ Status MTOTSRunFDJobs(MTOTSFDJob *jobs, size_t njobs);
  * descriptors will be closed */
 Status readFromMultipleFDs(int *fds, Buffer *buffers, size_t nfds);
 
+/* Readiness flags for MTOTSPoller */
+#define MTOTS_POLL_IN 1
+#define MTOTS_POLL_OUT 2
+#define MTOTS_POLL_ERR 4 /* error or hangup - only ever reported, never requested */
+
+typedef struct MTOTSPollEvent {
+  int fd;
+  int events;
+} MTOTSPollEvent;
+
+/* Waits for readiness on any number of file descriptors.
+ * Uses epoll on Linux and poll() everywhere else on POSIX.
+ * If epoll refuses a file descriptor (e.g. a regular file), the poller
+ * quietly switches over to poll() */
+typedef struct MTOTSPoller {
+  int epollFD;           /* -1 if poll() is used */
+  void *entries;         /* struct pollfd for each registered fd */
+  size_t count;          /* number of registered file descriptors */
+  size_t capacity;       /* capacity of 'entries' */
+  int *slots;            /* index into 'entries' for each fd, or -1 */
+  size_t slotCount;      /* length of 'slots' */
+  void *epollEvents;     /* struct epoll_event buffer for epoll_wait() */
+  MTOTSPollEvent *ready; /* results of the most recent MTOTSPollerWait */
+  size_t readyCapacity;  /* capacity of 'ready' and 'epollEvents' */
+} MTOTSPoller;
+
+Status MTOTSPollerInit(MTOTSPoller *poller);
+void MTOTSPollerFree(MTOTSPoller *poller);
+
+/* Sets the events to watch for on the given file descriptor.
+ * Registers 'fd' if it is not yet registered, and
+ * unregisters it if 'events' is zero */
+Status MTOTSPollerSet(MTOTSPoller *poller, int fd, int events);
+
+/* Waits until at least one registered file descriptor is ready or
+ * until 'timeoutMillis' milliseconds pass (forever if negative).
+ * On success, '*events' points to an array of '*count' events that
+ * stays valid until the next call on this poller. Being interrupted by
+ * a signal is not an error, and yields zero events */
+Status MTOTSPollerWait(
+    MTOTSPoller *poller,
+    int timeoutMillis,
+    MTOTSPollEvent **events,
+    size_t *count);
+
 #endif /*mtots_util_fd_h*/
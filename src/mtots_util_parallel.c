@@ -0,0 +1,126 @@
+#include "mtots_util_parallel.h"
+
+#if MTOTS_IS_POSIX
+#include <pthread.h>
+#include <unistd.h>
+
+#define MAX_WORKERS 63
+
+typedef struct Pool {
+  pthread_mutex_t mutex;
+  pthread_cond_t workAvailable;
+  pthread_cond_t workDone;
+  size_t workerCount;
+  ubool started;
+
+  /* The current job. 'generation' changes every time a new job starts */
+  unsigned long generation;
+  ParallelTask task;
+  void *context;
+  size_t count;
+  size_t next;
+  size_t finished;
+} Pool;
+
+static Pool pool = {
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+};
+
+/* Runs items of the current job until there are none left.
+ * Must be called with the mutex held, and returns with it held */
+static void runItems(void) {
+  while (pool.next < pool.count) {
+    size_t index = pool.next++;
+    ParallelTask task = pool.task;
+    void *context = pool.context;
+    pthread_mutex_unlock(&pool.mutex);
+    task(context, index);
+    pthread_mutex_lock(&pool.mutex);
+    if (++pool.finished == pool.count) {
+      pthread_cond_signal(&pool.workDone);
+    }
+  }
+}
+
+static void *workerMain(void *arg) {
+  unsigned long seen = 0;
+  pthread_mutex_lock(&pool.mutex);
+  for (;;) {
+    while (pool.generation == seen) {
+      pthread_cond_wait(&pool.workAvailable, &pool.mutex);
+    }
+    seen = pool.generation;
+    runItems();
+  }
+  return NULL;
+}
+
+/* Only the thread calling 'runParallel' gets here, so there is no
+ * race on 'started' */
+static void startWorkers(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t i, wanted = cpus > 1 ? (size_t)(cpus - 1) : 0;
+  if (pool.started) {
+    return;
+  }
+  if (wanted > MAX_WORKERS) {
+    wanted = MAX_WORKERS;
+  }
+  pool.started = UTRUE;
+  for (i = 0; i < wanted; i++) {
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, workerMain, NULL) == 0) {
+      pool.workerCount++;
+    }
+    pthread_attr_destroy(&attr);
+  }
+}
+
+void runParallel(size_t count, ParallelTask task, void *context) {
+  size_t i;
+  startWorkers();
+  if (count < 2 || pool.workerCount == 0) {
+    for (i = 0; i < count; i++) {
+      task(context, i);
+    }
+    return;
+  }
+  pthread_mutex_lock(&pool.mutex);
+  pool.task = task;
+  pool.context = context;
+  pool.count = count;
+  pool.next = 0;
+  pool.finished = 0;
+  pool.generation++;
+  pthread_cond_broadcast(&pool.workAvailable);
+  runItems();
+  while (pool.finished < pool.count) {
+    pthread_cond_wait(&pool.workDone, &pool.mutex);
+  }
+  pthread_mutex_unlock(&pool.mutex);
+}
+
+size_t getParallelThreadCount(void) {
+  startWorkers();
+  return pool.workerCount + 1;
+}
+
+#else
+
+void runParallel(size_t count, ParallelTask task, void *context) {
+  size_t i;
+  for (i = 0; i < count; i++) {
+    task(context, i);
+  }
+}
+
+size_t getParallelThreadCount(void) {
+  return 1;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef mtots_util_parallel_h
+#define mtots_util_parallel_h
+
+#include "mtots_common.h"
+
+/* A process wide pool of worker threads for data parallel loops.
+ *
+ * The workers are started the first time they are needed, one fewer
+ * than the number of online CPUs (the calling thread also does work).
+ * On platforms without POSIX threads everything runs on the calling
+ * thread.
+ *
+ * Tasks run on other threads, so they must not touch the VM, allocate
+ * through 'reallocate', or update the external memory counters. */
+
+typedef void (*ParallelTask)(void *context, size_t index);
+
+/* Calls 'task(context, i)' for every i in [0, count), in no particular
+ * order and possibly concurrently, and returns once all calls finish.
+ *
+ * Must only be called from one thread at a time */
+void runParallel(size_t count, ParallelTask task, void *context);
+
+/* Number of threads (including the calling thread) that 'runParallel'
+ * will spread work over */
+size_t getParallelThreadCount(void);
+
+#endif /*mtots_util_parallel_h*/
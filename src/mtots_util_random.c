@@ -1,5 +1,7 @@
 #include "mtots_util_random.h"
 
+#include <math.h>
+
 /* References:
  * https://github.com/notr1ch/opentdm/blob/master/mt19937.c
  * http://facweb.cs.depaul.edu/sjost/csc433/documents/mersenne-twister-pseudocode.txt
@@ -82,3 +84,93 @@ u32 randomInt(Random *random, u32 n) {
   } while (value >= limit);
   return value % count;
 }
+
+static u64 rotl(u64 x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+static u64 splitmix64(u64 *state) {
+  u64 z = (*state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+void initXoshiro256(Xoshiro256 *x, u64 seed) {
+  x->s[0] = splitmix64(&seed);
+  x->s[1] = splitmix64(&seed);
+  x->s[2] = splitmix64(&seed);
+  x->s[3] = splitmix64(&seed);
+}
+
+u64 xoshiro256Next(Xoshiro256 *x) {
+  u64 *s = x->s;
+  u64 result = rotl(s[1] * 5, 7) * 9;
+  u64 t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
+void xoshiro256Jump(Xoshiro256 *x) {
+  static const u64 JUMP[] = {
+      0x180ec6d33cfd0aba,
+      0xd5a61266f0c9392c,
+      0xa9582618e03fc9aa,
+      0x39abdc4528b3fe9e,
+  };
+  u64 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  size_t i;
+  int b;
+  for (i = 0; i < sizeof(JUMP) / sizeof(JUMP[0]); i++) {
+    for (b = 0; b < 64; b++) {
+      if (JUMP[i] & ((u64)1) << b) {
+        s0 ^= x->s[0];
+        s1 ^= x->s[1];
+        s2 ^= x->s[2];
+        s3 ^= x->s[3];
+      }
+      xoshiro256Next(x);
+    }
+  }
+  x->s[0] = s0;
+  x->s[1] = s1;
+  x->s[2] = s2;
+  x->s[3] = s3;
+}
+
+double xoshiro256Float(Xoshiro256 *x) {
+  return (double)(xoshiro256Next(x) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Lemire's multiply-shift method: mostly avoids division, and rejects
+ * just enough values to stay unbiased */
+u32 xoshiro256Below(Xoshiro256 *x, u32 count) {
+  u64 m = (xoshiro256Next(x) >> 32) * (u64)count;
+  u32 low = (u32)m;
+  if (low < count) {
+    u32 threshold = (u32)(0 - count) % count;
+    while (low < threshold) {
+      m = (xoshiro256Next(x) >> 32) * (u64)count;
+      low = (u32)m;
+    }
+  }
+  return (u32)(m >> 32);
+}
+
+/* Marsaglia polar method */
+void xoshiro256NormalPair(Xoshiro256 *x, double *a, double *b) {
+  double u, v, s;
+  do {
+    u = 2 * xoshiro256Float(x) - 1;
+    v = 2 * xoshiro256Float(x) - 1;
+    s = u * u + v * v;
+  } while (s >= 1 || s == 0);
+  s = sqrt(-2 * log(s) / s);
+  *a = u * s;
+  *b = v * s;
+}
@@ -14,4 +14,29 @@ u32 randomNext(Random *random);
 double randomFloat(Random *random);
 u32 randomInt(Random *random, u32 n);
 
+/* xoshiro256** (https://prng.di.unimi.it/)
+ * Much smaller and faster than MT19937, and supports jumping ahead
+ * 2^128 steps to create non-overlapping streams */
+typedef struct Xoshiro256 {
+  u64 s[4];
+} Xoshiro256;
+
+/* The state is expanded from the seed with splitmix64 */
+void initXoshiro256(Xoshiro256 *x, u64 seed);
+u64 xoshiro256Next(Xoshiro256 *x);
+
+/* Advances the state by 2^128 steps */
+void xoshiro256Jump(Xoshiro256 *x);
+
+/* Returns a floating point number X such that 0.0 <= X < 1.0,
+ * using 53 random bits */
+double xoshiro256Float(Xoshiro256 *x);
+
+/* Returns an integer uniformly randomly selected from [0, count).
+ * 'count' must not be zero */
+u32 xoshiro256Below(Xoshiro256 *x, u32 count);
+
+/* Returns two independent samples from the standard normal distribution */
+void xoshiro256NormalPair(Xoshiro256 *x, double *a, double *b);
+
 #endif /*mtots_util_random_h*/
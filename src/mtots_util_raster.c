@@ -0,0 +1,901 @@
+#include "mtots_util_raster.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtots_util_error.h"
+#include "mtots_util_parallel.h"
+
+/* Coordinates are clamped to this range before being converted to
+ * integers, so that huge or non-finite values cannot overflow */
+#define COORDINATE_LIMIT 1073741824L
+
+/* Number of polygon edges that can be handled without allocating */
+#define POLYGON_STACK_EDGES 32
+
+/* Width and height of the tiles used by 'rasterFlush' */
+#define TILE_SIZE 64
+
+#define LOW_LANES 0x00FF00FFUL
+
+/* x is recomputed from the edge's equation on every row rather than
+ * accumulated, so a row's crossings do not depend on which row drawing
+ * started at (i.e. on the clip rectangle) */
+typedef struct Edge {
+  double x; /* x at the center of the current row */
+  double topX;
+  double topY;
+  double dxdy;
+  long yStart; /* first row covered (inclusive) */
+  long yEnd;   /* last row covered (exclusive) */
+  int winding;
+} Edge;
+
+/* Index of the first pixel whose center is at or after 'v' */
+static long pixelBoundary(double v) {
+  v = ceil(v - 0.5);
+  if (!(v > (double)-COORDINATE_LIMIT)) {
+    return -COORDINATE_LIMIT;
+  }
+  if (!(v < (double)COORDINATE_LIMIT)) {
+    return COORDINATE_LIMIT;
+  }
+  return (long)v;
+}
+
+/* Index of the pixel containing 'v' */
+static long pixelIndex(double v) {
+  v = floor(v);
+  if (!(v > (double)-COORDINATE_LIMIT)) {
+    return -COORDINATE_LIMIT;
+  }
+  if (!(v < (double)COORDINATE_LIMIT)) {
+    return COORDINATE_LIMIT;
+  }
+  return (long)v;
+}
+
+static long clampLong(long value, long low, long high) {
+  return value < low ? low : value > high ? high : value;
+}
+
+static u8 getAlpha(u32 color) {
+  u8 bytes[4];
+  memcpy(bytes, &color, 4);
+  return bytes[3];
+}
+
+void initRaster(Raster *raster, u32 *pixels, size_t width, size_t height, size_t stride) {
+  raster->pixels = pixels;
+  raster->width = width;
+  raster->height = height;
+  raster->stride = stride;
+  rasterResetClip(raster);
+}
+
+void rasterSetClip(Raster *raster, double minX, double minY, double width, double height) {
+  long x0 = clampLong(pixelBoundary(minX), 0, (long)raster->width);
+  long y0 = clampLong(pixelBoundary(minY), 0, (long)raster->height);
+  long x1 = clampLong(pixelBoundary(minX + width), x0, (long)raster->width);
+  long y1 = clampLong(pixelBoundary(minY + height), y0, (long)raster->height);
+  raster->clipMinX = (size_t)x0;
+  raster->clipMinY = (size_t)y0;
+  raster->clipMaxX = (size_t)x1;
+  raster->clipMaxY = (size_t)y1;
+}
+
+void rasterResetClip(Raster *raster) {
+  raster->clipMinX = 0;
+  raster->clipMinY = 0;
+  raster->clipMaxX = raster->width;
+  raster->clipMaxY = raster->height;
+}
+
+u32 rasterPixel(u8 red, u8 green, u8 blue, u8 alpha) {
+  u8 bytes[4];
+  u32 pixel;
+  bytes[0] = red;
+  bytes[1] = green;
+  bytes[2] = blue;
+  bytes[3] = alpha;
+  memcpy(&pixel, bytes, 4);
+  return pixel;
+}
+
+void rasterUnpackPixel(u32 pixel, u8 *red, u8 *green, u8 *blue, u8 *alpha) {
+  u8 bytes[4];
+  memcpy(bytes, &pixel, 4);
+  *red = bytes[0];
+  *green = bytes[1];
+  *blue = bytes[2];
+  *alpha = bytes[3];
+}
+
+/* Plain stores in a simple counted loop, which compilers turn into
+ * wide vector stores */
+static void fillPixels(u32 *pixels, size_t count, u32 color) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    pixels[i] = color;
+    pixels[i + 1] = color;
+    pixels[i + 2] = color;
+    pixels[i + 3] = color;
+  }
+  for (; i < count; i++) {
+    pixels[i] = color;
+  }
+}
+
+/* Divides each of the two 16-bit lanes of 'x' by 255, rounding to nearest.
+ * Each lane must be at most 255 * 255 */
+#define DIV255_LANES(x) \
+  ((((x) + 0x00800080UL + ((((x) + 0x00800080UL) >> 8) & LOW_LANES)) >> 8) & LOW_LANES)
+
+/* Blends two channels at a time in the 16-bit lanes of a u32
+ * ("SIMD within a register").
+ *
+ * The source's alpha byte is replaced with 255 so that the alpha lane
+ * computes `a + dstAlpha * (1 - a)` with the same arithmetic as the
+ * color lanes */
+void rasterBlendSpan(u32 *pixels, size_t count, u32 color) {
+  u32 alpha = getAlpha(color);
+  u32 inverse = 255 - alpha;
+  u32 opaque = color | rasterPixel(0, 0, 0, 255);
+  u32 srcRB = (u32)((opaque & LOW_LANES) * alpha);
+  u32 srcGA = (u32)(((opaque >> 8) & LOW_LANES) * alpha);
+  size_t i;
+  for (i = 0; i < count; i++) {
+    u32 dst = pixels[i];
+    u32 rb = (u32)((dst & LOW_LANES) * inverse + srcRB);
+    u32 ga = (u32)(((dst >> 8) & LOW_LANES) * inverse + srcGA);
+    pixels[i] = (u32)(DIV255_LANES(rb) | (DIV255_LANES(ga) << 8));
+  }
+}
+
+void rasterFill(Raster *raster, u32 color) {
+  size_t y;
+  for (y = raster->clipMinY; y < raster->clipMaxY; y++) {
+    fillPixels(
+        raster->pixels + y * raster->stride + raster->clipMinX,
+        raster->clipMaxX - raster->clipMinX,
+        color);
+  }
+}
+
+void rasterSpan(Raster *raster, long y, long minX, long maxX, u32 color) {
+  u8 alpha = getAlpha(color);
+  u32 *row;
+  if (alpha == 0 || y < (long)raster->clipMinY || y >= (long)raster->clipMaxY) {
+    return;
+  }
+  minX = clampLong(minX, (long)raster->clipMinX, (long)raster->clipMaxX);
+  maxX = clampLong(maxX, (long)raster->clipMinX, (long)raster->clipMaxX);
+  if (minX >= maxX) {
+    return;
+  }
+  row = raster->pixels + (size_t)y * raster->stride + (size_t)minX;
+  if (alpha == 255) {
+    fillPixels(row, (size_t)(maxX - minX), color);
+  } else {
+    rasterBlendSpan(row, (size_t)(maxX - minX), color);
+  }
+}
+
+/* Rows [*y0, *y1) narrowed to the clip rectangle */
+static void clipRows(Raster *raster, long *y0, long *y1) {
+  *y0 = clampLong(*y0, (long)raster->clipMinY, (long)raster->clipMaxY);
+  *y1 = clampLong(*y1, *y0, (long)raster->clipMaxY);
+}
+
+void rasterFillRect(
+    Raster *raster, double minX, double minY, double width, double height, u32 color) {
+  long x0 = pixelBoundary(minX), x1 = pixelBoundary(minX + width);
+  long y0 = pixelBoundary(minY), y1 = pixelBoundary(minY + height);
+  long y;
+  clipRows(raster, &y0, &y1);
+  for (y = y0; y < y1; y++) {
+    rasterSpan(raster, y, x0, x1, color);
+  }
+}
+
+void rasterStrokeRect(
+    Raster *raster, double minX, double minY, double width, double height, u32 color) {
+  long x0 = pixelBoundary(minX), x1 = pixelBoundary(minX + width);
+  long y0 = pixelBoundary(minY), y1 = pixelBoundary(minY + height);
+  long y, top, bottom;
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+  rasterSpan(raster, y0, x0, x1, color);
+  if (y1 - 1 > y0) {
+    rasterSpan(raster, y1 - 1, x0, x1, color);
+  }
+  top = y0 + 1;
+  bottom = y1 - 1;
+  clipRows(raster, &top, &bottom);
+  for (y = top; y < bottom; y++) {
+    rasterSpan(raster, y, x0, x0 + 1, color);
+    if (x1 - 1 > x0) {
+      rasterSpan(raster, y, x1 - 1, x1, color);
+    }
+  }
+}
+
+#define OUT_LEFT 1
+#define OUT_RIGHT 2
+#define OUT_TOP 4
+#define OUT_BOTTOM 8
+
+static int outCode(double x, double y, double minX, double minY, double maxX, double maxY) {
+  return (x < minX ? OUT_LEFT : x > maxX ? OUT_RIGHT : 0) |
+         (y < minY ? OUT_TOP : y > maxY ? OUT_BOTTOM : 0);
+}
+
+/* Cohen-Sutherland clipping of the segment to the given box.
+ * Each clipped end point is placed exactly on the boundary it crossed,
+ * with the other coordinate interpolated by a ratio in [0, 1], so end
+ * points far outside the box do not cost precision near it.
+ * Returns UFALSE if no part of the segment is in the box */
+static ubool clipLine(
+    double *x0, double *y0, double *x1, double *y1,
+    double minX, double minY, double maxX, double maxY) {
+  int code0 = outCode(*x0, *y0, minX, minY, maxX, maxY);
+  int code1 = outCode(*x1, *y1, minX, minY, maxX, maxY);
+  while (code0 | code1) {
+    int code = code0 ? code0 : code1;
+    double dx = *x1 - *x0, dy = *y1 - *y0, x, y;
+    if (code0 & code1) {
+      return UFALSE;
+    }
+    if (code & OUT_LEFT) {
+      x = minX;
+      y = *y0 + dy * ((minX - *x0) / dx);
+    } else if (code & OUT_RIGHT) {
+      x = maxX;
+      y = *y0 + dy * ((maxX - *x0) / dx);
+    } else if (code & OUT_TOP) {
+      x = *x0 + dx * ((minY - *y0) / dy);
+      y = minY;
+    } else {
+      x = *x0 + dx * ((maxY - *y0) / dy);
+      y = maxY;
+    }
+    if (code == code0) {
+      *x0 = x;
+      *y0 = y;
+      code0 = outCode(x, y, minX, minY, maxX, maxY);
+    } else {
+      *x1 = x;
+      *y1 = y;
+      code1 = outCode(x, y, minX, minY, maxX, maxY);
+    }
+  }
+  return UTRUE;
+}
+
+static ubool isFinite(double v) {
+  return v - v == 0;
+}
+
+void rasterDrawLine(Raster *raster, double x0, double y0, double x1, double y1, u32 color) {
+  /* The segment is cut down to just outside the raster before stepping,
+   * so lines that are mostly off screen stay cheap. The clip rectangle
+   * is deliberately not used here so that the pixels chosen do not
+   * depend on it. Lines with a non-finite end point (or whose extent
+   * overflows) are not drawn */
+  double maxX = (double)raster->width + 1, maxY = (double)raster->height + 1;
+  long xa, ya, xb, yb, sx, sy, err, ex, ey;
+  if (getAlpha(color) == 0 ||
+      !isFinite(x1 - x0) || !isFinite(y1 - y0) ||
+      !clipLine(&x0, &y0, &x1, &y1, -1, -1, maxX, maxY)) {
+    return;
+  }
+  /* Rounding in the interpolation can leave an end point a hair
+   * outside the box; clamping keeps the step count bounded */
+  xa = clampLong(pixelIndex(x0), -1, (long)raster->width + 1);
+  ya = clampLong(pixelIndex(y0), -1, (long)raster->height + 1);
+  xb = clampLong(pixelIndex(x1), -1, (long)raster->width + 1);
+  yb = clampLong(pixelIndex(y1), -1, (long)raster->height + 1);
+  ex = xb > xa ? xb - xa : xa - xb;
+  ey = yb > ya ? ya - yb : yb - ya;
+  sx = xa < xb ? 1 : -1;
+  sy = ya < yb ? 1 : -1;
+  err = ex + ey;
+  for (;;) {
+    long e2;
+    rasterSpan(raster, ya, xa, xa + 1, color);
+    if (xa == xb && ya == yb) {
+      break;
+    }
+    e2 = 2 * err;
+    if (e2 >= ey) {
+      err += ey;
+      xa += sx;
+    }
+    if (e2 <= ex) {
+      err += ex;
+      ya += sy;
+    }
+  }
+}
+
+static int compareEdges(const void *a, const void *b) {
+  long ya = ((const Edge *)a)->yStart, yb = ((const Edge *)b)->yStart;
+  return ya < yb ? -1 : ya > yb ? 1 : 0;
+}
+
+/* Builds the edge table, with each edge limited to the visible rows.
+ * Returns the number of edges that cover any visible row */
+static size_t buildEdges(Raster *raster, const float *points, size_t count, Edge *edges) {
+  size_t i, edgeCount = 0;
+  for (i = 0; i < count; i++) {
+    size_t j = i + 1 == count ? 0 : i + 1;
+    double ax = points[2 * i], ay = points[2 * i + 1];
+    double bx = points[2 * j], by = points[2 * j + 1];
+    Edge *edge = &edges[edgeCount];
+    if (ay == by) {
+      continue;
+    }
+    edge->winding = ay < by ? 1 : -1;
+    if (ay > by) {
+      double t = ax;
+      ax = bx;
+      bx = t;
+      t = ay;
+      ay = by;
+      by = t;
+    }
+    edge->yStart = pixelBoundary(ay);
+    edge->yEnd = pixelBoundary(by);
+    clipRows(raster, &edge->yStart, &edge->yEnd);
+    if (edge->yStart >= edge->yEnd) {
+      continue;
+    }
+    edge->topX = ax;
+    edge->topY = ay;
+    edge->dxdy = (bx - ax) / (by - ay);
+    edgeCount++;
+  }
+  qsort(edges, edgeCount, sizeof(Edge), compareEdges);
+  return edgeCount;
+}
+
+void rasterFillPolygon(Raster *raster, const float *points, size_t count, u32 color) {
+  Edge stackEdges[POLYGON_STACK_EDGES];
+  Edge *stackActive[POLYGON_STACK_EDGES];
+  Edge *edges = stackEdges;
+  Edge **active = stackActive;
+  size_t edgeCount, activeCount = 0, next = 0;
+  long y;
+
+  if (count < 3 || getAlpha(color) == 0) {
+    return;
+  }
+  if (count > POLYGON_STACK_EDGES) {
+    edges = (Edge *)malloc(sizeof(Edge) * count);
+    active = (Edge **)malloc(sizeof(Edge *) * count);
+    if (!edges || !active) {
+      panic("rasterFillPolygon: out of memory");
+    }
+  }
+
+  edgeCount = buildEdges(raster, points, count, edges);
+  y = edgeCount ? edges[0].yStart : 0;
+  while (next < edgeCount || activeCount > 0) {
+    size_t i, kept;
+    int winding = 0;
+    double start = 0;
+
+    while (next < edgeCount && edges[next].yStart == y) {
+      active[activeCount++] = &edges[next++];
+    }
+    for (i = 0; i < activeCount; i++) {
+      Edge *edge = active[i];
+      edge->x = edge->topX + ((double)y + 0.5 - edge->topY) * edge->dxdy;
+    }
+
+    /* Edges only swap order where they cross, so insertion sort
+     * is close to linear from one row to the next */
+    for (i = 1; i < activeCount; i++) {
+      Edge *edge = active[i];
+      size_t j = i;
+      while (j > 0 && active[j - 1]->x > edge->x) {
+        active[j] = active[j - 1];
+        j--;
+      }
+      active[j] = edge;
+    }
+
+    for (i = 0; i < activeCount; i++) {
+      int before = winding;
+      winding += active[i]->winding;
+      if (before == 0 && winding != 0) {
+        start = active[i]->x;
+      } else if (before != 0 && winding == 0) {
+        rasterSpan(raster, y, pixelBoundary(start), pixelBoundary(active[i]->x), color);
+      }
+    }
+
+    y++;
+    for (i = kept = 0; i < activeCount; i++) {
+      if (active[i]->yEnd > y) {
+        active[kept++] = active[i];
+      }
+    }
+    activeCount = kept;
+    if (activeCount == 0 && next < edgeCount) {
+      y = edges[next].yStart;
+    }
+  }
+
+  if (edges != stackEdges) {
+    free(edges);
+    free(active);
+  }
+}
+
+/* Horizontal extent of the ellipse at the center of row 'y'.
+ * Returns false if the row's center is outside the ellipse */
+static ubool ovalRow(
+    double cx, double cy, double rx, double ry, long y, long *x0, long *x1) {
+  double dy, t, half;
+  if (rx <= 0 || ry <= 0) {
+    return UFALSE;
+  }
+  dy = ((double)y + 0.5 - cy) / ry;
+  t = 1 - dy * dy;
+  if (t <= 0) {
+    return UFALSE;
+  }
+  half = rx * sqrt(t);
+  *x0 = pixelBoundary(cx - half);
+  *x1 = pixelBoundary(cx + half);
+  return *x0 < *x1;
+}
+
+void rasterFillOval(
+    Raster *raster, double minX, double minY, double width, double height, u32 color) {
+  double rx = width / 2, ry = height / 2, cx = minX + rx, cy = minY + ry;
+  long y0 = pixelBoundary(minY), y1 = pixelBoundary(minY + height);
+  long y, x0, x1;
+  clipRows(raster, &y0, &y1);
+  for (y = y0; y < y1; y++) {
+    if (ovalRow(cx, cy, rx, ry, y, &x0, &x1)) {
+      rasterSpan(raster, y, x0, x1, color);
+    }
+  }
+}
+
+/* The outline is the difference between the ellipse and the same
+ * ellipse shrunk by one pixel, so each row is at most two spans */
+void rasterStrokeOval(
+    Raster *raster, double minX, double minY, double width, double height, u32 color) {
+  double rx = width / 2, ry = height / 2, cx = minX + rx, cy = minY + ry;
+  long y0 = pixelBoundary(minY), y1 = pixelBoundary(minY + height);
+  long y, x0, x1, inner0, inner1;
+  clipRows(raster, &y0, &y1);
+  for (y = y0; y < y1; y++) {
+    if (!ovalRow(cx, cy, rx, ry, y, &x0, &x1)) {
+      continue;
+    }
+    if (ovalRow(cx, cy, rx - 1, ry - 1, y, &inner0, &inner1)) {
+      inner0 = clampLong(inner0, x0 + 1, x1);
+      inner1 = clampLong(inner1, inner0, x1 - 1);
+      rasterSpan(raster, y, x0, inner0, color);
+      rasterSpan(raster, y, inner1, x1, color);
+    } else {
+      rasterSpan(raster, y, x0, x1, color);
+    }
+  }
+}
+
+/* Row of 'src' sampled by destination row 'y' in 'rasterCopy' */
+static long copySourceRow(
+    long y, double dstMinY, double dv, double srcMinY, double srcHeight, ubool flipY,
+    long maxSrcY) {
+  double offset = ((double)y + 0.5 - dstMinY) * dv;
+  double v = flipY ? srcMinY + srcHeight - offset : srcMinY + offset;
+  return clampLong(pixelIndex(v), 0, maxSrcY);
+}
+
+static ubool rastersOverlap(const Raster *a, const Raster *b) {
+  const u32 *aEnd = a->pixels + a->height * a->stride;
+  const u32 *bEnd = b->pixels + b->height * b->stride;
+  return a->pixels < bEnd && b->pixels < aEnd;
+}
+
+void rasterCopy(
+    Raster *dst, double dstMinX, double dstMinY, double dstWidth, double dstHeight,
+    const Raster *src, double srcMinX, double srcMinY, double srcWidth, double srcHeight,
+    ubool flipX, ubool flipY) {
+  long x0 = pixelBoundary(dstMinX), x1 = pixelBoundary(dstMinX + dstWidth);
+  long y0 = pixelBoundary(dstMinY), y1 = pixelBoundary(dstMinY + dstHeight);
+  long y, maxSrcX, maxSrcY, firstSrcY = 0;
+  size_t srcStride = src->stride;
+  const u32 *srcPixels = src->pixels;
+  u32 *copy = NULL;
+  double du, dv;
+
+  if (src->width == 0 || src->height == 0 || dstWidth <= 0 || dstHeight <= 0) {
+    return;
+  }
+  maxSrcX = (long)src->width - 1;
+  maxSrcY = (long)src->height - 1;
+  x0 = clampLong(x0, (long)dst->clipMinX, (long)dst->clipMaxX);
+  x1 = clampLong(x1, x0, (long)dst->clipMaxX);
+  clipRows(dst, &y0, &y1);
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+
+  du = srcWidth / dstWidth;
+  dv = srcHeight / dstHeight;
+
+  if (rastersOverlap(dst, src)) {
+    /* Copying within the same pixels: rows written early could be read
+     * again later (scaling and flips rule out a safe copy direction),
+     * so the source rows that will be read are copied out first */
+    long a = copySourceRow(y0, dstMinY, dv, srcMinY, srcHeight, flipY, maxSrcY);
+    long b = copySourceRow(y1 - 1, dstMinY, dv, srcMinY, srcHeight, flipY, maxSrcY);
+    size_t rowCount;
+    firstSrcY = a < b ? a : b;
+    rowCount = (size_t)((a < b ? b : a) - firstSrcY + 1);
+    copy = (u32 *)malloc(sizeof(u32) * src->width * rowCount);
+    if (!copy) {
+      panic("rasterCopy: out of memory");
+    }
+    for (y = 0; y < (long)rowCount; y++) {
+      memcpy(
+          copy + (size_t)y * src->width,
+          src->pixels + (size_t)(firstSrcY + y) * src->stride,
+          sizeof(u32) * src->width);
+    }
+    srcPixels = copy;
+    srcStride = src->width;
+  }
+
+  for (y = y0; y < y1; y++) {
+    long sy = copySourceRow(y, dstMinY, dv, srcMinY, srcHeight, flipY, maxSrcY);
+    const u32 *srcRow = srcPixels + (size_t)(sy - firstSrcY) * srcStride;
+    u32 *dstRow = dst->pixels + (size_t)y * dst->stride;
+    long x;
+    for (x = x0; x < x1; x++) {
+      double offsetX = ((double)x + 0.5 - dstMinX) * du;
+      double u = flipX ? srcMinX + srcWidth - offsetX : srcMinX + offsetX;
+      dstRow[x] = srcRow[clampLong(pixelIndex(u), 0, maxSrcX)];
+    }
+  }
+  free(copy);
+}
+
+void rasterBlendMask(
+    Raster *raster, long x, long y,
+    const u8 *mask, size_t maskStride, size_t width, size_t height, u32 color) {
+  long x0 = clampLong(x, (long)raster->clipMinX, (long)raster->clipMaxX);
+  long x1 = clampLong(x + (long)width, x0, (long)raster->clipMaxX);
+  long y0 = y, y1 = y + (long)height, row;
+  u32 alpha = getAlpha(color);
+  u32 opaque = color | rasterPixel(0, 0, 0, 255);
+  u32 colorRB = (u32)(opaque & LOW_LANES);
+  u32 colorGA = (u32)((opaque >> 8) & LOW_LANES);
+  clipRows(raster, &y0, &y1);
+  if (alpha == 0 || x0 >= x1) {
+    return;
+  }
+  for (row = y0; row < y1; row++) {
+    const u8 *coverage = mask + (size_t)(row - y) * maskStride + (size_t)(x0 - x);
+    u32 *pixels = raster->pixels + (size_t)row * raster->stride + (size_t)x0;
+    size_t i, count = (size_t)(x1 - x0);
+    for (i = 0; i < count; i++) {
+      /* coverage * alpha / 255, rounded */
+      u32 a = (u32)coverage[i] * alpha + 128;
+      u32 inverse, dst, rb, ga;
+      a = (a + (a >> 8)) >> 8;
+      inverse = 255 - a;
+      dst = pixels[i];
+      rb = (u32)((dst & LOW_LANES) * inverse + colorRB * a);
+      ga = (u32)(((dst >> 8) & LOW_LANES) * inverse + colorGA * a);
+      pixels[i] = (u32)(DIV255_LANES(rb) | (DIV255_LANES(ga) << 8));
+    }
+  }
+}
+
+void initRasterCommandList(RasterCommandList *list) {
+  list->commands = NULL;
+  list->count = list->capacity = 0;
+  list->points = NULL;
+  list->pointCount = list->pointCapacity = 0;
+}
+
+void freeRasterCommandList(RasterCommandList *list) {
+  free(list->commands);
+  free(list->points);
+  initRasterCommandList(list);
+}
+
+void rasterDraw(Raster *raster, RasterCommandType type, const double *args, u32 color) {
+  switch (type) {
+    case RASTER_COMMAND_FILL:
+      rasterFill(raster, color);
+      return;
+    case RASTER_COMMAND_FILL_RECT:
+      rasterFillRect(raster, args[0], args[1], args[2], args[3], color);
+      return;
+    case RASTER_COMMAND_STROKE_RECT:
+      rasterStrokeRect(raster, args[0], args[1], args[2], args[3], color);
+      return;
+    case RASTER_COMMAND_LINE:
+      rasterDrawLine(raster, args[0], args[1], args[2], args[3], color);
+      return;
+    case RASTER_COMMAND_FILL_OVAL:
+      rasterFillOval(raster, args[0], args[1], args[2], args[3], color);
+      return;
+    case RASTER_COMMAND_STROKE_OVAL:
+      rasterStrokeOval(raster, args[0], args[1], args[2], args[3], color);
+      return;
+    case RASTER_COMMAND_POLYGON:
+      break;
+  }
+  panic("rasterDraw: invalid command type %d", (int)type);
+}
+
+/* Limits the pixels [x0, x1) x [y0, y1) to the raster's clip rectangle.
+ * Returns UFALSE if nothing is left */
+static ubool clipBounds(
+    const Raster *raster, long x0, long y0, long x1, long y1, RasterBounds *bounds) {
+  x0 = clampLong(x0, (long)raster->clipMinX, (long)raster->clipMaxX);
+  x1 = clampLong(x1, x0, (long)raster->clipMaxX);
+  y0 = clampLong(y0, (long)raster->clipMinY, (long)raster->clipMaxY);
+  y1 = clampLong(y1, y0, (long)raster->clipMaxY);
+  if (x0 >= x1 || y0 >= y1) {
+    return UFALSE;
+  }
+  bounds->minX = (size_t)x0;
+  bounds->minY = (size_t)y0;
+  bounds->maxX = (size_t)x1;
+  bounds->maxY = (size_t)y1;
+  return UTRUE;
+}
+
+ubool rasterGetBounds(
+    const Raster *raster, RasterCommandType type, const double *args, u32 color,
+    RasterBounds *bounds) {
+  double minX, minY, maxX, maxY;
+  if (type == RASTER_COMMAND_FILL) {
+    return clipBounds(
+        raster,
+        (long)raster->clipMinX, (long)raster->clipMinY,
+        (long)raster->clipMaxX, (long)raster->clipMaxY,
+        bounds);
+  }
+  if (getAlpha(color) == 0) {
+    return UFALSE;
+  }
+  if (type == RASTER_COMMAND_LINE) {
+    /* Padded by a pixel on each side, since the clipped end points
+     * may be off by a rounding error */
+    minX = args[0] < args[2] ? args[0] : args[2];
+    maxX = args[0] < args[2] ? args[2] : args[0];
+    minY = args[1] < args[3] ? args[1] : args[3];
+    maxY = args[1] < args[3] ? args[3] : args[1];
+    return clipBounds(
+        raster,
+        pixelIndex(minX) - 1, pixelIndex(minY) - 1,
+        pixelIndex(maxX) + 2, pixelIndex(maxY) + 2,
+        bounds);
+  }
+  return clipBounds(
+      raster,
+      pixelBoundary(args[0]), pixelBoundary(args[1]),
+      pixelBoundary(args[0] + args[2]), pixelBoundary(args[1] + args[3]),
+      bounds);
+}
+
+ubool rasterGetPolygonBounds(
+    const Raster *raster, const float *points, size_t count, u32 color,
+    RasterBounds *bounds) {
+  double minX, minY, maxX, maxY;
+  size_t i;
+  if (count < 3 || getAlpha(color) == 0) {
+    return UFALSE;
+  }
+  minX = maxX = points[0];
+  minY = maxY = points[1];
+  for (i = 1; i < count; i++) {
+    double x = points[2 * i], y = points[2 * i + 1];
+    minX = x < minX ? x : minX;
+    maxX = x > maxX ? x : maxX;
+    minY = y < minY ? y : minY;
+    maxY = y > maxY ? y : maxY;
+  }
+  return clipBounds(
+      raster,
+      pixelBoundary(minX) - 1, pixelBoundary(minY), pixelBoundary(maxX) + 1, pixelBoundary(maxY),
+      bounds);
+}
+
+void rasterBoundsUnion(RasterBounds *bounds, const RasterBounds *other) {
+  if (bounds->minX >= bounds->maxX || bounds->minY >= bounds->maxY) {
+    *bounds = *other;
+    return;
+  }
+  if (other->minX >= other->maxX || other->minY >= other->maxY) {
+    return;
+  }
+  bounds->minX = other->minX < bounds->minX ? other->minX : bounds->minX;
+  bounds->minY = other->minY < bounds->minY ? other->minY : bounds->minY;
+  bounds->maxX = other->maxX > bounds->maxX ? other->maxX : bounds->maxX;
+  bounds->maxY = other->maxY > bounds->maxY ? other->maxY : bounds->maxY;
+}
+
+/* Appends a command covering the given (already clipped) pixels */
+static void addCommand(
+    RasterCommandList *list, RasterCommandType type, const double *args, u32 color,
+    const RasterBounds *bounds) {
+  RasterCommand *command;
+  if (list->count == list->capacity) {
+    size_t newCapacity = list->capacity < 16 ? 16 : list->capacity * 2;
+    RasterCommand *commands =
+        (RasterCommand *)realloc(list->commands, sizeof(RasterCommand) * newCapacity);
+    if (!commands) {
+      panic("rasterRecord: out of memory");
+    }
+    list->commands = commands;
+    list->capacity = newCapacity;
+  }
+  command = &list->commands[list->count++];
+  command->type = type;
+  command->color = color;
+  command->minX = bounds->minX;
+  command->minY = bounds->minY;
+  command->maxX = bounds->maxX;
+  command->maxY = bounds->maxY;
+  memcpy(command->args, args, sizeof(command->args));
+}
+
+void rasterRecord(
+    RasterCommandList *list, const Raster *raster,
+    RasterCommandType type, const double *args, u32 color) {
+  static const double noArgs[4] = {0, 0, 0, 0};
+  RasterBounds bounds;
+  if (rasterGetBounds(raster, type, args, color, &bounds)) {
+    addCommand(list, type, type == RASTER_COMMAND_FILL ? noArgs : args, color, &bounds);
+  }
+}
+
+void rasterRecordPolygon(
+    RasterCommandList *list, const Raster *raster,
+    const float *points, size_t count, u32 color) {
+  double args[4];
+  RasterBounds bounds;
+  if (!rasterGetPolygonBounds(raster, points, count, color, &bounds)) {
+    return;
+  }
+  args[0] = (double)list->pointCount;
+  args[1] = (double)count;
+  args[2] = args[3] = 0;
+  addCommand(list, RASTER_COMMAND_POLYGON, args, color, &bounds);
+  if (list->pointCount + count > list->pointCapacity) {
+    size_t newCapacity = list->pointCapacity < 64 ? 64 : list->pointCapacity;
+    float *newPoints;
+    while (newCapacity < list->pointCount + count) {
+      newCapacity *= 2;
+    }
+    newPoints = (float *)realloc(list->points, sizeof(float) * 2 * newCapacity);
+    if (!newPoints) {
+      panic("rasterRecordPolygon: out of memory");
+    }
+    list->points = newPoints;
+    list->pointCapacity = newCapacity;
+  }
+  memcpy(list->points + 2 * list->pointCount, points, sizeof(float) * 2 * count);
+  list->pointCount += count;
+}
+
+typedef struct TileJob {
+  const Raster *raster;
+  const RasterCommandList *list;
+  size_t tilesX;
+  const size_t *offsets; /* tile i's commands are indices[offsets[i]..offsets[i + 1]] */
+  const size_t *indices;
+} TileJob;
+
+/* Draws a command limited to its bounds and the given region */
+static void drawCommand(
+    const Raster *target, const RasterCommandList *list, const RasterCommand *command,
+    size_t minX, size_t minY, size_t maxX, size_t maxY) {
+  Raster raster = *target;
+  raster.clipMinX = command->minX > minX ? command->minX : minX;
+  raster.clipMinY = command->minY > minY ? command->minY : minY;
+  raster.clipMaxX = command->maxX < maxX ? command->maxX : maxX;
+  raster.clipMaxY = command->maxY < maxY ? command->maxY : maxY;
+  if (command->type == RASTER_COMMAND_POLYGON) {
+    rasterFillPolygon(
+        &raster, list->points + 2 * (size_t)command->args[0],
+        (size_t)command->args[1], command->color);
+  } else {
+    rasterDraw(&raster, command->type, command->args, command->color);
+  }
+}
+
+static void drawTile(void *context, size_t tile) {
+  const TileJob *job = (const TileJob *)context;
+  size_t tileMinX = (tile % job->tilesX) * TILE_SIZE;
+  size_t tileMinY = (tile / job->tilesX) * TILE_SIZE;
+  size_t i;
+  for (i = job->offsets[tile]; i < job->offsets[tile + 1]; i++) {
+    drawCommand(
+        job->raster, job->list, &job->list->commands[job->indices[i]],
+        tileMinX, tileMinY, tileMinX + TILE_SIZE, tileMinY + TILE_SIZE);
+  }
+}
+
+void rasterFlush(Raster *raster, RasterCommandList *list) {
+  size_t tilesX = (raster->width + TILE_SIZE - 1) / TILE_SIZE;
+  size_t tilesY = (raster->height + TILE_SIZE - 1) / TILE_SIZE;
+  size_t tileCount = tilesX * tilesY, i, total = 0;
+  size_t *offsets, *cursors, *indices;
+  TileJob job;
+
+  if (list->count == 0 || tileCount == 0) {
+    list->count = list->pointCount = 0;
+    return;
+  }
+
+  /* With only one thread, tiling would just repeat each shape's setup
+   * for every tile it touches */
+  if (getParallelThreadCount() == 1) {
+    for (i = 0; i < list->count; i++) {
+      drawCommand(raster, list, &list->commands[i], 0, 0, raster->width, raster->height);
+    }
+    list->count = list->pointCount = 0;
+    return;
+  }
+
+  /* Count the commands in each tile, then place each command's index
+   * into every tile it touches, keeping the recorded order */
+  offsets = (size_t *)calloc(2 * (tileCount + 1), sizeof(size_t));
+  if (!offsets) {
+    panic("rasterFlush: out of memory");
+  }
+  cursors = offsets + tileCount + 1;
+  for (i = 0; i < list->count; i++) {
+    const RasterCommand *command = &list->commands[i];
+    size_t tx, ty;
+    for (ty = command->minY / TILE_SIZE; ty <= (command->maxY - 1) / TILE_SIZE; ty++) {
+      for (tx = command->minX / TILE_SIZE; tx <= (command->maxX - 1) / TILE_SIZE; tx++) {
+        offsets[ty * tilesX + tx + 1]++;
+      }
+    }
+  }
+  for (i = 0; i < tileCount; i++) {
+    offsets[i + 1] += offsets[i];
+    cursors[i] = offsets[i];
+  }
+  total = offsets[tileCount];
+  indices = (size_t *)malloc(sizeof(size_t) * (total ? total : 1));
+  if (!indices) {
+    panic("rasterFlush: out of memory");
+  }
+  for (i = 0; i < list->count; i++) {
+    const RasterCommand *command = &list->commands[i];
+    size_t tx, ty;
+    for (ty = command->minY / TILE_SIZE; ty <= (command->maxY - 1) / TILE_SIZE; ty++) {
+      for (tx = command->minX / TILE_SIZE; tx <= (command->maxX - 1) / TILE_SIZE; tx++) {
+        indices[cursors[ty * tilesX + tx]++] = i;
+      }
+    }
+  }
+
+  job.raster = raster;
+  job.list = list;
+  job.tilesX = tilesX;
+  job.offsets = offsets;
+  job.indices = indices;
+  runParallel(tileCount, drawTile, &job);
+
+  free(indices);
+  free(offsets);
+  list->count = list->pointCount = 0;
+}
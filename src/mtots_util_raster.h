@@ -0,0 +1,181 @@
+#ifndef mtots_util_raster_h
+#define mtots_util_raster_h
+
+#include "mtots_common.h"
+
+/* Software rasterizer over packed 32-bit RGBA8 pixels.
+ *
+ * A pixel is the 4 bytes red, green, blue, alpha in memory order,
+ * loaded into a u32 with memcpy. Every operation treats the four bytes
+ * as independent lanes, so the byte order of the host does not matter.
+ *
+ * Shapes are filled with the pixel-center rule: a pixel (x, y) is
+ * covered when its center (x + 0.5, y + 0.5) lies inside the shape,
+ * with the left and top edges inclusive and the right and bottom edges
+ * exclusive. Everything is drawn in whole spans, and spans are clipped
+ * against the raster's clip rectangle before any pixel is touched.
+ *
+ * Colors with an alpha of 255 are stored directly. Other colors are
+ * blended over the existing pixels ("source over"). */
+
+typedef struct Raster {
+  u32 *pixels;
+  size_t width;
+  size_t height;
+  size_t stride; /* in pixels */
+
+  /* Clip rectangle, as half open pixel ranges */
+  size_t clipMinX;
+  size_t clipMinY;
+  size_t clipMaxX;
+  size_t clipMaxY;
+} Raster;
+
+void initRaster(Raster *raster, u32 *pixels, size_t width, size_t height, size_t stride);
+
+/* Sets the clip rectangle to the pixels covered by the given rectangle,
+ * intersected with the raster's bounds */
+void rasterSetClip(Raster *raster, double minX, double minY, double width, double height);
+void rasterResetClip(Raster *raster);
+
+/* Packs and unpacks a pixel in memory order */
+u32 rasterPixel(u8 red, u8 green, u8 blue, u8 alpha);
+void rasterUnpackPixel(u32 pixel, u8 *red, u8 *green, u8 *blue, u8 *alpha);
+
+/* Blends 'color' over 'count' consecutive pixels */
+void rasterBlendSpan(u32 *pixels, size_t count, u32 color);
+
+/* Stores 'color' into every pixel inside the clip rectangle,
+ * without blending */
+void rasterFill(Raster *raster, u32 color);
+
+/* Draws a horizontal span of pixels [minX, maxX) on row y.
+ * Coordinates outside the clip rectangle are dropped */
+void rasterSpan(Raster *raster, long y, long minX, long maxX, u32 color);
+
+void rasterFillRect(
+    Raster *raster, double minX, double minY, double width, double height, u32 color);
+void rasterStrokeRect(
+    Raster *raster, double minX, double minY, double width, double height, u32 color);
+
+/* One pixel wide line between the pixels containing the two end points,
+ * including both ends */
+void rasterDrawLine(Raster *raster, double x0, double y0, double x1, double y1, u32 color);
+
+/* Fills a polygon given as 'count' (x, y) pairs using the nonzero
+ * winding rule */
+void rasterFillPolygon(Raster *raster, const float *points, size_t count, u32 color);
+
+/* Ellipse with the given bounding rectangle */
+void rasterFillOval(
+    Raster *raster, double minX, double minY, double width, double height, u32 color);
+
+/* One pixel wide outline of the ellipse with the given bounding rectangle */
+void rasterStrokeOval(
+    Raster *raster, double minX, double minY, double width, double height, u32 color);
+
+/* Copies the 'src' region (srcMinX, srcMinY, srcWidth, srcHeight) into the
+ * destination region with nearest neighbour scaling. Pixels are stored
+ * without blending. 'src' may share pixels with 'dst' */
+void rasterCopy(
+    Raster *dst, double dstMinX, double dstMinY, double dstWidth, double dstHeight,
+    const Raster *src, double srcMinX, double srcMinY, double srcWidth, double srcHeight,
+    ubool flipX, ubool flipY);
+
+/* Blends 'color' through an 8-bit coverage mask with its top left
+ * corner at (x, y). Each mask value scales the color's alpha, so a
+ * value of 255 draws the color as 'rasterSpan' would and 0 leaves the
+ * pixel unchanged. Used to draw glyphs from a font atlas */
+void rasterBlendMask(
+    Raster *raster, long x, long y,
+    const u8 *mask, size_t maskStride, size_t width, size_t height, u32 color);
+
+/* Recorded drawing
+ *
+ * Instead of being drawn right away, commands can be appended to a
+ * RasterCommandList. 'rasterFlush' then splits the raster into tiles,
+ * bins each command into the tiles its bounding box touches, and draws
+ * the tiles in parallel (see mtots_util_parallel.h).
+ *
+ * Within a tile, commands are drawn in the order they were recorded,
+ * and no shape's pixels depend on the clip rectangle used to draw it,
+ * so the result is identical to drawing every command immediately. */
+
+typedef enum RasterCommandType {
+  RASTER_COMMAND_FILL,
+  RASTER_COMMAND_FILL_RECT,
+  RASTER_COMMAND_STROKE_RECT,
+  RASTER_COMMAND_LINE,
+  RASTER_COMMAND_FILL_OVAL,
+  RASTER_COMMAND_STROKE_OVAL,
+  RASTER_COMMAND_POLYGON
+} RasterCommandType;
+
+typedef struct RasterCommand {
+  RasterCommandType type;
+  u32 color;
+
+  /* Pixels the command may touch, limited to the clip rectangle
+   * that was set when the command was recorded */
+  size_t minX;
+  size_t minY;
+  size_t maxX;
+  size_t maxY;
+
+  /* (minX, minY, width, height) for rects and ovals, (x0, y0, x1, y1)
+   * for lines, and (first point, point count) for polygons */
+  double args[4];
+} RasterCommand;
+
+/* Pixels [minX, maxX) x [minY, maxY). Empty when minX >= maxX or
+ * minY >= maxY */
+typedef struct RasterBounds {
+  size_t minX;
+  size_t minY;
+  size_t maxX;
+  size_t maxY;
+} RasterBounds;
+
+typedef struct RasterCommandList {
+  RasterCommand *commands;
+  size_t count;
+  size_t capacity;
+  float *points; /* (x, y) pairs used by polygons */
+  size_t pointCount;
+  size_t pointCapacity;
+} RasterCommandList;
+
+void initRasterCommandList(RasterCommandList *list);
+void freeRasterCommandList(RasterCommandList *list);
+
+/* Gets the pixels that drawing a command other than RASTER_COMMAND_POLYGON
+ * may touch, limited to the clip rectangle. These are the bounds commands
+ * are recorded with. Returns UFALSE if the command cannot touch any pixels */
+ubool rasterGetBounds(
+    const Raster *raster, RasterCommandType type, const double *args, u32 color,
+    RasterBounds *bounds);
+ubool rasterGetPolygonBounds(
+    const Raster *raster, const float *points, size_t count, u32 color,
+    RasterBounds *bounds);
+
+/* Grows 'bounds' to also cover 'other' */
+void rasterBoundsUnion(RasterBounds *bounds, const RasterBounds *other);
+
+/* Draws any command other than RASTER_COMMAND_POLYGON immediately */
+void rasterDraw(Raster *raster, RasterCommandType type, const double *args, u32 color);
+
+/* Records a command other than RASTER_COMMAND_POLYGON, capturing the
+ * raster's current clip rectangle */
+void rasterRecord(
+    RasterCommandList *list, const Raster *raster,
+    RasterCommandType type, const double *args, u32 color);
+
+/* Records a polygon. The points are copied into the list */
+void rasterRecordPolygon(
+    RasterCommandList *list, const Raster *raster,
+    const float *points, size_t count, u32 color);
+
+/* Draws all recorded commands and empties the list */
+void rasterFlush(Raster *raster, RasterCommandList *list);
+
+#endif /*mtots_util_raster_h*/
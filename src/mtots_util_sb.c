@@ -5,14 +5,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "mtots_util_dtoa.h"
 #include "mtots_util_error.h"
+#include "mtots_util_extmem.h"
 
 static void setSBLength(StringBuilder *sb, size_t newLength) {
   if (sb->capacity < newLength + 1) {
+    size_t oldCapacity = sb->capacity;
     while (sb->capacity < newLength + 1) {
       sb->capacity = sb->capacity < 8 ? 8 : sb->capacity * 2;
     }
     sb->buffer = (char *)realloc(sb->buffer, sb->capacity);
+    trackExternalAllocation(
+        EXTERNAL_MEMORY_STRING_BUILDER, sb->capacity - oldCapacity);
   }
   sb->length = newLength;
   sb->buffer[newLength] = '\0';
@@ -25,6 +30,7 @@ void initStringBuilder(StringBuilder *sb) {
 
 void freeStringBuilder(StringBuilder *sb) {
   free(sb->buffer);
+  trackExternalFree(EXTERNAL_MEMORY_STRING_BUILDER, sb->capacity);
 }
 
 void sbclear(StringBuilder *sb) {
@@ -39,18 +45,13 @@ String *sbstring(StringBuilder *sb) {
 }
 
 void sbputnumber(StringBuilder *sb, double number) {
-  if (number != number) {
-    sbprintf(sb, "nan");
-    return;
-  }
-  /* Trim the trailing zeros in the number representation */
-  sbprintf(sb, "%f", number);
-  while (sb->length > 0 && sb->buffer[sb->length - 1] == '0') {
-    sb->buffer[--sb->length] = '\0';
-  }
-  if (sb->length > 0 && sb->buffer[sb->length - 1] == '.') {
-    sb->buffer[--sb->length] = '\0';
-  }
+  char buffer[FORMAT_DOUBLE_BUFFER_SIZE];
+  sbputstrlen(sb, buffer, formatDouble(number, buffer));
+}
+
+void sbputfloat(StringBuilder *sb, float number) {
+  char buffer[FORMAT_DOUBLE_BUFFER_SIZE];
+  sbputstrlen(sb, buffer, formatFloat(number, buffer));
 }
 
 void sbputchar(StringBuilder *sb, char ch) {
@@ -14,6 +14,10 @@ void freeStringBuilder(StringBuilder *sb);
 void sbclear(StringBuilder *sb);
 String *sbstring(StringBuilder *sb);
 void sbputnumber(StringBuilder *sb, double number);
+
+/* Like sbputnumber, but for values stored as floats, so that they
+ * are not written with the noise of widening to double */
+void sbputfloat(StringBuilder *sb, float number);
 void sbputchar(StringBuilder *sb, char ch);
 void sbputstrlen(StringBuilder *sb, const char *chars, size_t byteLength);
 void sbputstr(StringBuilder *sb, const char *string);
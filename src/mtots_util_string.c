@@ -273,6 +273,7 @@ CommonStrings *getCommonStrings(void) {
     cs->minY = internForeverCString("minY");
     cs->maxX = internForeverCString("maxX");
     cs->maxY = internForeverCString("maxY");
+    cs->image = internForeverCString("image");
     {
       unsigned char ch;
       cs->oneCharAsciiStrings[0] = cs->empty;
@@ -62,6 +62,7 @@ typedef struct CommonStrings {
   String *minY;
   String *maxX;
   String *maxY;
+  String *image;
   String *oneCharAsciiStrings[128];
 } CommonStrings;
 
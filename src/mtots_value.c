@@ -223,6 +223,23 @@ Vector asVector(Value value) {
   vector.z = value.as.vector.z;
   return vector;
 }
+Color asColor(Value value) {
+  if (!isColor(value)) {
+    panic("Expected Color but got %s", getKindName(value));
+  }
+  return value.as.color;
+}
+Rect asRect(Value value) {
+  Rect rect;
+  if (!isRect(value)) {
+    panic("Expected Rect but got %s", getKindName(value));
+  }
+  rect.minX = partsToF24(value.extra.exponents[0], value.as.rect.significands[0]);
+  rect.minY = partsToF24(value.extra.exponents[1], value.as.rect.significands[1]);
+  rect.width = partsToF24(value.extra.exponents[2], value.as.rect.significands[2]);
+  rect.height = partsToF24(value.extra.exponents[3], value.as.rect.significands[3]);
+  return rect;
+}
 TypedPointer asPointer(Value value) {
   TypedPointer pointer;
   if (!isPointer(value)) {
@@ -335,6 +352,19 @@ Value valVector(Vector vector) {
   v.as.vector.z = vector.z;
   return v;
 }
+Value valColor(Color color) {
+  Value v = {VAL_COLOR};
+  v.as.color = color;
+  return v;
+}
+Value valRect(Rect rect) {
+  Value v = {VAL_RECT};
+  f24ToParts(rect.minX, &v.extra.exponents[0], &v.as.rect.significands[0]);
+  f24ToParts(rect.minY, &v.extra.exponents[1], &v.as.rect.significands[1]);
+  f24ToParts(rect.width, &v.extra.exponents[2], &v.as.rect.significands[2]);
+  f24ToParts(rect.height, &v.extra.exponents[3], &v.as.rect.significands[3]);
+  return v;
+}
 Value valPointer(TypedPointer pointer) {
   Value v = {VAL_POINTER};
   v.extra.tpm = pointer.metadata;
@@ -363,6 +393,22 @@ Vector newVector(float x, float y, float z) {
   vector.z = z;
   return vector;
 }
+Color newColor(u8 red, u8 green, u8 blue, u8 alpha) {
+  Color color;
+  color.red = red;
+  color.green = green;
+  color.blue = blue;
+  color.alpha = alpha;
+  return color;
+}
+Rect newRect(float minX, float minY, float width, float height) {
+  Rect rect;
+  rect.minX = minX;
+  rect.minY = minY;
+  rect.width = width;
+  rect.height = height;
+  return rect;
+}
 
 TypedPointer newConstTypedPointer(const void *pointer, PointerType type) {
   TypedPointer ret;
@@ -430,6 +476,10 @@ const char *getKindName(Value value) {
       return "RangeIterator";
     case VAL_VECTOR:
       return "Vector";
+    case VAL_COLOR:
+      return "Color";
+    case VAL_RECT:
+      return "Rect";
     case VAL_POINTER:
       return "Pointer";
     case VAL_FILE_DESCRIPTOR:
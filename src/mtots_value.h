@@ -25,6 +25,8 @@ typedef enum ValueType {
 
   /* other useful types */
   VAL_VECTOR,
+  VAL_COLOR,
+  VAL_RECT,
 
   /* dangerous, but useful for interfacing with C */
   VAL_POINTER,
@@ -61,6 +63,26 @@ typedef struct VectorPartial {
   float z;
 } VectorPartial;
 
+typedef struct Color {
+  u8 red;
+  u8 green;
+  u8 blue;
+  u8 alpha;
+} Color;
+
+typedef struct Rect {
+  float minX;
+  float minY;
+  float width;
+  float height;
+} Rect;
+
+/* Each component of a Rect is stored as an f24 (see partsToF24),
+ * with the exponents in Value.extra and the significands here */
+typedef struct RectPartial {
+  i16 significands[4];
+} RectPartial;
+
 typedef enum PointerType {
   POINTER_TYPE_VOID,
 
@@ -112,6 +134,7 @@ typedef struct Value {
     i32 integer;              /* for Range and RangeIterator */
     float floatingPoint;      /* for Vector */
     TypedPointerMetadata tpm; /* for TypedPointer */
+    i8 exponents[4];          /* for Rect */
   } extra;                    /* 4-bytes */
 
   /*
@@ -127,6 +150,8 @@ typedef struct Value {
     Sentinel sentinel;
     RangePartial range;
     VectorPartial vector;
+    Color color;
+    RectPartial rect;
     void *voidPointer;            /* for TypedPointer */
     const void *constVoidPointer; /* for TypedPointer */
     FileDescriptor fileDescriptor;
@@ -158,6 +183,8 @@ typedef struct ValueArray {
 #define isRange(value) ((value).type == VAL_RANGE)
 #define isRangeIterator(value) ((value).type == VAL_RANGE_ITERATOR)
 #define isVector(value) ((value).type == VAL_VECTOR)
+#define isColor(value) ((value).type == VAL_COLOR)
+#define isRect(value) ((value).type == VAL_RECT)
 #define isPointer(value) ((value).type == VAL_POINTER)
 #define isFileDescriptor(value) ((value).type == VAL_FILE_DESCRIPTOR)
 #define isObj(value) ((value).type == VAL_OBJ)
@@ -185,6 +212,8 @@ CFunction *asCFunction(Value value);
 Range asRange(Value value);
 RangeIterator asRangeIterator(Value value);
 Vector asVector(Value value);
+Color asColor(Value value);
+Rect asRect(Value value);
 TypedPointer asPointer(Value value);
 FileDescriptor asFileDescriptor(Value value);
 Obj *asObj(Value value);
@@ -249,9 +278,13 @@ Value valRangeIterator(RangeIterator rangeIterator);
 Value valPointer(TypedPointer pointer);
 Value valFileDescriptor(FileDescriptor fd);
 Value valVector(Vector vector);
+Value valColor(Color color);
+Value valRect(Rect rect);
 Value valObjExplicit(Obj *object);
 
 Vector newVector(float x, float y, float z);
+Color newColor(u8 red, u8 green, u8 blue, u8 alpha);
+Rect newRect(float minX, float minY, float width, float height);
 TypedPointer newConstTypedPointer(const void *pointer, PointerType type);
 TypedPointer newTypedPointer(void *pointer, PointerType type);
 
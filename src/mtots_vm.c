@@ -10,10 +10,12 @@
 #include "mtots_assumptions.h"
 #include "mtots_class_buffer.h"
 #include "mtots_class_class.h"
+#include "mtots_class_color.h"
 #include "mtots_class_dict.h"
 #include "mtots_class_list.h"
 #include "mtots_class_number.h"
 #include "mtots_class_pointer.h"
+#include "mtots_class_rect.h"
 #include "mtots_class_str.h"
 #include "mtots_class_vector.h"
 #include "mtots_globals.h"
@@ -25,21 +27,155 @@ VM vm;
 
 static Status invoke(String *name, i16 argCount);
 static Status callClosure(ObjClosure *closure, i16 argCount);
+static Status startContinuation(ptrdiff_t slotsOffset, i16 argCount, ubool consummate);
+static Status run(i32 returnFrameCount);
 
-static void resetStack(void) {
+static void initStack(void) {
+  vm.stack = (Value *)malloc(sizeof(Value) * STACK_INITIAL_CAPACITY);
+  if (vm.stack == NULL) {
+    panic("out of memory");
+  }
+  vm.stackEnd = vm.stack + STACK_INITIAL_CAPACITY;
   vm.stackTop = vm.stack;
+  vm.retiredStacks = NULL;
+  vm.retiredStackCount = 0;
+  vm.frameBlocks = NULL;
+  vm.frameBlockCount = 0;
   vm.frameCount = 0;
+  vm.maxFrameCount = DEFAULT_MAX_FRAME_COUNT;
   vm.openUpvalues = NULL;
+  vm.scheduledContinuation = NULL;
+  vm.scheduledArgCount = 0;
+}
+
+static void freeStack(void) {
+  size_t i;
+  i32 j;
+  for (i = 0; i < vm.retiredStackCount; i++) {
+    free(vm.retiredStacks[i]);
+  }
+  free(vm.retiredStacks);
+  for (j = 0; j < vm.frameBlockCount; j++) {
+    free(vm.frameBlocks[j]);
+  }
+  free(vm.frameBlocks);
+  free(vm.stack);
+  vm.retiredStacks = NULL;
+  vm.retiredStackCount = 0;
+  vm.frameBlocks = NULL;
+  vm.frameBlockCount = 0;
+  vm.stack = vm.stackTop = vm.stackEnd = NULL;
+}
+
+/* Moves the value stack into a larger buffer so that at least
+ * 'minFree' slots are available above the stack top.
+ * All pointers into the stack that the VM knows about (the stack top,
+ * the slots of each CallFrame and open upvalues) are fixed up */
+static void growStack(size_t minFree) {
+  Value *oldStack = vm.stack, *newStack, **retiredStacks;
+  size_t used = vm.stackTop - vm.stack;
+  size_t newCapacity = (size_t)(vm.stackEnd - vm.stack) * 2;
+  ObjUpvalue *upvalue;
+  i32 i;
+
+  while (newCapacity - used < minFree) {
+    newCapacity *= 2;
+  }
+
+  newStack = (Value *)malloc(sizeof(Value) * newCapacity);
+  retiredStacks = (Value **)realloc(
+      vm.retiredStacks, sizeof(Value *) * (vm.retiredStackCount + 1));
+  if (newStack == NULL || retiredStacks == NULL) {
+    panic("out of memory (while growing the stack)");
+  }
+  memcpy(newStack, oldStack, sizeof(Value) * used);
+
+  for (i = 0; i < vm.frameCount; i++) {
+    CallFrame *frame = VM_FRAME(i);
+    frame->slots = newStack + (frame->slots - oldStack);
+  }
+  for (upvalue = vm.openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+    upvalue->location = newStack + (upvalue->location - oldStack);
+  }
+
+  vm.stack = newStack;
+  vm.stackTop = newStack + used;
+  vm.stackEnd = newStack + newCapacity;
+
+  retiredStacks[vm.retiredStackCount++] = oldStack;
+  vm.retiredStacks = retiredStacks;
+}
+
+static void reserveStack(size_t slots) {
+  if ((size_t)(vm.stackEnd - vm.stackTop) < slots) {
+    growStack(slots);
+  }
+}
+
+static void ensureStackReserve(void) {
+  reserveStack(STACK_FRAME_RESERVE);
+}
+
+static Status checkFrameCount(void) {
+  if (vm.frameCount >= vm.maxFrameCount) {
+    runtimeError(
+        "Stack overflow (maximum call depth of %ld exceeded)",
+        (long)vm.maxFrameCount);
+    return STATUS_ERROR;
+  }
+  return STATUS_OK;
+}
+
+static CallFrame *pushFrame(void) {
+  if (vm.frameCount >= vm.frameBlockCount * FRAMES_PER_BLOCK) {
+    CallFrame **frameBlocks = (CallFrame **)realloc(
+        vm.frameBlocks, sizeof(CallFrame *) * (vm.frameBlockCount + 1));
+    if (frameBlocks == NULL) {
+      panic("out of memory (while adding a call frame)");
+    }
+    vm.frameBlocks = frameBlocks;
+    frameBlocks[vm.frameBlockCount] =
+        (CallFrame *)malloc(sizeof(CallFrame) * FRAMES_PER_BLOCK);
+    if (frameBlocks[vm.frameBlockCount] == NULL) {
+      panic("out of memory (while adding a call frame)");
+    }
+    vm.frameBlockCount++;
+  }
+  vm.frameCount++;
+  return VM_FRAME(vm.frameCount - 1);
+}
+
+Status setMaxFrameCount(i32 maxFrameCount) {
+  if (maxFrameCount < 1) {
+    runtimeError("The maximum call depth must be positive, but got %ld",
+                 (long)maxFrameCount);
+    return STATUS_ERROR;
+  }
+  if (maxFrameCount < vm.frameCount) {
+    runtimeError(
+        "The maximum call depth (%ld) cannot be less than the "
+        "current call depth (%ld)",
+        (long)maxFrameCount, (long)vm.frameCount);
+    return STATUS_ERROR;
+  }
+  vm.maxFrameCount = maxFrameCount;
+  return STATUS_OK;
 }
 
 static void printStackToStringBuffer(StringBuilder *out) {
-  i16 i;
+  i32 i;
   for (i = vm.frameCount - 1; i >= 0; i--) {
-    CallFrame *frame = &vm.frames[i];
-    ObjThunk *thunk = frame->closure->thunk;
-    size_t instruction = frame->ip - thunk->chunk.code - 1;
+    CallFrame *frame = VM_FRAME(i);
+    ObjThunk *thunk;
+    size_t instruction;
+    if (frame->closure == NULL) {
+      continue; /* continuation frame */
+    }
+    thunk = frame->closure->thunk;
+    instruction = frame->ip - thunk->chunk.code - 1;
     sbprintf(
-        out, "[line %d] in ", thunk->chunk.lines[instruction]);
+        out, "[line %lu] in ",
+        (unsigned long)getChunkLine(&thunk->chunk, instruction));
     if (thunk->name == NULL) {
       if (thunk->moduleName == NULL) {
         sbprintf(out, "[script]\n");
@@ -86,7 +222,7 @@ static void initNoMethodClass(ObjClass **clsptr, const char *name) {
 void initVM(void) {
   setErrorContextProvider(printStackToStringBuffer);
   checkAssumptions();
-  resetStack();
+  initStack();
   initMemory(&vm.memory);
   vm.runOnFinish = NULL;
   vm.enableGCLogs = UFALSE;
@@ -108,6 +244,8 @@ void initVM(void) {
   vm.numberClass = NULL;
   vm.stringClass = NULL;
   vm.vectorClass = NULL;
+  vm.colorClass = NULL;
+  vm.rectClass = NULL;
   vm.listClass = NULL;
   vm.frozenListClass = NULL;
   vm.dictClass = NULL;
@@ -130,6 +268,8 @@ void initVM(void) {
   initNumberClass();
   initStringClass();
   initVectorClass();
+  initColorClass();
+  initRectClass();
   initPointerClass();
   initNoMethodClass(&vm.fileDescriptorClass, "FileDescriptor");
   initBufferClass();
@@ -165,20 +305,25 @@ void freeVM(void) {
   freeMap(&vm.frozenLists);
   freeMap(&vm.frozenDicts);
   freeObjects();
+  freeStack();
 }
 
 void push(Value value) {
-  if (vm.stackTop + 1 > vm.stack + STACK_MAX) {
+#if DEBUG_STACK_CHECKS
+  if (vm.stackTop >= vm.stackEnd) {
     panic("stack overflow");
   }
+#endif
   *vm.stackTop = value;
   vm.stackTop++;
 }
 
 Value pop(void) {
+#if DEBUG_STACK_CHECKS
   if (vm.stackTop <= vm.stack) {
     panic("stack underflow");
   }
+#endif
   vm.stackTop--;
   return *vm.stackTop;
 }
@@ -231,8 +376,14 @@ static void prepCFunction(CFunction *cfunc) {
 
 static Status callCFunctionWithKwArgs(CFunction *cfunc, i16 argc) {
   /* TOS is assumed to be the kwargs dict, so args must start at TOS - argc - 1 */
-  Value *argv = vm.stackTop - argc - 1, *returnSlot = argv - 1;
-  ObjDict *kwargs = AS_DICT_UNSAFE(vm.stackTop[-1]);
+  Value *argv, result = valNil();
+  ObjDict *kwargs;
+  ptrdiff_t argvOffset;
+
+  ensureStackReserve();
+  argv = vm.stackTop - argc - 1;
+  argvOffset = argv - vm.stack;
+  kwargs = AS_DICT_UNSAFE(vm.stackTop[-1]);
 
   prepCFunction(cfunc); /* potential GC */
 
@@ -274,20 +425,29 @@ static Status callCFunctionWithKwArgs(CFunction *cfunc, i16 argc) {
     return STATUS_ERROR;
   }
 
-  if (cfunc->body(argc, argv, returnSlot)) {
-    vm.stackTop = argv;
+  if (cfunc->body(argc, argv, &result)) {
+    if (vm.scheduledContinuation) {
+      return startContinuation(argvOffset - 1, argc, UFALSE);
+    }
+    /* the body may have called back into the VM and moved the stack */
+    vm.stackTop = vm.stack + argvOffset;
+    vm.stackTop[-1] = result;
     return STATUS_OK;
   }
 
+  vm.scheduledContinuation = NULL;
   return STATUS_ERROR;
 }
 
 static Status setupCallClosure(ObjClosure *closure, i16 argCount);
 
 static Status setupClosureWithKwArgs(ObjClosure *closure, i16 argc) {
-  ObjDict *kwargs = AS_DICT_UNSAFE(vm.stackTop[-1]);
+  ObjDict *kwargs;
   i16 requiredArgc = closure->thunk->arity - closure->thunk->defaultArgsCount;
 
+  reserveStack(closure->thunk->maxStackSize);
+  kwargs = AS_DICT_UNSAFE(vm.stackTop[-1]);
+
   /* We have to be careful here - kwargs is no longer safe from GC */
   vm.stackTop--;
 
@@ -433,8 +593,9 @@ static Status invokeWithKwArgs(String *name, i16 argCount) {
   return invokeFromClassWithKwArgs(klass, name, argCount);
 }
 
-static Status callCFunction(CFunction *cfunc, i16 argCount) {
-  Value result = valNil(), *argsStart;
+static Status callCFunction(CFunction *cfunc, i16 argCount, ubool consummate) {
+  Value result = valNil();
+  ptrdiff_t argsOffset;
   Status status;
   if (cfunc->arity != argCount) {
     /* not an exact match for the arity
@@ -461,11 +622,17 @@ static Status callCFunction(CFunction *cfunc, i16 argCount) {
       return STATUS_ERROR;
     }
   }
-  argsStart = vm.stackTop - argCount;
-  status = cfunc->body(argCount, argsStart, &result);
+  ensureStackReserve();
+  argsOffset = vm.stackTop - argCount - vm.stack;
+  status = cfunc->body(argCount, vm.stack + argsOffset, &result);
   if (!status) {
+    vm.scheduledContinuation = NULL;
     return STATUS_ERROR;
   }
+  /* the body may have called back into the VM and moved the stack */
+  if (vm.scheduledContinuation) {
+    return startContinuation(argsOffset - 1, argCount, consummate);
+  }
   vm.stackTop -= argCount + 1;
   push(result);
   return STATUS_OK;
@@ -474,6 +641,8 @@ static Status callCFunction(CFunction *cfunc, i16 argCount) {
 static Status setupCallClosure(ObjClosure *closure, i16 argCount) {
   CallFrame *frame;
 
+  reserveStack(closure->thunk->maxStackSize);
+
   if (argCount < closure->thunk->arity &&
       argCount + closure->thunk->defaultArgsCount >=
           closure->thunk->arity) {
@@ -491,12 +660,11 @@ static Status setupCallClosure(ObjClosure *closure, i16 argCount) {
     return STATUS_ERROR;
   }
 
-  if (vm.frameCount == FRAMES_MAX) {
-    runtimeError("Stack overflow");
+  if (!checkFrameCount()) {
     return STATUS_ERROR;
   }
 
-  frame = &vm.frames[vm.frameCount++];
+  frame = pushFrame();
   frame->closure = closure;
   frame->ip = closure->thunk->chunk.code;
   frame->slots = vm.stackTop - argCount - 1;
@@ -609,7 +777,7 @@ static void defineStaticMethod(String *name) {
   pop();
 }
 
-static ubool isFalsey(Value value) {
+ubool isFalsey(Value value) {
   return isNil(value) ||
          (isBool(value) && !value.as.boolean) ||
          (isNumber(value) && value.as.number == 0);
@@ -630,9 +798,167 @@ static void concatenate(void) {
   push(valString(result));
 }
 
-static Status run(void) {
-  i16 returnFrameCount = vm.frameCount - 1;
-  CallFrame *frame = &vm.frames[vm.frameCount - 1];
+Status scheduleCall(i16 argCount, NativeContinuation *continuation) {
+  if (vm.scheduledContinuation) {
+    panic("scheduleCall() called while another call is already scheduled");
+  }
+  vm.scheduledContinuation = continuation;
+  vm.scheduledArgCount = argCount;
+  return STATUS_OK;
+}
+
+/* Finishes the continuation frame at the top of the frame stack,
+ * replacing the CFunction's slot with the result */
+static void finishContinuation(Value result) {
+  CallFrame *frame = VM_FRAME(vm.frameCount - 1);
+  vm.frameCount--;
+  vm.stackTop = frame->slots;
+  push(result);
+}
+
+/* Makes the call scheduled for the continuation frame at the top of the
+ * frame stack.
+ *
+ * Calls that complete without running any bytecode (e.g. to CFunctions)
+ * are resumed right away. This repeats until either the scheduled call
+ * pushes a closure's frame (in which case run() will resume the
+ * continuation when that frame returns), or the continuation finishes
+ * (in which case its frame is popped and the result is on the stack). */
+static Status driveContinuation(void) {
+  CallFrame *frame = VM_FRAME(vm.frameCount - 1);
+  for (;;) {
+    i16 argCount = vm.scheduledArgCount;
+    Value result, out = valNil();
+
+    frame->continuation = vm.scheduledContinuation;
+    frame->stackSize = (i32)(vm.stackTop - argCount - 1 - frame->slots);
+    vm.scheduledContinuation = NULL;
+
+    if (!callFunctionOrMethod(vm.stackTop[-argCount - 1], argCount, UFALSE)) {
+      return STATUS_ERROR;
+    }
+    if (VM_FRAME(vm.frameCount - 1) != frame) {
+      return STATUS_OK;
+    }
+
+    result = pop();
+    if (!frame->continuation->resume(frame->argCount, frame->slots + 1, result, &out)) {
+      vm.scheduledContinuation = NULL;
+      return STATUS_ERROR;
+    }
+    if (!vm.scheduledContinuation) {
+      finishContinuation(out);
+      return STATUS_OK;
+    }
+  }
+}
+
+/* Resumes the continuation frame at the top of the frame stack with
+ * the value at the top of the value stack */
+static Status resumeContinuation(void) {
+  CallFrame *frame = VM_FRAME(vm.frameCount - 1);
+  Value result = pop(), out = valNil();
+  if (!frame->continuation->resume(frame->argCount, frame->slots + 1, result, &out)) {
+    vm.scheduledContinuation = NULL;
+    return STATUS_ERROR;
+  }
+  if (vm.scheduledContinuation) {
+    return driveContinuation();
+  }
+  finishContinuation(out);
+  return STATUS_OK;
+}
+
+/* Resumes continuation frames at the top of the frame stack (above
+ * 'floor') until there is a closure frame to run, or there are no
+ * frames left above 'floor' */
+static Status settleContinuations(i32 floor) {
+  while (vm.frameCount > floor &&
+         VM_FRAME(vm.frameCount - 1)->closure == NULL) {
+    if (!resumeContinuation()) {
+      return STATUS_ERROR;
+    }
+  }
+  return STATUS_OK;
+}
+
+/* Called when a runtime error is propagating.
+ * Looks for a continuation frame above 'floor' that can recover from
+ * errors, unwinds the stack to it and lets it recover.
+ * Returns STATUS_ERROR if no continuation could recover */
+static Status recoverFromError(i32 floor) {
+  i32 i = vm.frameCount - 1;
+  for (; i >= floor; i--) {
+    CallFrame *frame = VM_FRAME(i);
+    Value out = valNil();
+    if (frame->closure != NULL || frame->continuation->recover == NULL) {
+      continue;
+    }
+
+    closeUpvalues(frame->slots + frame->stackSize);
+    vm.stackTop = frame->slots + frame->stackSize;
+    vm.frameCount = i + 1;
+
+    if (!frame->continuation->recover(frame->argCount, frame->slots + 1, &out)) {
+      vm.scheduledContinuation = NULL;
+      continue;
+    }
+    if (vm.scheduledContinuation) {
+      if (!driveContinuation()) {
+        i = vm.frameCount;
+        continue;
+      }
+    } else {
+      finishContinuation(out);
+    }
+    if (!settleContinuations(floor)) {
+      i = vm.frameCount;
+      continue;
+    }
+    return STATUS_OK;
+  }
+  return STATUS_ERROR;
+}
+
+/* Called when a CFunction returns after scheduling a call.
+ * 'slotsOffset' is the offset of the CFunction's own slot on the stack.
+ *
+ * If 'consummate' is true, the CFunction's continuations are run to
+ * completion before this function returns. Otherwise, this may return
+ * with a new closure frame at the top of the frame stack for run() to
+ * pick up */
+static Status startContinuation(ptrdiff_t slotsOffset, i16 argCount, ubool consummate) {
+  i32 base = vm.frameCount;
+  CallFrame *frame;
+
+  if (!checkFrameCount()) {
+    vm.scheduledContinuation = NULL;
+    return STATUS_ERROR;
+  }
+
+  frame = pushFrame();
+  frame->closure = NULL;
+  frame->ip = NULL;
+  frame->slots = vm.stack + slotsOffset;
+  frame->argCount = argCount;
+
+  if (!consummate) {
+    return driveContinuation();
+  }
+
+  if (!driveContinuation() && !recoverFromError(base)) {
+    return STATUS_ERROR;
+  }
+  if (vm.frameCount > base) {
+    return run(base);
+  }
+  return STATUS_OK;
+}
+
+/* Runs bytecode until the frame at index 'returnFrameCount' returns.
+ * The frame at the top of the frame stack must be a closure frame */
+static Status runFrames(i32 returnFrameCount) {
+  CallFrame *frame = VM_FRAME(vm.frameCount - 1);
 
 #define READ_BYTE() (*frame->ip++)
 #define READ_SHORT() \
@@ -645,14 +971,14 @@ static Status run(void) {
     if (!invoke(methodName, argCount)) {   \
       return STATUS_ERROR;                 \
     }                                      \
-    frame = &vm.frames[vm.frameCount - 1]; \
+    frame = VM_FRAME(vm.frameCount - 1); \
   } while (0)
 #define INVOKE_KW(methodName, argCount)            \
   do {                                             \
     if (!invokeWithKwArgs(methodName, argCount)) { \
       return STATUS_ERROR;                         \
     }                                              \
-    frame = &vm.frames[vm.frameCount - 1];         \
+    frame = VM_FRAME(vm.frameCount - 1);         \
   } while (0)
 #define CALL(argCount)                     \
   do {                                     \
@@ -660,7 +986,7 @@ static Status run(void) {
     if (!setupOrCallValue(peek(ac), ac)) { \
       return STATUS_ERROR;                 \
     }                                      \
-    frame = &vm.frames[vm.frameCount - 1]; \
+    frame = VM_FRAME(vm.frameCount - 1); \
   } while (0)
 #define CALL_KW(argCount)                  \
   do {                                     \
@@ -668,7 +994,7 @@ static Status run(void) {
     if (!callFunctionWithKwArgs(ac)) {     \
       return STATUS_ERROR;                 \
     }                                      \
-    frame = &vm.frames[vm.frameCount - 1]; \
+    frame = VM_FRAME(vm.frameCount - 1); \
   } while (0)
 #define BINARY_OP(opexpr, invokeStr)                 \
   do {                                               \
@@ -813,10 +1139,11 @@ static Status run(void) {
             if (!callFunctionOrMethod(getter, 0, UFALSE)) {
               return STATUS_ERROR;
             }
+            frame = VM_FRAME(vm.frameCount - 1);
             break;
           } else if (cls->getattr) {
             push(valString(name));
-            if (!callCFunction(cls->getattr, 1)) {
+            if (!callCFunction(cls->getattr, 1, UTRUE)) {
               return STATUS_ERROR;
             }
             break;
@@ -860,12 +1187,13 @@ static Status run(void) {
             if (!callFunctionOrMethod(setter, 1, UFALSE)) {
               return STATUS_ERROR;
             }
+            frame = VM_FRAME(vm.frameCount - 1);
             break;
           } else if (cls->setattr) {
             value = pop();
             push(valString(name));
             push(value);
-            if (!callCFunction(cls->setattr, 2)) {
+            if (!callCFunction(cls->setattr, 2, UTRUE)) {
               return STATUS_ERROR;
             }
             break;
@@ -1038,8 +1366,9 @@ static Status run(void) {
           i32 step = iter->as.range.step;
           if (step > 0 ? (iter->extra.integer < iter->as.range.stop)
                        : (iter->extra.integer > iter->as.range.stop)) {
-            push(valNumber(iter->extra.integer));
+            i32 current = iter->extra.integer;
             iter->extra.integer += step;
+            push(valNumber(current));
           } else {
             push(valStopIteration());
           }
@@ -1072,7 +1401,7 @@ static Status run(void) {
         if (!invokeFromClass(superclass, method, argCount)) {
           return STATUS_ERROR;
         }
-        frame = &vm.frames[vm.frameCount - 1];
+        frame = VM_FRAME(vm.frameCount - 1);
         break;
       }
       case OP_CALL_KW: {
@@ -1119,7 +1448,7 @@ static Status run(void) {
           vm.stackTop = frame->slots;
           push(result);
           if (vm.frameCount > 0) {
-            frame = &vm.frames[vm.frameCount - 1];
+            frame = VM_FRAME(vm.frameCount - 1);
           }
 
           return STATUS_OK;
@@ -1127,7 +1456,16 @@ static Status run(void) {
 
         vm.stackTop = frame->slots;
         push(result);
-        frame = &vm.frames[vm.frameCount - 1];
+        if (VM_FRAME(vm.frameCount - 1)->closure == NULL) {
+          /* returning to a CFunction waiting on a scheduled call */
+          if (!settleContinuations(returnFrameCount)) {
+            return STATUS_ERROR;
+          }
+          if (vm.frameCount == returnFrameCount) {
+            return STATUS_OK;
+          }
+        }
+        frame = VM_FRAME(vm.frameCount - 1);
         break;
       }
       case OP_IMPORT: {
@@ -1222,6 +1560,21 @@ static Status run(void) {
 #undef READ_BYTE
 }
 
+/* Runs until the frame at index 'returnFrameCount' returns.
+ * Errors are recovered from by continuations above that frame where
+ * possible */
+static Status run(i32 returnFrameCount) {
+  while (!runFrames(returnFrameCount)) {
+    if (!recoverFromError(returnFrameCount)) {
+      return STATUS_ERROR;
+    }
+    if (vm.frameCount == returnFrameCount) {
+      break;
+    }
+  }
+  return STATUS_OK;
+}
+
 /* Runs true on success, false otherwise */
 Status interpret(const char *source, ObjModule *module) {
   ObjClosure *closure;
@@ -1243,7 +1596,7 @@ static Status callClass(ObjClass *klass, i16 argCount, ubool consummate) {
   Value initializer;
 
   if (klass->instantiate) {
-    return callCFunction(klass->instantiate, argCount);
+    return callCFunction(klass->instantiate, argCount, consummate);
   } else if (klass->isBuiltinClass) {
     /* builtin class */
     runtimeError("Builtin class %s does not support being called",
@@ -1266,7 +1619,7 @@ static Status callClass(ObjClass *klass, i16 argCount, ubool consummate) {
         return STATUS_ERROR;
       }
       if (consummate) {
-        return run();
+        return run(vm.frameCount - 1);
       }
       return STATUS_OK;
     } else if (argCount != 0) {
@@ -1286,7 +1639,7 @@ static Status callClass(ObjClass *klass, i16 argCount, ubool consummate) {
  * any value.
  */
 static Status callClosure(ObjClosure *closure, i16 argCount) {
-  return setupCallClosure(closure, argCount) && run();
+  return setupCallClosure(closure, argCount) && run(vm.frameCount - 1);
 }
 
 /*
@@ -1309,7 +1662,7 @@ static Status callClosure(ObjClosure *closure, i16 argCount) {
 static Status callFunctionOrMethod(Value callable, i16 argCount, ubool consummate) {
   if (isCFunction(callable)) {
     CFunction *cfunc = callable.as.cfunction;
-    return callCFunction(cfunc, argCount);
+    return callCFunction(cfunc, argCount, consummate);
   } else if (isObj(callable)) {
     switch (OBJ_TYPE(callable)) {
       case OBJ_CLASS:
@@ -1321,7 +1674,7 @@ static Status callFunctionOrMethod(Value callable, i16 argCount, ubool consummat
       case OBJ_NATIVE: {
         ObjNative *n = AS_NATIVE_UNSAFE(callable);
         if (n->descriptor->klass->call) {
-          return callCFunction(n->descriptor->klass->call, argCount);
+          return callCFunction(n->descriptor->klass->call, argCount, consummate);
         }
         break;
       }
@@ -7,8 +7,18 @@
 #include "mtots_m_bmon.h"
 #include "mtots_m_sys.h"
 
-#define FRAMES_MAX 64
-#define STACK_MAX (FRAMES_MAX * U8_COUNT)
+/* CallFrames live in fixed size blocks so that a CallFrame never moves
+ * once allocated, even as the number of frames grows */
+#define FRAMES_PER_BLOCK 64
+#define DEFAULT_MAX_FRAME_COUNT 8192
+
+/* The value stack is reallocated as needed. A call to a closure makes
+ * sure that its thunk's maxStackSize slots are free, and a call to a
+ * CFunction that at least this many are. So push() only checks for
+ * overflow in debug builds */
+#define STACK_INITIAL_CAPACITY (16 * U8_COUNT)
+#define STACK_FRAME_RESERVE (4 * U8_COUNT)
+
 #define MAX_ERROR_STRING_LENGTH 2048
 #define SIGNAL_HANDLERS_COUNT 32
 
@@ -23,17 +33,40 @@
     vm.localGCPause = flag;    \
   } while (0)
 
+/* A CallFrame is either a closure's frame, or a continuation frame
+ * for a CFunction that is waiting on a call it scheduled with
+ * 'scheduleCall'. Continuation frames have a NULL closure, and their
+ * slots start at the CFunction's own slot */
 typedef struct CallFrame {
   ObjClosure *closure;
   u8 *ip;
   Value *slots;
+  NativeContinuation *continuation;
+  i16 argCount;  /* continuation frames only */
+  i32 stackSize; /* continuation frames only */
 } CallFrame;
 
+#define VM_FRAME(i)                             \
+  (&vm.frameBlocks[(u32)(i) / FRAMES_PER_BLOCK] \
+                  [(u32)(i) % FRAMES_PER_BLOCK])
+
 typedef struct VM {
-  CallFrame frames[FRAMES_MAX];
-  i16 frameCount;
-  Value stack[STACK_MAX];
+  CallFrame **frameBlocks;
+  i32 frameBlockCount;
+  i32 frameCount;
+  i32 maxFrameCount;
+  Value *stack;
   Value *stackTop;
+  Value *stackEnd;
+
+  /* Stacks that have been replaced by a larger one.
+   * CFunctions that call back into the VM may still be reading their
+   * arguments from an old stack, so these are kept until the VM is freed.
+   * Since the stack grows geometrically, these never add up to more
+   * than the size of the current stack */
+  Value **retiredStacks;
+  size_t retiredStackCount;
+
   Map globals;
   Map modules;            /* all preloaded modules */
   Map nativeModuleThunks; /* Map of CFunctions */
@@ -56,6 +89,8 @@ typedef struct VM {
   ObjClass *rangeClass;
   ObjClass *rangeIteratorClass;
   ObjClass *vectorClass;
+  ObjClass *colorClass;
+  ObjClass *rectClass;
   ObjClass *pointerClass;
   ObjClass *fileDescriptorClass;
   ObjClass *bufferClass;
@@ -68,6 +103,10 @@ typedef struct VM {
 
   ObjUpvalue *openUpvalues;
 
+  /* set by 'scheduleCall' until the VM picks up the call */
+  NativeContinuation *scheduledContinuation;
+  i16 scheduledArgCount;
+
   Memory memory;
   ubool enableGCLogs;
   ubool enableMallocFreeLogs;
@@ -88,6 +127,10 @@ void freeVM(void);
 Status interpret(const char *source, ObjModule *module);
 void defineGlobal(const char *name, Value value);
 void closeUpvalues(Value *last);
+Status setMaxFrameCount(i32 maxFrameCount);
+
+/* nil, false and 0 are falsey, everything else is truthy */
+ubool isFalsey(Value value);
 
 Status checkAndHandleSignals(void);
 